@@ -0,0 +1,758 @@
+// 环形缓冲区的用户态单元测试和基准测试，直接编译驱动的ring.c
+// 在Linux上编译运行：
+//     cc -O2 -Wall -Wextra -pthread -o ring_bench ring_bench.c
+//     ./ring_bench [megabytes]
+// 先检查槽的状态和读写游标：FIFO顺序、部分读取、槽满和MemoryCap、分配失败、回绕、内存预留的归还，以及多个写者和读者并发时每次写入恰好被读到一次
+// 再测量同一个线程写读和一个写线程对一个读线程时的吞吐量
+// 自旋锁用pthread互斥量代替，块的缓冲区用malloc分配，跟踪为空操作
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 驱动使用的类型和宏
+typedef void VOID, *PVOID;
+typedef uint8_t BOOLEAN;
+typedef uint8_t UCHAR, *PUCHAR;
+typedef uint32_t ULONG, *PULONG;
+typedef int32_t LONG, NTSTATUS;
+typedef uint8_t KIRQL;
+typedef pthread_mutex_t KSPIN_LOCK;
+
+#define IN
+#define OUT
+#define ANYSIZE_ARRAY		1
+#define FIELD_OFFSET(Type, Field)	((ULONG)offsetof(Type, Field))
+#define NT_SUCCESS(Status)	((NTSTATUS)(Status) >= 0)
+
+#define STATUS_SUCCESS					((NTSTATUS)0x00000000L)
+#define STATUS_DEVICE_BUSY				((NTSTATUS)0x80000011L)
+#define STATUS_INVALID_PARAMETER		((NTSTATUS)0xC000000DL)
+#define STATUS_INSUFFICIENT_RESOURCES	((NTSTATUS)0xC000009AL)
+#define STATUS_INTEGER_OVERFLOW			((NTSTATUS)0xC0000095L)
+
+#define PAGED_CODE()						((void)0)
+#define ASSERT(Expression)					assert(Expression)
+#define TraceEvents(...)					((void)0)
+#define RtlZeroMemory(Destination, Length)	memset((Destination), 0, (Length))
+#define RtlCopyMemory						memcpy
+
+#define KeInitializeSpinLock(Lock)				((void)pthread_mutex_init((Lock), NULL))
+#define KeAcquireSpinLock(Lock, OldIrql)		((void)(*(OldIrql) = 0), (void)pthread_mutex_lock(Lock))
+#define KeReleaseSpinLock(Lock, OldIrql)		((void)(OldIrql), (void)pthread_mutex_unlock(Lock))
+#define ExAllocatePoolWithTag(Type, Size, Tag)	malloc(Size)
+#define ExFreePool(Buffer)						free(Buffer)
+
+static NTSTATUS
+RtlULongMult(
+	ULONG Multiplicand,
+	ULONG Multiplier,
+	PULONG Result
+)
+{
+	uint64_t product = (uint64_t)Multiplicand * Multiplier;
+
+	if (product > UINT32_MAX) {
+		*Result = UINT32_MAX;
+		return STATUS_INTEGER_OVERFLOW;
+	}
+
+	*Result = (ULONG)product;
+	return STATUS_SUCCESS;
+}
+
+// 缓冲区分配器：记录未归还的缓冲区数和预留的字节数，可以让第N次分配失败
+typedef struct _ECHO_BUFFER_POOL {
+	atomic_long Outstanding;	// 已分配未归还的块
+	atomic_llong Charged;		// 写入者预留、尚未由环形缓冲区归还的字节数
+	atomic_long FailAfter;		// 再成功分配这么多次后失败一次，负数表示不失败
+} ECHO_BUFFER_POOL, *PECHO_BUFFER_POOL;
+
+static PVOID
+EchoBufferAllocate(
+	PECHO_BUFFER_POOL Pool,
+	ULONG Length,
+	PUCHAR SizeClass
+)
+{
+	PVOID buffer;
+
+	if (atomic_load(&Pool->FailAfter) >= 0 && atomic_fetch_sub(&Pool->FailAfter, 1) == 0) {
+		return NULL;
+	}
+
+	buffer = malloc(Length);
+	if (buffer != NULL) {
+		atomic_fetch_add(&Pool->Outstanding, 1);
+	}
+
+	*SizeClass = 0;
+	return buffer;
+}
+
+static VOID
+EchoBufferFree(
+	PECHO_BUFFER_POOL Pool,
+	PVOID Buffer,
+	UCHAR SizeClass
+)
+{
+	(void)SizeClass;
+
+	atomic_fetch_sub(&Pool->Outstanding, 1);
+	free(Buffer);
+}
+
+static VOID
+EchoBufferUncharge(
+	PECHO_BUFFER_POOL Pool,
+	ULONG Bytes
+)
+{
+	atomic_fetch_sub(&Pool->Charged, (long long)Bytes);
+}
+
+#define ECHO_RING_PORTABLE
+#include "../echo/ring.c"
+
+#define BENCH_DEFAULT_MEGABYTES		1024	// 每项基准测试写入的数据总量
+#define BENCH_CHUNK_SIZE			(40 * 1024)	// 驱动的CHUNK_LENGTH
+#define BENCH_SLOT_COUNT			16		// 驱动的ECHO_RING_DEFAULT_SLOT_COUNT
+#define BENCH_MEMORY_CAP			(128 * 1024 * 1024)
+
+#define TEST_WRITES					20000	// 并发测试中每个写线程的写入次数
+#define TEST_WRITERS				2
+#define TEST_READERS				2
+
+static int Failures;
+
+#define CHECK(Expression) \
+	do { \
+		if (!(Expression)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #Expression); \
+			Failures++; \
+		} \
+	} while (0)
+
+static ECHO_BUFFER_POOL Pool;
+
+// 第Write次写入的第Offset个字节
+static UCHAR
+PatternByte(
+	ULONG Write,
+	ULONG Offset
+)
+{
+	return (UCHAR)(Write * 31 + Offset * 7 + (Offset >> 8));
+}
+
+static void
+FillPattern(
+	PUCHAR Buffer,
+	ULONG Write,
+	ULONG Length
+)
+{
+	ULONG i;
+
+	for (i = 0; i < Length; i++) {
+		Buffer[i] = PatternByte(Write, i);
+	}
+}
+
+// 与驱动的写路径相同：先预留再写入，失败时由调用者归还预留
+static NTSTATUS
+ChargedWrite(
+	PECHO_RING Ring,
+	PVOID Buffer,
+	ULONG Length
+)
+{
+	NTSTATUS status;
+
+	atomic_fetch_add(&Pool.Charged, (long long)Length);
+
+	status = EchoRingWrite(Ring, Buffer, Length);
+	if (!NT_SUCCESS(status)) {
+		EchoBufferUncharge(&Pool, Length);
+	}
+
+	return status;
+}
+
+// 以每次最多Piece字节读完第Write次写入的Length字节，检查每次读取的长度和数据
+static void
+ReadBack(
+	PECHO_RING Ring,
+	ULONG Write,
+	ULONG Length,
+	ULONG Piece
+)
+{
+	UCHAR buffer[4096];
+	ULONG offset = 0;
+	ULONG expected;
+	ULONG bytesRead;
+	ULONG i;
+
+	while (offset < Length) {
+		expected = (Length - offset < Piece) ? Length - offset : Piece;
+		bytesRead = EchoRingRead(Ring, buffer, Piece);
+		CHECK(bytesRead == expected);
+		if (bytesRead != expected) {
+			return;
+		}
+
+		for (i = 0; i < bytesRead; i++) {
+			if (buffer[i] != PatternByte(Write, offset + i)) {
+				printf("write %u offset %u: data differs\n", Write, offset + i);
+				Failures++;
+				return;
+			}
+		}
+
+		offset += bytesRead;
+	}
+}
+
+static void
+TestParameters(
+	void
+)
+{
+	ECHO_RING ring;
+	UCHAR byte = 0;
+
+	CHECK(EchoRingInitialize(&ring, 0, 64, 4096, &Pool) == STATUS_INVALID_PARAMETER);
+	CHECK(EchoRingInitialize(&ring, 4, ECHO_CHUNK_HEADER_SIZE, 4096, &Pool) == STATUS_INVALID_PARAMETER);
+	CHECK(EchoRingInitialize(&ring, 4, 64, 0, &Pool) == STATUS_INVALID_PARAMETER);
+	CHECK(EchoRingInitialize(&ring, 0x40000000, 64, 4096, &Pool) == STATUS_INTEGER_OVERFLOW);
+
+	CHECK(EchoRingInitialize(&ring, 4, 64, 4096, &Pool) == STATUS_SUCCESS);
+	CHECK(EchoRingWrite(&ring, &byte, 0) == STATUS_INVALID_PARAMETER);
+	CHECK(EchoRingWrite(&ring, &byte, 4097) == STATUS_INVALID_PARAMETER);
+	CHECK(EchoRingRead(&ring, &byte, 1) == 0);
+	EchoRingCleanup(&ring);
+}
+
+// 块链的每种形状：不足一块、正好一块、跨块边界和多块，再以不同的长度分段读取
+static void
+TestFifo(
+	void
+)
+{
+	static const ULONG lengths[] = { 1, 7, 64 - ECHO_CHUNK_HEADER_SIZE, 64 - ECHO_CHUNK_HEADER_SIZE + 1, 200, 1000, 4000 };
+	static const ULONG pieces[] = { 1, 13, 56, 4096 };
+	UCHAR buffer[4096];
+	ECHO_RING ring;
+	size_t p, w;
+
+	CHECK(EchoRingInitialize(&ring, 8, 64, 8192, &Pool) == STATUS_SUCCESS);
+
+	for (p = 0; p < sizeof(pieces) / sizeof(pieces[0]); p++) {
+
+		for (w = 0; w < sizeof(lengths) / sizeof(lengths[0]); w++) {
+			FillPattern(buffer, (ULONG)w, lengths[w]);
+			CHECK(ChargedWrite(&ring, buffer, lengths[w]) == STATUS_SUCCESS);
+		}
+
+		for (w = 0; w < sizeof(lengths) / sizeof(lengths[0]); w++) {
+			ReadBack(&ring, (ULONG)w, lengths[w], pieces[p]);
+		}
+
+		CHECK(EchoRingRead(&ring, buffer, sizeof(buffer)) == 0);
+		CHECK(ring.Count == 0 && ring.StoredBytes == 0);
+	}
+
+	EchoRingCleanup(&ring);
+}
+
+// 槽用完或超过MemoryCap时返回STATUS_DEVICE_BUSY，读走数据后可以再写
+static void
+TestFull(
+	void
+)
+{
+	UCHAR buffer[100];
+	ECHO_RING ring;
+	ULONG i;
+
+	CHECK(EchoRingInitialize(&ring, 4, 64, 100, &Pool) == STATUS_SUCCESS);
+
+	for (i = 0; i < 4; i++) {
+		FillPattern(buffer, i, 10);
+		CHECK(ChargedWrite(&ring, buffer, 10) == STATUS_SUCCESS);
+	}
+
+	CHECK(ChargedWrite(&ring, buffer, 10) == STATUS_DEVICE_BUSY);
+
+	ReadBack(&ring, 0, 10, 10);
+	FillPattern(buffer, 4, 10);
+	CHECK(ChargedWrite(&ring, buffer, 10) == STATUS_SUCCESS);
+
+	for (i = 1; i < 5; i++) {
+		ReadBack(&ring, i, 10, 10);
+	}
+
+	FillPattern(buffer, 5, 60);
+	CHECK(ChargedWrite(&ring, buffer, 60) == STATUS_SUCCESS);
+	CHECK(ChargedWrite(&ring, buffer, 50) == STATUS_DEVICE_BUSY);
+	FillPattern(buffer, 6, 40);
+	CHECK(ChargedWrite(&ring, buffer, 40) == STATUS_SUCCESS);
+	CHECK(ring.StoredBytes == 100);
+
+	ReadBack(&ring, 5, 60, 100);
+	ReadBack(&ring, 6, 40, 100);
+
+	EchoRingCleanup(&ring);
+}
+
+// 复制到一半时分配失败：块链全部归还，该槽以长度0提交，读请求跳过它
+static void
+TestAllocationFailure(
+	void
+)
+{
+	UCHAR buffer[1000];
+	ECHO_RING ring;
+	long outstanding;
+
+	CHECK(EchoRingInitialize(&ring, 4, 64, 4096, &Pool) == STATUS_SUCCESS);
+
+	FillPattern(buffer, 0, 100);
+	CHECK(ChargedWrite(&ring, buffer, 100) == STATUS_SUCCESS);
+
+	outstanding = atomic_load(&Pool.Outstanding);
+	atomic_store(&Pool.FailAfter, 3);
+	FillPattern(buffer, 1, 1000);
+	CHECK(ChargedWrite(&ring, buffer, 1000) == STATUS_INSUFFICIENT_RESOURCES);
+	atomic_store(&Pool.FailAfter, -1);
+
+	CHECK(atomic_load(&Pool.Outstanding) == outstanding);
+	CHECK(ring.StoredBytes == 100 && ring.Count == 2);
+
+	FillPattern(buffer, 2, 300);
+	CHECK(ChargedWrite(&ring, buffer, 300) == STATUS_SUCCESS);
+
+	ReadBack(&ring, 0, 100, 4096);
+	ReadBack(&ring, 2, 300, 4096);
+	CHECK(ring.Count == 0 && ring.StoredBytes == 0);
+
+	EchoRingCleanup(&ring);
+}
+
+// 占用的顺序就是读取的顺序：后占用的槽先提交时，读请求仍在先占用、尚未提交的槽处停下
+static void
+TestReserveOrder(
+	void
+)
+{
+	UCHAR buffer[200];
+	ECHO_RING ring;
+	PECHO_SLOT first;
+	PECHO_SLOT second;
+
+	CHECK(EchoRingInitialize(&ring, 4, 64, 4096, &Pool) == STATUS_SUCCESS);
+	CHECK(EchoRingIsEmpty(&ring));
+
+	atomic_fetch_add(&Pool.Charged, 300);
+	CHECK(EchoRingReserve(&ring, 100, &first) == STATUS_SUCCESS);
+	CHECK(EchoRingReserve(&ring, 200, &second) == STATUS_SUCCESS);
+	CHECK(!EchoRingIsEmpty(&ring));
+
+	FillPattern(buffer, 1, 200);
+	CHECK(EchoRingCommit(&ring, second, buffer, 200) == STATUS_SUCCESS);
+	CHECK(EchoRingRead(&ring, buffer, sizeof(buffer)) == 0);
+
+	FillPattern(buffer, 0, 100);
+	CHECK(EchoRingCommit(&ring, first, buffer, 100) == STATUS_SUCCESS);
+
+	ReadBack(&ring, 0, 100, 4096);
+	ReadBack(&ring, 1, 200, 4096);
+	CHECK(EchoRingIsEmpty(&ring));
+	CHECK(ring.Count == 0 && ring.StoredBytes == 0);
+
+	EchoRingCleanup(&ring);
+}
+
+// 槽数很少时反复回绕，写入和读取的长度都在变化
+static void
+TestWrap(
+	void
+)
+{
+	UCHAR buffer[512];
+	ECHO_RING ring;
+	ULONG written = 0;
+	ULONG read = 0;
+	ULONG lengths[3];
+	ULONG round;
+
+	CHECK(EchoRingInitialize(&ring, 3, 64, 4096, &Pool) == STATUS_SUCCESS);
+
+	srand(1);
+
+	for (round = 0; round < 10000; round++) {
+
+		while (written - read < 3) {
+			lengths[written % 3] = 1 + (ULONG)rand() % sizeof(buffer);
+			FillPattern(buffer, written, lengths[written % 3]);
+			if (ChargedWrite(&ring, buffer, lengths[written % 3]) != STATUS_SUCCESS) {
+				break;
+			}
+			written++;
+		}
+
+		CHECK(ChargedWrite(&ring, buffer, 1) == STATUS_DEVICE_BUSY);
+
+		ReadBack(&ring, read, lengths[read % 3], 1 + (ULONG)rand() % 100);
+		read++;
+	}
+
+	while (read < written) {
+		ReadBack(&ring, read, lengths[read % 3], 4096);
+		read++;
+	}
+
+	CHECK(ring.Count == 0 && ring.StoredBytes == 0);
+
+	EchoRingCleanup(&ring);
+}
+
+// 归还环形缓冲区时，未读取的块和它们的预留一起归还
+static void
+TestCleanup(
+	void
+)
+{
+	UCHAR buffer[1000];
+	ECHO_RING ring;
+
+	CHECK(EchoRingInitialize(&ring, 4, 64, 4096, &Pool) == STATUS_SUCCESS);
+
+	FillPattern(buffer, 0, 1000);
+	CHECK(ChargedWrite(&ring, buffer, 1000) == STATUS_SUCCESS);
+	CHECK(ChargedWrite(&ring, buffer, 500) == STATUS_SUCCESS);
+	CHECK(ChargedWrite(&ring, buffer, 10) == STATUS_SUCCESS);
+
+	ReadBack(&ring, 0, 1000, 4096);
+	CHECK(EchoRingRead(&ring, buffer, 100) == 100);
+
+	EchoRingCleanup(&ring);
+
+	CHECK(atomic_load(&Pool.Outstanding) == 0);
+	CHECK(atomic_load(&Pool.Charged) == 0);
+	CHECK(ring.Slots == NULL);
+}
+
+// 并发测试：每次写入以写者和序号开头，读者每次读走一整个槽
+// 单个读者时检查每个写者的写入按顺序到达；多个读者时检查每次写入恰好被读到一次
+typedef struct _TEST_CONTEXT {
+	PECHO_RING Ring;
+	ULONG Writer;
+	ULONG Readers;
+	atomic_uint* Seen;
+	atomic_uint* Done;
+} TEST_CONTEXT;
+
+typedef struct _TEST_HEADER {
+	ULONG Writer;
+	ULONG Sequence;
+	ULONG Length;
+} TEST_HEADER;
+
+static void*
+ConcurrentWriter(
+	void* Argument
+)
+{
+	TEST_CONTEXT* context = Argument;
+	UCHAR buffer[2048];
+	TEST_HEADER header;
+	ULONG i;
+
+	header.Writer = context->Writer;
+
+	for (i = 0; i < TEST_WRITES; i++) {
+		header.Sequence = i;
+		header.Length = sizeof(header) + (i * 37 + context->Writer * 101) % (sizeof(buffer) - sizeof(header));
+		memcpy(buffer, &header, sizeof(header));
+		FillPattern(buffer + sizeof(header), context->Writer * TEST_WRITES + i, header.Length - (ULONG)sizeof(header));
+
+		while (ChargedWrite(context->Ring, buffer, header.Length) == STATUS_DEVICE_BUSY) {
+			sched_yield();
+		}
+	}
+
+	atomic_fetch_add(context->Done, 1);
+
+	return NULL;
+}
+
+static void*
+ConcurrentReader(
+	void* Argument
+)
+{
+	TEST_CONTEXT* context = Argument;
+	ULONG next[TEST_WRITERS] = { 0 };
+	UCHAR buffer[2048];
+	TEST_HEADER header;
+	ULONG bytesRead;
+	ULONG i;
+
+	for (;;) {
+
+		bytesRead = EchoRingRead(context->Ring, buffer, sizeof(buffer));
+		if (bytesRead == 0) {
+			if (atomic_load(context->Done) == TEST_WRITERS && context->Ring->Count == 0) {
+				break;
+			}
+			sched_yield();
+			continue;
+		}
+
+		memcpy(&header, buffer, sizeof(header));
+		CHECK(bytesRead == header.Length && header.Writer < TEST_WRITERS && header.Sequence < TEST_WRITES);
+		if (bytesRead != header.Length || header.Writer >= TEST_WRITERS || header.Sequence >= TEST_WRITES) {
+			break;
+		}
+
+		for (i = sizeof(header); i < bytesRead; i++) {
+			if (buffer[i] != PatternByte(header.Writer * TEST_WRITES + header.Sequence, i - (ULONG)sizeof(header))) {
+				printf("writer %u sequence %u: data differs\n", header.Writer, header.Sequence);
+				Failures++;
+				break;
+			}
+		}
+
+		if (context->Readers == 1) {
+			CHECK(header.Sequence == next[header.Writer]);
+			next[header.Writer] = header.Sequence + 1;
+		}
+
+		atomic_fetch_add(&context->Seen[header.Writer * TEST_WRITES + header.Sequence], 1);
+	}
+
+	return NULL;
+}
+
+static void
+TestConcurrent(
+	ULONG Readers
+)
+{
+	pthread_t writers[TEST_WRITERS];
+	pthread_t readers[TEST_READERS];
+	TEST_CONTEXT writerContexts[TEST_WRITERS];
+	TEST_CONTEXT readerContext;
+	atomic_uint* seen = calloc(TEST_WRITERS * TEST_WRITES, sizeof(atomic_uint));
+	atomic_uint done = 0;
+	ECHO_RING ring;
+	ULONG i;
+
+	if (seen == NULL) {
+		printf("Failed to allocate the concurrent test\n");
+		Failures++;
+		return;
+	}
+
+	CHECK(EchoRingInitialize(&ring, 8, 256, 8192, &Pool) == STATUS_SUCCESS);
+
+	readerContext.Ring = &ring;
+	readerContext.Readers = Readers;
+	readerContext.Seen = seen;
+	readerContext.Done = &done;
+
+	for (i = 0; i < Readers; i++) {
+		pthread_create(&readers[i], NULL, ConcurrentReader, &readerContext);
+	}
+
+	for (i = 0; i < TEST_WRITERS; i++) {
+		writerContexts[i] = readerContext;
+		writerContexts[i].Writer = i;
+		pthread_create(&writers[i], NULL, ConcurrentWriter, &writerContexts[i]);
+	}
+
+	for (i = 0; i < TEST_WRITERS; i++) {
+		pthread_join(writers[i], NULL);
+	}
+
+	for (i = 0; i < Readers; i++) {
+		pthread_join(readers[i], NULL);
+	}
+
+	for (i = 0; i < TEST_WRITERS * TEST_WRITES; i++) {
+		if (atomic_load(&seen[i]) != 1) {
+			printf("writer %u sequence %u: read %u times\n", i / TEST_WRITES, i % TEST_WRITES, atomic_load(&seen[i]));
+			Failures++;
+			break;
+		}
+	}
+
+	EchoRingCleanup(&ring);
+	free(seen);
+}
+
+static double
+NowSeconds(
+	void
+)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 基准测试：写线程写入Count次Length字节，读线程以同样的长度读回
+typedef struct _BENCH_CONTEXT {
+	PECHO_RING Ring;
+	ULONG Length;
+	ULONG Count;
+	PUCHAR Buffer;
+} BENCH_CONTEXT;
+
+static void*
+BenchWriter(
+	void* Argument
+)
+{
+	BENCH_CONTEXT* context = Argument;
+	ULONG i;
+
+	for (i = 0; i < context->Count; i++) {
+		while (ChargedWrite(context->Ring, context->Buffer, context->Length) == STATUS_DEVICE_BUSY) {
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+static void
+BenchRun(
+	ULONG Length,
+	ULONG Megabytes,
+	int Threaded
+)
+{
+	BENCH_CONTEXT context;
+	pthread_t writer;
+	ECHO_RING ring;
+	PUCHAR source = malloc(Length);
+	PUCHAR destination = malloc(Length);
+	unsigned long long bytes = 0;
+	ULONG bytesRead;
+	ULONG i;
+	double start;
+	double elapsed;
+
+	if (source == NULL || destination == NULL ||
+		EchoRingInitialize(&ring, BENCH_SLOT_COUNT, BENCH_CHUNK_SIZE, BENCH_MEMORY_CAP, &Pool) != STATUS_SUCCESS) {
+		printf("Failed to set up the benchmark\n");
+		Failures++;
+		free(source);
+		free(destination);
+		return;
+	}
+
+	FillPattern(source, 0, Length);
+
+	context.Ring = &ring;
+	context.Length = Length;
+	context.Count = (ULONG)(((unsigned long long)Megabytes << 20) / Length);
+	context.Buffer = source;
+
+	start = NowSeconds();
+
+	if (Threaded) {
+		pthread_create(&writer, NULL, BenchWriter, &context);
+
+		while (bytes < (unsigned long long)context.Count * Length) {
+			bytesRead = EchoRingRead(&ring, destination, Length);
+			if (bytesRead == 0) {
+				sched_yield();
+			}
+			bytes += bytesRead;
+		}
+
+		pthread_join(writer, NULL);
+	}
+	else {
+		for (i = 0; i < context.Count; i++) {
+			ChargedWrite(&ring, source, Length);
+			bytes += EchoRingRead(&ring, destination, Length);
+		}
+	}
+
+	elapsed = NowSeconds() - start;
+
+	CHECK(bytes == (unsigned long long)context.Count * Length);
+	CHECK(memcmp(source, destination, Length) == 0);
+
+	printf("%-8s %8u %12.1f %10.1f\n",
+		Threaded ? "2 thread" : "1 thread",
+		Length,
+		bytes / elapsed / 1e6,
+		elapsed * 1e9 / context.Count);
+
+	EchoRingCleanup(&ring);
+	free(source);
+	free(destination);
+}
+
+int
+main(
+	int argc,
+	char* argv[]
+)
+{
+	static const ULONG lengths[] = { 64, 4096, 40 * 1024, 256 * 1024 };
+	ULONG megabytes = (argc > 1) ? (ULONG)atoi(argv[1]) : BENCH_DEFAULT_MEGABYTES;
+	size_t l;
+
+	if (megabytes == 0) {
+		megabytes = BENCH_DEFAULT_MEGABYTES;
+	}
+
+	atomic_store(&Pool.FailAfter, -1);
+
+	TestParameters();
+	TestFifo();
+	TestFull();
+	TestAllocationFailure();
+	TestReserveOrder();
+	TestWrap();
+	TestCleanup();
+	TestConcurrent(1);
+	TestConcurrent(TEST_READERS);
+
+	CHECK(atomic_load(&Pool.Outstanding) == 0);
+	CHECK(atomic_load(&Pool.Charged) == 0);
+
+	printf("unit tests: %s\n", (Failures == 0) ? "passed" : "FAILED");
+	if (Failures != 0) {
+		return 1;
+	}
+
+	printf("%-8s %8s %12s %10s\n", "mode", "length", "MB/s", "ns/write");
+
+	for (l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+		BenchRun(lengths[l], megabytes, 0);
+		BenchRun(lengths[l], megabytes, 1);
+	}
+
+	CHECK(atomic_load(&Pool.Outstanding) == 0);
+
+	return (Failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+// 数字转中文转码核心的用户态基准测试，直接编译驱动的transcode.c
+// 在Linux上编译运行：
+//     cc -O2 -o transcode_bench transcode_bench.c
+//     ./transcode_bench [megabytes]
+// 对每种输入长度和数据分布，先与逐字节的参考实现比较输出，再测量原地转码的吞吐量
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 驱动使用的类型和宏
+typedef uint8_t UCHAR, *PUCHAR;
+typedef uint16_t WCHAR;
+typedef uint32_t ULONG;
+typedef int32_t LONG;
+typedef uint64_t ULONG64;
+
+#define IN
+#define OUT
+#define FORCEINLINE static inline
+#define RtlCopyMemory memcpy
+
+#define ECHO_TRANSCODE_PORTABLE
+#include "../echo/transcode.c"
+
+#define BENCH_DEFAULT_MEGABYTES		256		// 每项测试转码的输入总量
+
+typedef ULONG (*PFN_TRANSCODE)(PUCHAR Buffer, ULONG Length);
+
+typedef struct _BENCH_KERNEL {
+	const char* Name;
+	PFN_TRANSCODE Transcode;
+	ULONG Expansion;
+} BENCH_KERNEL;
+
+static const BENCH_KERNEL Kernels[] = {
+	{ "utf16", EchoTranscodeDigitsUtf16, ECHO_TRANSCODE_UTF16_EXPANSION },
+	{ "utf8", EchoTranscodeDigitsUtf8, ECHO_TRANSCODE_UTF8_EXPANSION },
+};
+
+// 输入长度：一次小的读写、典型的读请求和驱动的块长度CHUNK_LENGTH
+static const ULONG Lengths[] = { 64, 1024, 4096, 40 * 1024 };
+
+// 数据分布：数字所占的百分比，以及是否混入非ASCII字节
+typedef struct _BENCH_INPUT {
+	const char* Name;
+	ULONG DigitPercent;
+	ULONG HighPercent;
+} BENCH_INPUT;
+
+static const BENCH_INPUT Inputs[] = {
+	{ "text", 0, 0 },
+	{ "text+10%digits", 10, 0 },
+	{ "digits", 100, 0 },
+	{ "latin1+10%digits", 10, 10 },
+};
+
+// 逐字节的参考实现，输出到另一个缓冲区
+static ULONG
+ReferenceTranscode(
+	const BENCH_KERNEL* Kernel,
+	const UCHAR* Input,
+	ULONG Length,
+	PUCHAR Output
+)
+{
+	ULONG out = 0;
+	ULONG i;
+	ULONG j;
+
+	for (i = 0; i < Length; i++) {
+		if (Kernel->Expansion == ECHO_TRANSCODE_UTF16_EXPANSION) {
+			WCHAR c = EchoDigitUtf16Table[Input[i]];
+			Output[out++] = (UCHAR)c;
+			Output[out++] = (UCHAR)(c >> 8);
+		}
+		else {
+			ULONG entry = EchoDigitUtf8Table[Input[i]];
+			for (j = 0; j < (entry >> 24); j++) {
+				Output[out++] = (UCHAR)(entry >> (8 * j));
+			}
+		}
+	}
+
+	return out;
+}
+
+static void
+FillInput(
+	const BENCH_INPUT* Input,
+	PUCHAR Buffer,
+	ULONG Length,
+	unsigned int Seed
+)
+{
+	ULONG i;
+	ULONG r;
+
+	srand(Seed);
+
+	for (i = 0; i < Length; i++) {
+		r = (ULONG)rand() % 100;
+		if (r < Input->DigitPercent) {
+			Buffer[i] = (UCHAR)('0' + rand() % 10);
+		}
+		else if (r < Input->DigitPercent + Input->HighPercent) {
+			Buffer[i] = (UCHAR)(0x80 + rand() % 0x80);
+		}
+		else {
+			Buffer[i] = (UCHAR)('a' + rand() % 26);
+		}
+	}
+}
+
+static double
+NowSeconds(
+	void
+)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main(
+	int argc,
+	char* argv[]
+)
+{
+	ULONG megabytes = (argc > 1) ? (ULONG)atoi(argv[1]) : BENCH_DEFAULT_MEGABYTES;
+	ULONG maxLength = Lengths[sizeof(Lengths) / sizeof(Lengths[0]) - 1];
+	PUCHAR source = malloc(maxLength);
+	PUCHAR buffer = malloc(maxLength * ECHO_TRANSCODE_UTF8_EXPANSION);
+	PUCHAR expected = malloc(maxLength * ECHO_TRANSCODE_UTF8_EXPANSION);
+	volatile ULONG sink = 0;
+	size_t k, d, l;
+	ULONG iterations;
+	ULONG outLength;
+	ULONG refLength;
+	ULONG n;
+	double start;
+	double elapsed;
+	int failed = 0;
+
+	if (source == NULL || buffer == NULL || expected == NULL) {
+		printf("Failed to allocate buffers\n");
+		return 1;
+	}
+
+	if (megabytes == 0) {
+		megabytes = BENCH_DEFAULT_MEGABYTES;
+	}
+
+	printf("%-6s %-18s %8s %12s %10s\n", "kernel", "input", "length", "MB/s in", "ns/call");
+
+	for (k = 0; k < sizeof(Kernels) / sizeof(Kernels[0]); k++) {
+		for (d = 0; d < sizeof(Inputs) / sizeof(Inputs[0]); d++) {
+			for (l = 0; l < sizeof(Lengths) / sizeof(Lengths[0]); l++) {
+
+				FillInput(&Inputs[d], source, Lengths[l], (unsigned int)(d * 131 + l));
+
+				// 检查原地转码的输出，包括每个不足一个字的长度
+				for (n = Lengths[l] - 9; n <= Lengths[l]; n++) {
+					memcpy(buffer, source, n);
+					outLength = Kernels[k].Transcode(buffer, n);
+					refLength = ReferenceTranscode(&Kernels[k], source, n, expected);
+					if (outLength != refLength || memcmp(buffer, expected, refLength) != 0) {
+						printf("%s %s length %u: output differs from the reference\n", Kernels[k].Name, Inputs[d].Name, n);
+						failed = 1;
+					}
+				}
+
+				// 每次调用前复制输入，复制的开销计入结果，与驱动中先从环形缓冲区复制再转码相同
+				iterations = (ULONG)(((unsigned long long)megabytes << 20) / Lengths[l]);
+				start = NowSeconds();
+
+				for (n = 0; n < iterations; n++) {
+					memcpy(buffer, source, Lengths[l]);
+					sink += Kernels[k].Transcode(buffer, Lengths[l]);
+				}
+
+				elapsed = NowSeconds() - start;
+
+				printf("%-6s %-18s %8u %12.1f %10.1f\n",
+					Kernels[k].Name,
+					Inputs[d].Name,
+					Lengths[l],
+					(double)iterations * Lengths[l] / elapsed / 1e6,
+					elapsed * 1e9 / iterations);
+			}
+		}
+	}
+
+	free(source);
+	free(buffer);
+	free(expected);
+
+	return failed;
+}
@@ -0,0 +1,385 @@
+#include "driver.h"
+#include "admission.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoAdmissionInitialize)
+#endif
+
+
+// ʼ׼ƣ׼еΪ
+NTSTATUS
+EchoAdmissionInitialize(
+	OUT PECHO_ADMISSION Admission,
+	IN WDFQUEUE Queue
+)
+{
+	NTSTATUS status;
+	WDF_OBJECT_ATTRIBUTES attributes;
+
+	PAGED_CODE();
+
+	Admission->Lock = NULL;
+	InitializeListHead(&Admission->HandleList);
+	EchoAdmitHandleInitialize(&Admission->Anonymous);
+	Admission->Count = 0;
+	Admission->Running = FALSE;
+	Admission->Rerun = FALSE;
+	Admission->Suspended = FALSE;
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = Queue;
+
+	status = WdfSpinLockCreate(&attributes, &Admission->Lock);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_BUFFER, "WdfSpinLockCreate failed %!STATUS!", status);
+		return status;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+
+// ȡ׼УûļʹAnonymous
+static
+PECHO_ADMIT_HANDLE
+EchoAdmissionGetHandle(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN WDFREQUEST     Request
+)
+{
+	WDFFILEOBJECT fileObject = WdfRequestGetFileObject(Request);
+
+	if (fileObject == NULL) {
+		return &QueueContext->Admission.Anonymous;
+	}
+
+	return &FileGetContext(fileObject)->Admit;
+}
+
+
+// EntryӾ׼ȡ£ûдڵȴʱHandleListȡ£߳Lock
+static
+VOID
+EchoAdmissionRemove(
+	IN PECHO_ADMISSION    Admission,
+	IN PECHO_ADMIT_HANDLE Handle,
+	IN PLIST_ENTRY        Entry
+)
+{
+	RemoveEntryList(Entry);
+	InitializeListHead(Entry);
+	InterlockedDecrement(&Admission->Count);
+
+	if (IsListEmpty(&Handle->Requests)) {
+		RemoveEntryList(&Handle->Entry);
+		InitializeListHead(&Handle->Entry);
+	}
+
+	return;
+}
+
+
+// ȡ¾д󣬴Listϣɵͷ֮ɣ߳Lock
+// ѱȡEchoEvtAdmissionCancel
+static
+VOID
+EchoAdmissionDetach(
+	IN PECHO_ADMISSION    Admission,
+	IN PECHO_ADMIT_HANDLE Handle,
+	IN OUT PLIST_ENTRY    List
+)
+{
+	PLIST_ENTRY entry;
+	WDFREQUEST request;
+
+	while (!IsListEmpty(&Handle->Requests)) {
+
+		entry = Handle->Requests.Flink;
+		EchoAdmissionRemove(Admission, Handle, entry);
+
+		request = (WDFREQUEST)WdfObjectContextGetObject(CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry));
+		if (WdfRequestUnmarkCancelable(request) != STATUS_CANCELLED) {
+			InsertTailList(List, entry);
+		}
+	}
+
+	return;
+}
+
+
+// StatusListϵдûд
+static
+VOID
+EchoAdmissionCompleteList(
+	IN PLIST_ENTRY List,
+	IN NTSTATUS    Status
+)
+{
+	PLIST_ENTRY entry;
+	WDFREQUEST request;
+
+	while (!IsListEmpty(List)) {
+
+		entry = RemoveHeadList(List);
+		InitializeListHead(entry);
+
+		request = (WDFREQUEST)WdfObjectContextGetObject(CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry));
+		WdfRequestCompleteWithInformation(request, Status, 0L);
+	}
+
+	return;
+}
+
+
+// ΪдڴԤԤLengthֽڣɹʱTRUEɵߴ
+// 1 ûдڵȴ׼ʱȡֱԤ
+// 2 LockȰCountһٳԤ黹ڴEchoAdmissionRunһһԷ
+//   дڵȴʱԣǺ
+// 3 Ԥʱþ׼УΪȡFALSErequestEchoAdmissionRunȡص
+// 豸ڹʱȴSTATUS_DEVICE_BUSYɸrequestFALSE
+BOOLEAN
+EchoAdmissionCharge(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	PECHO_ADMISSION admission = &queueContext->Admission;
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+	PECHO_ADMIT_HANDLE handle;
+
+	// 1 ֱԤ
+	if (admission->Count == 0 && EchoBufferCharge(&queueContext->BufferPool, Length)) {
+		return TRUE;
+	}
+
+	requestContext->Buffer = Buffer;
+	requestContext->Length = Length;
+	handle = EchoAdmissionGetHandle(queueContext, Request);
+
+	// 2 һ
+	WdfSpinLockAcquire(admission->Lock);
+
+	InterlockedIncrement(&admission->Count);
+
+	if (IsListEmpty(&admission->HandleList) && EchoBufferCharge(&queueContext->BufferPool, Length)) {
+		InterlockedDecrement(&admission->Count);
+		WdfSpinLockRelease(admission->Lock);
+		return TRUE;
+	}
+
+	if (admission->Suspended) {
+		InterlockedDecrement(&admission->Count);
+		WdfSpinLockRelease(admission->Lock);
+		WdfRequestCompleteWithInformation(Request, STATUS_DEVICE_BUSY, 0L);
+		return FALSE;
+	}
+
+	// 3 ׼УȹΪȡEchoEvtAdmissionCancelڶҵ
+	InsertTailList(&handle->Requests, &requestContext->ListEntry);
+	if (IsListEmpty(&handle->Entry)) {
+		InsertTailList(&admission->HandleList, &handle->Entry);
+	}
+
+	if (WdfRequestMarkCancelableEx(Request, EchoEvtAdmissionCancel) == STATUS_CANCELLED) {
+		EchoAdmissionRemove(admission, handle, &requestContext->ListEntry);
+		WdfSpinLockRelease(admission->Lock);
+		EchoStatsAdd(&queueContext->Stats, Cancels, 1);
+		WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
+		return FALSE;
+	}
+
+	WdfSpinLockRelease(admission->Lock);
+
+	TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_BUFFER, "EchoAdmissionCharge Request 0x%p waits for %u bytes of budget", Request, Length);
+
+	EchoStatsAdd(&queueContext->Stats, AdmissionWaits, 1);
+
+	return FALSE;
+}
+
+
+// ڴ黹ã׼ȴд
+// 1 ûдڵȴʱȡ׼ʱֻټһ
+// 2 LockΪHandleListͷдԤɹȡ£ѸþƵβԤʧʱֹͣ
+// 3 ͷEchoWriteStoreȡµд󣬴ڼ黹ڴRerun׼
+// ʱܳ
+VOID
+EchoAdmissionRun(
+	IN WDFQUEUE   Queue
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	PECHO_ADMISSION admission = &queueContext->Admission;
+	PREQUEST_CONTEXT requestContext;
+	PECHO_ADMIT_HANDLE handle;
+	LIST_ENTRY admitList;
+	PLIST_ENTRY entry;
+	WDFREQUEST request;
+
+	// 1 黹ȹ黹ԤٶȡдȼһٳԤ
+	KeMemoryBarrier();
+	if (admission->Count == 0) {
+		return;
+	}
+
+	InitializeListHead(&admitList);
+
+	WdfSpinLockAcquire(admission->Lock);
+
+	if (admission->Running) {
+		admission->Rerun = TRUE;
+		WdfSpinLockRelease(admission->Lock);
+		return;
+	}
+
+	admission->Running = TRUE;
+
+	do {
+		admission->Rerun = FALSE;
+
+		// 2 ׼
+		while (!IsListEmpty(&admission->HandleList)) {
+
+			handle = CONTAINING_RECORD(admission->HandleList.Flink, ECHO_ADMIT_HANDLE, Entry);
+			entry = handle->Requests.Flink;
+			requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+
+			if (!EchoBufferCharge(&queueContext->BufferPool, requestContext->Length)) {
+				break;
+			}
+
+			EchoAdmissionRemove(admission, handle, entry);
+
+			if (!IsListEmpty(&handle->Entry)) {
+				RemoveEntryList(&handle->Entry);
+				InsertTailList(&admission->HandleList, &handle->Entry);
+			}
+
+			// ѱȡдEchoEvtAdmissionCancelɣ黹ΪԤԤ
+			request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+			if (WdfRequestUnmarkCancelable(request) == STATUS_CANCELLED) {
+				EchoBufferUncharge(&queueContext->BufferPool, requestContext->Length);
+				continue;
+			}
+
+			InsertTailList(&admitList, entry);
+		}
+
+		WdfSpinLockRelease(admission->Lock);
+
+		// 3 ȡµд
+		while (!IsListEmpty(&admitList)) {
+
+			entry = RemoveHeadList(&admitList);
+			InitializeListHead(entry);
+
+			requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+			request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+			TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_BUFFER, "EchoAdmissionRun admits Request 0x%p with %u bytes", request, requestContext->Length);
+
+			EchoWriteStore(Queue, EchoRequestGetChannel(request), request, requestContext->Buffer, requestContext->Length);
+		}
+
+		WdfSpinLockAcquire(admission->Lock);
+
+	} while (admission->Rerun);
+
+	admission->Running = FALSE;
+
+	WdfSpinLockRelease(admission->Lock);
+
+	return;
+}
+
+
+// StatusFileObjectȴ׼д󣬹رվʱ
+// þHandleListͷȡº׼
+VOID
+EchoAdmissionRelease(
+	IN WDFQUEUE      Queue,
+	IN WDFFILEOBJECT FileObject,
+	IN NTSTATUS      Status
+)
+{
+	PECHO_ADMISSION admission = &QueueGetContext(Queue)->Admission;
+	LIST_ENTRY releaseList;
+
+	InitializeListHead(&releaseList);
+
+	WdfSpinLockAcquire(admission->Lock);
+	EchoAdmissionDetach(admission, &FileGetContext(FileObject)->Admit, &releaseList);
+	WdfSpinLockRelease(admission->Lock);
+
+	EchoAdmissionCompleteList(&releaseList, Status);
+
+	EchoAdmissionRun(Queue);
+
+	return;
+}
+
+
+// 豸ʱãеȴ׼д󷵻STATUS_DEVICE_BUSY볬Ԥ㡢ܹʱͬ
+// ˺ֱ豸صD0дٹȴ׼룬ֹͣĬ϶ʱһֱȴ
+VOID
+EchoAdmissionReleaseAll(
+	IN WDFQUEUE   Queue
+)
+{
+	PECHO_ADMISSION admission = &QueueGetContext(Queue)->Admission;
+	LIST_ENTRY releaseList;
+
+	InitializeListHead(&releaseList);
+
+	WdfSpinLockAcquire(admission->Lock);
+
+	admission->Suspended = TRUE;
+
+	while (!IsListEmpty(&admission->HandleList)) {
+		EchoAdmissionDetach(admission,
+			CONTAINING_RECORD(admission->HandleList.Flink, ECHO_ADMIT_HANDLE, Entry),
+			&releaseList);
+	}
+
+	WdfSpinLockRelease(admission->Lock);
+
+	EchoAdmissionCompleteList(&releaseList, STATUS_DEVICE_BUSY);
+
+	return;
+}
+
+
+// ȴ׼дȡʱĻص
+// HandleListͷȡº׼
+VOID
+EchoEvtAdmissionCancel(
+	IN WDFREQUEST Request
+)
+{
+	WDFQUEUE queue = WdfRequestGetIoQueue(Request);
+	PQUEUE_CONTEXT queueContext = QueueGetContext(queue);
+	PECHO_ADMISSION admission = &queueContext->Admission;
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_BUFFER, "EchoEvtAdmissionCancel called on Request 0x%p", Request);
+
+	// ѱȡµListEntryָ
+	WdfSpinLockAcquire(admission->Lock);
+
+	if (!IsListEmpty(&requestContext->ListEntry)) {
+		EchoAdmissionRemove(admission, EchoAdmissionGetHandle(queueContext, Request), &requestContext->ListEntry);
+	}
+
+	WdfSpinLockRelease(admission->Lock);
+
+	EchoStatsAdd(&queueContext->Stats, Cancels, 1);
+
+	WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
+
+	EchoAdmissionRun(queue);
+
+	return;
+}
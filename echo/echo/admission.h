@@ -0,0 +1,74 @@
+#pragma once
+
+// Default device-wide memory budget: all channels together may hold this many bytes of written data
+#define ECHO_DEFAULT_MEMORY_BUDGET		(2ULL * MAX_STORED_LENGTH)
+
+// һ׼УǶļĻ
+// ûдڵȴʱEntryָHandleList
+typedef struct _ECHO_ADMIT_HANDLE {
+
+	LIST_ENTRY Requests;	// þȴ׼д󣬰˳
+	LIST_ENTRY Entry;		// ECHO_ADMISSIONHandleList
+
+} ECHO_ADMIT_HANDLE, *PECHO_ADMIT_HANDLE;
+
+// ڴԤ׼
+// дݽǷҳڴ֮ǰȴӶеĻԤȣԤʱд󣬶Ƿʧ
+// ڴ黹ʱݡ㲥ͷšͨ٣׼룺ÿ׼HandleListͷд
+// ٰѸþƵβһĴд󲻻
+// ͷдԳԤʱֹͣСдԽϴд󲻻ᱻ
+// ׼дͷ֮EchoWriteStore룬ͬһʱֻһ׼УֻҪټһ
+typedef struct _ECHO_ADMISSION {
+
+	WDFSPINLOCK Lock;		// HandleList׼СRunningRerun
+	LIST_ENTRY HandleList;	// дڵȴľ׼
+	ECHO_ADMIT_HANDLE Anonymous;	// ûļд
+	volatile LONG Count;	// ȴ׼ڹд黹ڴ߲
+	BOOLEAN Running;		// ׼
+	BOOLEAN Rerun;			// ׼ڴ黹ټһ
+	volatile BOOLEAN Suspended;	// 豸ڼд󲻹ȴ׼
+
+} ECHO_ADMISSION, *PECHO_ADMISSION;
+
+FORCEINLINE
+VOID
+EchoAdmitHandleInitialize(
+	OUT PECHO_ADMIT_HANDLE Handle
+)
+{
+	InitializeListHead(&Handle->Requests);
+	InitializeListHead(&Handle->Entry);
+}
+
+NTSTATUS
+EchoAdmissionInitialize(
+	OUT PECHO_ADMISSION Admission,
+	IN WDFQUEUE Queue
+);
+
+BOOLEAN
+EchoAdmissionCharge(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+);
+
+VOID
+EchoAdmissionRun(
+	IN WDFQUEUE   Queue
+);
+
+VOID
+EchoAdmissionRelease(
+	IN WDFQUEUE      Queue,
+	IN WDFFILEOBJECT FileObject,
+	IN NTSTATUS      Status
+);
+
+VOID
+EchoAdmissionReleaseAll(
+	IN WDFQUEUE   Queue
+);
+
+EVT_WDF_REQUEST_CANCEL EchoEvtAdmissionCancel;
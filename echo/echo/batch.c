@@ -0,0 +1,223 @@
+#include "driver.h"
+#include "batch.tmh"
+
+
+// ִһдظò״̬͹ڴ滷
+// 1 㲥ģʽжڵȴʱ
+// 2 ڴԤԤдڵȴ׼ʱԽ
+// 3 뻷λ㿽ģʽ¹дģʽµȴռдڸòԽ
+// 4 ѵȴݵĶ
+NTSTATUS
+EchoBatchWrite(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN PECHO_CHANNEL Channel,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+)
+{
+	NTSTATUS status = STATUS_DEVICE_BUSY;
+	PECHO_SLOT slot = NULL;
+	ULONG spilled = 0;
+
+	if (Length > QueueContext->MaxWriteLength) {
+		return STATUS_BUFFER_OVERFLOW;
+	}
+
+	// 1 㲥
+	if (Channel->Broadcast && EchoBroadcastWrite(Channel, Buffer, Length)) {
+		EchoStatsAdd(&QueueContext->Stats, BytesIn, Length);
+		return STATUS_SUCCESS;
+	}
+
+	// 㿽ģʽ¹дڸòȰλȴڴԤԤ
+	if (QueueContext->Config.ZeroCopy) {
+		spilled = EchoForwardSpill(Channel, MAXULONG);
+	}
+
+	// 2 ԤڴԤ
+	if (QueueContext->Admission.Count != 0 || !EchoBufferCharge(&QueueContext->BufferPool, Length)) {
+		if (spilled != 0) {
+			EchoReadWaitWake(Channel);
+		}
+		return STATUS_DEVICE_BUSY;
+	}
+
+	// 3 뻷λ
+	// 㿽ģʽתΪʱųForwardLockռòۣ󲻻Խòֱתд
+	// дʱԽ
+	// ģʽ³StreamLockֻռòۣͷٸ
+	if (QueueContext->Config.ZeroCopy) {
+		WdfSpinLockAcquire(Channel->ForwardLock);
+		if (IsListEmpty(&Channel->ForwardList)) {
+			status = EchoRingReserve(&Channel->Ring, Length, &slot);
+		}
+		WdfSpinLockRelease(Channel->ForwardLock);
+
+		if (NT_SUCCESS(status)) {
+			status = EchoRingCommit(&Channel->Ring, slot, Buffer, Length);
+		}
+	}
+	else if (Channel->Stream) {
+		WdfSpinLockAcquire(Channel->StreamLock);
+		if (IsListEmpty(&Channel->StreamList)) {
+			status = EchoRingReserve(&Channel->Ring, Length, &slot);
+		}
+		WdfSpinLockRelease(Channel->StreamLock);
+
+		if (NT_SUCCESS(status)) {
+			status = EchoRingCommit(&Channel->Ring, slot, Buffer, Length);
+		}
+	}
+	else {
+		status = EchoRingWrite(&Channel->Ring, Buffer, Length);
+	}
+
+	if (!NT_SUCCESS(status)) {
+		EchoBufferUncharge(&QueueContext->BufferPool, Length);
+		if (status == STATUS_INSUFFICIENT_RESOURCES) {
+			EchoStatsAdd(&QueueContext->Stats, AllocationFailures, 1);
+		}
+		if (spilled != 0) {
+			EchoReadWaitWake(Channel);
+		}
+		return status;
+	}
+
+	EchoStatsAdd(&QueueContext->Stats, BytesIn, Length);
+
+	// 4 ѵȴݵĶ
+	EchoReadWaitWake(Channel);
+
+	return STATUS_SUCCESS;
+}
+
+
+// ִһInformationΪȡĳȣ͹ڴ滷
+// 㿽ģʽ»λΪʱֱȡд
+// ͨתʱInformationΪתĳȣڴ滷תڼ䱻ĶʱSTATUS_INVALID_USER_BUFFER
+// ߵڳ˿ռڴԤ㣬ȴռд׼ȴԤд
+NTSTATUS
+EchoBatchRead(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN PECHO_CHANNEL Channel,
+	OUT PVOID     Buffer,
+	IN ULONG      Length,
+	OUT PULONG    Information
+)
+{
+	PCECHO_TRANSFORM transform = Channel->Transform;
+	ULONG bytesRead;
+
+	Length = EchoTransformCapacity(transform, Length);
+
+	bytesRead = Channel->Stream ?
+		EchoStreamRead(Channel, Buffer, Length) :
+		EchoRingRead(&Channel->Ring, Buffer, Length);
+
+	// 㿽ģʽͬλΪʱֱӴӹдȡݣEchoReadServe
+	if (bytesRead == 0 && QueueContext->Config.ZeroCopy) {
+		bytesRead = EchoForwardTake(Channel, Buffer, Length);
+		if (bytesRead == 0) {
+			bytesRead = EchoRingRead(&Channel->Ring, Buffer, Length);
+			if (bytesRead != 0) {
+				EchoReadWaitWake(Channel);
+			}
+		}
+	}
+
+	if (bytesRead != 0) {
+		EchoStreamWake(Channel);
+		EchoAdmissionRun(Channel->Queue);
+		EchoStatsAdd(&QueueContext->Stats, BytesOut, bytesRead);
+	}
+
+	return EchoTransformApply(transform, Buffer, bytesRead, Information);
+}
+
+
+// ִIOCTL_ECHO_BATCH
+// 1 黺뻺ECHO_BATCH_MAX_OPS뻺
+// 2 ˳ִÿԽδ֪ĲSTATUS_INVALID_PARAMETERִк
+// ʧʱִκβɹʱInformationΪĳȣÿĽStatus
+NTSTATUS
+EchoBatchExecute(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	IN size_t     InputBufferLength,
+	IN size_t     OutputBufferLength,
+	OUT PULONG_PTR Information
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	PECHO_CHANNEL channel = EchoRequestGetChannel(Request);
+	PECHO_BATCH batch;
+	PECHO_BATCH_OP op;
+	PUCHAR data;
+	size_t dataOffset;
+	size_t dataLength;
+	NTSTATUS status;
+	ULONG i;
+
+	*Information = 0;
+
+	// 1 黺METHOD_BUFFEREDһϵͳ
+	if (InputBufferLength < FIELD_OFFSET(ECHO_BATCH, Ops) || OutputBufferLength < InputBufferLength) {
+		return STATUS_BUFFER_TOO_SMALL;
+	}
+
+	status = WdfRequestRetrieveInputBuffer(Request, InputBufferLength, (PVOID*)&batch, NULL);
+	if (!NT_SUCCESS(status)) {
+		return status;
+	}
+
+	if (batch->Count > ECHO_BATCH_MAX_OPS) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	dataOffset = ECHO_BATCH_DATA_OFFSET(batch->Count);
+	if (dataOffset > InputBufferLength) {
+		return STATUS_BUFFER_TOO_SMALL;
+	}
+
+	data = (PUCHAR)batch + dataOffset;
+	dataLength = InputBufferLength - dataOffset;
+
+	// 2 ˳ִ
+	for (i = 0; i < batch->Count; i++) {
+
+		op = &batch->Ops[i];
+		op->Information = 0;
+
+		if (op->Offset > dataLength || op->Length > dataLength - op->Offset) {
+			op->Status = STATUS_INVALID_PARAMETER;
+			continue;
+		}
+
+		switch (op->Op) {
+
+		case ECHO_BATCH_OP_WRITE:
+			op->Status = (op->Length == 0) ? STATUS_SUCCESS :
+				EchoBatchWrite(queueContext, channel, data + op->Offset, op->Length);
+			if (NT_SUCCESS(op->Status)) {
+				op->Information = op->Length;
+			}
+			break;
+
+		case ECHO_BATCH_OP_READ:
+			op->Status = EchoBatchRead(queueContext, channel, data + op->Offset, op->Length, &op->Information);
+			break;
+
+		default:
+			op->Status = STATUS_INVALID_PARAMETER;
+			break;
+		}
+	}
+
+	EchoStatsAdd(&queueContext->Stats, BatchOps, batch->Count);
+
+	TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_IO, "EchoBatchExecute Request 0x%p executed %u operations", Request, batch->Count);
+
+	*Information = InputBufferLength;
+
+	return STATUS_SUCCESS;
+}
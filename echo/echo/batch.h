@@ -0,0 +1,33 @@
+#pragma once
+
+// IOCTL_ECHO_BATCHһοа˳ִжд
+// ддһڴԤԤڵͨѵȴݵĶ󣬵ȴ
+// һͨȡ㿽ģʽҲȡдݣݺȴռд׼ȴԤд
+// 㿽ģʽддٴ뻷λݵ˳дͬ
+// ڿϵͳУֻһνں˵ĸ
+
+NTSTATUS
+EchoBatchWrite(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN PECHO_CHANNEL Channel,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+);
+
+NTSTATUS
+EchoBatchRead(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN PECHO_CHANNEL Channel,
+	OUT PVOID     Buffer,
+	IN ULONG      Length,
+	OUT PULONG    Information
+);
+
+NTSTATUS
+EchoBatchExecute(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	IN size_t     InputBufferLength,
+	IN size_t     OutputBufferLength,
+	OUT PULONG_PTR Information
+);
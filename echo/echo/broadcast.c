@@ -0,0 +1,156 @@
+#include "driver.h"
+#include "broadcast.tmh"
+
+
+// һд㲥еȴݵĶֻһ
+// 1 ûжڵȴʱ仺
+// 2 仺ݣдһ
+// 3 ѶȴϵĶȫƵͶÿһãԿɱȡ
+// 4 ͨDPCͶݣͷд
+// FALSEʱûжյݣɵ߰ͨд
+BOOLEAN
+EchoBroadcastWrite(
+	IN PECHO_CHANNEL Channel,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+)
+{
+	PECHO_BROADCAST broadcast;
+	PREQUEST_CONTEXT requestContext;
+	PLIST_ENTRY entry;
+	UCHAR sizeClass;
+	ULONG readers = 0;
+
+	// 1 ûжڵȴ
+	if (Channel->WaitCount == 0) {
+		return FALSE;
+	}
+
+	// 2 仺ݣһʱNULL
+	// һͷ֮ǰռڴԤ㣬Ԥʱͨд׼ƹ
+	if (!EchoBufferCharge(Channel->Ring.Pool, Length)) {
+		return FALSE;
+	}
+
+	broadcast = EchoBufferAllocate(Channel->Ring.Pool, ECHO_BROADCAST_HEADER_SIZE + Length, &sizeClass);
+	if (broadcast == NULL) {
+		EchoBufferUncharge(Channel->Ring.Pool, Length);
+		return FALSE;
+	}
+
+	broadcast->RefCount = 1;
+	broadcast->Length = Length;
+	broadcast->SizeClass = sizeClass;
+	RtlCopyMemory(broadcast->Data, Buffer, Length);
+
+	// 3 ƵͶȡصBroadcastжĸ
+	WdfSpinLockAcquire(Channel->WaitLock);
+
+	while (!IsListEmpty(&Channel->WaitList)) {
+
+		entry = RemoveHeadList(&Channel->WaitList);
+		InterlockedDecrement(&Channel->WaitCount);
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		requestContext->Broadcast = broadcast;
+		InterlockedIncrement(&broadcast->RefCount);
+
+		InsertTailList(&Channel->DeliverList, entry);
+		readers++;
+	}
+
+	WdfSpinLockRelease(Channel->WaitLock);
+
+	TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_IO, "EchoBroadcastWrite %u bytes to %u readers", Length, readers);
+
+	// 4 ͶݣDPCڶʱظŶ
+	if (readers != 0) {
+		WdfDpcEnqueue(Channel->BroadcastDpc);
+	}
+
+	EchoBroadcastRelease(Channel, broadcast);
+
+	return (readers != 0);
+}
+
+
+// ͷһãһͷʱѻ黹б黹ڴԤ
+// 黹Ԥ㹻׼ȴд󣬵ʱܳ
+VOID
+EchoBroadcastRelease(
+	IN PECHO_CHANNEL   Channel,
+	IN PECHO_BROADCAST Broadcast
+)
+{
+	ULONG length;
+
+	if (InterlockedDecrement(&Broadcast->RefCount) == 0) {
+		length = Broadcast->Length;
+		EchoBufferFree(Channel->Ring.Pool, Broadcast, Broadcast->SizeClass);
+		EchoBufferUncharge(Channel->Ring.Pool, length);
+		EchoAdmissionRun(Channel->Queue);
+	}
+
+	return;
+}
+
+
+// ͨͶDPC
+// FIFO˳ȡͶϵĶ󣬸ݺ󽻸棬ͷ
+// ѱȡĶEchoEvtReadWaitCancelɣֻͷ
+VOID
+EchoEvtBroadcastDpc(
+	IN WDFDPC Dpc
+)
+{
+	PECHO_CHANNEL channel = ChannelTimerGetContext(Dpc)->Channel;
+	PQUEUE_CONTEXT queueContext = QueueGetContext(channel->Queue);
+	PREQUEST_CONTEXT requestContext;
+	PECHO_BROADCAST broadcast;
+	PCECHO_TRANSFORM transform;
+	PLIST_ENTRY entry;
+	WDFREQUEST request;
+	NTSTATUS status;
+	ULONG length;
+
+	for (;;) {
+
+		WdfSpinLockAcquire(channel->WaitLock);
+
+		if (IsListEmpty(&channel->DeliverList)) {
+			WdfSpinLockRelease(channel->WaitLock);
+			break;
+		}
+
+		entry = RemoveHeadList(&channel->DeliverList);
+		InitializeListHead(entry);
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+		broadcast = requestContext->Broadcast;
+		requestContext->Broadcast = NULL;
+
+		status = WdfRequestUnmarkCancelable(request);
+
+		WdfSpinLockRelease(channel->WaitLock);
+
+		if (status == STATUS_CANCELLED) {
+			EchoBroadcastRelease(channel, broadcast);
+			continue;
+		}
+
+		// ͨתʱֻתܷŽ
+		transform = channel->Transform;
+		length = min(broadcast->Length, EchoTransformCapacity(transform, requestContext->Length));
+		RtlCopyMemory(requestContext->Buffer, broadcast->Data, length);
+
+		EchoBroadcastRelease(channel, broadcast);
+
+		EchoStatsAdd(&queueContext->Stats, BytesOut, length);
+		status = EchoTransformApply(transform, requestContext->Buffer, length, &length);
+		WdfRequestSetInformation(request, (ULONG_PTR)length);
+		EchoCompletionPend(channel->Queue, request, status);
+	}
+
+	return;
+}
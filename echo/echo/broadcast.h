@@ -0,0 +1,34 @@
+#pragma once
+
+// 㲥ȳͨ򿪹㲥һд뽻˿еȴݵĶ󣬶Ҫ򿪶ȴ
+// дݸһεüĻÿȴĶһãƵͨͶϣȻ
+// ͨDPCݸƵĻǣһͷʱ黹б
+// дĿȴĶ޹أĻдʱֻյǰĲ
+// ûжڵȴд볬һʱͨд֮ͨһ
+
+// һι㲥ݣͷݷͬһӻĻ
+typedef struct _ECHO_BROADCAST {
+
+	volatile LONG RefCount;	// ͶÿһãдͶڼһ
+	ULONG Length;
+	UCHAR SizeClass;		// ûļ
+	UCHAR Data[ANYSIZE_ARRAY];
+
+} ECHO_BROADCAST, *PECHO_BROADCAST;
+
+#define ECHO_BROADCAST_HEADER_SIZE	FIELD_OFFSET(ECHO_BROADCAST, Data)
+
+BOOLEAN
+EchoBroadcastWrite(
+	IN PECHO_CHANNEL Channel,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+);
+
+VOID
+EchoBroadcastRelease(
+	IN PECHO_CHANNEL   Channel,
+	IN PECHO_BROADCAST Broadcast
+);
+
+EVT_WDF_DPC EchoEvtBroadcastDpc;
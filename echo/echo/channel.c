@@ -0,0 +1,335 @@
+#include "driver.h"
+#include "channel.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoChannelInitialize)
+#pragma alloc_text (PAGE, EchoEvtDeviceFileCreate)
+#endif
+
+
+// ʼͨ
+// 1 ʼλ
+// 2 תΪParent
+// 3 תʱΪParentָͨ
+// 4 ȴ͵ȴʱ
+// 5 㲥ͶDPC
+// 6 ģʽдȴ
+// ͨParentǶУ˽ͨParentļͨParentһ
+NTSTATUS
+EchoChannelInitialize(
+	OUT PECHO_CHANNEL Channel,
+	IN WDFQUEUE Queue,
+	IN WDFOBJECT Parent,
+	IN ULONG SlotCount,
+	IN ULONG ChunkSize,
+	IN ULONG MemoryCap,
+	IN PECHO_BUFFER_POOL Pool
+)
+{
+	NTSTATUS status;
+	WDF_OBJECT_ATTRIBUTES lockAttributes;
+	WDF_OBJECT_ATTRIBUTES timerAttributes;
+	WDF_TIMER_CONFIG timerConfig;
+	WDF_DPC_CONFIG dpcConfig;
+
+	PAGED_CODE();
+
+	Channel->Queue = Queue;
+	Channel->ForwardLock = NULL;
+	Channel->ForwardTimer = NULL;
+	InitializeListHead(&Channel->ForwardList);
+	Channel->ForwardCount = 0;
+	Channel->WaitLock = NULL;
+	Channel->WaitTimer = NULL;
+	InitializeListHead(&Channel->WaitList);
+	Channel->WaitCount = 0;
+	Channel->Waking = FALSE;
+	Channel->Rewake = FALSE;
+	Channel->WaitDeadline = 0;
+	Channel->Broadcast = FALSE;
+	Channel->BroadcastDpc = NULL;
+	InitializeListHead(&Channel->DeliverList);
+	Channel->Stream = FALSE;
+	Channel->StreamLock = NULL;
+	InitializeListHead(&Channel->StreamList);
+	Channel->StreamWaitCount = 0;
+	Channel->StreamWaking = FALSE;
+	Channel->StreamRewake = FALSE;
+	Channel->Transform = NULL;
+	InitializeListHead(&Channel->ChannelEntry);
+
+	// 1 ʼλ
+	// ʧʱParentٻصԻEchoChannelCleanupEchoRingCleanupԴδʼĻ
+	status = EchoRingInitialize(&Channel->Ring, SlotCount, ChunkSize, MemoryCap, Pool);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_CHANNEL, "EchoRingInitialize failed %!STATUS!", status);
+		return status;
+	}
+
+	// 2 ת
+	WDF_OBJECT_ATTRIBUTES_INIT(&lockAttributes);
+	lockAttributes.ParentObject = Parent;
+
+	status = WdfSpinLockCreate(&lockAttributes, &Channel->ForwardLock);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_CHANNEL, "WdfSpinLockCreate failed %!STATUS!", status);
+		return status;
+	}
+
+	// 3 תʱһԶʱΪ0
+	// ʱصԼȡForwardLockرAutomaticSerialization
+	WDF_TIMER_CONFIG_INIT_PERIODIC(&timerConfig, EchoEvtForwardTimerFunc, 0);
+	timerConfig.AutomaticSerialization = FALSE;
+
+	WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&timerAttributes, CHANNEL_TIMER_CONTEXT);
+	timerAttributes.ParentObject = Parent;
+
+	status = WdfTimerCreate(&timerConfig, &timerAttributes, &Channel->ForwardTimer);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_CHANNEL, "Error creating forward timer %!STATUS!", status);
+		return status;
+	}
+
+	ChannelTimerGetContext(Channel->ForwardTimer)->Channel = Channel;
+
+	// 4 ȴ͵ȴʱȴʱҲһԶʱ
+	status = WdfSpinLockCreate(&lockAttributes, &Channel->WaitLock);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_CHANNEL, "WdfSpinLockCreate failed %!STATUS!", status);
+		return status;
+	}
+
+	WDF_TIMER_CONFIG_INIT_PERIODIC(&timerConfig, EchoEvtReadWaitTimerFunc, 0);
+	timerConfig.AutomaticSerialization = FALSE;
+
+	status = WdfTimerCreate(&timerConfig, &timerAttributes, &Channel->WaitTimer);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_CHANNEL, "Error creating read wait timer %!STATUS!", status);
+		return status;
+	}
+
+	ChannelTimerGetContext(Channel->WaitTimer)->Channel = Channel;
+
+	// 5 㲥ͶDPCDPCصԼȡWaitLock
+	WDF_DPC_CONFIG_INIT(&dpcConfig, EchoEvtBroadcastDpc);
+	dpcConfig.AutomaticSerialization = FALSE;
+
+	status = WdfDpcCreate(&dpcConfig, &timerAttributes, &Channel->BroadcastDpc);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_CHANNEL, "WdfDpcCreate failed %!STATUS!", status);
+		return status;
+	}
+
+	ChannelTimerGetContext(Channel->BroadcastDpc)->Channel = Channel;
+
+	// 6 ģʽдȴ
+	status = WdfSpinLockCreate(&lockAttributes, &Channel->StreamLock);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_CHANNEL, "WdfSpinLockCreate failed %!STATUS!", status);
+		return status;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+
+// ͨParentٻصе
+// ʱͨѾûͶʱParentһɾ
+VOID
+EchoChannelCleanup(
+	IN PECHO_CHANNEL Channel
+)
+{
+	EchoRingCleanup(&Channel->Ring);
+
+	return;
+}
+
+
+// ȡͨ
+// ûļʹùͨƬʱʹùͨõʱѡķƬͨ
+PECHO_CHANNEL
+EchoRequestGetChannel(
+	IN WDFREQUEST Request
+)
+{
+	WDFFILEOBJECT fileObject = WdfRequestGetFileObject(Request);
+	PECHO_SHARD shard = RequestGetContext(Request)->Shard;
+	PFILE_CONTEXT fileContext;
+
+	if (fileObject == NULL) {
+		return (shard != NULL) ? &shard->Channel : &QueueGetContext(WdfRequestGetIoQueue(Request))->Channel;
+	}
+
+	fileContext = FileGetContext(fileObject);
+
+	if (shard != NULL && fileContext->Channel != &fileContext->PrivateChannel) {
+		return &shard->Channel;
+	}
+
+	return fileContext->Channel;
+}
+
+
+// 豸ʱĻص
+VOID
+EchoEvtDeviceFileCreate(
+	IN WDFDEVICE     Device,
+	IN WDFREQUEST    Request,
+	IN WDFFILEOBJECT FileObject
+)
+/*++
+
+Routine Description:
+
+	This event is called when an application opens a handle to the device.
+	A handle opened with ECHO_PRIVATE_CHANNEL_NAME appended to the interface
+	path, or any handle when the device is in EchoChannelPerHandle mode, gets
+	its own channel in the file-object context. Other handles share the
+	channel of the default queue.
+
+Arguments:
+
+	Device - Handle to a framework device object.
+
+	Request - Handle to the framework request object for the create.
+
+	FileObject - Handle to the framework file object being created.
+
+Return Value:
+
+	VOID
+
+--*/
+{
+	WDFQUEUE queue = WdfDeviceGetDefaultQueue(Device);
+	PQUEUE_CONTEXT queueContext = QueueGetContext(queue);
+	PFILE_CONTEXT fileContext = FileGetContext(FileObject);
+	PUNICODE_STRING fileName = WdfFileObjectGetFileName(FileObject);
+	DECLARE_CONST_UNICODE_STRING(privateName, ECHO_PRIVATE_CHANNEL_NAME);
+	BOOLEAN privateChannel;
+	NTSTATUS status;
+
+	PAGED_CODE();
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_CHANNEL, "EchoEvtDeviceFileCreate Called! FileObject 0x%p FileName %wZ", FileObject, fileName);
+
+	fileContext->Channel = NULL;
+	fileContext->DelayUs = ECHO_REQUEST_DELAY_DEFAULT;
+	fileContext->PriorityClass = EchoPriorityNormal;
+	fileContext->Closing = FALSE;
+	EchoAdmitHandleInitialize(&fileContext->Admit);
+	EchoUringInitialize(&fileContext->Uring);
+
+	// 򿪻صڵߵִ߳УȨ߳зַ
+	fileContext->MayPersist = SeSinglePrivilegeCheck(RtlConvertLongToLuid(SE_LOAD_DRIVER_PRIVILEGE),
+		WdfRequestGetRequestorMode(Request));
+
+	// ֻܿյļECHO_PRIVATE_CHANNEL_NAME
+	if (fileName == NULL || fileName->Length == 0) {
+		privateChannel = (queueContext->Config.ChannelMode == EchoChannelPerHandle);
+	}
+	else if (RtlEqualUnicodeString(fileName, &privateName, TRUE)) {
+		privateChannel = TRUE;
+	}
+	else {
+		WdfRequestComplete(Request, STATUS_OBJECT_NAME_NOT_FOUND);
+		return;
+	}
+
+	if (!privateChannel) {
+		fileContext->Channel = &queueContext->Channel;
+		WdfRequestComplete(Request, STATUS_SUCCESS);
+		return;
+	}
+
+	status = EchoChannelInitialize(&fileContext->PrivateChannel,
+		queue,
+		FileObject,
+		queueContext->Config.SlotCount,
+		queueContext->Config.ChunkSize,
+		queueContext->Config.MemoryCap,
+		&queueContext->BufferPool);
+
+	if (NT_SUCCESS(status)) {
+		fileContext->Channel = &fileContext->PrivateChannel;
+
+		// ڶеChannelListϣ豸ʱͷŸͨϵȴĶ
+		WdfSpinLockAcquire(queueContext->ChannelLock);
+		InsertTailList(&queueContext->ChannelList, &fileContext->PrivateChannel.ChannelEntry);
+		WdfSpinLockRelease(queueContext->ChannelLock);
+	}
+
+	WdfRequestComplete(Request, status);
+
+	return;
+}
+
+
+// رվʱĻص
+// þϵȴݵĶ󲻻ٱдѣSTATUS_CANCELLED
+// þϵȴռ͵ȴ׼дҲSTATUS_CANCELLEDɣǼǵĹڴ滷ע
+// ȹرնȴClosing˺󵽴Ķͻѹʱȡ¡ûжݵĶ󶼲ٹ
+VOID
+EchoEvtFileCleanup(
+	IN WDFFILEOBJECT FileObject
+)
+{
+	PFILE_CONTEXT fileContext = FileGetContext(FileObject);
+	WDFQUEUE queue = WdfDeviceGetDefaultQueue(WdfFileObjectGetDevice(FileObject));
+	PECHO_CHANNEL channel;
+	ULONG i;
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_CHANNEL, "EchoEvtFileCleanup Called! FileObject 0x%p", FileObject);
+
+	if (fileContext->Channel == NULL) {
+		return;
+	}
+
+	fileContext->ReadWait = FALSE;
+	fileContext->Closing = TRUE;
+
+	// ƬʱʹùͨľɢзƬͨ
+	for (i = 0; (channel = EchoShardChannelAt(queue, fileContext->Channel, i)) != NULL; i++) {
+		EchoReadWaitRelease(channel, FileObject, STATUS_CANCELLED);
+		EchoStreamRelease(channel, FileObject, STATUS_CANCELLED);
+	}
+
+	EchoAdmissionRelease(queue, FileObject, STATUS_CANCELLED);
+	EchoUringRelease(queue, FileObject);
+
+	return;
+}
+
+
+// ļʱĻص
+// رպ󣬸þɣ˽ͨӶеChannelListȡ£黹е
+// 黹ڴԤ׼ȴд
+// ʹùͨļPrivateChannelֿ״̬EchoRingCleanupԴδʼĻ
+VOID
+EchoEvtFileContextDestroy(
+	IN WDFOBJECT Object
+)
+{
+	PFILE_CONTEXT fileContext = FileGetContext(Object);
+	PQUEUE_CONTEXT queueContext;
+	WDFQUEUE queue = NULL;
+
+	if (fileContext->Channel == &fileContext->PrivateChannel) {
+		queue = fileContext->PrivateChannel.Queue;
+		queueContext = QueueGetContext(queue);
+
+		WdfSpinLockAcquire(queueContext->ChannelLock);
+		RemoveEntryList(&fileContext->PrivateChannel.ChannelEntry);
+		InitializeListHead(&fileContext->PrivateChannel.ChannelEntry);
+		WdfSpinLockRelease(queueContext->ChannelLock);
+	}
+
+	EchoChannelCleanup(&fileContext->PrivateChannel);
+
+	if (queue != NULL) {
+		EchoAdmissionRun(queue);
+	}
+
+	return;
+}
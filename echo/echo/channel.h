@@ -0,0 +1,97 @@
+#pragma once
+
+// Default channel mode, shared keeps the original behavior for handles opened without a channel name
+#define ECHO_DEFAULT_CHANNEL_MODE	EchoChannelShared
+
+// ͨһĻݴ洢㿽ת״̬
+// 豸ĹͨĬ϶еĻУ˽ͨļĻ
+// ֮ͬͨ䲻ʹøԵͨʱӰ죻ɶеͨ
+typedef struct _ECHO_CHANNEL {
+
+	WDFQUEUE Queue;			// ͨԸöУ
+	ECHO_RING Ring;			// дδ뻷λFIFO˳ʽȡ
+
+	WDFSPINLOCK ForwardLock;	// תתʱ
+	WDFTIMER ForwardTimer;	// һԶʱ㿽ģʽµںѹдλ
+	LIST_ENTRY ForwardList;	// 㿽ģʽµȴд
+	ULONG ForwardCount;
+
+	WDFSPINLOCK WaitLock;	// ȴWaitDeadline͵ȴʱ
+	WDFTIMER WaitTimer;		// һԶʱĵȴ޵
+	LIST_ENTRY WaitList;	// ûݿɶȴдĶ
+	volatile LONG WaitCount;	// д󲻳Ƿжڵȴ
+	BOOLEAN Waking;			// ڻѵȴĶͬһʱֻһѹ
+	BOOLEAN Rewake;			// ѹݵټһ
+	LONGLONG WaitDeadline;	// ȴʱޣжʱ䣩0ʾδ
+
+	BOOLEAN Broadcast;		// д뽻еȴĶIOCTL_ECHO_SET_BROADCAST
+	WDFDPC BroadcastDpc;	// ѹ㲥ݸƵͶϵĶ
+	LIST_ENTRY DeliverList;	// յ㲥ȴͶݵĶWaitLock
+
+	BOOLEAN Stream;			// λΪֽFIFOʱдȴIOCTL_ECHO_SET_STREAM
+	WDFSPINLOCK StreamLock;	// дȴStreamWakingģʽдռò
+	LIST_ENTRY StreamList;	// FIFOȴռд
+	volatile LONG StreamWaitCount;	// ڳд͵ȴд󲻳
+	BOOLEAN StreamWaking;	// ڰѵȴд뻷λͬһʱֻһѹ
+	BOOLEAN StreamRewake;	// ѹڳ˿ռ䣬ټһ
+
+	PCECHO_TRANSFORM Transform;	// ȡݽ֮ǰתNULLʾתIOCTL_ECHO_SET_TRANSFORM
+
+	LIST_ENTRY ChannelEntry;	// ˽ͨڶеChannelListϣ豸ʱͷͨϵȴĶ
+
+} ECHO_CHANNEL, *PECHO_CHANNEL;
+
+// ļĻ
+// ChannelָþʹõͨͨPrivateChannel
+// ReadWaitReadTimeoutMsIOCTL_ECHO_SET_READ_WAIT
+// DelayUsΪECHO_REQUEST_DELAY_DEFAULTʱʹɲԵMaxDelayMs
+typedef struct _FILE_CONTEXT {
+
+	PECHO_CHANNEL Channel;
+	ECHO_CHANNEL PrivateChannel;
+	BOOLEAN ReadWait;		// ûʱȴ
+	ULONG ReadTimeoutMs;	// ȴޣ0ʾһֱȴ
+	ULONG DelayUs;			// EchoCompletionDeadlineģʽ¸þӳ٣IOCTL_ECHO_SET_REQUEST_DELAY
+	ECHO_ADMIT_HANDLE Admit;	// þڴԤ㡢ȴ׼д
+	ECHO_URING Uring;		// þǼǵĹڴ滷IOCTL_ECHO_URING_SETUPǼ
+	ULONG PriorityClass;	// þȼIOCTL_ECHO_SET_PRIORITY
+	BOOLEAN MayPersist;		// 򿪾ĵSeLoadDriverPrivilege԰Ѳдע
+	BOOLEAN Closing;		// ڹرգþĶٹȴEchoEvtFileCleanup
+
+} FILE_CONTEXT, *PFILE_CONTEXT;
+
+WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(FILE_CONTEXT, FileGetContext)
+
+// ͨʱDPCĻ
+typedef struct _CHANNEL_TIMER_CONTEXT {
+
+	PECHO_CHANNEL Channel;
+
+} CHANNEL_TIMER_CONTEXT, *PCHANNEL_TIMER_CONTEXT;
+
+WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(CHANNEL_TIMER_CONTEXT, ChannelTimerGetContext)
+
+NTSTATUS
+EchoChannelInitialize(
+	OUT PECHO_CHANNEL Channel,
+	IN WDFQUEUE Queue,
+	IN WDFOBJECT Parent,
+	IN ULONG SlotCount,
+	IN ULONG ChunkSize,
+	IN ULONG MemoryCap,
+	IN PECHO_BUFFER_POOL Pool
+);
+
+VOID
+EchoChannelCleanup(
+	IN PECHO_CHANNEL Channel
+);
+
+PECHO_CHANNEL
+EchoRequestGetChannel(
+	IN WDFREQUEST Request
+);
+
+EVT_WDF_DEVICE_FILE_CREATE EchoEvtDeviceFileCreate;
+EVT_WDF_FILE_CLEANUP EchoEvtFileCleanup;
+EVT_WDF_OBJECT_CONTEXT_DESTROY EchoEvtFileContextDestroy;
@@ -0,0 +1,471 @@
+#include "driver.h"
+#include "completion.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoCompletionInitialize)
+#endif
+
+
+// ʼһȴɵ󣬸ΪĬ϶Queue
+// 1 ȴ
+// 2 Ϊÿȼ𴴽ȴɵֶ
+// 3 ϲʹõһԶʱ
+// ֶкͶʱĻָ飬ȡصͶʱصݴҵ
+NTSTATUS
+EchoCompletionInitialize(
+	OUT PECHO_PENDING Pending,
+	IN WDFQUEUE Queue
+)
+{
+	NTSTATUS status;
+	WDF_OBJECT_ATTRIBUTES attributes;
+	WDF_IO_QUEUE_CONFIG pendingConfig;
+	WDF_TIMER_CONFIG timerConfig;
+	ULONG i;
+
+	PAGED_CODE();
+
+	RtlZeroMemory(Pending, sizeof(ECHO_PENDING));
+	Pending->Queue = Queue;
+
+	// 1 ȴΪ
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = Queue;
+
+	status = WdfSpinLockCreate(&attributes, &Pending->PendingLock);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_COMPLETION, "WdfSpinLockCreate failed %!STATUS!", status);
+		return status;
+	}
+
+	// 2 Ϊÿȼ𴴽ȴɵֶ
+	// ڶʱɿܸȡȡʱEchoEvtPendingCanceledOnQueueҪMarkCancelable
+	// Ĭ϶һܵԴ豸뿪D0ʱֹͣöУڶУصD0
+	WDF_IO_QUEUE_CONFIG_INIT(&pendingConfig, WdfIoQueueDispatchManual);
+	pendingConfig.EvtIoCanceledOnQueue = EchoEvtPendingCanceledOnQueue;
+
+	for (i = 0; i < ECHO_PRIORITY_CLASSES; i++) {
+
+		WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&attributes, PENDING_CONTEXT);
+
+		status = WdfIoQueueCreate(
+			WdfIoQueueGetDevice(Queue),
+			&pendingConfig,
+			&attributes,
+			&Pending->PendingQueue[i]
+		);
+
+		if (!NT_SUCCESS(status)) {
+			TraceEvents(TRACE_LEVEL_ERROR, TRACE_COMPLETION, "WdfIoQueueCreate for pending queue %u failed %!STATUS!", i, status);
+			return status;
+		}
+
+		PendingGetContext(Pending->PendingQueue[i])->Pending = Pending;
+	}
+
+	// 3 ϲʱһԶʱΪ0
+	// ûͬΧʱصԼȡPendingLockرAutomaticSerialization
+	WDF_TIMER_CONFIG_INIT_PERIODIC(&timerConfig, EchoEvtCoalesceTimerFunc, 0);
+	timerConfig.AutomaticSerialization = FALSE;
+
+	WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&attributes, PENDING_CONTEXT);
+	attributes.ParentObject = Queue;
+
+	status = WdfTimerCreate(&timerConfig, &attributes, &Pending->CoalesceTimer);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_COMPLETION, "Error creating coalesce timer %!STATUS!", status);
+		return status;
+	}
+
+	PendingGetContext(Pending->CoalesceTimer)->Pending = Pending;
+
+	return STATUS_SUCCESS;
+}
+
+
+// һ󣬲¼ɴӳ
+VOID
+EchoCompletionComplete(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN WDFREQUEST     Request,
+	IN NTSTATUS       Status
+)
+{
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+
+	EchoStatsRecordCompletion(&QueueContext->Stats, requestContext->StartTime, requestContext->Class);
+
+	WdfRequestComplete(Request, Status);
+
+	return;
+}
+
+
+// ȡEchoCompletionDeadlineģʽӳ٣us
+// IOCTL_ECHO_SET_REQUEST_DELAYùӳʱʹʹɲԵMaxDelayMs
+static
+ULONG
+EchoCompletionGetDelay(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN WDFREQUEST     Request
+)
+{
+	WDFFILEOBJECT fileObject = WdfRequestGetFileObject(Request);
+	ULONG delayUs;
+
+	if (fileObject != NULL) {
+		delayUs = FileGetContext(fileObject)->DelayUs;
+		if (delayUs != ECHO_REQUEST_DELAY_DEFAULT) {
+			return delayUs;
+		}
+	}
+
+	return QueueContext->Policy.MaxDelayMs * 1000;
+}
+
+
+// ȡȴʱʹõһ飺ڷƬģƬʱе
+FORCEINLINE
+PECHO_PENDING
+EchoCompletionGetPending(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN WDFREQUEST     Request
+)
+{
+	PECHO_SHARD shard = RequestGetContext(Request)->Shard;
+
+	return (shard != NULL) ? &shard->Pending : &QueueContext->Pending;
+}
+
+
+// ϵ󽻸
+// 1 EchoCompletionImmediate
+// 2 EchoCompletionCoalesceתĵȴУһʱɣɱĺϲʱMaxDelayMs
+// 3 EchoCompletionTimerתĵȴУڶʱÿһƬʱƬ
+// 4 EchoCompletionDeadlineʱϣԼӳ֮ɣȴ
+// ӳģʱɲԣģͳķʱʱ
+VOID
+EchoCompletionPend(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	IN NTSTATUS   Status
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+	PECHO_PENDING pending;
+	BOOLEAN drainNow = FALSE;
+	NTSTATUS forwardStatus;
+
+	requestContext->Status = Status;
+
+	// ӳģ͵ķʱɣֽõInformation
+	if (queueContext->Latency.Enabled) {
+		EchoWheelInsert(Queue, Request, EchoLatencySample(&queueContext->Latency, (ULONG)WdfRequestGetInformation(Request)));
+		return;
+	}
+
+	// 1 ɣȴ
+	// ȡModeת֮ټһ
+	if (queueContext->Policy.Mode == EchoCompletionImmediate) {
+		EchoCompletionComplete(queueContext, Request, Status);
+		return;
+	}
+
+	// 4 Լӳ
+	if (queueContext->Policy.Mode == EchoCompletionDeadline) {
+		EchoWheelInsert(Queue, Request, EchoCompletionGetDelay(queueContext, Request));
+		return;
+	}
+
+	// תȴУ˺ɿܸȡ
+	// ܳPendingLockתѱȡתʱ͵EchoEvtPendingCanceledOnQueue
+	pending = EchoCompletionGetPending(queueContext, Request);
+
+	forwardStatus = WdfRequestForwardToIoQueue(Request, pending->PendingQueue[requestContext->Class]);
+	if (!NT_SUCCESS(forwardStatus)) {
+		TraceEvents(TRACE_LEVEL_WARNING, TRACE_COMPLETION, "EchoCompletionPend WdfRequestForwardToIoQueue failed %!STATUS!, completing request 0x%p", forwardStatus, Request);
+		EchoCompletionComplete(queueContext, Request, Status);
+		return;
+	}
+
+	EchoStatsAdd(&queueContext->Stats, Pending, 1);
+
+	WdfSpinLockAcquire(pending->PendingLock);
+
+	pending->PendingCount++;
+
+	// תڼԱлΪɣEchoCompletionSetPolicyѾ˱ĵȴ
+	if (queueContext->Policy.Mode == EchoCompletionImmediate) {
+		drainNow = TRUE;
+	}
+
+	// 2 ϲ
+	else if (queueContext->Policy.Mode == EchoCompletionCoalesce) {
+
+		if (pending->PendingCount >= (LONG)queueContext->Policy.BatchSize) {
+			// һͷȫ
+			WdfTimerStop(pending->CoalesceTimer, FALSE);
+			drainNow = TRUE;
+		}
+		else if (pending->PendingCount == 1) {
+			// ĵһ󣬿ʼʱ
+			WdfTimerStart(pending->CoalesceTimer,
+				WDF_REL_TIMEOUT_IN_MS(queueContext->Policy.MaxDelayMs));
+		}
+	}
+
+	// 3 EchoCompletionTimerģʽEchoEvtTimerFunc
+
+	WdfSpinLockRelease(pending->PendingLock);
+
+	if (drainNow) {
+		EchoCompletionDrain(queueContext, pending, MAXULONG);
+	}
+
+	return;
+}
+
+
+// Ȩתһĸȴȡһû豸D0ʱNULLиPendingLockʱ
+// ǰĶΪʱȡ󣬿۳ֽECHO_PRIORITY_MIN_COST
+// ѿʱֵһõȨ * ECHO_PRIORITY_QUANTUMֽڵĶȣѿյʣĶ
+// ȡٿ۳һʹΪΪһֶȣÿǿյ֮ھͻᱻ
+static
+WDFREQUEST
+EchoCompletionRetrieve(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN PECHO_PENDING  Pending
+)
+{
+	WDFREQUEST request;
+	NTSTATUS status;
+	LONG quantum;
+	LONG cost;
+	ULONG i;
+
+	for (i = 0; i < 3 * ECHO_PRIORITY_CLASSES; i++) {
+
+		if (Pending->Deficit[Pending->Current] > 0) {
+
+			status = WdfIoQueueRetrieveNextRequest(Pending->PendingQueue[Pending->Current], &request);
+			if (NT_SUCCESS(status)) {
+				quantum = (LONG)(QueueContext->PriorityWeights[Pending->Current] * ECHO_PRIORITY_QUANTUM);
+				cost = (LONG)min(max(WdfRequestGetInformation(request), ECHO_PRIORITY_MIN_COST), (ULONG_PTR)MAXLONG / 2);
+				Pending->Deficit[Pending->Current] = max(Pending->Deficit[Pending->Current] - cost, -quantum);
+				return request;
+			}
+
+			// STATUS_WDF_PAUSED豸D0Ķжֹͣ
+			if (status != STATUS_NO_MORE_ENTRIES) {
+				return NULL;
+			}
+
+			Pending->Deficit[Pending->Current] = 0;
+		}
+
+		// ֵһ
+		Pending->Current = (Pending->Current + 1) % ECHO_PRIORITY_CLASSES;
+		Pending->Deficit[Pending->Current] += (LONG)(QueueContext->PriorityWeights[Pending->Current] * ECHO_PRIORITY_QUANTUM);
+	}
+
+	return NULL;
+}
+
+
+// Ȩת˳һȴеMaxCount󣬷ȡĸͬһ󰴵˳
+// иPendingLockʱֶȡͷ
+// ȡٿȡѱȡ󲻻ᱻȡEchoEvtPendingCanceledOnQueue
+// 豸D0ʱȴֹͣȡڶֱ豸صD0
+ULONG
+EchoCompletionDrain(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN PECHO_PENDING  Pending,
+	IN ULONG          MaxCount
+)
+{
+	LIST_ENTRY completeList;
+	PLIST_ENTRY entry;
+	PREQUEST_CONTEXT requestContext;
+	WDFREQUEST request;
+	ULONG count = 0;
+
+	InitializeListHead(&completeList);
+
+	WdfSpinLockAcquire(Pending->PendingLock);
+
+	while (MaxCount > 0) {
+
+		request = EchoCompletionRetrieve(QueueContext, Pending);
+		if (request == NULL) {
+			break;
+		}
+
+		Pending->PendingCount--;
+		MaxCount--;
+		count++;
+
+		// ѲκζУListEntryҪɵ
+		requestContext = RequestGetContext(request);
+		InsertTailList(&completeList, &requestContext->ListEntry);
+	}
+
+	WdfSpinLockRelease(Pending->PendingLock);
+
+	while (!IsListEmpty(&completeList)) {
+
+		entry = RemoveHeadList(&completeList);
+		InitializeListHead(entry);
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+		TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_COMPLETION, "EchoCompletionDrain Completing request 0x%p, Status %!STATUS!", request, requestContext->Status);
+
+		EchoStatsAdd(&QueueContext->Stats, Pending, -1);
+		EchoCompletionComplete(QueueContext, request, requestContext->Status);
+	}
+
+	return count;
+}
+
+
+// ɲǷϷòԺ޸Ĳʱ
+NTSTATUS
+EchoCompletionValidatePolicy(
+	IN PECHO_COMPLETION_POLICY Policy
+)
+{
+	if (Policy->Mode >= EchoCompletionModeMax) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	if (Policy->Mode == EchoCompletionDeadline) {
+		if (Policy->MaxDelayMs > ECHO_MAX_DEADLINE_DELAY) {
+			return STATUS_INVALID_PARAMETER;
+		}
+	}
+
+	if (Policy->Mode == EchoCompletionCoalesce) {
+		if (Policy->MaxDelayMs == 0 || Policy->MaxDelayMs > ECHO_MAX_COALESCE_DELAY ||
+			Policy->BatchSize == 0 || Policy->BatchSize > ECHO_MAX_BATCH_SIZE) {
+			return STATUS_INVALID_PARAMETER;
+		}
+	}
+
+	return STATUS_SUCCESS;
+}
+
+
+// ɲ
+// лʱɲԵȴȫɣʱϵڸԵ
+// ڶеPendingLockд²ԣֹͣƬĺϲʱǵȴ
+// ƬԼڶɲԵĵȴУᱻEchoShardDrainȡ
+NTSTATUS
+EchoCompletionSetPolicy(
+	IN WDFQUEUE               Queue,
+	IN PECHO_COMPLETION_POLICY Policy
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	PECHO_PENDING pending;
+	NTSTATUS status;
+	ULONG i;
+
+	status = EchoCompletionValidatePolicy(Policy);
+	if (!NT_SUCCESS(status)) {
+		return status;
+	}
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_COMPLETION, "EchoCompletionSetPolicy Mode %u MaxDelayMs %u BatchSize %u",
+		Policy->Mode, Policy->MaxDelayMs, Policy->BatchSize);
+
+	WdfSpinLockAcquire(queueContext->Pending.PendingLock);
+
+	WdfTimerStop(queueContext->Pending.CoalesceTimer, FALSE);
+	queueContext->Policy = *Policy;
+
+	WdfSpinLockRelease(queueContext->Pending.PendingLock);
+
+	EchoCompletionDrain(queueContext, &queueContext->Pending, MAXULONG);
+
+	for (i = 0; i < queueContext->ShardCount; i++) {
+		pending = &queueContext->Shards[i].Pending;
+
+		WdfSpinLockAcquire(pending->PendingLock);
+		WdfTimerStop(pending->CoalesceTimer, FALSE);
+		WdfSpinLockRelease(pending->PendingLock);
+	}
+
+	EchoShardDrain(Queue, MAXULONG);
+
+	return STATUS_SUCCESS;
+}
+
+
+// øȼȨأÿȨΪ1 ~ ECHO_MAX_PRIORITY_WEIGHT
+// еĶȲ䣬һֵĳµȨز
+NTSTATUS
+EchoCompletionSetWeights(
+	IN WDFQUEUE               Queue,
+	IN PECHO_PRIORITY_WEIGHTS Weights
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	ULONG i;
+
+	for (i = 0; i < ECHO_PRIORITY_CLASSES; i++) {
+		if (Weights->Weights[i] == 0 || Weights->Weights[i] > ECHO_MAX_PRIORITY_WEIGHT) {
+			return STATUS_INVALID_PARAMETER;
+		}
+	}
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_COMPLETION, "EchoCompletionSetWeights %u %u %u",
+		Weights->Weights[EchoPriorityHigh], Weights->Weights[EchoPriorityNormal], Weights->Weights[EchoPriorityBulk]);
+
+	WdfSpinLockAcquire(queueContext->Pending.PendingLock);
+
+	for (i = 0; i < ECHO_PRIORITY_CLASSES; i++) {
+		queueContext->PriorityWeights[i] = Weights->Weights[i];
+	}
+
+	WdfSpinLockRelease(queueContext->Pending.PendingLock);
+
+	return STATUS_SUCCESS;
+}
+
+
+// ȡøȼȨ
+VOID
+EchoCompletionQueryWeights(
+	IN WDFQUEUE                Queue,
+	OUT PECHO_PRIORITY_WEIGHTS Weights
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	ULONG i;
+
+	WdfSpinLockAcquire(queueContext->Pending.PendingLock);
+
+	for (i = 0; i < ECHO_PRIORITY_CLASSES; i++) {
+		Weights->Weights[i] = queueContext->PriorityWeights[i];
+	}
+
+	WdfSpinLockRelease(queueContext->Pending.PendingLock);
+
+	return;
+}
+
+
+// ϲʱĻصɱ鱾еȴ
+VOID
+EchoEvtCoalesceTimerFunc(
+	IN WDFTIMER     Timer
+)
+{
+	PECHO_PENDING pending = PendingGetContext(Timer)->Pending;
+
+	EchoCompletionDrain(QueueGetContext(pending->Queue), pending, MAXULONG);
+
+	return;
+}
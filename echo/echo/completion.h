@@ -0,0 +1,74 @@
+#pragma once
+
+// 棺дص水豸ɲԾʱ
+// ߣдصȡصʱصصԲִУ
+// ȴɵתһECHO_PENDINGֶPendingQueueɿܸȡ水ȡ
+// ƬʱʹöеPendingƬʱʹڷƬPendingÿԼͺϲʱ
+// EchoCompletionDeadlineģʽºӳģʱڶеʱϣԵʱ
+// ɲɶеPending.PendingLockĵȴͺϲʱɸPendingLock
+// ͷPendingLock֮
+// ÿÿȼԼֶУEchoCompletionDrain֮䰴ȨֽڼƷѵĲת
+
+// 󵽴ʱ¼ȼûļΪEchoPriorityNormal
+FORCEINLINE
+VOID
+EchoCompletionClassify(
+	IN WDFREQUEST Request
+)
+{
+	WDFFILEOBJECT fileObject = WdfRequestGetFileObject(Request);
+
+	RequestGetContext(Request)->Class = (fileObject != NULL) ? FileGetContext(fileObject)->PriorityClass : EchoPriorityNormal;
+}
+
+NTSTATUS
+EchoCompletionInitialize(
+	OUT PECHO_PENDING Pending,
+	IN WDFQUEUE Queue
+);
+
+VOID
+EchoCompletionComplete(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN WDFREQUEST     Request,
+	IN NTSTATUS       Status
+);
+
+VOID
+EchoCompletionPend(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	IN NTSTATUS   Status
+);
+
+ULONG
+EchoCompletionDrain(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN PECHO_PENDING  Pending,
+	IN ULONG          MaxCount
+);
+
+NTSTATUS
+EchoCompletionValidatePolicy(
+	IN PECHO_COMPLETION_POLICY Policy
+);
+
+NTSTATUS
+EchoCompletionSetPolicy(
+	IN WDFQUEUE               Queue,
+	IN PECHO_COMPLETION_POLICY Policy
+);
+
+NTSTATUS
+EchoCompletionSetWeights(
+	IN WDFQUEUE               Queue,
+	IN PECHO_PRIORITY_WEIGHTS Weights
+);
+
+VOID
+EchoCompletionQueryWeights(
+	IN WDFQUEUE                Queue,
+	OUT PECHO_PRIORITY_WEIGHTS Weights
+);
+
+EVT_WDF_TIMER EchoEvtCoalesceTimerFunc;
@@ -1,4 +1,5 @@
 #include "driver.h"
+#include "device.tmh"
 
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text (PAGE, EchoDeviceCreate)
@@ -18,6 +19,10 @@ EchoDeviceCreate(
 )
 {
 	WDF_OBJECT_ATTRIBUTES deviceAttributes;				// 豸
+	WDF_OBJECT_ATTRIBUTES requestAttributes;			// 
+	WDF_OBJECT_ATTRIBUTES fileAttributes;				// ļ
+	WDF_FILEOBJECT_CONFIG fileConfig;					// ļ
+	ECHO_QUEUE_CONFIG queueConfig;						// Ĭ϶е
 	PDEVICE_CONTEXT deviceContext;						// 豸Ļ
 	WDF_PNPPOWER_EVENT_CALLBACKS pnpPowerCallbacks;		// pnpص
 	WDFDEVICE device;
@@ -40,6 +45,23 @@ EchoDeviceCreate(
 	// עpnp͵ԴصԴصĻص֮ע
 	WdfDeviceInitSetPnpPowerEventCallbacks(DeviceInit, &pnpPowerCallbacks);
 
+	// ΪÿREQUEST_CONTEXTȴ
+	WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&requestAttributes, REQUEST_CONTEXT);
+	WdfDeviceInitSetRequestAttributes(DeviceInit, &requestAttributes);
+
+	// ÿļFILE_CONTEXT豸ʱþʹùͨԼͨ
+	// رվʱɸþϵȴݵĶļʱ黹˽ͨе
+	WDF_FILEOBJECT_CONFIG_INIT(&fileConfig, EchoEvtDeviceFileCreate, WDF_NO_EVENT_CALLBACK, EchoEvtFileCleanup);
+	WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&fileAttributes, FILE_CONTEXT);
+	fileAttributes.EvtDestroyCallback = EchoEvtFileContextDestroy;
+	WdfDeviceInitSetFileObjectConfig(DeviceInit, &fileConfig, &fileAttributes);
+
+	ECHO_QUEUE_CONFIG_INIT(&queueConfig);
+	// ParametersעеֵĬ
+	EchoParametersLoad(&queueConfig);
+	// 㿽תҪֱI/OдĻMDLӳûܵм仺ĬʹûI/O
+	WdfDeviceInitSetIoType(DeviceInit, queueConfig.ZeroCopy ? WdfDeviceIoDirect : WdfDeviceIoBuffered);
+
 	// 2 ʼ豸Ժͻ
 	WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&deviceAttributes, DEVICE_CONTEXT);
 
@@ -61,7 +83,7 @@ EchoDeviceCreate(
 
 		if (NT_SUCCESS(status)) {
 			// 5 ʼ
-			status = EchoQueueInitialize(device);
+			status = EchoQueueInitialize(device, &queueConfig);
 		}
 	}
 
@@ -77,18 +99,27 @@ EchoEvtDeviceSelfManagedIoStart(
 )
 {
 	PQUEUE_CONTEXT queueContext = QueueGetContext(WdfDeviceGetDefaultQueue(Device));
-	LARGE_INTEGER DueTime;
+	LARGE_INTEGER start = KeQueryPerformanceCounter(NULL);
 
-	KdPrint(("--> EchoEvtDeviceSelfManagedIoInit\n"));
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DEVICE, "--> EchoEvtDeviceSelfManagedIoStart");
+
+	// ¿Թȴݣģʽд¿Թȴռ䣬д¿Թȴ׼룬½ܹڴ滷ĵǼ
+	queueContext->ReadWaitSuspended = FALSE;
+	queueContext->StreamSuspended = FALSE;
+	queueContext->Wheel.Suspended = FALSE;
+	queueContext->Admission.Suspended = FALSE;
+	queueContext->UringSuspended = FALSE;
 
 	// Ĭ϶
 	WdfIoQueueStart(WdfDeviceGetDefaultQueue(Device));
 
 	// ʱһε100msԺ
-	DueTime.QuadPart = WDF_REL_TIMEOUT_IN_MS(100);
-	WdfTimerStart(queueContext->Timer, DueTime.QuadPart);
+	EchoTickerStart(&queueContext->Ticker);
+
+	queueContext->LastResumeUs = (ULONG64)(KeQueryPerformanceCounter(NULL).QuadPart - start.QuadPart) *
+		1000000 / (ULONG64)queueContext->Stats.Frequency;
 
-	KdPrint(("<-- EchoEvtDeviceSelfManagedIoInit\n"));
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DEVICE, "<-- EchoEvtDeviceSelfManagedIoStart %I64u us", queueContext->LastResumeUs);
 
 	return STATUS_SUCCESS;
 
@@ -103,22 +134,52 @@ EchoEvtDeviceSelfManagedIoSuspend(
 )
 {
 	PQUEUE_CONTEXT queueContext = QueueGetContext(WdfDeviceGetDefaultQueue(Device));
+	LARGE_INTEGER start = KeQueryPerformanceCounter(NULL);
 
 	PAGED_CODE();
 
-	KdPrint(("--> EchoEvtDeviceSelfManagedIoSuspend\n"));
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DEVICE, "--> EchoEvtDeviceSelfManagedIoSuspend");
+
+	queueContext->SuspendCount++;
+	queueContext->StopAcknowledged = 0;
 
 	// 豸ǰδɵI/Oִʽ
 	// 1) ȴδɺٹ
 	// 2) עEvtIoStopصȷ֪ͨܿԹδI/O豸
-	// ʹõһַWdfIoQueueStopSynchronouslyͬʽֹͣ
+	// FastSuspendʱʹõڶַĬ϶ܵԴֹͣеÿEchoEvtIoStop
+	// ֻȷϣԭϣȴģʽ׼͹ڴ滷ڹڼԿԹȴ
+	// λеݱֲ䣻ͨĶʱʱճУֹֻͣɶʱ͸ĺϲʱ
+	// ʹõһַWdfIoQueueStopSynchronouslyͬʽֹͣ
+	// ȴݵĶԶȲдֹ֮ͣǰǷ0ֽ
+	// ģʽµȴռдҲԶȲ󣬷STATUS_DEVICE_BUSYȴ׼дͬ
+	// ʱϵٵȴڣɣڴ滷ĵǼһֱעйڴ滷
 	// WdfIoQueueStopSynchronouslyַֹͣԽգֱɻȡ󣬲ŷ
-	WdfIoQueueStopSynchronously(WdfDeviceGetDefaultQueue(Device));
+	// ѴȴɵڵȴУĬ϶УȴܵԴɿֹͣ豸صD0
+	if (queueContext->Config.FastSuspend) {
+
+		EchoTickerStop(&queueContext->Ticker);
+		WdfTimerStop(queueContext->Pending.CoalesceTimer, TRUE);
+		EchoShardStopTimers(WdfDeviceGetDefaultQueue(Device));
+	}
+	else {
+
+		EchoQueueReleaseWaiters(WdfDeviceGetDefaultQueue(Device));
+		WdfIoQueueStopSynchronously(WdfDeviceGetDefaultQueue(Device));
+
+		// ֹͣʱȴʱصִŷ
+		EchoTickerStop(&queueContext->Ticker);
+		WdfTimerStop(queueContext->Pending.CoalesceTimer, TRUE);
+		EchoShardStopTimers(WdfDeviceGetDefaultQueue(Device));
+		WdfTimerStop(queueContext->Channel.ForwardTimer, TRUE);
+		WdfTimerStop(queueContext->Channel.WaitTimer, TRUE);
+		WdfTimerStop(queueContext->Wheel.Timer, TRUE);
+		queueContext->Wheel.Running = FALSE;
+	}
 
-	// ֹͣʱȴʱصִŷ
-	WdfTimerStop(queueContext->Timer, TRUE);
+	queueContext->LastSuspendUs = (ULONG64)(KeQueryPerformanceCounter(NULL).QuadPart - start.QuadPart) *
+		1000000 / (ULONG64)queueContext->Stats.Frequency;
 
-	KdPrint(("<-- EchoEvtDeviceSelfManagedIoSuspend\n"));
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DEVICE, "<-- EchoEvtDeviceSelfManagedIoSuspend %I64u us", queueContext->LastSuspendUs);
 
 	return STATUS_SUCCESS;
 }
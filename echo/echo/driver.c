@@ -1,5 +1,6 @@
 
 #include "driver.h"
+#include "driver.tmh"
 
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text (INIT, DriverEntry)
@@ -14,8 +15,15 @@ DriverEntry(
 	)
 {
 	WDF_DRIVER_CONFIG config;
+	WDF_OBJECT_ATTRIBUTES attributes;
 	NTSTATUS status;
 
+	// ʼWPP٣ɾʱEchoEvtDriverContextCleanupֹͣ
+	WPP_INIT_TRACING(DriverObject, RegistryPath);
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.EvtCleanupCallback = EchoEvtDriverContextCleanup;
+
 	WDF_DRIVER_CONFIG_INIT(
 		&config, 
 		EchoEvtDeviceAdd);
@@ -23,12 +31,13 @@ DriverEntry(
 	status = WdfDriverCreate(
 		DriverObject, 
 		RegistryPath, 
-		WDF_NO_OBJECT_ATTRIBUTES,
+		&attributes,
 		&config,
 		WDF_NO_HANDLE);
 
 	if (!NT_SUCCESS(status)) {
-		KdPrint(("Error: WdfDriverCreate failed 0x%x\n", status));
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_DRIVER, "WdfDriverCreate failed %!STATUS!", status);
+		WPP_CLEANUP(DriverObject);
 		return status;
 	}
 
@@ -37,6 +46,18 @@ DriverEntry(
 }
 
 
+// ɾʱĻصֹͣWPP
+VOID
+EchoEvtDriverContextCleanup(
+	IN WDFOBJECT DriverObject
+)
+{
+	WPP_CLEANUP(WdfDriverWdmGetDriverObject((WDFDRIVER)DriverObject));
+
+	return;
+}
+
+
 // EvtDeviceAddص豸ִеĵһص
 NTSTATUS
 EchoEvtDeviceAdd(
@@ -50,7 +71,7 @@ EchoEvtDeviceAdd(
 
 	PAGED_CODE();
 
-	KdPrint(("Enter  EchoEvtDeviceAdd\n"));
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DRIVER, "Enter  EchoEvtDeviceAdd");
 
 	// ʵʵĹEchoDeviceCreate
 	status = EchoDeviceCreate(DeviceInit);
@@ -5,8 +5,30 @@
 #include <ntddk.h>
 #include <wdf.h>
 
+#include "trace.h"
+
 #include "device.h"
+#include "lookaside.h"
+#include "stats.h"
+#include "ring.h"
+#include "transcode.h"
+#include "transform.h"
+#include "admission.h"
+#include "uring.h"
+#include "channel.h"
+#include "shard.h"
+#include "wheel.h"
+#include "latency.h"
+#include "ticker.h"
 #include "queue.h"
+#include "completion.h"
+#include "params.h"
+#include "forward.h"
+#include "readwait.h"
+#include "broadcast.h"
+#include "stream.h"
+#include "batch.h"
 
 DRIVER_INITIALIZE DriverEntry;
-EVT_WDF_DRIVER_DEVICE_ADD EchoEvtDeviceAdd;
\ No newline at end of file
+EVT_WDF_DRIVER_DEVICE_ADD EchoEvtDeviceAdd;
+EVT_WDF_OBJECT_CONTEXT_CLEANUP EchoEvtDriverContextCleanup;
\ No newline at end of file
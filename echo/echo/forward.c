@@ -0,0 +1,303 @@
+#include "driver.h"
+#include "forward.tmh"
+
+
+// һд󣬵ȴֱȡ
+// BufferдMDLӳַ֮ǰһֱЧ
+// 1 תΪȡ
+// 2 һдתʱںλ
+// 3 д󳬹ʱһ
+VOID
+EchoForwardPark(
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+)
+{
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+	BOOLEAN spillNow = FALSE;
+
+	requestContext->Buffer = Buffer;
+	requestContext->Length = Length;
+
+	WdfSpinLockAcquire(Channel->ForwardLock);
+
+	// 1 ȹתΪȡEchoEvtForwardCancelҵ
+	InsertTailList(&Channel->ForwardList, &requestContext->ListEntry);
+	Channel->ForwardCount++;
+
+	if (WdfRequestMarkCancelableEx(Request, EchoEvtForwardCancel) == STATUS_CANCELLED) {
+		RemoveEntryList(&requestContext->ListEntry);
+		InitializeListHead(&requestContext->ListEntry);
+		Channel->ForwardCount--;
+		WdfSpinLockRelease(Channel->ForwardLock);
+		EchoStatsAdd(&QueueGetContext(Channel->Queue)->Stats, Cancels, 1);
+		WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
+		return;
+	}
+
+	if (Channel->ForwardCount > Channel->Ring.SlotCount) {
+		// 3 д̫࣬ͷһ
+		spillNow = TRUE;
+	}
+	else if (Channel->ForwardCount == 1) {
+		// 2 ʼʱ
+		WdfTimerStart(Channel->ForwardTimer, WDF_REL_TIMEOUT_IN_MS(ECHO_FORWARD_HOLD_TIME));
+	}
+
+	WdfSpinLockRelease(Channel->ForwardLock);
+
+	if (spillNow) {
+		EchoForwardSpill(Channel, 1);
+	}
+
+	return;
+}
+
+
+// дBufferظƵĳȣBufferǶMDLӳַ
+// ֻһΣд漴
+// ûйдʱ0λݻĲʱҲ0йд󣬵Ӧȶλ
+// дLengthʱλ0ٴӻλʽȡ
+ULONG
+EchoForwardTake(
+	IN PECHO_CHANNEL Channel,
+	OUT PVOID     Buffer,
+	IN ULONG      Length
+)
+{
+	PREQUEST_CONTEXT writeContext = NULL;
+	PLIST_ENTRY entry;
+	WDFREQUEST write = NULL;
+	BOOLEAN spillNow = FALSE;
+
+	WdfSpinLockAcquire(Channel->ForwardLock);
+
+	// ForwardLockռòۣ￴λΪʱûбȹд
+	if (!EchoRingIsEmpty(&Channel->Ring)) {
+		WdfSpinLockRelease(Channel->ForwardLock);
+		return 0;
+	}
+
+	while (!IsListEmpty(&Channel->ForwardList)) {
+
+		writeContext = CONTAINING_RECORD(Channel->ForwardList.Flink, REQUEST_CONTEXT, ListEntry);
+		if (writeContext->Length > Length) {
+			spillNow = TRUE;
+			break;
+		}
+
+		entry = RemoveHeadList(&Channel->ForwardList);
+		InitializeListHead(entry);
+		Channel->ForwardCount--;
+
+		writeContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		write = (WDFREQUEST)WdfObjectContextGetObject(writeContext);
+
+		// ѱȡдEchoEvtForwardCancelɣȡһ
+		if (WdfRequestUnmarkCancelable(write) != STATUS_CANCELLED) {
+			break;
+		}
+
+		write = NULL;
+	}
+
+	WdfSpinLockRelease(Channel->ForwardLock);
+
+	if (spillNow) {
+		EchoForwardSpill(Channel, 1);
+		return 0;
+	}
+
+	if (write == NULL) {
+		return 0;
+	}
+
+	Length = writeContext->Length;
+
+	RtlCopyMemory(Buffer, writeContext->Buffer, Length);
+
+	TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_FORWARD, "EchoForwardTake Forwarded %u bytes from Request 0x%p", Length, write);
+
+	WdfRequestSetInformation(write, (ULONG_PTR)Length);
+	EchoCompletionPend(Channel->Queue, write, STATUS_SUCCESS);
+
+	return Length;
+}
+
+
+// MaxCountдݴ뻷λٽ棬شĸ
+// 1 ForwardLock˳ȡдԤڴԤ㲢ռòۣ۵˳ǹ˳
+// 2 ͷݲύۣͬʱƣڸƵĲ۴ͣ£ҲԽֱת
+// λ򳬹ʱдSTATUS_DEVICE_BUSYɣ븴ģʽµдͬ
+// ʱдԼĻУʱŴڴԤԤдڵȴ׼ʱԽ
+// 3 ڴԤ㣬ģʽʱɣд֮д𣬵ȶֱȡ߻ʱ
+//   븴ģʽµȴ׼͵ȴռдͬ豸STATUS_DEVICE_BUSY
+// ѵȴĶɵʵʱ
+ULONG
+EchoForwardSpill(
+	IN PECHO_CHANNEL Channel,
+	IN ULONG      MaxCount
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Channel->Queue);
+	PREQUEST_CONTEXT requestContext;
+	LIST_ENTRY spillList;
+	PLIST_ENTRY entry;
+	WDFREQUEST request;
+	NTSTATUS status;
+	ULONG stored = 0;
+	BOOLEAN overBudget;
+	BOOLEAN hold = FALSE;
+
+	InitializeListHead(&spillList);
+
+	// 1 ˳ռò
+	WdfSpinLockAcquire(Channel->ForwardLock);
+
+	while (MaxCount > 0 && !IsListEmpty(&Channel->ForwardList)) {
+
+		entry = RemoveHeadList(&Channel->ForwardList);
+		InitializeListHead(entry);
+		Channel->ForwardCount--;
+		MaxCount--;
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+		if (WdfRequestUnmarkCancelable(request) == STATUS_CANCELLED) {
+			continue;
+		}
+
+		// дڵȴ׼ʱԽ
+		overBudget = (queueContext->Admission.Count != 0 ||
+			!EchoBufferCharge(Channel->Ring.Pool, requestContext->Length));
+
+		if (overBudget) {
+			status = STATUS_DEVICE_BUSY;
+			hold = !queueContext->Admission.Suspended;
+		}
+		else {
+			status = EchoRingReserve(&Channel->Ring, requestContext->Length, &requestContext->Slot);
+			if (!NT_SUCCESS(status)) {
+				EchoBufferUncharge(Channel->Ring.Pool, requestContext->Length);
+			}
+			hold = (status == STATUS_DEVICE_BUSY && Channel->Stream && !queueContext->StreamSuspended);
+		}
+
+		// 3 ڴԤ㣬ģʽFIFOŻͷΪȡ
+		if (hold) {
+			InsertHeadList(&Channel->ForwardList, entry);
+			Channel->ForwardCount++;
+
+			if (WdfRequestMarkCancelableEx(request, EchoEvtForwardCancel) == STATUS_CANCELLED) {
+				RemoveEntryList(entry);
+				InitializeListHead(entry);
+				Channel->ForwardCount--;
+				requestContext->Status = STATUS_CANCELLED;
+				InsertTailList(&spillList, entry);
+			}
+
+			break;
+		}
+
+		requestContext->Status = status;
+		InsertTailList(&spillList, entry);
+	}
+
+	// дȶֱȡߣʱʱٳ豸ټ
+	if (hold && !IsListEmpty(&Channel->ForwardList)) {
+		WdfTimerStart(Channel->ForwardTimer, WDF_REL_TIMEOUT_IN_MS(ECHO_FORWARD_HOLD_TIME));
+	}
+
+	WdfSpinLockRelease(Channel->ForwardLock);
+
+	// 2 ݲύ
+	while (!IsListEmpty(&spillList)) {
+
+		entry = RemoveHeadList(&spillList);
+		InitializeListHead(entry);
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+		status = requestContext->Status;
+		if (NT_SUCCESS(status)) {
+			status = EchoRingCommit(&Channel->Ring, requestContext->Slot, requestContext->Buffer, requestContext->Length);
+			if (!NT_SUCCESS(status)) {
+				EchoBufferUncharge(Channel->Ring.Pool, requestContext->Length);
+			}
+		}
+
+		requestContext->Slot = NULL;
+
+		if (status == STATUS_CANCELLED) {
+			EchoStatsAdd(&queueContext->Stats, Cancels, 1);
+			WdfRequestCompleteWithInformation(request, status, 0L);
+			continue;
+		}
+
+		if (!NT_SUCCESS(status)) {
+			TraceEvents(TRACE_LEVEL_WARNING, TRACE_FORWARD, "EchoForwardSpill: EchoRingWrite failed for Request 0x%p %!STATUS!", request, status);
+			if (status == STATUS_INSUFFICIENT_RESOURCES) {
+				EchoStatsAdd(&queueContext->Stats, AllocationFailures, 1);
+			}
+			WdfRequestCompleteWithInformation(request, status, 0L);
+			continue;
+		}
+
+		stored++;
+		WdfRequestSetInformation(request, (ULONG_PTR)requestContext->Length);
+		EchoCompletionPend(Channel->Queue, request, STATUS_SUCCESS);
+	}
+
+	return stored;
+}
+
+
+// дȡʱĻص
+VOID
+EchoEvtForwardCancel(
+	IN WDFREQUEST Request
+)
+{
+	PECHO_CHANNEL channel = EchoRequestGetChannel(Request);
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_FORWARD, "EchoEvtForwardCancel called on Request 0x%p", Request);
+
+	// ѱEchoForwardTakeEchoForwardSpillȡµListEntryָ
+	WdfSpinLockAcquire(channel->ForwardLock);
+
+	if (!IsListEmpty(&requestContext->ListEntry)) {
+		RemoveEntryList(&requestContext->ListEntry);
+		InitializeListHead(&requestContext->ListEntry);
+		channel->ForwardCount--;
+	}
+
+	WdfSpinLockRelease(channel->ForwardLock);
+
+	EchoStatsAdd(&QueueGetContext(channel->Queue)->Stats, Cancels, 1);
+
+	WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
+
+	return;
+}
+
+
+// תʱĻصȴʱдȫλٻѵȴĶ
+VOID
+EchoEvtForwardTimerFunc(
+	IN WDFTIMER     Timer
+)
+{
+	PECHO_CHANNEL channel = ChannelTimerGetContext(Timer)->Channel;
+
+	// ڼΪڸƵĲ۶ûȡݣ֮
+	if (EchoForwardSpill(channel, MAXULONG) != 0) {
+		EchoReadWaitWake(channel);
+	}
+
+	return;
+}
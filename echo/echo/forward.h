@@ -0,0 +1,38 @@
+#pragma once
+
+// Longest time a write waits for a reader before it is stored into the ring, in ms
+#define ECHO_FORWARD_HOLD_TIME	50
+
+// 㿽ת豸ʹֱI/OʱдݲƵλתϵȴ
+// 󵽴һλΪʱֱӴдMDLӳַƵԼMDLӳַһ
+// дȶʱתλɶʽȡ
+// дȴECHO_FORWARD_HOLD_TIME룬д󳬹λĲʱFIFO˳λ
+// ʱŴ豸ڴԤԤԤ㣬ģʽ»λʱдʧܣ
+// ȶֱȡߣÿECHO_FORWARD_HOLD_TIMEٳ
+// ForwardLock˳ռòۣͷٸƣForwardLock黷λΪղֱת
+// ڸƵĲ۲ΪգԶ󲻻Խȡ߸д
+// ÿͨԼתͨForwardLockͷ֮
+
+VOID
+EchoForwardPark(
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+);
+
+ULONG
+EchoForwardTake(
+	IN PECHO_CHANNEL Channel,
+	OUT PVOID     Buffer,
+	IN ULONG      Length
+);
+
+ULONG
+EchoForwardSpill(
+	IN PECHO_CHANNEL Channel,
+	IN ULONG      MaxCount
+);
+
+EVT_WDF_REQUEST_CANCEL EchoEvtForwardCancel;
+EVT_WDF_TIMER EchoEvtForwardTimerFunc;
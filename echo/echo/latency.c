@@ -0,0 +1,195 @@
+#include "driver.h"
+#include "latency.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoLatencyInitialize)
+#endif
+
+
+// ʼӳģͣĬϲãΪĬ϶Queue
+NTSTATUS
+EchoLatencyInitialize(
+	OUT PECHO_LATENCY Latency,
+	IN WDFQUEUE Queue
+)
+{
+	WDF_OBJECT_ATTRIBUTES attributes;
+
+	PAGED_CODE();
+
+	RtlZeroMemory(Latency, sizeof(ECHO_LATENCY));
+	Latency->Config.Model = EchoLatencyNone;
+	Latency->State = ECHO_LATENCY_DEFAULT_SEED;
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = Queue;
+
+	return WdfSpinLockCreate(&attributes, &Latency->Lock);
+}
+
+
+// ӳģͣȼֶΣϷʱSTATUS_INVALID_PARAMETER޸ԭ
+// αдSeed¿ʼ·Ϊ
+NTSTATUS
+EchoLatencyConfigure(
+	IN PECHO_LATENCY Latency,
+	IN PECHO_LATENCY_CONFIG Config
+)
+{
+	if (Config->Model >= EchoLatencyModelMax ||
+		Config->MinUs > ECHO_LATENCY_MAX_US ||
+		Config->MaxUs > ECHO_LATENCY_MAX_US ||
+		Config->TailPpm > 1000000 ||
+		(Config->BytesPerSecond != 0 && Config->BytesPerSecond < ECHO_LATENCY_MIN_BANDWIDTH)) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	if ((Config->Model == EchoLatencyUniform || Config->Model == EchoLatencyBimodal) && Config->MaxUs < Config->MinUs) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	if (Config->Model == EchoLatencyExponential && (Config->MeanUs == 0 || Config->MaxUs < Config->MinUs)) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_COMPLETION, "EchoLatencyConfigure Model %u MinUs %u MaxUs %u MeanUs %u TailPpm %u BytesPerSecond %I64u Seed 0x%I64x",
+		Config->Model, Config->MinUs, Config->MaxUs, Config->MeanUs, Config->TailPpm, Config->BytesPerSecond, Config->Seed);
+
+	WdfSpinLockAcquire(Latency->Lock);
+
+	Latency->Config = *Config;
+	Latency->Config.Reserved = 0;
+	Latency->State = (Config->Seed != 0) ? Config->Seed : ECHO_LATENCY_DEFAULT_SEED;
+	Latency->LinkFree = 0;
+	Latency->Enabled = (Config->Model != EchoLatencyNone || Config->BytesPerSecond != 0);
+
+	WdfSpinLockRelease(Latency->Lock);
+
+	return STATUS_SUCCESS;
+}
+
+
+// ȡõǰӳģ
+VOID
+EchoLatencyQuery(
+	IN PECHO_LATENCY Latency,
+	OUT PECHO_LATENCY_CONFIG Config
+)
+{
+	WdfSpinLockAcquire(Latency->Lock);
+	*Config = Latency->Config;
+	WdfSpinLockRelease(Latency->Lock);
+
+	return;
+}
+
+
+// xorshift64*32λαLockʱ
+static
+ULONG
+EchoLatencyNext(
+	IN PECHO_LATENCY Latency
+)
+{
+	ULONG64 x = Latency->State;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	Latency->State = x;
+
+	return (ULONG)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+
+// -ln(R / 2^32)Q16RΪ0
+// ںвʹø㣺ȡλõlog2(R)֣ٶԹ񻯵[1, 2)βλƽõ16λС
+static
+ULONG64
+EchoLatencyNegLog(
+	IN ULONG R
+)
+{
+	ULONG msb;
+	ULONG64 x;
+	ULONG64 log2;
+	ULONG i;
+
+	_BitScanReverse(&msb, R);
+
+	// xΪβQ31[1, 2)
+	x = (ULONG64)R << (31 - msb);
+	log2 = msb;
+
+	for (i = 0; i < 16; i++) {
+		x = (x * x) >> 31;
+		log2 <<= 1;
+		if (x >= (2ULL << 31)) {
+			x >>= 1;
+			log2 |= 1;
+		}
+	}
+
+	// -ln(R / 2^32) = (32 - log2(R)) * ln2ln2Q16Ϊ45426
+	return (((32ULL << 16) - log2) * 45426) >> 16;
+}
+
+
+// ģͳһķʱ䣨usLengthΪֽ
+// 1 ģͳӳ
+// 2 дʱ·кʼ䣬ʱϵȴ·ʹʱ
+ULONG
+EchoLatencySample(
+	IN PECHO_LATENCY Latency,
+	IN ULONG Length
+)
+{
+	PECHO_LATENCY_CONFIG config = &Latency->Config;
+	ULONGLONG now;
+	ULONGLONG start;
+	ULONG64 delayUs = 0;
+	ULONG r;
+
+	WdfSpinLockAcquire(Latency->Lock);
+
+	// 1 ģͳ
+	switch (config->Model) {
+
+	case EchoLatencyConstant:
+		delayUs = config->MinUs;
+		break;
+
+	case EchoLatencyUniform:
+		r = EchoLatencyNext(Latency);
+		delayUs = config->MinUs + (((ULONG64)r * ((ULONG64)config->MaxUs - config->MinUs + 1)) >> 32);
+		break;
+
+	case EchoLatencyExponential:
+		r = EchoLatencyNext(Latency);
+		delayUs = config->MinUs + ((config->MeanUs * EchoLatencyNegLog(r != 0 ? r : 1)) >> 16);
+		if (delayUs > config->MaxUs) {
+			delayUs = config->MaxUs;
+		}
+		break;
+
+	case EchoLatencyBimodal:
+		r = EchoLatencyNext(Latency);
+		delayUs = ((((ULONG64)r * 1000000) >> 32) < config->TailPpm) ? config->MaxUs : config->MinUs;
+		break;
+
+	default:
+		break;
+	}
+
+	// 2 ·
+	if (config->BytesPerSecond != 0) {
+		now = KeQueryInterruptTime();
+		start = max(now, Latency->LinkFree);
+		Latency->LinkFree = start + (ULONG64)Length * 10000000 / config->BytesPerSecond;
+		delayUs += (Latency->LinkFree - now) / 10;
+	}
+
+	WdfSpinLockRelease(Latency->Lock);
+
+	return (ULONG)min(delayUs, (ULONG64)MAXULONG);
+}
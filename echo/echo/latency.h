@@ -0,0 +1,41 @@
+#pragma once
+
+// Default seed of the sampling sequence when the configuration leaves Seed at 0
+#define ECHO_LATENCY_DEFAULT_SEED	0x9E3779B97F4A7C15ULL
+
+// 豸ӳģͣɶӵ
+// дϺģʱEchoLatencySampleʱ䣬ʱϣʱ
+// αк·״̬Lock󵽴˳
+typedef struct _ECHO_LATENCY {
+
+	WDFSPINLOCK Lock;		// ConfigStateLinkFree
+	ECHO_LATENCY_CONFIG Config;	// ǰ
+	ULONG64 State;			// xorshift64*״̬Ϊ0
+	ULONGLONG LinkFree;		// ·еʱ̣жʱ䣬100ns֮ǰѴ
+	volatile BOOLEAN Enabled;	// ģͻȡ
+
+} ECHO_LATENCY, *PECHO_LATENCY;
+
+NTSTATUS
+EchoLatencyInitialize(
+	OUT PECHO_LATENCY Latency,
+	IN WDFQUEUE Queue
+);
+
+NTSTATUS
+EchoLatencyConfigure(
+	IN PECHO_LATENCY Latency,
+	IN PECHO_LATENCY_CONFIG Config
+);
+
+VOID
+EchoLatencyQuery(
+	IN PECHO_LATENCY Latency,
+	OUT PECHO_LATENCY_CONFIG Config
+);
+
+ULONG
+EchoLatencySample(
+	IN PECHO_LATENCY Latency,
+	IN ULONG Length
+);
@@ -0,0 +1,229 @@
+#include "driver.h"
+#include "lookaside.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoBufferPoolInitialize)
+#endif
+
+static ALLOCATE_FUNCTION_EX EchoLookasideAllocate;
+static FREE_FUNCTION_EX EchoLookasideFree;
+
+
+// бΪʱķصڴط䲢¼һδ
+static
+PVOID
+EchoLookasideAllocate(
+	IN POOL_TYPE PoolType,
+	IN SIZE_T NumberOfBytes,
+	IN ULONG Tag,
+	IN PLOOKASIDE_LIST_EX Lookaside
+)
+{
+	PECHO_SIZE_CLASS sizeClass = CONTAINING_RECORD(Lookaside, ECHO_SIZE_CLASS, Lookaside);
+
+	InterlockedIncrement64(&sizeClass->Misses);
+
+	return ExAllocatePoolWithTag(PoolType, NumberOfBytes, Tag);
+}
+
+
+// бʱͷŻص
+static
+VOID
+EchoLookasideFree(
+	IN PVOID Buffer,
+	IN PLOOKASIDE_LIST_EX Lookaside
+)
+{
+	UNREFERENCED_PARAMETER(Lookaside);
+
+	ExFreePool(Buffer);
+}
+
+
+// ʼб512B4KB16KBMaxSizeСMaxSizeļŻᴴ
+// BudgetΪ0ʱ
+NTSTATUS
+EchoBufferPoolInitialize(
+	OUT PECHO_BUFFER_POOL Pool,
+	IN ULONG MaxSize,
+	IN LONG64 Budget
+)
+{
+	static const ULONG classSizes[] = { ECHO_SIZE_CLASS_0, ECHO_SIZE_CLASS_1, ECHO_SIZE_CLASS_2 };
+	NTSTATUS status;
+	ULONG i;
+
+	PAGED_CODE();
+
+	C_ASSERT(RTL_NUMBER_OF(classSizes) < ECHO_LOOKASIDE_MAX_CLASSES);
+
+	RtlZeroMemory(Pool, sizeof(ECHO_BUFFER_POOL));
+
+	Pool->Budget = (Budget > 0) ? Budget : MAXLONG64;
+
+	if (MaxSize == 0) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	for (i = 0; i < RTL_NUMBER_OF(classSizes) && classSizes[i] < MaxSize; i++) {
+		Pool->Classes[Pool->ClassCount++].Size = classSizes[i];
+	}
+
+	Pool->Classes[Pool->ClassCount++].Size = MaxSize;
+
+	for (i = 0; i < Pool->ClassCount; i++) {
+
+		status = ExInitializeLookasideListEx(&Pool->Classes[i].Lookaside,
+			EchoLookasideAllocate,
+			EchoLookasideFree,
+			NonPagedPoolNx,
+			0,
+			Pool->Classes[i].Size,
+			'sam1',
+			0);
+
+		if (!NT_SUCCESS(status)) {
+			TraceEvents(TRACE_LEVEL_ERROR, TRACE_BUFFER, "ExInitializeLookasideListEx for %u bytes failed %!STATUS!", Pool->Classes[i].Size, status);
+			EchoBufferPoolCleanup(Pool);
+			return status;
+		}
+
+		Pool->Classes[i].Initialized = TRUE;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+
+// ɾбǰлѾ黹
+// ٻصDISPATCH_LEVELãɷҳ
+VOID
+EchoBufferPoolCleanup(
+	IN PECHO_BUFFER_POOL Pool
+)
+{
+	ULONG i;
+
+	for (i = 0; i < Pool->ClassCount; i++) {
+		if (Pool->Classes[i].Initialized) {
+			ExDeleteLookasideListEx(&Pool->Classes[i].Lookaside);
+			Pool->Classes[i].Initialized = FALSE;
+		}
+	}
+
+	return;
+}
+
+
+// LengthֽڵСһ仺SizeClass𣬹黹ʱʹ
+// LengthһʱNULL
+PVOID
+EchoBufferAllocate(
+	IN PECHO_BUFFER_POOL Pool,
+	IN ULONG Length,
+	OUT PUCHAR SizeClass
+)
+{
+	PECHO_SIZE_CLASS sizeClass;
+	ULONG i;
+
+	for (i = 0; i < Pool->ClassCount; i++) {
+
+		sizeClass = &Pool->Classes[i];
+		if (Length <= sizeClass->Size) {
+			InterlockedIncrement64(&sizeClass->Allocations);
+			*SizeClass = (UCHAR)i;
+			return ExAllocateFromLookasideListEx(&sizeClass->Lookaside);
+		}
+	}
+
+	return NULL;
+}
+
+
+// 黹һ
+VOID
+EchoBufferFree(
+	IN PECHO_BUFFER_POOL Pool,
+	IN PVOID Buffer,
+	IN UCHAR SizeClass
+)
+{
+	PECHO_SIZE_CLASS sizeClass = &Pool->Classes[SizeClass];
+
+	ASSERT(SizeClass < Pool->ClassCount);
+
+	InterlockedIncrement64(&sizeClass->Frees);
+	ExFreeToLookasideListEx(&sizeClass->Lookaside, Buffer);
+
+	return;
+}
+
+
+// ԤԤBytesֽڣԤʱԤFALSE
+// ȽϺһԭӲдͬʱԤԽ
+BOOLEAN
+EchoBufferCharge(
+	IN PECHO_BUFFER_POOL Pool,
+	IN ULONG Bytes
+)
+{
+	LONG64 charged;
+	LONG64 old;
+
+	charged = Pool->Charged;
+
+	for (;;) {
+		if ((LONG64)Bytes > Pool->Budget - charged) {
+			return FALSE;
+		}
+
+		old = InterlockedCompareExchange64(&Pool->Charged, charged + Bytes, charged);
+		if (old == charged) {
+			return TRUE;
+		}
+
+		charged = old;
+	}
+}
+
+
+// 黹EchoBufferChargeԤֽ
+VOID
+EchoBufferUncharge(
+	IN PECHO_BUFFER_POOL Pool,
+	IN ULONG Bytes
+)
+{
+	LONG64 charged = InterlockedExchangeAdd64(&Pool->Charged, -(LONG64)Bytes);
+
+	UNREFERENCED_PARAMETER(charged);
+	ASSERT(charged >= (LONG64)Bytes);
+
+	return;
+}
+
+
+// ȡøͳ
+VOID
+EchoBufferPoolQueryStats(
+	IN PECHO_BUFFER_POOL Pool,
+	OUT PECHO_LOOKASIDE_STATS Stats
+)
+{
+	ULONG i;
+
+	RtlZeroMemory(Stats, sizeof(ECHO_LOOKASIDE_STATS));
+
+	Stats->ClassCount = Pool->ClassCount;
+
+	for (i = 0; i < Pool->ClassCount; i++) {
+		Stats->Classes[i].Size = Pool->Classes[i].Size;
+		Stats->Classes[i].Allocations = (ULONG64)Pool->Classes[i].Allocations;
+		Stats->Classes[i].Misses = (ULONG64)Pool->Classes[i].Misses;
+		Stats->Classes[i].Frees = (ULONG64)Pool->Classes[i].Frees;
+	}
+
+	return;
+}
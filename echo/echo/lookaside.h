@@ -0,0 +1,75 @@
+#pragma once
+
+// Size classes below the largest one; the largest class is the maximum write length
+#define ECHO_SIZE_CLASS_0	512
+#define ECHO_SIZE_CLASS_1	(4*1024)
+#define ECHO_SIZE_CLASS_2	(16*1024)
+
+// һб
+// MissesںбķصۼӣֻкбΪʱܲŻøûص
+typedef struct _ECHO_SIZE_CLASS {
+
+	LOOKASIDE_LIST_EX Lookaside;
+	ULONG Size;
+	BOOLEAN Initialized;
+	volatile LONG64 Allocations;
+	volatile LONG64 Misses;
+	volatile LONG64 Frees;
+
+} ECHO_SIZE_CLASS, *PECHO_SIZE_CLASS;
+
+// СּĻɶӵ
+// ģ鲻WDFIRQL <= DISPATCH_LEVEL·͹黹
+// Budget豸ڴԤ㣺ݽǷҳڴ֮ǰдEchoBufferChargeԤ뿪ʱ黹
+typedef struct _ECHO_BUFFER_POOL {
+
+	ULONG ClassCount;
+	ECHO_SIZE_CLASS Classes[ECHO_LOOKASIDE_MAX_CLASSES];
+	LONG64 Budget;			// ͨŵܳȵ
+	volatile LONG64 Charged;	// Ԥֽ
+
+} ECHO_BUFFER_POOL, *PECHO_BUFFER_POOL;
+
+NTSTATUS
+EchoBufferPoolInitialize(
+	OUT PECHO_BUFFER_POOL Pool,
+	IN ULONG MaxSize,
+	IN LONG64 Budget
+);
+
+VOID
+EchoBufferPoolCleanup(
+	IN PECHO_BUFFER_POOL Pool
+);
+
+PVOID
+EchoBufferAllocate(
+	IN PECHO_BUFFER_POOL Pool,
+	IN ULONG Length,
+	OUT PUCHAR SizeClass
+);
+
+VOID
+EchoBufferFree(
+	IN PECHO_BUFFER_POOL Pool,
+	IN PVOID Buffer,
+	IN UCHAR SizeClass
+);
+
+BOOLEAN
+EchoBufferCharge(
+	IN PECHO_BUFFER_POOL Pool,
+	IN ULONG Bytes
+);
+
+VOID
+EchoBufferUncharge(
+	IN PECHO_BUFFER_POOL Pool,
+	IN ULONG Bytes
+);
+
+VOID
+EchoBufferPoolQueryStats(
+	IN PECHO_BUFFER_POOL Pool,
+	OUT PECHO_LOOKASIDE_STATS Stats
+);
@@ -0,0 +1,306 @@
+#include "driver.h"
+#include "params.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoParametersLoad)
+#pragma alloc_text (PAGE, EchoParametersInitialize)
+#pragma alloc_text (PAGE, EchoParametersQuery)
+#pragma alloc_text (PAGE, EchoParametersSet)
+#endif
+
+
+// עжȡһULONGֵڻ[Min, Max]ʱFALSEValueֲ
+static
+BOOLEAN
+EchoParametersQueryULong(
+	IN WDFKEY Key,
+	IN PCWSTR Name,
+	IN ULONG  Min,
+	IN ULONG  Max,
+	IN OUT PULONG Value
+)
+{
+	UNICODE_STRING valueName;
+	NTSTATUS status;
+	ULONG value;
+
+	PAGED_CODE();
+
+	RtlInitUnicodeString(&valueName, Name);
+
+	status = WdfRegistryQueryULong(Key, &valueName, &value);
+	if (!NT_SUCCESS(status)) {
+		return FALSE;
+	}
+
+	if (value < Min || value > Max) {
+		TraceEvents(TRACE_LEVEL_WARNING, TRACE_QUEUE, "Registry value %ws = %u out of range [%u, %u], ignored", Name, value, Min, Max);
+		return FALSE;
+	}
+
+	*Value = value;
+
+	return TRUE;
+}
+
+
+// 豸ʱãParametersעеֵǶõĬֵ
+// ûParametersûĳֵʱʹĬֵϷֵ
+VOID
+EchoParametersLoad(
+	IN OUT PECHO_QUEUE_CONFIG Config
+)
+{
+	WDFKEY key;
+	NTSTATUS status;
+	ULONG value;
+
+	PAGED_CODE();
+
+	status = WdfDriverOpenParametersRegistryKey(WdfGetDriver(), KEY_READ, WDF_NO_OBJECT_ATTRIBUTES, &key);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_QUEUE, "No Parameters registry key %!STATUS!, using defaults", status);
+		return;
+	}
+
+	EchoParametersQueryULong(key, ECHO_REG_MAX_WRITE_LENGTH, 1, Config->MemoryCap, &Config->MaxWriteLength);
+	EchoParametersQueryULong(key, ECHO_REG_TIMER_PERIOD_US, ECHO_TIMER_MIN_PERIOD_US, ECHO_TICKER_MAX_PERIOD_US, &Config->TimerPeriodUs);
+	EchoParametersQueryULong(key, ECHO_REG_COMPLETION_DELAY_MS, 0, ECHO_MAX_DEADLINE_DELAY, &Config->CompletionDelayMs);
+	EchoParametersQueryULong(key, ECHO_REG_BATCH_SIZE, 1, ECHO_MAX_BATCH_SIZE, &Config->BatchSize);
+
+	value = Config->DispatchMode;
+	if (EchoParametersQueryULong(key, ECHO_REG_DISPATCH_MODE, 0, EchoDispatchModeMax - 1, &value)) {
+		Config->DispatchMode = (ECHO_DISPATCH_MODE)value;
+	}
+
+	// ڴԤKB棬EchoQueueInitialize֤Сڻλ
+	if (EchoParametersQueryULong(key, ECHO_REG_MEMORY_BUDGET_KB, 1, MAXULONG, &value)) {
+		Config->MemoryBudget = (ULONG64)value * 1024;
+	}
+
+	// 㿽תҪֱI/O0ʾ
+	value = Config->ZeroCopy;
+	if (EchoParametersQueryULong(key, ECHO_REG_ZERO_COPY, 0, 1, &value)) {
+		Config->ZeroCopy = (BOOLEAN)value;
+	}
+
+	WdfRegistryClose(key);
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_QUEUE, "Parameters: MaxWriteLength %u TimerPeriodUs %u CompletionDelayMs %u BatchSize %u DispatchMode %u MemoryBudget %I64u ZeroCopy %u",
+		Config->MaxWriteLength, Config->TimerPeriodUs, Config->CompletionDelayMs, Config->BatchSize, Config->DispatchMode, Config->MemoryBudget, Config->ZeroCopy);
+
+	return;
+}
+
+
+// ʼʱ״̬EchoQueueInitializeе
+NTSTATUS
+EchoParametersInitialize(
+	IN WDFQUEUE Queue
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	WDF_OBJECT_ATTRIBUTES attributes;
+
+	PAGED_CODE();
+
+	queueContext->MaxWriteLength = min(queueContext->Config.MaxWriteLength, queueContext->Config.MemoryCap);
+	queueContext->NextDispatchMode = queueContext->Config.DispatchMode;
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = Queue;
+
+	return WdfWaitLockCreate(&attributes, &queueContext->ParameterLock);
+}
+
+
+// ȡõǰĲParameterLockῴеһ
+NTSTATUS
+EchoParametersQuery(
+	IN WDFQUEUE Queue,
+	OUT PECHO_PARAMETERS Parameters
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+
+	PAGED_CODE();
+
+	if (KeGetCurrentIrql() != PASSIVE_LEVEL) {
+		return STATUS_INVALID_DEVICE_STATE;
+	}
+
+	RtlZeroMemory(Parameters, sizeof(ECHO_PARAMETERS));
+
+	WdfWaitLockAcquire(queueContext->ParameterLock, NULL);
+
+	Parameters->MaxWriteLength = queueContext->MaxWriteLength;
+	Parameters->TimerPeriodUs = queueContext->Ticker.Config.PeriodUs;
+
+	WdfSpinLockAcquire(queueContext->Pending.PendingLock);
+	Parameters->CompletionDelayMs = queueContext->Policy.MaxDelayMs;
+	Parameters->BatchSize = queueContext->Policy.BatchSize;
+	WdfSpinLockRelease(queueContext->Pending.PendingLock);
+
+	Parameters->DispatchMode = queueContext->NextDispatchMode;
+	Parameters->MemoryBudget = (ULONG64)queueContext->BufferPool.Budget;
+	Parameters->MaxWriteLimit = queueContext->Config.MemoryCap;
+	Parameters->ActiveDispatchMode = queueContext->Config.DispatchMode;
+
+	WdfWaitLockRelease(queueContext->ParameterLock);
+
+	return STATUS_SUCCESS;
+}
+
+
+// ѲдParametersע豸´δʱEchoParametersLoadȡ
+static
+NTSTATUS
+EchoParametersSave(
+	IN PECHO_PARAMETERS Parameters
+)
+{
+	DECLARE_CONST_UNICODE_STRING(maxWriteLength, ECHO_REG_MAX_WRITE_LENGTH);
+	DECLARE_CONST_UNICODE_STRING(timerPeriodUs, ECHO_REG_TIMER_PERIOD_US);
+	DECLARE_CONST_UNICODE_STRING(completionDelayMs, ECHO_REG_COMPLETION_DELAY_MS);
+	DECLARE_CONST_UNICODE_STRING(batchSize, ECHO_REG_BATCH_SIZE);
+	DECLARE_CONST_UNICODE_STRING(dispatchMode, ECHO_REG_DISPATCH_MODE);
+	DECLARE_CONST_UNICODE_STRING(memoryBudgetKB, ECHO_REG_MEMORY_BUDGET_KB);
+	WDFKEY key;
+	NTSTATUS status;
+
+	PAGED_CODE();
+
+	status = WdfDriverOpenParametersRegistryKey(WdfGetDriver(), KEY_SET_VALUE, WDF_NO_OBJECT_ATTRIBUTES, &key);
+	if (!NT_SUCCESS(status)) {
+		return status;
+	}
+
+	status = WdfRegistryAssignULong(key, &maxWriteLength, Parameters->MaxWriteLength);
+	if (NT_SUCCESS(status)) {
+		status = WdfRegistryAssignULong(key, &timerPeriodUs, Parameters->TimerPeriodUs);
+	}
+	if (NT_SUCCESS(status)) {
+		status = WdfRegistryAssignULong(key, &completionDelayMs, Parameters->CompletionDelayMs);
+	}
+	if (NT_SUCCESS(status)) {
+		status = WdfRegistryAssignULong(key, &batchSize, Parameters->BatchSize);
+	}
+	if (NT_SUCCESS(status)) {
+		status = WdfRegistryAssignULong(key, &dispatchMode, Parameters->DispatchMode);
+	}
+	if (NT_SUCCESS(status)) {
+		status = WdfRegistryAssignULong(key, &memoryBudgetKB, (ULONG)min(Parameters->MemoryBudget / 1024, (ULONG64)MAXULONG));
+	}
+
+	WdfRegistryClose(key);
+
+	return status;
+}
+
+
+// ޸ĲִIOCTL_ECHO_SET_PARAMETERS
+// 1 ֶΣκһϷʱSTATUS_INVALID_PARAMETER޸κβ
+// 2 ڸıʱ滻ɶʱΨһʧܵһʧʱû޸
+// 3 ޸ĵд󳤶ȡڴԤɲԣԤʱ׼ȴд
+// 4 ָECHO_PARAMETERS_FLAG_PERSISTʱдעʧʱشеĲѾ޸
+// עеĲӰ豸ԺÿMayPersistΪFALSEʱָECHO_PARAMETERS_FLAG_PERSISTSTATUS_PRIVILEGE_NOT_HELD
+// ParameterLockνУ滻ʱҪȴɶʱĻصأֻPASSIVE_LEVEL
+NTSTATUS
+EchoParametersSet(
+	IN WDFQUEUE Queue,
+	IN PECHO_PARAMETERS Parameters,
+	IN BOOLEAN MayPersist
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	ECHO_COMPLETION_POLICY policy;
+	ECHO_TIMER_CONFIG timerConfig;
+	LONG64 oldBudget;
+	NTSTATUS status;
+
+	PAGED_CODE();
+
+	if (KeGetCurrentIrql() != PASSIVE_LEVEL) {
+		return STATUS_INVALID_DEVICE_STATE;
+	}
+
+	if ((Parameters->Flags & ECHO_PARAMETERS_FLAG_PERSIST) && !MayPersist) {
+		return STATUS_PRIVILEGE_NOT_HELD;
+	}
+
+	WdfWaitLockAcquire(queueContext->ParameterLock, NULL);
+
+	// 1 ֶΣӳٺСҪϵǰģʽҪ
+	WdfSpinLockAcquire(queueContext->Pending.PendingLock);
+	policy = queueContext->Policy;
+	WdfSpinLockRelease(queueContext->Pending.PendingLock);
+
+	policy.MaxDelayMs = Parameters->CompletionDelayMs;
+	policy.BatchSize = Parameters->BatchSize;
+
+	timerConfig = queueContext->Ticker.Config;
+	timerConfig.PeriodUs = Parameters->TimerPeriodUs;
+
+	if (Parameters->MaxWriteLength == 0 ||
+		Parameters->MaxWriteLength > queueContext->Config.MemoryCap ||
+		Parameters->TimerPeriodUs < ECHO_TIMER_MIN_PERIOD_US ||
+		Parameters->TimerPeriodUs > ECHO_TICKER_MAX_PERIOD_US ||
+		Parameters->CompletionDelayMs > ECHO_MAX_DEADLINE_DELAY ||
+		Parameters->BatchSize == 0 ||
+		Parameters->BatchSize > ECHO_MAX_BATCH_SIZE ||
+		Parameters->DispatchMode >= EchoDispatchModeMax ||
+		Parameters->MemoryBudget < Parameters->MaxWriteLength ||
+		Parameters->MemoryBudget > (ULONG64)MAXLONG64) {
+		status = STATUS_INVALID_PARAMETER;
+		goto exit;
+	}
+
+	// ַʽֻڴʱָı뱣浽ע
+	if (Parameters->DispatchMode != (ULONG)queueContext->Config.DispatchMode &&
+		!(Parameters->Flags & ECHO_PARAMETERS_FLAG_PERSIST)) {
+		status = STATUS_INVALID_PARAMETER;
+		goto exit;
+	}
+
+	status = EchoCompletionValidatePolicy(&policy);
+	if (!NT_SUCCESS(status)) {
+		goto exit;
+	}
+
+	// 2 滻ɶʱ
+	if (timerConfig.PeriodUs != queueContext->Ticker.Config.PeriodUs) {
+		status = EchoTickerConfigure(&queueContext->Ticker, &timerConfig);
+		if (!NT_SUCCESS(status)) {
+			goto exit;
+		}
+	}
+
+	// 3 ޸Щ޸Ķʧ
+	queueContext->MaxWriteLength = Parameters->MaxWriteLength;
+	queueContext->NextDispatchMode = (ECHO_DISPATCH_MODE)Parameters->DispatchMode;
+
+	oldBudget = InterlockedExchange64(&queueContext->BufferPool.Budget, (LONG64)Parameters->MemoryBudget);
+	if ((LONG64)Parameters->MemoryBudget > oldBudget) {
+		EchoAdmissionRun(Queue);
+	}
+
+	if (policy.MaxDelayMs != queueContext->Policy.MaxDelayMs || policy.BatchSize != queueContext->Policy.BatchSize) {
+		EchoCompletionSetPolicy(Queue, &policy);
+	}
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_QUEUE, "EchoParametersSet MaxWriteLength %u TimerPeriodUs %u CompletionDelayMs %u BatchSize %u DispatchMode %u MemoryBudget %I64u",
+		Parameters->MaxWriteLength, Parameters->TimerPeriodUs, Parameters->CompletionDelayMs, Parameters->BatchSize, Parameters->DispatchMode, Parameters->MemoryBudget);
+
+	// 4 дע
+	if (Parameters->Flags & ECHO_PARAMETERS_FLAG_PERSIST) {
+		status = EchoParametersSave(Parameters);
+		if (!NT_SUCCESS(status)) {
+			TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoParametersSave failed %!STATUS!", status);
+		}
+	}
+
+exit:
+	WdfWaitLockRelease(queueContext->ParameterLock);
+
+	return status;
+}
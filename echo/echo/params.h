@@ -0,0 +1,39 @@
+#pragma once
+
+// Value names under the driver's Parameters registry key, read when the device is created
+#define ECHO_REG_MAX_WRITE_LENGTH		L"MaxWriteLength"
+#define ECHO_REG_TIMER_PERIOD_US		L"TimerPeriodUs"
+#define ECHO_REG_COMPLETION_DELAY_MS	L"CompletionDelayMs"
+#define ECHO_REG_BATCH_SIZE				L"BatchSize"
+#define ECHO_REG_DISPATCH_MODE			L"DispatchMode"
+#define ECHO_REG_MEMORY_BUDGET_KB		L"MemoryBudgetKB"
+#define ECHO_REG_ZERO_COPY				L"ZeroCopy"
+
+// ɵд󳤶ȡɶʱڡɲԵӳٺСַʽڴԤ
+// Ĭֵqueue.hȴĺ꣬豸ʱParametersעǣʱIOCTL_ECHO_SET_PARAMETERS޸
+// 㿽豸I/Oʽֻע豸ʱѡIOCTL_ECHO_SET_PARAMETERS޸
+// ÿԱʹĵطQUEUE_CONTEXT.MaxWriteLengthPolicyTickerBufferPool.Budget·ģ
+// úͶȡɶеParameterLockлȡ߿һ֮ǰ֮
+
+VOID
+EchoParametersLoad(
+	IN OUT PECHO_QUEUE_CONFIG Config
+);
+
+NTSTATUS
+EchoParametersInitialize(
+	IN WDFQUEUE Queue
+);
+
+NTSTATUS
+EchoParametersQuery(
+	IN WDFQUEUE Queue,
+	OUT PECHO_PARAMETERS Parameters
+);
+
+NTSTATUS
+EchoParametersSet(
+	IN WDFQUEUE Queue,
+	IN PECHO_PARAMETERS Parameters,
+	IN BOOLEAN MayPersist
+);
@@ -4,4 +4,454 @@
 
 DEFINE_GUID (GUID_DEVINTERFACE_ECHO, 0xcdc35b6e, 0xbe4, 0x4936, 0xbf, 0x5f, 0x55, 0x37, 0x38, 0xa, 0x7c, 0x1a);
 
+// WPPṩߣtrace.hеĿGUIDͬ
+DEFINE_GUID (GUID_ECHO_TRACE_PROVIDER, 0xd67e46f0, 0x281b, 0x4854, 0xa6, 0xfd, 0xb2, 0x0a, 0xcd, 0x54, 0x38, 0xba);
 
+//
+// 豸Ŀ룬Ӧó
+//
+#define IOCTL_ECHO_INDEX	0x800
+
+// ɲ
+typedef enum _ECHO_COMPLETION_MODE {
+	EchoCompletionImmediate = 0,	// д
+	EchoCompletionCoalesce,			// ϲɣBatchSize󣬻ȴMaxDelayMsһ
+	EchoCompletionTimer,			// ʱÿһԭеʾΪ
+	EchoCompletionDeadline,			// ÿԼӳ֮ɣõӳ٣ΪMaxDelayMs
+	EchoCompletionModeMax
+} ECHO_COMPLETION_MODE;
+
+typedef struct _ECHO_COMPLETION_POLICY {
+	ULONG Mode;				// ECHO_COMPLETION_MODE
+	ULONG MaxDelayMs;		// ϲɵȴʱ䣻EchoCompletionDeadlineģʽΪδӳٵľӳ
+	ULONG BatchSize;		// ϲɵδСEchoCompletionCoalesce
+} ECHO_COMPLETION_POLICY, *PECHO_COMPLETION_POLICY;
+
+// ECHO_COMPLETION_POLICY豸ɲ
+#define IOCTL_ECHO_SET_COMPLETION_POLICY CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 0,\
+	METHOD_BUFFERED,\
+	FILE_WRITE_ACCESS)
+
+// ECHO_COMPLETION_POLICYȡ豸ǰɲ
+#define IOCTL_ECHO_GET_COMPLETION_POLICY CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 1,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+// Ĭ϶еķַʽ
+typedef enum _ECHO_DISPATCH_MODE {
+	EchoDispatchSequential = 0,		// зַһֻһ
+	EchoDispatchParallel,			// зַͬʱɶڲͬ
+	EchoDispatchModeMax
+} ECHO_DISPATCH_MODE;
+
+// дݻСּӸĺб
+#define ECHO_LOOKASIDE_MAX_CLASSES	4
+
+typedef struct _ECHO_LOOKASIDE_CLASS_STATS {
+	ULONG Size;				// üĴС
+	ULONG Reserved;
+	ULONG64 Allocations;	// 
+	ULONG64 Misses;			// бΪաڴطĴдΪAllocations - Misses
+	ULONG64 Frees;			// 黹
+} ECHO_LOOKASIDE_CLASS_STATS, *PECHO_LOOKASIDE_CLASS_STATS;
+
+typedef struct _ECHO_LOOKASIDE_STATS {
+	ULONG ClassCount;
+	ULONG Reserved;
+	ECHO_LOOKASIDE_CLASS_STATS Classes[ECHO_LOOKASIDE_MAX_CLASSES];
+} ECHO_LOOKASIDE_STATS, *PECHO_LOOKASIDE_STATS;
+
+// ECHO_LOOKASIDE_STATSȡøбͳ
+#define IOCTL_ECHO_GET_LOOKASIDE_STATS CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 2,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+// дڵͨ
+// 豸ӿʱ·󸽼ECHO_PRIVATE_CHANNEL_NAMEþʹԼͨ
+typedef enum _ECHO_CHANNEL_MODE {
+	EchoChannelShared = 0,			// δָͨľ豸ͨ
+	EchoChannelPerHandle,			// ÿʹԼͨ
+	EchoChannelModeMax
+} ECHO_CHANNEL_MODE;
+
+#define ECHO_PRIVATE_CHANNEL_NAME	L"\\Private"
+
+// ͨ͵ȴɵǷ񰴴Ƭ
+typedef enum _ECHO_SHARD_MODE {
+	EchoShardNone = 0,				// Ƭдһͨһȴɵ
+	EchoShardPerProcessor,			// ύĴѡƬ
+	EchoShardPerHandle,				// ĹϣѡƬ
+	EchoShardModeMax
+} ECHO_SHARD_MODE;
+
+// 豸ͳƣÿԵļ
+// ӳٰlog2Ͱ0ͰΪ0~1usiͰΪ[2^i, 2^(i+1))usһͰиӳ
+#define ECHO_STATS_LATENCY_BUCKETS	32
+
+// ȼECHO_PRIORITY_CLASS
+#define ECHO_PRIORITY_CLASSES		3
+
+typedef struct _ECHO_STATS {
+	ULONG64 IntervalUs;		// ϴ㣨أʱ
+	ULONG64 BytesIn;		// дתֽ
+	ULONG64 BytesOut;		// ߵֽ
+	ULONG64 WriteRequests;
+	ULONG64 ReadRequests;
+	ULONG64 Completions;	// ɵ
+	ULONG64 Cancels;
+	ULONG64 AllocationFailures;
+	ULONG64 ReadWaits;		// ûݡȴдĶ
+	ULONG64 ReadWaitTimeouts;	// ȴڡ0ֽڵĶ
+	ULONG64 WriteWaits;		// ģʽFIFOȴռд
+	ULONG64 AdmissionWaits;	// ڴԤ㡢ȴ׼д
+	ULONG64 BatchOps;		// IOCTL_ECHO_BATCHִеĲ
+	ULONG64 UringOps;		// ڴ滷ִеĲ
+	LONG64 PendingDepth;	// ǰȴɵᱻ
+	LONG64 AdmissionDepth;	// ǰȴ׼дᱻ
+	ULONG64 BudgetUsed;		// ǰԤڴԤ㣨ֽڣᱻ
+	ULONG64 BudgetLimit;	// 豸ڴԤ㣨ֽڣ
+	ULONG64 SuspendCount;	// 豸뿪D0Ĵᱻ
+	ULONG64 LastSuspendUs;	// һιصĺʱ
+	ULONG64 LastResumeUs;	// һλصD0Ļصĺʱ
+	ULONG64 StopAcknowledged;	// һιʱEvtIoStopȷϡе
+	ULONG ProcessorCount;
+	ULONG ShardCount;		// Ƭĸ0ʾƬ
+	ULONG64 Latency[ECHO_STATS_LATENCY_BUCKETS];	// յɵӳٷֲ
+	ULONG64 ClassLatency[ECHO_PRIORITY_CLASSES][ECHO_STATS_LATENCY_BUCKETS];	// ȼECHO_PRIORITY_CLASSֿӳٷֲ
+} ECHO_STATS, *PECHO_STATS;
+
+// ѡULONG־ECHO_STATS
+// ָECHO_STATS_FLAG_RESETʱȡͬʱѼ㣬سֱöֵIntervalUsõ
+#define ECHO_STATS_FLAG_RESET	0x1
+
+#define IOCTL_ECHO_GET_STATS CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 3,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+// ĶȴãֻӰ췢͸ÿľ
+// EnableΪ0ʱûݿɶĶȴд󵽴ѣΪ0ʱ0ֽڣĬϣ
+// TimeoutMsΪȴޣں󷵻0ֽڣ0ʾһֱȴֱݡȡر
+typedef struct _ECHO_READ_WAIT {
+	ULONG Enable;
+	ULONG TimeoutMs;
+} ECHO_READ_WAIT, *PECHO_READ_WAIT;
+
+#define IOCTL_ECHO_SET_READ_WAIT CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 4,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+// ͨĹ㲥ãӰͨϵо
+// EnableΪ0ʱһд뽻˿еȴݵĶЩľҪ򿪶ȴûжڵȴʱͨд
+// EnableΪ0ʱһдֻһߣĬϣ
+typedef struct _ECHO_BROADCAST_CONFIG {
+	ULONG Enable;
+} ECHO_BROADCAST_CONFIG, *PECHO_BROADCAST_CONFIG;
+
+#define IOCTL_ECHO_SET_BROADCAST CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 5,\
+	METHOD_BUFFERED,\
+	FILE_WRITE_ACCESS)
+
+// ӳ٣λusΪʱֵһ
+// IOCTL_ECHO_SET_REQUEST_DELAYøþEchoCompletionDeadlineģʽµĶдӳ٣ECHO_REQUEST_DELAY_DEFAULTָʹMaxDelayMs
+// IOCTL_ECHO_DELAYÿDelayUs֮ɣɲ޹
+typedef struct _ECHO_REQUEST_DELAY {
+	ULONG DelayUs;
+} ECHO_REQUEST_DELAY, *PECHO_REQUEST_DELAY;
+
+#define ECHO_REQUEST_DELAY_DEFAULT	0xFFFFFFFF
+
+#define IOCTL_ECHO_SET_REQUEST_DELAY CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 6,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+#define IOCTL_ECHO_DELAY CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 7,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+// ɶʱãEchoCompletionTimerģʽ¸öʱÿһ
+// ͨʱֻϵͳʱжʱʱ̵ĶʱжϼͨԼ15.6ms൱
+// ߾ȶʱָʱ̴Ǹʱж
+// TolerableDelayMsϵͳΪϲʱжϰͨʱƳٴʱ䣬߾ȶʱΪ0
+typedef struct _ECHO_TIMER_CONFIG {
+	ULONG PeriodUs;			// ڣСECHO_TIMER_MIN_PERIOD_US
+	ULONG HighResolution;	// 0ʱʹø߾ȶʱ
+	ULONG TolerableDelayMs;
+} ECHO_TIMER_CONFIG, *PECHO_TIMER_CONFIG;
+
+#define ECHO_TIMER_MIN_PERIOD_US	500
+
+// ECHO_TIMER_CONFIG´ɶʱͬʱ㶶ͳ
+#define IOCTL_ECHO_SET_TIMER CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 8,\
+	METHOD_BUFFERED,\
+	FILE_WRITE_ACCESS)
+
+// ɶʱĶÿδʱʵʱʱ̵ʱ䣬log2ͰECHO_STATS.Latencyͬ
+// ʱΪһʱ̼һڣ津ĳٵۻƯ
+typedef struct _ECHO_TIMER_JITTER {
+	ECHO_TIMER_CONFIG Config;	// ǰ
+	ULONG Reserved;
+	ULONG64 Fires;			// 
+	ULONG64 Early;			// ʱ̴Ĵ0Ͱ
+	ULONG64 Missed;			// ٵһڶ
+	ULONG64 TotalLateUs;	// ٵʱ֮ͣFiresõƽֵ
+	ULONG64 MaxLateUs;
+	ULONG64 Histogram[ECHO_STATS_LATENCY_BUCKETS];
+} ECHO_TIMER_JITTER, *PECHO_TIMER_JITTER;
+
+// ѡULONG־ECHO_TIMER_JITTERָECHO_STATS_FLAG_RESETʱȡͬʱ
+#define IOCTL_ECHO_GET_TIMER_JITTER CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 9,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+// ͨģʽãӰͨϵо
+// EnableΪ0ʱλΪнֽFIFOԿԽдı߽ȡFIFOʱдȴڳռ
+// EnableΪ0ʱһζһдĩβFIFOʱд󷵻STATUS_DEVICE_BUSYĬϣ
+// 㿽ַʱд͹ȴģʽFIFOʱǼ𣬶󷵻STATUS_DEVICE_BUSY
+typedef struct _ECHO_STREAM_CONFIG {
+	ULONG Enable;
+} ECHO_STREAM_CONFIG, *PECHO_STREAM_CONFIG;
+
+#define IOCTL_ECHO_SET_STREAM CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 10,\
+	METHOD_BUFFERED,\
+	FILE_WRITE_ACCESS)
+
+// һοִждСдΪÿβһIRPĿ
+// ΪECHO_BATCHͷCountECHO_BATCH_OPOffsetͷƫ
+// ECHO_BATCH_OP_WRITEȡLengthֽڴڵͨECHO_BATCH_OP_READͨȡLengthֽڵ
+// ˳ִУɲԣÿĽдStatusInformationһʧܲӰ
+// дȴFIFO򳬳ڴԤʱòSTATUS_DEVICE_BUSYûʱ0ֽ
+// 㿽ģʽдȰѹдλǺ棻ڻλΪʱֱȡд
+// ͬһܶ뻺󷵻
+#define ECHO_BATCH_OP_WRITE		1
+#define ECHO_BATCH_OP_READ		2
+
+#define ECHO_BATCH_MAX_OPS		1024
+
+typedef struct _ECHO_BATCH_OP {
+	ULONG Op;				// ECHO_BATCH_OP_WRITEECHO_BATCH_OP_READ
+	ULONG Offset;			// еƫ
+	ULONG Length;			// дĳȣȡ󳤶
+	LONG Status;			// òNTSTATUS
+	ULONG Information;		// дȡֽ
+	ULONG Reserved;
+} ECHO_BATCH_OP, *PECHO_BATCH_OP;
+
+typedef struct _ECHO_BATCH {
+	ULONG Count;			// ECHO_BATCH_MAX_OPS
+	ULONG Reserved;
+	ECHO_BATCH_OP Ops[ANYSIZE_ARRAY];
+} ECHO_BATCH, *PECHO_BATCH;
+
+// ڻͷƫ
+#define ECHO_BATCH_DATA_OFFSET(Count)	(FIELD_OFFSET(ECHO_BATCH, Ops) + (Count) * sizeof(ECHO_BATCH_OP))
+
+#define IOCTL_ECHO_BATCH CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 11,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+// ڴ滷ӦԼڴзύɻύȡɻддٸԾһIRP
+// ӦIOCTL_ECHO_URING_SETUPǼһڴ棬һֱڴڴڼI/Oȡرվע
+// ڴΪECHO_URING_HEADERSqEntriesECHO_URING_SQECqEntriesECHO_URING_CQEֵƫĺ
+// ͷβǲƵļ뻷ĴСһõ±ꣻӦдSqTailCqHeadдSqHeadCqTail
+// ӦύƽSqTail֮󣬷IOCTL_ECHO_URING_ENTERΪ壬ִύĲ
+// IOCTL_ECHO_BATCHִͬУȴɻʱʣύһ
+#define ECHO_URING_MAX_ENTRIES	4096
+
+typedef struct _ECHO_URING_SETUP {
+	ULONG SqEntries;		// ύĴС2ݣECHO_URING_MAX_ENTRIES
+	ULONG CqEntries;		// ɻĴС2ݣСSqEntries
+} ECHO_URING_SETUP, *PECHO_URING_SETUP;
+
+typedef struct _ECHO_URING_SQE {
+	ULONG Op;				// ECHO_BATCH_OP_WRITEECHO_BATCH_OP_READ
+	ULONG Offset;			// еƫ
+	ULONG Length;			// дĳȣȡ󳤶
+	ULONG Reserved;
+	ULONG64 UserData;		// ԭ
+} ECHO_URING_SQE, *PECHO_URING_SQE;
+
+typedef struct _ECHO_URING_CQE {
+	ULONG64 UserData;
+	LONG Status;			// òNTSTATUS
+	ULONG Information;		// дȡֽ
+} ECHO_URING_CQE, *PECHO_URING_CQE;
+
+// ĸռһУӦúдԵļʱ
+typedef struct _ECHO_URING_HEADER {
+	volatile ULONG SqHead;	// ȡߵύ
+	ULONG Reserved0[15];
+	volatile ULONG SqTail;	// Ӧãύύ
+	ULONG Reserved1[15];
+	volatile ULONG CqHead;	// ӦãѴ
+	ULONG Reserved2[15];
+	volatile ULONG CqTail;	// д
+	ULONG Reserved3[15];
+	ULONG SqEntries;		// ڵǼʱд
+	ULONG CqEntries;
+	ULONG DataOffset;		// ڴ濪ͷƫ
+	ULONG DataLength;
+	ULONG Reserved4[12];
+} ECHO_URING_HEADER, *PECHO_URING_HEADER;
+
+#define ECHO_URING_SQ_OFFSET				sizeof(ECHO_URING_HEADER)
+#define ECHO_URING_CQ_OFFSET(Sq)			(ECHO_URING_SQ_OFFSET + (Sq) * sizeof(ECHO_URING_SQE))
+#define ECHO_URING_DATA_OFFSET(Sq, Cq)		((ECHO_URING_CQ_OFFSET(Sq) + (Cq) * sizeof(ECHO_URING_CQE) + 63) & ~(size_t)63)
+
+// ΪECHO_URING_SETUPΪڴ棬ɹǼǺֱע
+#define IOCTL_ECHO_URING_SETUP CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 12,\
+	METHOD_OUT_DIRECT,\
+	FILE_ANY_ACCESS)
+
+// 壬ûInformationΪȡߵύ
+#define IOCTL_ECHO_URING_ENTER CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 13,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+// ·ϵתֻӰڵͨ
+// ECHO_TRANSFORM_DIGITS_UTF16Ѷȡ0~9תΪ~ţUTF-16LEֽڰLatin-1תΪͬһַ
+// ECHO_TRANSFORM_DIGITS_UTF8ͬUTF-8
+// ȡ߳ȵ1/2UTF-161/3UTF-8ݣתܷŽĻ
+// ͹ڴ滷Ķ㲥תдݱԭ
+#define ECHO_TRANSFORM_NONE				0
+#define ECHO_TRANSFORM_DIGITS_UTF16		1
+#define ECHO_TRANSFORM_DIGITS_UTF8		2
+#define ECHO_TRANSFORM_COUNT			3
+
+typedef struct _ECHO_TRANSFORM_CONFIG {
+	ULONG Transform;		// ECHO_TRANSFORM_*
+} ECHO_TRANSFORM_CONFIG, *PECHO_TRANSFORM_CONFIG;
+
+#define IOCTL_ECHO_SET_TRANSFORM CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 14,\
+	METHOD_BUFFERED,\
+	FILE_WRITE_ACCESS)
+
+// 豸Ŀɵ豸ʱParametersעȡʱIOCTL_ECHO_SET_PARAMETERS޸
+// ʱȼֶΣκһϷʱ޸κβDispatchModeֻڴʱָ
+// 뵱ǰķַʽͬʱָECHO_PARAMETERS_FLAG_PERSIST豸´ʱЧ
+// עеֵֶͬMemoryBudgetΪMemoryBudgetKBKBϷֵԣʹĬֵ
+// ޸豸õĿɲԡʱɵӳģ͡ȼȨأҪдȨޣ
+// ޸ͨõĿ󣨹㲥ģʽ·任Ӱ칲ͨоͬҪдȨ
+// ָECHO_PARAMETERS_FLAG_PERSISTʱ򿪾Ḻ̌SeLoadDriverPrivilege򷵻STATUS_PRIVILEGE_NOT_HELD
+#define ECHO_PARAMETERS_FLAG_PERSIST	0x00000001	// ͬʱдעΪ豸´ʱĬֵ
+
+typedef struct _ECHO_PARAMETERS {
+	ULONG Flags;				// ECHO_PARAMETERS_FLAG_*ֻ
+	ULONG MaxWriteLength;		// д󳤶ȣ1 ~ MaxWriteLimit
+	ULONG TimerPeriodUs;		// ɶʱڣECHO_TIMER_MIN_PERIOD_US ~ 60s
+	ULONG CompletionDelayMs;	// ɲԵMaxDelayMsϲģʽΪ1 ~ 1000ģʽ²60000
+	ULONG BatchSize;			// ɲԵBatchSize1 ~ 1024
+	ULONG DispatchMode;			// ECHO_DISPATCH_MODE豸´ʱʹõķַʽ
+	ULONG64 MemoryBudget;		// ͨŵܳȵޣֽڣСMaxWriteLength
+	ULONG MaxWriteLimit;		// ֻλҲMaxWriteLength
+	ULONG ActiveDispatchMode;	// ֻĬ϶еǰķַʽ
+} ECHO_PARAMETERS, *PECHO_PARAMETERS;
+
+// ECHO_PARAMETERS޸豸Ŀɵ
+#define IOCTL_ECHO_SET_PARAMETERS CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 15,\
+	METHOD_BUFFERED,\
+	FILE_WRITE_ACCESS)
+
+// ECHO_PARAMETERSȡ豸ǰĿɵ
+#define IOCTL_ECHO_GET_PARAMETERS CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 16,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+
+// ϳɵ豸ӳģͣѻ豸Ӳʹʱÿдķʱ䰴ģͳ
+// ģͻʱдٰɲɣǹʱϣڷʱ֮ɣECHO_LATENCY_NONEҴΪ0ʱָɲ
+// ʱ = ģͳӳ + ʱ䣻ʱ䰴BytesPerSecond㣬һ·ǰһſʼһ
+// ʹSeedΪӵαУÿģʱ¿ʼͬ˳򵽴ʱͬ
+// ʱľʱֵĽģ500us
+typedef enum _ECHO_LATENCY_MODEL {
+	EchoLatencyNone,			// ֻд
+	EchoLatencyConstant,		// ̶ΪMinUs
+	EchoLatencyUniform,			// [MinUs, MaxUs]ھȷֲ
+	EchoLatencyExponential,		// MinUsϾֵΪMeanUsֲָMaxUs
+	EchoLatencyBimodal,			// ΪMinUsTailPpmĸΪMaxUs·β
+	EchoLatencyModelMax
+} ECHO_LATENCY_MODEL;
+
+typedef struct _ECHO_LATENCY_CONFIG {
+	ULONG Model;			// ECHO_LATENCY_MODEL
+	ULONG MinUs;
+	ULONG MaxUs;			// ECHO_LATENCY_MAX_USȷֲ˫ֲʱСMinUs
+	ULONG MeanUs;			// ֲָľֵ
+	ULONG TailPpm;			// ˫ֲ·ĸʣ֮һ1000000
+	ULONG Reserved;
+	ULONG64 BytesPerSecond;	// ·0ʾƣСECHO_LATENCY_MIN_BANDWIDTH
+	ULONG64 Seed;			// αеӣ0ʹù̶Ĭ
+} ECHO_LATENCY_CONFIG, *PECHO_LATENCY_CONFIG;
+
+#define ECHO_LATENCY_MAX_US			(60 * 1000 * 1000)
+#define ECHO_LATENCY_MIN_BANDWIDTH	4096
+
+// ECHO_LATENCY_CONFIGӳģͣѹʱϵ԰ԭķʱ
+#define IOCTL_ECHO_SET_LATENCY_MODEL CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 17,\
+	METHOD_BUFFERED,\
+	FILE_WRITE_ACCESS)
+
+// ECHO_LATENCY_CONFIGȡõǰӳģ
+#define IOCTL_ECHO_GET_LATENCY_MODEL CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 18,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+// ȼɾþʱΪEchoPriorityNormal
+// EchoCompletionTimerEchoCompletionCoalesceģʽ£ÿȴɵֿŶӣ
+// 水ȨؼȨתֽڼƷѵĲתÿһÿõȨ * ECHO_PRIORITY_QUANTUMֽڵĶȣ
+// Ϊʱɸ󲢿۳ֽӳеС󲻻ڴ40KB֮
+// EchoCompletionImmediateEchoCompletionDeadlineģʽӳģɣֻͳ
+typedef enum _ECHO_PRIORITY_CLASS {
+	EchoPriorityHigh,			// ӳе
+	EchoPriorityNormal,			// Ĭ
+	EchoPriorityBulk,			// 
+	EchoPriorityClassMax
+} ECHO_PRIORITY_CLASS;
+
+#define ECHO_PRIORITY_QUANTUM		16384		// ÿһÿλȨصĶȣֽڣ
+#define ECHO_MAX_PRIORITY_WEIGHT	64
+
+// ECHO_PRIORITYøþ˺Ķдȼ
+typedef struct _ECHO_PRIORITY {
+	ULONG Class;			// ECHO_PRIORITY_CLASS
+} ECHO_PRIORITY, *PECHO_PRIORITY;
+
+#define IOCTL_ECHO_SET_PRIORITY CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 19,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
+
+// Ȩأ1 ~ ECHO_MAX_PRIORITY_WEIGHTĬΪ841
+typedef struct _ECHO_PRIORITY_WEIGHTS {
+	ULONG Weights[ECHO_PRIORITY_CLASSES];
+} ECHO_PRIORITY_WEIGHTS, *PECHO_PRIORITY_WEIGHTS;
+
+// ECHO_PRIORITY_WEIGHTS豸ĸȨ
+#define IOCTL_ECHO_SET_PRIORITY_WEIGHTS CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 20,\
+	METHOD_BUFFERED,\
+	FILE_WRITE_ACCESS)
+
+// ECHO_PRIORITY_WEIGHTSȡõǰȨ
+#define IOCTL_ECHO_GET_PRIORITY_WEIGHTS CTL_CODE(FILE_DEVICE_UNKNOWN,\
+	IOCTL_ECHO_INDEX + 21,\
+	METHOD_BUFFERED,\
+	FILE_ANY_ACCESS)
@@ -1,4 +1,5 @@
 #include "driver.h"
+#include "queue.tmh"
 
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text (PAGE, EchoQueueInitialize)
@@ -6,13 +7,16 @@
 #endif
 
 // ͳʼ
-// 1 ʼĬ϶УWDF_IO_QUEUE_CONFIGôдIOĻص
+// 1 ʼĬ϶УWDF_IO_QUEUE_CONFIGôлдIOĻص
 // 2 ʼеԺͻͬ͡ٻصʼ
 // 3 
-// 4 ͳʼʱ
+// 4 ȴɵֶУƬʱƬ
+// 5 ͳʼʱ
+// ConfigַָʽԼλĲĴСݵܳ޺ͷƬʽ
 NTSTATUS
 EchoQueueInitialize(
-	WDFDEVICE Device
+	WDFDEVICE Device,
+	PECHO_QUEUE_CONFIG Config
 )
 {
 	WDFQUEUE queue;
@@ -20,27 +24,36 @@ EchoQueueInitialize(
 	PQUEUE_CONTEXT queueContext;
 	WDF_IO_QUEUE_CONFIG    queueConfig;
 	WDF_OBJECT_ATTRIBUTES  queueAttributes;
+	WDF_OBJECT_ATTRIBUTES  lockAttributes;
 
 	PAGED_CODE();
 
-	// 1 ʼĬ϶УWDF_IO_QUEUE_CONFIGôдIOĻص
+	// 1 ʼĬ϶УWDF_IO_QUEUE_CONFIGôлдIOĻص
 
-	// ʼĬ϶УдһֻܴһI/O
+	// дһֻܴһI/O󣻲дʱꡢȴɵ󲻻ķַ
 	WDF_IO_QUEUE_CONFIG_INIT_DEFAULT_QUEUE(
 		&queueConfig,
-		WdfIoQueueDispatchSequential
+		(Config->DispatchMode == EchoDispatchParallel) ? WdfIoQueueDispatchParallel : WdfIoQueueDispatchSequential
 	);
 
 	// öеĶдĻص
 	queueConfig.EvtIoRead = EchoEvtIoRead;
 	queueConfig.EvtIoWrite = EchoEvtIoWrite;
 
+	// ɲ
+	queueConfig.EvtIoDeviceControl = EchoEvtIoDeviceControl;
+
+	// 豸ʱȷе󣬲ȴ
+	if (Config->FastSuspend) {
+		queueConfig.EvtIoStop = EchoEvtIoStop;
+	}
+
 	// 2 ʼеԺͻ
 	WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&queueAttributes, QUEUE_CONTEXT);
 
-	// ͬΧΪWdfSynchronizationScopeQueueΪTimerĸEchoTimerCreateã
-	// ڴ£кTimerĻصͬһͬ
-	queueAttributes.SynchronizationScope = WdfSynchronizationScopeQueue;
+	// ʹÿܵͬΧлصȡصͶʱصԲִ
+	// ɻλPendingLockֱ𱣻
+	queueAttributes.SynchronizationScope = WdfSynchronizationScopeNone;
 
 	// öʱĻص
 	queueAttributes.EvtDestroyCallback = EchoEvtIoQueueContextDestroy;
@@ -54,23 +67,120 @@ EchoQueueInitialize(
 	);
 
 	if (!NT_SUCCESS(status)) {
-		KdPrint(("WdfIoQueueCreate failed 0x%x\n", status));
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "WdfIoQueueCreate failed %!STATUS!", status);
 		return status;
 	}
 
 	// 2.x еĻʼ
 	queueContext = QueueGetContext(queue);
 
-	queueContext->Buffer = NULL;
-	queueContext->Timer = NULL;
+	queueContext->Config = *Config;
+
+	queueContext->SuspendCount = 0;
+	queueContext->LastSuspendUs = 0;
+	queueContext->LastResumeUs = 0;
+	queueContext->StopAcknowledged = 0;
+	InitializeListHead(&queueContext->ChannelList);
+	InitializeListHead(&queueContext->UringList);
+	queueContext->ReadWaitSuspended = FALSE;
+	queueContext->StreamSuspended = FALSE;
+	queueContext->UringSuspended = FALSE;
+
+	// ˽ͨ͹ڴ滷Ϊ
+	WDF_OBJECT_ATTRIBUTES_INIT(&lockAttributes);
+	lockAttributes.ParentObject = queue;
+
+	status = WdfSpinLockCreate(&lockAttributes, &queueContext->ChannelLock);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "WdfSpinLockCreate failed %!STATUS!", status);
+		return status;
+	}
+
+	queueContext->Policy.Mode = ECHO_DEFAULT_COMPLETION_MODE;
+	queueContext->Policy.MaxDelayMs = Config->CompletionDelayMs;
+	queueContext->Policy.BatchSize = Config->BatchSize;
+	queueContext->PriorityWeights[EchoPriorityHigh] = ECHO_DEFAULT_WEIGHT_HIGH;
+	queueContext->PriorityWeights[EchoPriorityNormal] = ECHO_DEFAULT_WEIGHT_NORMAL;
+	queueContext->PriorityWeights[EchoPriorityBulk] = ECHO_DEFAULT_WEIGHT_BULK;
+
+	// ɵʱ״̬
+	status = EchoParametersInitialize(queue);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoParametersInitialize failed %!STATUS!", status);
+		return status;
+	}
+
+	// ÿԵͳƼ
+	status = EchoStatsInitialize(&queueContext->Stats);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoStatsInitialize failed %!STATUS!", status);
+		return status;
+	}
+
+	// Сּĺбͨд󰴳ȡÿĻ黹
+	// ʧʱԻᱻٻصEchoBufferPoolCleanupֻɾѳʼļ
+	// ڴԤ㲻Сڵд󳤶ȣκһдնܱ׼
+	status = EchoBufferPoolInitialize(&queueContext->BufferPool,
+		Config->ChunkSize,
+		(LONG64)max(Config->MemoryBudget, (ULONG64)Config->MemoryCap));
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoBufferPoolInitialize failed %!STATUS!", status);
+		return status;
+	}
+
+	// ڴԤдȴ׼
+	status = EchoAdmissionInitialize(&queueContext->Admission, queue);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoAdmissionInitialize failed %!STATUS!", status);
+		return status;
+	}
 
-	queueContext->CurrentRequest = NULL;
-	queueContext->CurrentStatus = STATUS_INVALID_DEVICE_REQUEST;
+	// ʼͨԤȷĻλĲ
+	// ʧʱԻᱻٻصEchoChannelCleanupԴδʼͨ
+	status = EchoChannelInitialize(&queueContext->Channel,
+		queue,
+		queue,
+		Config->SlotCount,
+		Config->ChunkSize,
+		Config->MemoryCap,
+		&queueContext->BufferPool);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoChannelInitialize failed %!STATUS!", status);
+		return status;
+	}
 
-	// 4 ͳʼʱ
-	status = EchoTimerCreate(&queueContext->Timer, TIMER_PERIOD, queue);
+	// 4 ȴɵֶСȴͺϲʱ
+	status = EchoCompletionInitialize(&queueContext->Pending, queue);
 	if (!NT_SUCCESS(status)) {
-		KdPrint(("Error creating timer 0x%x\n", status));
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoCompletionInitialize failed %!STATUS!", status);
+		return status;
+	}
+
+	// ƬʱƬͨ͵ȴ
+	status = EchoShardInitialize(queue);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoShardInitialize failed %!STATUS!", status);
+		return status;
+	}
+
+	// Լʹõʱ
+	status = EchoWheelInitialize(&queueContext->Wheel, queue);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoWheelInitialize failed %!STATUS!", status);
+		return status;
+	}
+
+	// ϳɵ豸ӳģͣĬϲ
+	status = EchoLatencyInitialize(&queueContext->Latency, queue);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoLatencyInitialize failed %!STATUS!", status);
+		return status;
+	}
+
+	// 5 ͳʼʱ
+	status = EchoTickerInitialize(&queueContext->Ticker, queue, EchoEvtTimerFunc, Config->TimerPeriodUs);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoTickerInitialize failed %!STATUS!", status);
 		return status;
 	}
 
@@ -78,11 +188,12 @@ EchoQueueInitialize(
 }
 
 
-// ͳʼʱ
+// ͳʼʱPeriodΪ0ʱһԶʱ
 NTSTATUS
 EchoTimerCreate(
 	IN WDFTIMER*       Timer,
 	IN ULONG           Period,
+	IN PFN_WDF_TIMER   TimerFunc,
 	IN WDFQUEUE        Queue
 )
 {
@@ -92,13 +203,14 @@ EchoTimerCreate(
 
 	PAGED_CODE();
 
-	// ڶʱʱ2000msصEchoEvtTimerFunc
-	// WDF_TIMER_CONFIG_INIT_PERIODIC sets AutomaticSerialization to TRUE by default.
-	WDF_TIMER_CONFIG_INIT_PERIODIC(&timerConfig, EchoEvtTimerFunc, Period);
+	// ʱʱPeriodmsصTimerFunc
+	// ûͬΧʱصԼȡPendingLockرAutomaticSerialization
+	WDF_TIMER_CONFIG_INIT_PERIODIC(&timerConfig, TimerFunc, Period);
+	timerConfig.AutomaticSerialization = FALSE;
 
 	// öʱĸΪĬ϶
 	WDF_OBJECT_ATTRIBUTES_INIT(&timerAttributes);
-	timerAttributes.ParentObject = Queue;			// Synchronize with the I/O Queue
+	timerAttributes.ParentObject = Queue;
 
 	// ʱ
 	Status = WdfTimerCreate(&timerConfig,
@@ -120,29 +232,88 @@ EchoEvtIoQueueContextDestroy(
 {
 	PQUEUE_CONTEXT queueContext = QueueGetContext(Object);
 	
-	if (queueContext->Buffer != NULL) {
-		ExFreePool(queueContext->Buffer);
-	}
+	// Ȱѹͨ͸ƬͨеĿ黹бɾб
+	// ˽ͨļ٣ļڶ
+	EchoChannelCleanup(&queueContext->Channel);
+	EchoShardCleanup((WDFQUEUE)Object);
+	EchoBufferPoolCleanup(&queueContext->BufferPool);
+	EchoStatsCleanup(&queueContext->Stats);
 
 	return;
 }
 
 
-// I/OȡʱĻص
-// I/OҪΪȡWdfRequestMarkCancelableȻȷʵȡˣŻøûص
+// ȴɵֶбȡʱĻص
+// Ѿֶȡ£ֻ¸ֶһļ
+// ÿȡӰ죬رվʱȡܿ
 VOID
-EchoEvtRequestCancel(
+EchoEvtPendingCanceledOnQueue(
+	IN WDFQUEUE   Queue,
 	IN WDFREQUEST Request
 )
 {
-	PQUEUE_CONTEXT queueContext = QueueGetContext(WdfRequestGetIoQueue(Request));
+	PECHO_PENDING pending = PendingGetContext(Queue)->Pending;
+	PQUEUE_CONTEXT queueContext = QueueGetContext(pending->Queue);
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_COMPLETION, "EchoEvtPendingCanceledOnQueue called on Request 0x%p", Request);
 
-	KdPrint(("EchoEvtRequestCancel called on Request 0x%p\n", Request));
+	WdfSpinLockAcquire(pending->PendingLock);
+	pending->PendingCount--;
+	WdfSpinLockRelease(pending->PendingLock);
+
+	EchoStatsAdd(&queueContext->Stats, Pending, -1);
+
+	EchoStatsAdd(&queueContext->Stats, Cancels, 1);
 
 	WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
 
-	ASSERT(queueContext->CurrentRequest == Request);
-	queueContext->CurrentRequest = NULL;
+	return;
+}
+
+
+// Ĭ϶еEvtIoStopصFastSuspendʱע
+// 豸뿪D0ʱܶеÿһΣȴ㿽תȴģʽ׼롢ʱ֡ڴ滷
+// ڴֻȷϡŶӣԭϣԭĻУصD0
+// Щ󲻷ӲD0֮ⱻȡͨĶʱҲû
+// б豸Ƴʱйȴתϵдתʱ
+VOID
+EchoEvtIoStop(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	IN ULONG      ActionFlags
+)
+{
+	TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_IO, "EchoEvtIoStop Request 0x%p ActionFlags 0x%x", Request, ActionFlags);
+
+	if (ActionFlags & WdfRequestStopActionSuspend) {
+		InterlockedIncrement(&QueueGetContext(Queue)->StopAcknowledged);
+		WdfRequestStopAcknowledge(Request, FALSE);
+		return;
+	}
+
+	if (ActionFlags & WdfRequestStopActionPurge) {
+		EchoQueueReleaseWaiters(Queue);
+	}
+
+	return;
+}
+
+
+// йȴ󣬴˺ֱ豸صD0ٹȴ
+// ȴݵĶ󷵻0ֽڣȴռ͵ȴ׼д󷵻STATUS_DEVICE_BUSYʱϵɣڴ滷ע
+// ͬͶʱãظãѾɵ󲻻ٱҵ
+VOID
+EchoQueueReleaseWaiters(
+	IN WDFQUEUE   Queue
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+
+	EchoReadWaitReleaseAll(queueContext);
+	EchoAdmissionReleaseAll(Queue);
+	EchoStreamReleaseAll(queueContext);
+	EchoUringReleaseAll(Queue);
+	EchoWheelFlush(Queue);
 
 	return;
 }
@@ -160,8 +331,17 @@ EchoEvtIoRead(
 Routine Description:
 
 	This event is called when the framework receives IRP_MJ_READ request.
-	It will copy the content from the queue-context buffer to the request buffer.
-	If the driver hasn't received any write request earlier, the read returns zero.
+	It will copy up to Length bytes from the read cursor of the oldest slot of
+	the ring of the request's channel to the request buffer, so a small reader streams
+	through a large write over successive reads. If the ring is empty and the
+	device forwards without copying, the oldest parked write is copied straight
+	into this request and both complete together. If there is no stored data,
+	the read returns zero, unless the handle enabled read waiting with
+	IOCTL_ECHO_SET_READ_WAIT, in which case the request is parked until a
+	write lands on the channel or its timeout expires. When the channel has a
+	transform selected with IOCTL_ECHO_SET_TRANSFORM, only as much data as the
+	transformed output can fit is taken, and it is transformed in place in
+	the request buffer before completion.
 
 Arguments:
 
@@ -184,58 +364,122 @@ Return Value:
 {
 	NTSTATUS Status;
 	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
-	WDFMEMORY memory;
+	PECHO_CHANNEL channel;
+	WDFFILEOBJECT fileObject;
+	PFILE_CONTEXT fileContext;
+	PVOID buffer;
 
 	_Analysis_assume_(Length > 0);
 
-	KdPrint(("EchoEvtIoRead Called! Queue 0x%p, Request 0x%p Length %Iu\n", Queue, Request, Length));
+	TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_IO, "EchoEvtIoRead Called! Queue 0x%p, Request 0x%p Length %I64u", Queue, Request, (ULONG64)Length);
 
-	// ûпɶȡ
-	if ((queueContext->Buffer == NULL)) {
-		WdfRequestCompleteWithInformation(Request, STATUS_SUCCESS, (ULONG_PTR)0L);
-		return;
-	}
+	RequestGetContext(Request)->StartTime = EchoStatsTimestamp();
+	EchoStatsAdd(&queueContext->Stats, ReadRequests, 1);
 
-	_Analysis_assume_(queueContext->Length > 0);
-	if (queueContext->Length < Length) {
-		Length = queueContext->Length;
-	}
+	// ѡƬ˺һֱʹƬͨ͵ȴ
+	EchoShardAssign(Queue, Request);
+	EchoCompletionClassify(Request);
+	channel = EchoRequestGetChannel(Request);
 
 	// ȡrequestĴ洢ַ
-	Status = WdfRequestRetrieveOutputMemory(Request, &memory);
+	// I/OʱǿܵϵͳֱI/OʱMDLӳϵͳַ
+	Status = WdfRequestRetrieveOutputBuffer(Request, Length, &buffer, NULL);
 	if (!NT_SUCCESS(Status)) {
-		KdPrint(("EchoEvtIoRead Could not get request memory buffer 0x%x\n", Status));
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_IO, "EchoEvtIoRead Could not get request buffer %!STATUS!", Status);
 		//WdfVerifierDbgBreakPoint();
 		WdfRequestCompleteWithInformation(Request, Status, 0L);
 		return;
 	}
 
-	// queueContext->BufferȡݵrequestĴ洢ַ
-	Status = WdfMemoryCopyFromBuffer(
-		memory,				// destination
-		0,					// offset into the destination memory
-		queueContext->Buffer,
-		Length);
-
-	if (!NT_SUCCESS(Status)) {
-		KdPrint(("EchoEvtIoRead: WdfMemoryCopyFromBuffer failed 0x%x\n", Status));
-		WdfRequestComplete(Request, Status);
+	if (EchoReadServe(channel, Request, buffer, (ULONG)Length)) {
 		return;
 	}
 
-	WdfRequestSetInformation(Request, (ULONG_PTR)Length);
-
-	// ørequestԱȡȡĻصΪEchoEvtRequestCancel
-	WdfRequestMarkCancelable(Request, EchoEvtRequestCancel);
+	// ûпɶȡݣ˶ȴʱrequestȴд
+	fileObject = WdfRequestGetFileObject(Request);
+	if (fileObject != NULL) {
+		fileContext = FileGetContext(fileObject);
+		if (fileContext->ReadWait) {
+			EchoReadWaitPark(channel, Request, buffer, (ULONG)Length, fileContext->ReadTimeoutMs);
+			return;
+		}
+	}
 
-	// 洢ǰrequestеĻ
-	queueContext->CurrentRequest = Request;
-	queueContext->CurrentStatus = Status;
+	// ֱӷ0ֽ
+	WdfRequestCompleteWithInformation(Request, STATUS_SUCCESS, (ULONG_PTR)0L);
 
 	return;
 }
 
 
+// ͨȡ󣬶ʱ沢TRUE
+// ûʱFALSEɵߴ
+// صͶȴĻѶ
+BOOLEAN
+EchoReadServe(
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Channel->Queue);
+	PCECHO_TRANSFORM transform = Channel->Transform;
+	NTSTATUS status;
+	ULONG bytesRead;
+	BOOLEAN spilled = FALSE;
+
+	// ͨתʱֻȡתܷŽ
+	Length = EchoTransformCapacity(transform, Length);
+	if (Length == 0) {
+		WdfRequestSetInformation(Request, (ULONG_PTR)0L);
+		EchoCompletionPend(Channel->Queue, Request, STATUS_BUFFER_TOO_SMALL);
+		return TRUE;
+	}
+
+	// дĲ۵Ķα괦ȡݣδĲĶ
+	// ģʽ¶һۺһֱۣ
+	// λԹдȶλ
+	bytesRead = Channel->Stream ?
+		EchoStreamRead(Channel, Buffer, Length) :
+		EchoRingRead(&Channel->Ring, Buffer, Length);
+
+	// 㿽ģʽ£ֱӴӹдȡ
+	// дȶʱλٴӻλʽȡ
+	// Ĳύ֮ǰ֮ǰͣ£ݺȴĶ
+	if (bytesRead == 0 && queueContext->Config.ZeroCopy) {
+		bytesRead = EchoForwardTake(Channel, Buffer, Length);
+		if (bytesRead == 0) {
+			bytesRead = EchoRingRead(&Channel->Ring, Buffer, Length);
+			spilled = (bytesRead != 0);
+		}
+	}
+
+	if (bytesRead == 0) {
+		return FALSE;
+	}
+
+	if (spilled) {
+		EchoReadWaitWake(Channel);
+	}
+
+	// ߵڳ˿ռ䣬ѵȴռд뻷λ
+	// 黹ڴԤ׼ȴд
+	// ڽ֮ǰãrequestɺ漴رգ˽ͨļ
+	EchoStreamWake(Channel);
+	EchoAdmissionRun(Channel->Queue);
+
+	EchoStatsAdd(&queueContext->Stats, BytesOut, bytesRead);
+	status = EchoTransformApply(transform, Buffer, bytesRead, &bytesRead);
+	WdfRequestSetInformation(Request, (ULONG_PTR)bytesRead);
+
+	// 棬ɲɸrequest
+	EchoCompletionPend(Channel->Queue, Request, status);
+
+	return TRUE;
+}
+
+
 // IoWriteĻص
 VOID
 EchoEvtIoWrite(
@@ -248,10 +492,24 @@ EchoEvtIoWrite(
 Routine Description:
 
 	This event is invoked when the framework receives IRP_MJ_WRITE request.
-	This routine allocates memory buffer, copies the data from the request to it,
-	and stores the buffer pointer in the queue-context with the length variable
-	representing the buffers length. The actual completion of the request
-	is defered to the periodic timer dpc.
+	This routine copies the data from the request into the next free slot of
+	the ring of the request's channel, so back-to-back writes are kept in FIFO order.
+	Writes longer than one chunk are stored as a chain of chunks, up to the
+	memory cap of the ring. When the device forwards without copying, the
+	request is parked instead and its direct I/O buffer is handed to the next
+	read. When the channel is in stream mode and the ring is full, the request
+	waits until reads free enough space. When the channel broadcasts and reads
+	are waiting, the data is copied once into a reference-counted buffer that
+	every waiting read receives. Data copied into the device is charged
+	against the device-wide memory budget first; a write that would exceed
+	it waits until memory is returned and is admitted in turn with the
+	writes of other handles. A parked write is charged only when it is
+	spilled into the ring; one that would exceed the budget stays parked
+	until a read takes it or memory is returned. The
+	chunk buffers come from the size-classed lookaside lists of the
+	queue, so this path does not go to the pool once the lists are warm. The
+	actual completion of the request is decided by the completion policy of
+	the device.
 
 Arguments:
 
@@ -273,72 +531,487 @@ Return Value:
 --*/
 {
 	NTSTATUS Status;
-	WDFMEMORY memory;
 	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	PECHO_CHANNEL channel;
+	PVOID buffer;
 
 	_Analysis_assume_(Length > 0);
 
-	KdPrint(("EchoEvtIoWrite Called! Queue 0x%p, Request 0x%p Length %Iu\n", Queue, Request, Length));
+	TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_IO, "EchoEvtIoWrite Called! Queue 0x%p, Request 0x%p Length %I64u", Queue, Request, (ULONG64)Length);
 
-	if (Length > MAX_WRITE_LENGTH) {
-		KdPrint(("EchoEvtIoWrite Buffer Length to big %Iu, Max is %d\n", Length, MAX_WRITE_LENGTH));
+	RequestGetContext(Request)->StartTime = EchoStatsTimestamp();
+	EchoStatsAdd(&queueContext->Stats, WriteRequests, 1);
+
+	// ѡƬ˺һֱʹƬͨ͵ȴ
+	EchoShardAssign(Queue, Request);
+	EchoCompletionClassify(Request);
+	channel = EchoRequestGetChannel(Request);
+
+	if (Length > queueContext->MaxWriteLength) {
+		TraceEvents(TRACE_LEVEL_WARNING, TRACE_IO, "EchoEvtIoWrite Buffer Length to big %I64u, Max is %u", (ULONG64)Length, queueContext->MaxWriteLength);
 		WdfRequestCompleteWithInformation(Request, STATUS_BUFFER_OVERFLOW, 0L);
 		return;
 	}
 
 	// ȡrequestĴ洢ַ
-	Status = WdfRequestRetrieveInputMemory(Request, &memory);
+	// ֱI/OʱȡõMDLӳϵͳַrequest֮ǰһֱЧ
+	Status = WdfRequestRetrieveInputBuffer(Request, Length, &buffer, NULL);
 	if (!NT_SUCCESS(Status)) {
-		KdPrint(("EchoEvtIoWrite Could not get request memory buffer 0x%x\n",
-			Status));
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_IO, "EchoEvtIoWrite Could not get request buffer %!STATUS!", Status);
 		WdfVerifierDbgBreakPoint();
-		WdfRequestComplete(Request, Status);
+		WdfRequestCompleteWithInformation(Request, Status, 0L);
 		return;
 	}
 
-	// queueContext->Bufferݣ
-	if (queueContext->Buffer != NULL) {
-		ExFreePool(queueContext->Buffer);
-		queueContext->Buffer = NULL;
-		queueContext->Length = 0L;
+	// 㲥ģʽ£ݸһκ󽻸еȴĶ󣬸request漴
+	if (channel->Broadcast && EchoBroadcastWrite(channel, buffer, (ULONG)Length)) {
+		EchoStatsAdd(&queueContext->Stats, BytesIn, Length);
+		WdfRequestSetInformation(Request, (ULONG_PTR)Length);
+		EchoCompletionPend(Queue, Request, STATUS_SUCCESS);
+		return;
 	}
 
-	// ¿ٿռ
-	queueContext->Buffer = ExAllocatePoolWithTag(NonPagedPoolNx, Length, 'sam1');
-	if (queueContext->Buffer == NULL) {
-		KdPrint(("EchoEvtIoWrite: Could not allocate %Iu byte buffer\n", Length));
-		WdfRequestComplete(Request, STATUS_INSUFFICIENT_RESOURCES);
+	// 㿽ģʽ²ݣrequestȴλʱŴڴԤԤ
+	if (queueContext->Config.ZeroCopy) {
+		EchoStatsAdd(&queueContext->Stats, BytesIn, Length);
+		EchoForwardPark(channel, Request, buffer, (ULONG)Length);
+
+		// ȴݵĶֱӴӹдȡ
+		EchoReadWaitWake(channel);
 		return;
 	}
 
-	// requestĴ洢ַȡݵqueueContext->Buffer
-	Status = WdfMemoryCopyToBuffer(memory,
-		0,						// offset into the source memory
-		queueContext->Buffer,
-		Length);
-	
-	if (!NT_SUCCESS(Status)) {
-		KdPrint(("EchoEvtIoWrite WdfMemoryCopyToBuffer failed 0x%x\n", Status));
-		//WdfVerifierDbgBreakPoint();
+	// ݽǷҳڴ֮ǰ豸ڴԤԤ
+	// Ԥдڵȴ׼ʱrequestڴ黹EchoAdmissionRun׼
+	if (!EchoAdmissionCharge(Queue, Request, buffer, (ULONG)Length)) {
+		return;
+	}
+
+	EchoWriteStore(Queue, channel, Request, buffer, (ULONG)Length);
+
+	return;
+}
+
+
+// ԤڴԤдݴͨдص׼ƶ
+// ݴ뻷λ
+// ûпвۻ򳬹ʱܾд루STATUS_DEVICE_BUSYδȡ
+// ģʽ´ʱrequestȴڳռEchoStreamWake벢
+// ûдʱ黹Ԥ黹Ԥ㹻׼д
+VOID
+EchoWriteStore(
+	IN WDFQUEUE   Queue,
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	NTSTATUS Status;
 
-		ExFreePool(queueContext->Buffer);
-		queueContext->Buffer = NULL;
-		queueContext->Length = 0L;
-		WdfRequestComplete(Request, Status);
+	if (Channel->Stream) {
+		Status = EchoStreamWrite(Channel, Request, Buffer, Length);
+		if (Status == STATUS_PENDING) {
+			return;
+		}
+	}
+	else {
+		Status = EchoRingWrite(&Channel->Ring, Buffer, Length);
+	}
+
+	if (!NT_SUCCESS(Status)) {
+		TraceEvents(TRACE_LEVEL_WARNING, TRACE_IO, "EchoWriteStore: EchoRingWrite failed %!STATUS! (%u slots, %u bytes stored)",
+			Status, Channel->Ring.SlotCount, Channel->Ring.StoredBytes);
+		if (Status == STATUS_INSUFFICIENT_RESOURCES) {
+			EchoStatsAdd(&queueContext->Stats, AllocationFailures, 1);
+		}
+		WdfRequestCompleteWithInformation(Request, Status, 0L);
+		EchoBufferUncharge(&queueContext->BufferPool, Length);
+		EchoAdmissionRun(Queue);
 		return;
 	}
 
+	EchoStatsAdd(&queueContext->Stats, BytesIn, Length);
 
-	queueContext->Length = (ULONG)Length;
+	// ѵȴݵĶ
+	// ڽ֮ǰѣrequestɺ漴رգ˽ͨļ
+	EchoReadWaitWake(Channel);
 
 	WdfRequestSetInformation(Request, (ULONG_PTR)Length);
 
-	// ǰrequestȡص
-	WdfRequestMarkCancelable(Request, EchoEvtRequestCancel);
+	// 棬ɲɸrequest
+	EchoCompletionPend(Queue, Request, Status);
+
+	return;
+}
+
+
+// IoDeviceControlĻص
+VOID
+EchoEvtIoDeviceControl(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	IN size_t     OutputBufferLength,
+	IN size_t     InputBufferLength,
+	IN ULONG      IoControlCode
+)
+/*++
+
+Routine Description:
+
+	This event is called when the framework receives IRP_MJ_DEVICE_CONTROL
+	request. Control requests are completed right away and never go through
+	the completion policy, except IOCTL_ECHO_DELAY, which waits on the timer
+	wheel for its own delay. IOCTL_ECHO_BATCH performs a whole array of
+	reads and writes on the caller's channel within this one request.
+	IOCTL_ECHO_URING_SETUP stays pending for as long as the caller's shared
+	submission and completion rings are registered, and each
+	IOCTL_ECHO_URING_ENTER executes whatever has been submitted there.
+
+Arguments:
+
+	Queue -  Handle to the framework queue object that is associated with the
+			 I/O request.
+
+	Request - Handle to a framework request object.
+
+	OutputBufferLength - length of the request's output buffer.
+
+	InputBufferLength - length of the request's input buffer.
+
+	IoControlCode - the driver-defined or system-defined I/O control code.
+
+Return Value:
 
-	// 洢ǰrequestеĻ
-	queueContext->CurrentRequest = Request;
-	queueContext->CurrentStatus = Status;
+	VOID
+
+--*/
+{
+	NTSTATUS Status;
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	PVOID buffer;
+	ULONG_PTR information = 0;
+	ULONG flags;
+	WDFFILEOBJECT fileObject;
+	PFILE_CONTEXT fileContext;
+	PCECHO_TRANSFORM transform;
+	PECHO_CHANNEL channel;
+	ULONG i;
+
+	TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_IO, "EchoEvtIoDeviceControl Called! Queue 0x%p, Request 0x%p Code 0x%x", Queue, Request, IoControlCode);
+
+	// ͹ڴ滷ڵķƬִ
+	EchoShardAssign(Queue, Request);
+	EchoCompletionClassify(Request);
+
+	switch (IoControlCode) {
+
+	// ɲ
+	case IOCTL_ECHO_SET_COMPLETION_POLICY:
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_COMPLETION_POLICY), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		Status = EchoCompletionSetPolicy(Queue, (PECHO_COMPLETION_POLICY)buffer);
+		break;
+
+	// ȡõǰɲ
+	case IOCTL_ECHO_GET_COMPLETION_POLICY:
+		Status = WdfRequestRetrieveOutputBuffer(Request, sizeof(ECHO_COMPLETION_POLICY), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		WdfSpinLockAcquire(queueContext->Pending.PendingLock);
+		*(PECHO_COMPLETION_POLICY)buffer = queueContext->Policy;
+		WdfSpinLockRelease(queueContext->Pending.PendingLock);
+		information = sizeof(ECHO_COMPLETION_POLICY);
+		break;
+
+	// ȡúбͳ
+	case IOCTL_ECHO_GET_LOOKASIDE_STATS:
+		Status = WdfRequestRetrieveOutputBuffer(Request, sizeof(ECHO_LOOKASIDE_STATS), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		EchoBufferPoolQueryStats(&queueContext->BufferPool, (PECHO_LOOKASIDE_STATS)buffer);
+		information = sizeof(ECHO_LOOKASIDE_STATS);
+		break;
+
+	// ܸͳƣ뻺ԴECHO_STATS_FLAG_RESET
+	case IOCTL_ECHO_GET_STATS:
+		flags = 0;
+		if (InputBufferLength >= sizeof(ULONG)) {
+			Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ULONG), &buffer, NULL);
+			if (!NT_SUCCESS(Status)) {
+				break;
+			}
+
+			flags = *(PULONG)buffer;
+		}
+
+		// METHOD_BUFFEREDһȡ־ȡ
+		Status = WdfRequestRetrieveOutputBuffer(Request, sizeof(ECHO_STATS), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		EchoStatsQuery(&queueContext->Stats, (flags & ECHO_STATS_FLAG_RESET) != 0, (PECHO_STATS)buffer);
+
+		// ڴԤʹáȴ׼Ⱥ͵Դתĺʱÿļ
+		((PECHO_STATS)buffer)->AdmissionDepth = queueContext->Admission.Count;
+		((PECHO_STATS)buffer)->BudgetUsed = (ULONG64)queueContext->BufferPool.Charged;
+		((PECHO_STATS)buffer)->BudgetLimit = (ULONG64)queueContext->BufferPool.Budget;
+		((PECHO_STATS)buffer)->SuspendCount = queueContext->SuspendCount;
+		((PECHO_STATS)buffer)->LastSuspendUs = queueContext->LastSuspendUs;
+		((PECHO_STATS)buffer)->LastResumeUs = queueContext->LastResumeUs;
+		((PECHO_STATS)buffer)->StopAcknowledged = (ULONG64)queueContext->StopAcknowledged;
+		((PECHO_STATS)buffer)->ShardCount = queueContext->ShardCount;
+		information = sizeof(ECHO_STATS);
+		break;
+
+	// ÷͸ľĶȴرնȴʱþڵȴĶ󷵻0ֽ
+	case IOCTL_ECHO_SET_READ_WAIT:
+		fileObject = WdfRequestGetFileObject(Request);
+		if (fileObject == NULL) {
+			Status = STATUS_INVALID_DEVICE_REQUEST;
+			break;
+		}
+
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_READ_WAIT), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		fileContext = FileGetContext(fileObject);
+		fileContext->ReadTimeoutMs = ((PECHO_READ_WAIT)buffer)->TimeoutMs;
+		fileContext->ReadWait = (((PECHO_READ_WAIT)buffer)->Enable != 0);
+
+		if (!fileContext->ReadWait) {
+			for (i = 0; (channel = EchoShardChannelAt(Queue, fileContext->Channel, i)) != NULL; i++) {
+				EchoReadWaitRelease(channel, fileObject, STATUS_SUCCESS);
+			}
+		}
+		break;
+
+	// ÷͸ľEchoCompletionDeadlineģʽµӳ
+	case IOCTL_ECHO_SET_REQUEST_DELAY:
+		fileObject = WdfRequestGetFileObject(Request);
+		if (fileObject == NULL) {
+			Status = STATUS_INVALID_DEVICE_REQUEST;
+			break;
+		}
+
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_REQUEST_DELAY), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		FileGetContext(fileObject)->DelayUs = ((PECHO_REQUEST_DELAY)buffer)->DelayUs;
+		break;
+
+	// ʱϣָӳ֮
+	case IOCTL_ECHO_DELAY:
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_REQUEST_DELAY), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		RequestGetContext(Request)->StartTime = EchoStatsTimestamp();
+		RequestGetContext(Request)->Status = STATUS_SUCCESS;
+		EchoWheelInsert(Queue, Request, ((PECHO_REQUEST_DELAY)buffer)->DelayUs);
+		return;
+
+	// 򿪻رͨģʽʹ÷ƬͨʱзƬ
+	// رʱڵȴдɶڳռ
+	case IOCTL_ECHO_SET_STREAM:
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_STREAM_CONFIG), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		for (i = 0; (channel = EchoShardChannelAt(Queue, EchoRequestGetChannel(Request), i)) != NULL; i++) {
+			channel->Stream = (((PECHO_STREAM_CONFIG)buffer)->Enable != 0);
+		}
+		break;
+
+	// 򿪻رͨĹ㲥ʹ÷ƬͨʱзƬ
+	case IOCTL_ECHO_SET_BROADCAST:
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_BROADCAST_CONFIG), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		for (i = 0; (channel = EchoShardChannelAt(Queue, EchoRequestGetChannel(Request), i)) != NULL; i++) {
+			channel->Broadcast = (((PECHO_BROADCAST_CONFIG)buffer)->Enable != 0);
+		}
+		break;
+
+	// ѡͨĶ·תʹ÷ƬͨʱзƬ
+	case IOCTL_ECHO_SET_TRANSFORM:
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_TRANSFORM_CONFIG), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		Status = EchoTransformLookup(((PECHO_TRANSFORM_CONFIG)buffer)->Transform, &transform);
+		if (NT_SUCCESS(Status)) {
+			for (i = 0; (channel = EchoShardChannelAt(Queue, EchoRequestGetChannel(Request), i)) != NULL; i++) {
+				channel->Transform = transform;
+			}
+		}
+		break;
+
+	// ´ɶʱPASSIVE_LEVELַԵȴɶʱĻص
+	case IOCTL_ECHO_SET_TIMER:
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_TIMER_CONFIG), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		Status = EchoTickerConfigure(&queueContext->Ticker, (PECHO_TIMER_CONFIG)buffer);
+		break;
+
+	// ȡɶʱúͶͳ
+	case IOCTL_ECHO_GET_TIMER_JITTER:
+		flags = 0;
+		if (InputBufferLength >= sizeof(ULONG)) {
+			Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ULONG), &buffer, NULL);
+			if (!NT_SUCCESS(Status)) {
+				break;
+			}
+
+			flags = *(PULONG)buffer;
+		}
+
+		Status = WdfRequestRetrieveOutputBuffer(Request, sizeof(ECHO_TIMER_JITTER), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		EchoTickerQueryJitter(&queueContext->Ticker, (flags & ECHO_STATS_FLAG_RESET) != 0, (PECHO_TIMER_JITTER)buffer);
+		information = sizeof(ECHO_TIMER_JITTER);
+		break;
+
+	// һοִжд
+	case IOCTL_ECHO_BATCH:
+		Status = EchoBatchExecute(Queue, Request, InputBufferLength, OutputBufferLength, &information);
+		break;
+
+	// Ǽǹڴ滷ɹʱֱע
+	case IOCTL_ECHO_URING_SETUP:
+		Status = EchoUringSetup(Queue, Request);
+		if (Status == STATUS_PENDING) {
+			return;
+		}
+		break;
+
+	// ڴ滷
+	case IOCTL_ECHO_URING_ENTER:
+		Status = EchoUringEnter(Queue, Request, &information);
+		break;
+
+	// ޸Ŀɵͬʱ浽ע
+	case IOCTL_ECHO_SET_PARAMETERS:
+		fileObject = WdfRequestGetFileObject(Request);
+		if (fileObject == NULL) {
+			Status = STATUS_INVALID_DEVICE_REQUEST;
+			break;
+		}
+
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_PARAMETERS), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		Status = EchoParametersSet(Queue, (PECHO_PARAMETERS)buffer, FileGetContext(fileObject)->MayPersist);
+		break;
+
+	// ȡõǰĿɵ
+	case IOCTL_ECHO_GET_PARAMETERS:
+		Status = WdfRequestRetrieveOutputBuffer(Request, sizeof(ECHO_PARAMETERS), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		Status = EchoParametersQuery(Queue, (PECHO_PARAMETERS)buffer);
+		if (NT_SUCCESS(Status)) {
+			information = sizeof(ECHO_PARAMETERS);
+		}
+		break;
+
+	// úϳɵ豸ӳģ
+	case IOCTL_ECHO_SET_LATENCY_MODEL:
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_LATENCY_CONFIG), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		Status = EchoLatencyConfigure(&queueContext->Latency, (PECHO_LATENCY_CONFIG)buffer);
+		break;
+
+	// ȡõǰӳģ
+	case IOCTL_ECHO_GET_LATENCY_MODEL:
+		Status = WdfRequestRetrieveOutputBuffer(Request, sizeof(ECHO_LATENCY_CONFIG), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		EchoLatencyQuery(&queueContext->Latency, (PECHO_LATENCY_CONFIG)buffer);
+		information = sizeof(ECHO_LATENCY_CONFIG);
+		break;
+
+	// øþȼ
+	case IOCTL_ECHO_SET_PRIORITY:
+		fileObject = WdfRequestGetFileObject(Request);
+		if (fileObject == NULL) {
+			Status = STATUS_INVALID_DEVICE_REQUEST;
+			break;
+		}
+
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_PRIORITY), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		if (((PECHO_PRIORITY)buffer)->Class >= EchoPriorityClassMax) {
+			Status = STATUS_INVALID_PARAMETER;
+			break;
+		}
+
+		FileGetContext(fileObject)->PriorityClass = ((PECHO_PRIORITY)buffer)->Class;
+		break;
+
+	// øȼȨ
+	case IOCTL_ECHO_SET_PRIORITY_WEIGHTS:
+		Status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_PRIORITY_WEIGHTS), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		Status = EchoCompletionSetWeights(Queue, (PECHO_PRIORITY_WEIGHTS)buffer);
+		break;
+
+	// ȡøȼȨ
+	case IOCTL_ECHO_GET_PRIORITY_WEIGHTS:
+		Status = WdfRequestRetrieveOutputBuffer(Request, sizeof(ECHO_PRIORITY_WEIGHTS), &buffer, NULL);
+		if (!NT_SUCCESS(Status)) {
+			break;
+		}
+
+		EchoCompletionQueryWeights(Queue, (PECHO_PRIORITY_WEIGHTS)buffer);
+		information = sizeof(ECHO_PRIORITY_WEIGHTS);
+		break;
+
+	default:
+		Status = STATUS_INVALID_DEVICE_REQUEST;
+		break;
+	}
+
+	WdfRequestCompleteWithInformation(Request, Status, information);
 
 	return;
 }
@@ -353,10 +1026,11 @@ EchoEvtTimerFunc(
 
 Routine Description:
 
-	This is the TimerDPC the driver sets up to complete requests.
-	This function is registered when the WDFTIMER object is created, and
-	will automatically synchronize with the I/O Queue callbacks
-	and cancel routine.
+	This is the TimerDPC the driver sets up to complete requests when the
+	device uses the EchoCompletionTimer policy.
+	This function is registered when the WDFTIMER object is created. It runs
+	in parallel with the I/O Queue callbacks and the cancel callback of the
+	pending queue, and EchoCompletionDrain takes the PendingLock itself.
 
 Arguments:
 
@@ -368,34 +1042,22 @@ Return Value:
 
 --*/
 {
-	NTSTATUS      Status;
-	WDFREQUEST     Request;
 	WDFQUEUE queue;
 	PQUEUE_CONTEXT queueContext;
 
 	queue = WdfTimerGetParentObject(Timer);
 	queueContext = QueueGetContext(queue);
 
-	// ȡǰҪrequest
-	Request = queueContext->CurrentRequest;
-	if (Request != NULL) {
-
-		// ȡǰrequestȡص
-		// ɹ򷵻STATUS_SUCCESS
-		// requestѾȡ򷵻STATUS_CANCELLED
-		Status = WdfRequestUnmarkCancelable(Request);
-		if (Status != STATUS_CANCELLED) {
-
-			queueContext->CurrentRequest = NULL;
-			Status = queueContext->CurrentStatus;
-
-			KdPrint(("CustomTimerDPC Completing request 0x%p, Status 0x%x \n", Request, Status));
+	// ¼ʱ̵Ķһڣѱ滻ľɶʱֱӷ
+	if (!EchoTickerFired(&queueContext->Ticker, Timer)) {
+		return;
+	}
 
-			WdfRequestComplete(Request, Status);
-		}
-		else {
-			// Status == STATUS_CANCELLEDʱҪWdfRequestComplete
-			KdPrint(("CustomTimerDPC Request 0x%p is STATUS_CANCELLED, not completing\n", Request));
+	// ֻEchoCompletionTimerģʽ¹ÿһrequestƬʱӸƬȡ
+	// ȡModeлʱEchoCompletionSetPolicyеȴ
+	if (queueContext->Policy.Mode == EchoCompletionTimer) {
+		if (EchoCompletionDrain(queueContext, &queueContext->Pending, 1) == 0) {
+			EchoShardDrain(queue, 1);
 		}
 	}
 
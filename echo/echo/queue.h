@@ -1,19 +1,144 @@
 #pragma once
 
-// Set max write length for testing
-#define MAX_WRITE_LENGTH 1024*40
+// Set chunk length of the stored data for testing, longer writes are chained
+#define CHUNK_LENGTH 1024*40
+
+// Set max length of all stored data, also the max write length
+#define MAX_STORED_LENGTH 1024*1024*128
 
 // Set timer period in ms
 #define TIMER_PERIOD 1000*2
 
+// Default dispatch mode of the default queue
+#define ECHO_DEFAULT_DISPATCH_MODE		EchoDispatchParallel
+
+// Forward writes to reads without the intermediate ring copy, requires direct I/O
+// Off by default: a zero-copy write waits for a read, so a client that reads only after its write completes
+// stalls for ECHO_FORWARD_HOLD_TIME per echo; enable it with the ZeroCopy registry value
+#define ECHO_DEFAULT_ZERO_COPY			FALSE
+
+// Acknowledge driver-owned requests in EvtIoStop on suspend instead of draining them, FALSE keeps the synchronous stop
+#define ECHO_DEFAULT_FAST_SUSPEND		TRUE
+
+// Default completion policy, EchoCompletionTimer keeps the original demo behavior
+#define ECHO_DEFAULT_COMPLETION_MODE	EchoCompletionTimer
+#define ECHO_DEFAULT_COALESCE_DELAY		10		// ms
+#define ECHO_DEFAULT_BATCH_SIZE			16
+
+// Limits accepted by IOCTL_ECHO_SET_COMPLETION_POLICY
+#define ECHO_MAX_COALESCE_DELAY			1000	// ms
+#define ECHO_MAX_BATCH_SIZE				1024
+#define ECHO_MAX_DEADLINE_DELAY			60000	// ms
+
+// Default weights of the priority classes in the weighted dispatch of pending requests
+#define ECHO_DEFAULT_WEIGHT_HIGH		8
+#define ECHO_DEFAULT_WEIGHT_NORMAL		4
+#define ECHO_DEFAULT_WEIGHT_BULK		1
+
+// Least bytes charged for one request in the weighted dispatch, so short requests still use up credit
+#define ECHO_PRIORITY_MIN_COST			512
+
+// Ļ
+// ϡȴʱתPendingQueueƬʱڷƬģStatus¼ʱʹõ״̬
+// 㿽ģʽ£дͨListEntryͨForwardList
+// ȴݵĶͨListEntryͨWaitListϣյ㲥ƵͨDeliverList
+// ԼɵͨListEntryʱֵĲ
+typedef struct _REQUEST_CONTEXT {
+
+	LIST_ENTRY ListEntry;
+	NTSTATUS Status;		// ʱʹõ״̬
+	LONGLONG StartTime;		// յʱܼͳӳ
+	PVOID Buffer;			// дȴĶĻ
+	ULONG Length;			// дȴĶĳ
+	LONGLONG Deadline;		// ȴĶޣжʱ䣩0ʾһֱȴ
+	struct _ECHO_BROADCAST* Broadcast;	// ͶϵĶõĹ㲥
+	ULONGLONG WheelTick;	// ʱϵĵڽ
+	PECHO_SHARD Shard;		// ʱѡķƬƬʱΪNULL
+	ULONG Class;			// ʱȼ𣬾ȴʱĸֶ
+	PECHO_SLOT Slot;		// дڻλռáδύĲ
+
+} REQUEST_CONTEXT, *PREQUEST_CONTEXT;
+
+WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(REQUEST_CONTEXT, RequestGetContext)
+
+// Ĭ϶ʱʹõãECHO_QUEUE_CONFIG_INITĬֵ
+typedef struct _ECHO_QUEUE_CONFIG {
+
+	ECHO_DISPATCH_MODE DispatchMode;
+	ULONG SlotCount;		// λĲŵд
+	ULONG ChunkSize;		// ÿĴСϳдзֳɶ
+	ULONG MemoryCap;		// ŵܳȵޣд󳤶ȵ
+	BOOLEAN ZeroCopy;		// дֱת豸ʹֱI/O
+	ECHO_CHANNEL_MODE ChannelMode;	// δָͨľǷʹԼͨ
+	ULONG64 MemoryBudget;	// ͨŵܳȵޣСMemoryCap
+	BOOLEAN FastSuspend;	// 豸ʱEvtIoStopȷе󣬲ȴ
+	ECHO_SHARD_MODE ShardMode;	// ͨ͵ȴɵǷ񰴴Ƭ
+	ULONG MaxWriteLength;	// д󳤶ȣMemoryCap
+	ULONG TimerPeriodUs;	// ɶʱ
+	ULONG CompletionDelayMs;	// ɲԵMaxDelayMs
+	ULONG BatchSize;		// ɲԵBatchSize
+
+} ECHO_QUEUE_CONFIG, *PECHO_QUEUE_CONFIG;
+
+FORCEINLINE
+VOID
+ECHO_QUEUE_CONFIG_INIT(
+	OUT PECHO_QUEUE_CONFIG Config
+)
+{
+	Config->DispatchMode = ECHO_DEFAULT_DISPATCH_MODE;
+	Config->SlotCount = ECHO_RING_DEFAULT_SLOT_COUNT;
+	Config->ChunkSize = ECHO_RING_DEFAULT_CHUNK_SIZE;
+	Config->MemoryCap = ECHO_RING_DEFAULT_MEMORY_CAP;
+	Config->ZeroCopy = ECHO_DEFAULT_ZERO_COPY;
+	Config->ChannelMode = ECHO_DEFAULT_CHANNEL_MODE;
+	Config->MemoryBudget = ECHO_DEFAULT_MEMORY_BUDGET;
+	Config->FastSuspend = ECHO_DEFAULT_FAST_SUSPEND;
+	Config->ShardMode = ECHO_DEFAULT_SHARD_MODE;
+	Config->MaxWriteLength = ECHO_RING_DEFAULT_MEMORY_CAP;
+	Config->TimerPeriodUs = ECHO_TICKER_DEFAULT_PERIOD_US;
+	Config->CompletionDelayMs = ECHO_DEFAULT_COALESCE_DELAY;
+	Config->BatchSize = ECHO_DEFAULT_BATCH_SIZE;
+}
+
 // Ĭ϶жĻ
+// ûͬΧдصԲִУ
+// ͨͨԼɲԡȴͺϲʱPendingPendingLock
+// ƬʱÿƬԼͨ͵ȴͨPending
 typedef struct _QUEUE_CONTEXT {
 
-	PVOID Buffer;
-	ULONG Length;
-	WDFTIMER Timer;
-	WDFREQUEST CurrentRequest;
-	NTSTATUS CurrentStatus;
+	ECHO_QUEUE_CONFIG Config;	// ʱã˽ͨʱʹ
+	ECHO_BUFFER_POOL BufferPool;	// ͨĿﰴȷ
+	ECHO_STATS_BLOCK Stats;	// ÿԵļҪ
+	ECHO_CHANNEL Channel;	// ͨδʹ˽ͨľд
+	ECHO_TICKER Ticker;		// ɶʱEchoCompletionTimerģʽÿһ
+	ECHO_WHEEL Wheel;		// EchoCompletionDeadlineģʽµIOCTL_ECHO_DELAYԵ޹
+	ECHO_LATENCY Latency;	// ϳɵ豸ӳģͣʱд󰴳ķʱʱ
+	ECHO_ADMISSION Admission;	// ڴԤдȴ׼
+
+	ECHO_PENDING Pending;	// Ѵȴɵ
+	ECHO_COMPLETION_POLICY Policy;	// Pending.PendingLock
+	ULONG PriorityWeights[ECHO_PRIORITY_CLASSES];	// ȼȨأPending.PendingLockд룬ȡʱָȡ
+
+	PECHO_SHARD Shards;		// Ƭ飬ƬʱΪNULL
+	ULONG ShardCount;
+	volatile LONG ShardNext;	// EchoShardDrainһοʼķƬ
+
+	WDFWAITLOCK ParameterLock;	// лIOCTL_ECHO_SET_PARAMETERSIOCTL_ECHO_GET_PARAMETERS
+	volatile ULONG MaxWriteLength;	// д󳤶ȣд󵽴ʱ
+	ECHO_DISPATCH_MODE NextDispatchMode;	// 浽ע´δ豸ʱʹõķַʽ
+
+	WDFSPINLOCK ChannelLock;	// ChannelListUringList͸Ĺڴ滷״̬
+	LIST_ENTRY ChannelList;	// ˽ͨ
+	LIST_ENTRY UringList;	// еǼǵĹڴ滷
+	volatile BOOLEAN UringSuspended;	// 豸ڼ䲻ܹڴ滷ĵǼǣǼʱChannelLock
+	volatile BOOLEAN ReadWaitSuspended;	// 豸ڼ󲻹ȴ
+	volatile BOOLEAN StreamSuspended;	// 豸ڼģʽд󲻹ȴ
+
+	ULONG64 SuspendCount;	// 豸뿪D0ĴɵԴص
+	ULONG64 LastSuspendUs;	// һιصĺʱ
+	ULONG64 LastResumeUs;	// һλصD0Ļصĺʱ
+	volatile LONG StopAcknowledged;	// һιʱEvtIoStopȷϵ
 
 } QUEUE_CONTEXT, *PQUEUE_CONTEXT;
 
@@ -21,18 +146,44 @@ WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(QUEUE_CONTEXT, QueueGetContext)
 
 NTSTATUS
 EchoQueueInitialize(
-	WDFDEVICE hDevice
+	WDFDEVICE hDevice,
+	PECHO_QUEUE_CONFIG Config
 );
 
 EVT_WDF_IO_QUEUE_CONTEXT_DESTROY_CALLBACK EchoEvtIoQueueContextDestroy;
 EVT_WDF_IO_QUEUE_IO_READ EchoEvtIoRead;
 EVT_WDF_IO_QUEUE_IO_WRITE EchoEvtIoWrite;
-EVT_WDF_REQUEST_CANCEL EchoEvtRequestCancel;
+EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL EchoEvtIoDeviceControl;
+EVT_WDF_IO_QUEUE_IO_CANCELED_ON_QUEUE EchoEvtPendingCanceledOnQueue;
+EVT_WDF_IO_QUEUE_IO_STOP EchoEvtIoStop;
+
+VOID
+EchoQueueReleaseWaiters(
+	IN WDFQUEUE   Queue
+);
+
+BOOLEAN
+EchoReadServe(
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+);
+
+VOID
+EchoWriteStore(
+	IN WDFQUEUE   Queue,
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+);
 
 NTSTATUS
 EchoTimerCreate(
 	IN WDFTIMER*       pTimer,
 	IN ULONG           Period,
+	IN PFN_WDF_TIMER   TimerFunc,
 	IN WDFQUEUE        Queue
 );
 
@@ -0,0 +1,400 @@
+#include "driver.h"
+#include "readwait.tmh"
+
+
+// ѶȴΪȡҪʱǰȴʱ
+// HeadΪTRUEʱͷڻѺûȡݡŻԭλĶ
+// 豸ڹڹرʱٹֱӷ0ֽ
+static
+VOID
+EchoReadWaitInsert(
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN BOOLEAN    Head
+)
+{
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Channel->Queue);
+	LONGLONG remaining;
+
+	WdfSpinLockAcquire(Channel->WaitLock);
+
+	// EchoReadWaitReleaseAllReadWaitSuspended֮EchoEvtFileCleanupClosing֮ŻȡͨWaitLock
+	// ￴FALSEʱһҵ
+	if (queueContext->ReadWaitSuspended || FileGetContext(WdfRequestGetFileObject(Request))->Closing) {
+		WdfSpinLockRelease(Channel->WaitLock);
+		WdfRequestCompleteWithInformation(Request, STATUS_SUCCESS, 0L);
+		return;
+	}
+
+	// ȹȴΪȡEchoEvtReadWaitCancelҵ
+	if (Head) {
+		InsertHeadList(&Channel->WaitList, &requestContext->ListEntry);
+	}
+	else {
+		InsertTailList(&Channel->WaitList, &requestContext->ListEntry);
+	}
+	InterlockedIncrement(&Channel->WaitCount);
+
+	if (WdfRequestMarkCancelableEx(Request, EchoEvtReadWaitCancel) == STATUS_CANCELLED) {
+		RemoveEntryList(&requestContext->ListEntry);
+		InitializeListHead(&requestContext->ListEntry);
+		InterlockedDecrement(&Channel->WaitCount);
+		WdfSpinLockRelease(Channel->WaitLock);
+		EchoStatsAdd(&queueContext->Stats, Cancels, 1);
+		WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
+		return;
+	}
+
+	// ڵȴʱǰʱǰʱ
+	if (requestContext->Deadline != 0 &&
+		(Channel->WaitDeadline == 0 || requestContext->Deadline < Channel->WaitDeadline)) {
+
+		Channel->WaitDeadline = requestContext->Deadline;
+
+		remaining = requestContext->Deadline - (LONGLONG)KeQueryInterruptTime();
+		if (remaining < 1) {
+			remaining = 1;
+		}
+
+		WdfTimerStart(Channel->WaitTimer, -remaining);
+	}
+
+	WdfSpinLockRelease(Channel->WaitLock);
+
+	return;
+}
+
+
+// һûݿɶĶ󣬵ȴд
+// BufferǶĻ֮ǰһֱЧ
+// TimeoutMsΪ0ʱһֱȴ
+// ֮ٻһΣڼ͹֮䵽ݲᱻ
+VOID
+EchoReadWaitPark(
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length,
+	IN ULONG      TimeoutMs
+)
+{
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+
+	requestContext->Buffer = Buffer;
+	requestContext->Length = Length;
+	requestContext->Broadcast = NULL;
+	requestContext->Deadline = (TimeoutMs == 0) ? 0 :
+		(LONGLONG)KeQueryInterruptTime() + (LONGLONG)TimeoutMs * 10000;
+
+	TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_IO, "EchoReadWaitPark Request 0x%p TimeoutMs %u", Request, TimeoutMs);
+
+	EchoStatsAdd(&QueueGetContext(Channel->Queue)->Stats, ReadWaits, 1);
+
+	EchoReadWaitInsert(Channel, Request, FALSE);
+
+	EchoReadWaitWake(Channel);
+
+	return;
+}
+
+
+// ͨеݰFIFO˳ȴĶݴ뻷λת֮
+// 1 ûжڵȴʱȡ
+// 2 ͬһʱֻһѹУлѹʱRewakeټһ飬Ȼ󷵻
+//   EchoReadServeʱҲỽѣòǶ
+// 3 ȡĶͷȡݣʱ棬ȡһ
+// 4 ûжʱŻͷڼݵRewakeʱԣ򷵻
+VOID
+EchoReadWaitWake(
+	IN PECHO_CHANNEL Channel
+)
+{
+	PREQUEST_CONTEXT requestContext;
+	PLIST_ENTRY entry;
+	WDFREQUEST request;
+	BOOLEAN served;
+
+	// дȴټWaitCountȴWaitCountٻѣ֤һԷ
+	KeMemoryBarrier();
+
+	// 1 ûжڵȴ
+	if (Channel->WaitCount == 0) {
+		return;
+	}
+
+	// 2 лѹ
+	WdfSpinLockAcquire(Channel->WaitLock);
+
+	if (Channel->Waking) {
+		Channel->Rewake = TRUE;
+		WdfSpinLockRelease(Channel->WaitLock);
+		return;
+	}
+
+	Channel->Waking = TRUE;
+
+	for (;;) {
+
+		if (IsListEmpty(&Channel->WaitList)) {
+			break;
+		}
+
+		// 3 ȡĶ
+		entry = RemoveHeadList(&Channel->WaitList);
+		InitializeListHead(entry);
+		InterlockedDecrement(&Channel->WaitCount);
+		Channel->Rewake = FALSE;
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+		// ѱȡĶEchoEvtReadWaitCancelɣȡһ
+		if (WdfRequestUnmarkCancelable(request) == STATUS_CANCELLED) {
+			continue;
+		}
+
+		WdfSpinLockRelease(Channel->WaitLock);
+
+		served = EchoReadServe(Channel, request, requestContext->Buffer, requestContext->Length);
+		if (!served) {
+			// 4 ѱȡߣŻͷ
+			EchoReadWaitInsert(Channel, request, TRUE);
+		}
+
+		WdfSpinLockAcquire(Channel->WaitLock);
+
+		if (!served && !Channel->Rewake) {
+			break;
+		}
+	}
+
+	Channel->Waking = FALSE;
+	Channel->Rewake = FALSE;
+
+	WdfSpinLockRelease(Channel->WaitLock);
+
+	return;
+}
+
+
+// ȡFileObjectĶFileObjectΪNULLʱȡж
+// ȡµListϣɵͷ֮
+static
+VOID
+EchoReadWaitDetach(
+	IN PECHO_CHANNEL Channel,
+	IN WDFFILEOBJECT FileObject,
+	IN OUT PLIST_ENTRY List
+)
+{
+	PREQUEST_CONTEXT requestContext;
+	PLIST_ENTRY entry;
+	PLIST_ENTRY next;
+	WDFREQUEST request;
+
+	WdfSpinLockAcquire(Channel->WaitLock);
+
+	for (entry = Channel->WaitList.Flink; entry != &Channel->WaitList; entry = next) {
+
+		next = entry->Flink;
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+		if (FileObject != NULL && WdfRequestGetFileObject(request) != FileObject) {
+			continue;
+		}
+
+		RemoveEntryList(entry);
+		InitializeListHead(entry);
+		InterlockedDecrement(&Channel->WaitCount);
+
+		if (WdfRequestUnmarkCancelable(request) != STATUS_CANCELLED) {
+			InsertTailList(List, entry);
+		}
+	}
+
+	WdfSpinLockRelease(Channel->WaitLock);
+
+	return;
+}
+
+
+// ListϵĶ󣬲
+static
+VOID
+EchoReadWaitCompleteList(
+	IN PLIST_ENTRY List,
+	IN NTSTATUS    Status
+)
+{
+	PREQUEST_CONTEXT requestContext;
+	PLIST_ENTRY entry;
+	WDFREQUEST request;
+
+	while (!IsListEmpty(List)) {
+
+		entry = RemoveHeadList(List);
+		InitializeListHead(entry);
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+		WdfRequestCompleteWithInformation(request, Status, 0L);
+	}
+
+	return;
+}
+
+
+// StatusͨFileObjectеȴĶ󣬹رվʱ
+VOID
+EchoReadWaitRelease(
+	IN PECHO_CHANNEL Channel,
+	IN WDFFILEOBJECT FileObject,
+	IN NTSTATUS      Status
+)
+{
+	LIST_ENTRY releaseList;
+
+	InitializeListHead(&releaseList);
+
+	EchoReadWaitDetach(Channel, FileObject, &releaseList);
+	EchoReadWaitCompleteList(&releaseList, Status);
+
+	return;
+}
+
+
+// 豸ʱãͨϵȴĶ󷵻0ֽڣûʱͨͬ
+// ˺ֱ豸صD0ٹȴֹͣĬ϶ʱһֱȴ
+VOID
+EchoReadWaitReleaseAll(
+	IN PQUEUE_CONTEXT QueueContext
+)
+{
+	LIST_ENTRY releaseList;
+	PLIST_ENTRY entry;
+
+	InitializeListHead(&releaseList);
+
+	QueueContext->ReadWaitSuspended = TRUE;
+
+	EchoReadWaitDetach(&QueueContext->Channel, NULL, &releaseList);
+
+	WdfSpinLockAcquire(QueueContext->ChannelLock);
+
+	for (entry = QueueContext->ChannelList.Flink; entry != &QueueContext->ChannelList; entry = entry->Flink) {
+		EchoReadWaitDetach(CONTAINING_RECORD(entry, ECHO_CHANNEL, ChannelEntry), NULL, &releaseList);
+	}
+
+	WdfSpinLockRelease(QueueContext->ChannelLock);
+
+	EchoReadWaitCompleteList(&releaseList, STATUS_SUCCESS);
+
+	return;
+}
+
+
+// ȴĶȡʱĻص
+VOID
+EchoEvtReadWaitCancel(
+	IN WDFREQUEST Request
+)
+{
+	PECHO_CHANNEL channel = EchoRequestGetChannel(Request);
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+	PECHO_BROADCAST broadcast = NULL;
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_IO, "EchoEvtReadWaitCancel called on Request 0x%p", Request);
+
+	// ѱѻͷŵListEntryָ
+	// BroadcastͶϣȡʱͷ
+	WdfSpinLockAcquire(channel->WaitLock);
+
+	if (!IsListEmpty(&requestContext->ListEntry)) {
+		RemoveEntryList(&requestContext->ListEntry);
+		InitializeListHead(&requestContext->ListEntry);
+
+		broadcast = requestContext->Broadcast;
+		requestContext->Broadcast = NULL;
+
+		if (broadcast == NULL) {
+			InterlockedDecrement(&channel->WaitCount);
+		}
+	}
+
+	WdfSpinLockRelease(channel->WaitLock);
+
+	if (broadcast != NULL) {
+		EchoBroadcastRelease(channel, broadcast);
+	}
+
+	EchoStatsAdd(&QueueGetContext(channel->Queue)->Stats, Cancels, 1);
+
+	WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
+
+	return;
+}
+
+
+// ȴʱĻص
+// ڵĶ󷵻0ֽڣٰѶʱõʣ
+VOID
+EchoEvtReadWaitTimerFunc(
+	IN WDFTIMER     Timer
+)
+{
+	PECHO_CHANNEL channel = ChannelTimerGetContext(Timer)->Channel;
+	PREQUEST_CONTEXT requestContext;
+	LIST_ENTRY expiredList;
+	PLIST_ENTRY entry;
+	PLIST_ENTRY next;
+	WDFREQUEST request;
+	LONGLONG now = (LONGLONG)KeQueryInterruptTime();
+	LONGLONG nextDeadline = 0;
+
+	InitializeListHead(&expiredList);
+
+	WdfSpinLockAcquire(channel->WaitLock);
+
+	for (entry = channel->WaitList.Flink; entry != &channel->WaitList; entry = next) {
+
+		next = entry->Flink;
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		if (requestContext->Deadline == 0) {
+			continue;
+		}
+
+		if (requestContext->Deadline > now) {
+			if (nextDeadline == 0 || requestContext->Deadline < nextDeadline) {
+				nextDeadline = requestContext->Deadline;
+			}
+			continue;
+		}
+
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+		RemoveEntryList(entry);
+		InitializeListHead(entry);
+		InterlockedDecrement(&channel->WaitCount);
+
+		if (WdfRequestUnmarkCancelable(request) != STATUS_CANCELLED) {
+			InsertTailList(&expiredList, entry);
+			EchoStatsAdd(&QueueGetContext(channel->Queue)->Stats, ReadWaitTimeouts, 1);
+		}
+	}
+
+	channel->WaitDeadline = nextDeadline;
+	if (nextDeadline != 0) {
+		WdfTimerStart(channel->WaitTimer, now - nextDeadline);
+	}
+
+	WdfSpinLockRelease(channel->WaitLock);
+
+	EchoReadWaitCompleteList(&expiredList, STATUS_SUCCESS);
+
+	return;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// ȴѯIOCTL_ECHO_SET_READ_WAIT򿪺ûݿɶĶͨĶȴ
+// дݴ뻷λתѵȴĶ󣬰FIFO˳
+// ʱͨĵȴʱ޵ڣʱĶ󷵻0ֽ
+// ÿͨԼĶȴͨWaitLockͷ֮
+
+VOID
+EchoReadWaitPark(
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length,
+	IN ULONG      TimeoutMs
+);
+
+VOID
+EchoReadWaitWake(
+	IN PECHO_CHANNEL Channel
+);
+
+VOID
+EchoReadWaitRelease(
+	IN PECHO_CHANNEL Channel,
+	IN WDFFILEOBJECT FileObject,
+	IN NTSTATUS      Status
+);
+
+VOID
+EchoReadWaitReleaseAll(
+	IN PQUEUE_CONTEXT QueueContext
+);
+
+EVT_WDF_REQUEST_CANCEL EchoEvtReadWaitCancel;
+EVT_WDF_TIMER EchoEvtReadWaitTimerFunc;
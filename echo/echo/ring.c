@@ -0,0 +1,419 @@
+#ifdef ECHO_RING_PORTABLE
+#include "ring.h"
+#else
+#include "driver.h"
+#include "ring.tmh"
+#endif
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoRingInitialize)
+#endif
+
+
+// ʼλһԷв
+// ĻдʱPool䣬Poolڱ볤ڻλһСChunkSize
+NTSTATUS
+EchoRingInitialize(
+	OUT PECHO_RING Ring,
+	IN ULONG SlotCount,
+	IN ULONG ChunkSize,
+	IN ULONG MemoryCap,
+	IN PECHO_BUFFER_POOL Pool
+)
+{
+	NTSTATUS status;
+	ULONG slotsSize;
+
+	PAGED_CODE();
+
+	RtlZeroMemory(Ring, sizeof(ECHO_RING));
+	KeInitializeSpinLock(&Ring->Lock);
+
+	if (SlotCount == 0 || ChunkSize <= ECHO_CHUNK_HEADER_SIZE || MemoryCap == 0) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	status = RtlULongMult(SlotCount, sizeof(ECHO_SLOT), &slotsSize);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_BUFFER, "EchoRingInitialize: %u slots overflow", SlotCount);
+		return status;
+	}
+
+	Ring->Slots = ExAllocatePoolWithTag(NonPagedPoolNx, slotsSize, 'sam1');
+	if (Ring->Slots == NULL) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_BUFFER, "EchoRingInitialize: Could not allocate %u slots", SlotCount);
+		return STATUS_INSUFFICIENT_RESOURCES;
+	}
+
+	RtlZeroMemory(Ring->Slots, slotsSize);
+
+	Ring->Pool = Pool;
+	Ring->SlotCount = SlotCount;
+	Ring->ChunkSize = ChunkSize;
+	Ring->MemoryCap = MemoryCap;
+
+	return STATUS_SUCCESS;
+}
+
+
+// һĻȫ黹Եļ
+static
+VOID
+EchoRingFreeChain(
+	IN PECHO_RING Ring,
+	IN PECHO_CHUNK Chunk
+)
+{
+	PECHO_CHUNK next;
+
+	while (Chunk != NULL) {
+		next = Chunk->Next;
+		EchoBufferFree(Ring->Pool, Chunk, Chunk->SizeClass);
+		Chunk = next;
+	}
+
+	return;
+}
+
+
+// һݣ
+// ʣͬͷܷĳһʱСһChunkSizeһ
+static
+NTSTATUS
+EchoRingBuildChain(
+	IN PECHO_RING Ring,
+	IN PUCHAR Buffer,
+	IN ULONG Length,
+	OUT PECHO_CHUNK* Chain
+)
+{
+	PECHO_CHUNK* link = Chain;
+	PECHO_CHUNK chunk;
+	ULONG chunkSize;
+	UCHAR sizeClass;
+
+	*Chain = NULL;
+
+	while (Length > 0) {
+
+		chunkSize = (Length < Ring->ChunkSize - ECHO_CHUNK_HEADER_SIZE) ?
+			Length + ECHO_CHUNK_HEADER_SIZE : Ring->ChunkSize;
+
+		chunk = EchoBufferAllocate(Ring->Pool, chunkSize, &sizeClass);
+		if (chunk == NULL) {
+			EchoRingFreeChain(Ring, *Chain);
+			*Chain = NULL;
+			return STATUS_INSUFFICIENT_RESOURCES;
+		}
+
+		chunk->Next = NULL;
+		chunk->Length = chunkSize - ECHO_CHUNK_HEADER_SIZE;
+		chunk->SizeClass = sizeClass;
+
+		RtlCopyMemory(chunk->Data, Buffer, chunk->Length);
+
+		*link = chunk;
+		link = &chunk->Next;
+
+		Buffer += chunk->Length;
+		Length -= chunk->Length;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+
+// 黹веĿ飬ͷŲۣڶʱ
+VOID
+EchoRingCleanup(
+	IN PECHO_RING Ring
+)
+{
+	ULONG i;
+
+	if (Ring->Slots != NULL) {
+
+		for (i = 0; i < Ring->SlotCount; i++) {
+			EchoRingFreeChain(Ring, Ring->Slots[i].First);
+			Ring->Slots[i].First = NULL;
+		}
+
+		ExFreePool(Ring->Slots);
+		Ring->Slots = NULL;
+	}
+
+	// δȡ滷λ黹黹ڴԤеԤ
+	if (Ring->StoredBytes != 0) {
+		EchoBufferUncharge(Ring->Pool, Ring->StoredBytes);
+	}
+
+	Ring->Count = 0;
+	Ring->StoredBytes = 0;
+	Ring->Head = 0;
+	Ring->Tail = 0;
+
+	return;
+}
+
+
+// ΪLengthֽռһвۣԤMemoryCapеĳȣ۵˳ռõ˳
+// ûпвۻ򳬹MemoryCapʱSTATUS_DEVICE_BUSYʱTailĲۿڱȡʱҲΪ
+// ռõĲ۱EchoRingCommitύڴ֮ǰڸò۴ͣ£߿ڳԼʱռãͷźύ
+NTSTATUS
+EchoRingReserve(
+	IN PECHO_RING Ring,
+	IN ULONG Length,
+	OUT PECHO_SLOT* Slot
+)
+{
+	KIRQL oldIrql;
+	PECHO_SLOT slot;
+
+	*Slot = NULL;
+
+	if (Length == 0 || Length > Ring->MemoryCap) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	KeAcquireSpinLock(&Ring->Lock, &oldIrql);
+
+	slot = &Ring->Slots[Ring->Tail];
+
+	if (Ring->Count == Ring->SlotCount || slot->State != EchoSlotFree ||
+		Length > Ring->MemoryCap - Ring->StoredBytes) {
+		KeReleaseSpinLock(&Ring->Lock, oldIrql);
+		return STATUS_DEVICE_BUSY;
+	}
+
+	slot->State = EchoSlotWriting;
+	Ring->StoredBytes += Length;
+
+	Ring->Tail++;
+	if (Ring->Tail == Ring->SlotCount) {
+		Ring->Tail = 0;
+	}
+
+	Ring->Count++;
+
+	KeReleaseSpinLock(&Ring->Lock, oldIrql);
+
+	*Slot = slot;
+
+	return STATUS_SUCCESS;
+}
+
+
+// BufferLengthֽڴEchoRingReserveռõĲۣLengthռʱͬ
+// 1 ݣдͬʱ
+// 2 ύòۣʧʱԳ0ύ
+NTSTATUS
+EchoRingCommit(
+	IN PECHO_RING Ring,
+	IN PECHO_SLOT Slot,
+	IN PVOID Buffer,
+	IN ULONG Length
+)
+{
+	KIRQL oldIrql;
+	PECHO_CHUNK chain;
+	NTSTATUS status;
+
+	// 1 
+	status = EchoRingBuildChain(Ring, Buffer, Length, &chain);
+
+	// 2 ύò
+	KeAcquireSpinLock(&Ring->Lock, &oldIrql);
+
+	ASSERT(Slot->State == EchoSlotWriting);
+
+	if (NT_SUCCESS(status)) {
+		Slot->First = chain;
+		Slot->ReadChunk = chain;
+		Slot->Length = Length;
+	}
+	else {
+		Slot->First = NULL;
+		Slot->ReadChunk = NULL;
+		Slot->Length = 0;
+		Ring->StoredBytes -= Length;
+	}
+
+	Slot->ReadChunkOffset = 0;
+	Slot->ReadOffset = 0;
+	Slot->Readers = 0;
+	Slot->State = EchoSlotReady;
+
+	KeReleaseSpinLock(&Ring->Lock, oldIrql);
+
+	return status;
+}
+
+
+// BufferLengthֽڵݴһв
+// ռòۣݣٳύEchoRingReserveEchoRingCommit
+// ߱EchoBufferChargeԤLengthֽڣɹʱԤתòۣʧʱɵ߹黹
+NTSTATUS
+EchoRingWrite(
+	IN PECHO_RING Ring,
+	IN PVOID Buffer,
+	IN ULONG Length
+)
+{
+	PECHO_SLOT slot;
+	NTSTATUS status;
+
+	status = EchoRingReserve(Ring, Length, &slot);
+	if (!NT_SUCCESS(status)) {
+		return status;
+	}
+
+	return EchoRingCommit(Ring, slot, Buffer, Length);
+}
+
+
+// ûδռõݣҲûдĲʱTRUE
+// ĲۿлڱȡʱHeadѾ׷Tail
+BOOLEAN
+EchoRingIsEmpty(
+	IN PECHO_RING Ring
+)
+{
+	KIRQL oldIrql;
+	UCHAR state;
+
+	KeAcquireSpinLock(&Ring->Lock, &oldIrql);
+	state = Ring->Slots[Ring->Head].State;
+	KeReleaseSpinLock(&Ring->Lock, oldIrql);
+
+	return (state == EchoSlotFree || state == EchoSlotReading);
+}
+
+
+// дĲ۵Ķα괦ȡLengthֽڣضȡĳ
+// 1 дʧܵĲۣռôӶα꿪ʼһݲƶα
+// 2 ݣͬʱͬһ۵Ĳͬ
+// 3 ȡһĶ黹ۺԤ
+// ΪգĲдʱ0
+ULONG
+EchoRingRead(
+	IN PECHO_RING Ring,
+	OUT PVOID Buffer,
+	IN ULONG Length
+)
+{
+	KIRQL oldIrql;
+	PECHO_SLOT slot;
+	PECHO_CHUNK chunk;
+	PECHO_CHUNK chain = NULL;
+	ULONG chainLength = 0;
+	PUCHAR destination = Buffer;
+	ULONG chunkOffset;
+	ULONG remaining;
+	ULONG copy;
+
+	// 1 ռһ
+	KeAcquireSpinLock(&Ring->Lock, &oldIrql);
+
+	for (;;) {
+
+		slot = &Ring->Slots[Ring->Head];
+
+		if (slot->State != EchoSlotReady) {
+			KeReleaseSpinLock(&Ring->Lock, oldIrql);
+			return 0;
+		}
+
+		if (slot->Length != 0) {
+			break;
+		}
+
+		// дʧܵĲۣûп
+		slot->State = EchoSlotFree;
+		Ring->Count--;
+
+		Ring->Head++;
+		if (Ring->Head == Ring->SlotCount) {
+			Ring->Head = 0;
+		}
+	}
+
+	if (Length > slot->Length - slot->ReadOffset) {
+		Length = slot->Length - slot->ReadOffset;
+	}
+
+	chunk = slot->ReadChunk;
+	chunkOffset = slot->ReadChunkOffset;
+
+	// ƶα꣬αͣڻδݵĿ
+	remaining = Length;
+	while (remaining > 0) {
+		copy = slot->ReadChunk->Length - slot->ReadChunkOffset;
+		if (remaining < copy) {
+			slot->ReadChunkOffset += remaining;
+			break;
+		}
+
+		remaining -= copy;
+		slot->ReadChunk = slot->ReadChunk->Next;
+		slot->ReadChunkOffset = 0;
+	}
+
+	slot->ReadOffset += Length;
+	slot->Readers++;
+
+	// ȫռãĶһۿʼ
+	if (slot->ReadOffset == slot->Length) {
+		slot->State = EchoSlotReading;
+
+		Ring->Head++;
+		if (Ring->Head == Ring->SlotCount) {
+			Ring->Head = 0;
+		}
+	}
+
+	KeReleaseSpinLock(&Ring->Lock, oldIrql);
+
+	// 2 ݣReadersΪ0ʱᱻ黹
+	remaining = Length;
+	while (remaining > 0) {
+		copy = chunk->Length - chunkOffset;
+		if (copy > remaining) {
+			copy = remaining;
+		}
+
+		RtlCopyMemory(destination, chunk->Data + chunkOffset, copy);
+
+		destination += copy;
+		remaining -= copy;
+		chunk = chunk->Next;
+		chunkOffset = 0;
+	}
+
+	// 3 ȡ
+	KeAcquireSpinLock(&Ring->Lock, &oldIrql);
+
+	slot->Readers--;
+
+	if (slot->State == EchoSlotReading && slot->Readers == 0) {
+		chain = slot->First;
+		chainLength = slot->Length;
+		Ring->StoredBytes -= slot->Length;
+
+		slot->First = NULL;
+		slot->ReadChunk = NULL;
+		slot->Length = 0;
+		slot->State = EchoSlotFree;
+		Ring->Count--;
+	}
+
+	KeReleaseSpinLock(&Ring->Lock, oldIrql);
+
+	EchoRingFreeChain(Ring, chain);
+
+	// 黹ʱͬʱ黹дڴԤеԤ
+	if (chainLength != 0) {
+		EchoBufferUncharge(Ring->Pool, chainLength);
+	}
+
+	return Length;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+// Default ring geometry, used when the queue is created by EchoDeviceCreate
+#define ECHO_RING_DEFAULT_SLOT_COUNT	16
+#define ECHO_RING_DEFAULT_CHUNK_SIZE	CHUNK_LENGTH
+#define ECHO_RING_DEFAULT_MEMORY_CAP	MAX_STORED_LENGTH
+
+// ۵״̬
+// ʱֻռú͹黹ۡƶαʱ
+typedef enum _ECHO_SLOT_STATE {
+	EchoSlotFree = 0,		// 
+	EchoSlotWriting,		// ѱдռãд
+	EchoSlotReady,			// д룬δռõ
+	EchoSlotReading			// ȫռãȴڸƵĶ
+} ECHO_SLOT_STATE;
+
+// һݣͷݷͬһУӻ
+// һдݰChunkSizeзֳɿ飬Next
+typedef struct _ECHO_CHUNK {
+
+	struct _ECHO_CHUNK* Next;
+	ULONG Length;			// DataЧݵĳ
+	UCHAR SizeClass;		// ûļ
+	UCHAR Data[ANYSIZE_ARRAY];
+
+} ECHO_CHUNK, *PECHO_CHUNK;
+
+#define ECHO_CHUNK_HEADER_SIZE	FIELD_OFFSET(ECHO_CHUNK, Data)
+
+// һۣһд
+// ֻһ֣α꣨ReadChunkReadChunkOffsetReadOffset¼һ
+typedef struct _ECHO_SLOT {
+
+	PECHO_CHUNK First;
+	PECHO_CHUNK ReadChunk;	// αڵĿ
+	ULONG ReadChunkOffset;	// αڿڵƫ
+	ULONG ReadOffset;		// ѱռõĳ
+	ULONG Length;			// ЧݵܳȣдʧʱΪ0
+	ULONG Readers;			// ڸݵĶ
+	UCHAR State;			// ECHO_SLOT_STATE
+
+} ECHO_SLOT, *PECHO_SLOT;
+
+// ݵĻλ
+// дʱһԷSlotCountۣдռÿвۣFIFO˳ʽȡ
+// в۴ŵܳȲMemoryCap
+// ģֻ۵ĹݴţԼ۵״̬ͶαꣻʹWDFֻط䡢ٺͻ
+// ECHO_RING_PORTABLEû̬룬ɵṩЩӿڣڵԪԺͻ׼ԣbench/ring_bench.c
+typedef struct _ECHO_RING {
+
+	KSPIN_LOCK Lock;
+	PECHO_BUFFER_POOL Pool;	// Ļ
+	PECHO_SLOT Slots;
+	ULONG SlotCount;
+	ULONG ChunkSize;		// 黺󳤶ȣͷ
+	ULONG MemoryCap;		// ŵܳȵޣҲǵд󳤶
+	ULONG StoredBytes;		// ѴŵܳȣдڶȡĲۣ
+	ULONG Head;				// һҪȡĲ
+	ULONG Tail;				// һҪдĲ
+	ULONG Count;			// ռõĲдڶȡĲۣ
+
+} ECHO_RING, *PECHO_RING;
+
+NTSTATUS
+EchoRingInitialize(
+	OUT PECHO_RING Ring,
+	IN ULONG SlotCount,
+	IN ULONG ChunkSize,
+	IN ULONG MemoryCap,
+	IN PECHO_BUFFER_POOL Pool
+);
+
+VOID
+EchoRingCleanup(
+	IN PECHO_RING Ring
+);
+
+NTSTATUS
+EchoRingReserve(
+	IN PECHO_RING Ring,
+	IN ULONG Length,
+	OUT PECHO_SLOT* Slot
+);
+
+NTSTATUS
+EchoRingCommit(
+	IN PECHO_RING Ring,
+	IN PECHO_SLOT Slot,
+	IN PVOID Buffer,
+	IN ULONG Length
+);
+
+NTSTATUS
+EchoRingWrite(
+	IN PECHO_RING Ring,
+	IN PVOID Buffer,
+	IN ULONG Length
+);
+
+BOOLEAN
+EchoRingIsEmpty(
+	IN PECHO_RING Ring
+);
+
+ULONG
+EchoRingRead(
+	IN PECHO_RING Ring,
+	OUT PVOID Buffer,
+	IN ULONG Length
+);
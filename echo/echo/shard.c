@@ -0,0 +1,221 @@
+#include "driver.h"
+#include "shard.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoShardInitialize)
+#pragma alloc_text (PAGE, EchoShardStopTimers)
+#endif
+
+
+// ƬEchoQueueInitializeе
+// 1 ĸECHO_MAX_SHARDSƬ飬һҳʱһҳ䣬ӻеı߽翪ʼ
+// 2 ʼÿƬͨڶеChannelList
+// 3 ÿƬĵȴСͺϲʱ
+// ƬʱShardCountΪ0ʹùͨͶеһȴɵ
+// ʧʱеٻصEchoShardCleanupEchoChannelCleanupԴδʼͨ
+NTSTATUS
+EchoShardInitialize(
+	IN WDFQUEUE Queue
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	PECHO_SHARD shard;
+	NTSTATUS status;
+	SIZE_T size;
+	ULONG count;
+	ULONG i;
+
+	PAGED_CODE();
+
+	queueContext->Shards = NULL;
+	queueContext->ShardCount = 0;
+	queueContext->ShardNext = 0;
+
+	if (queueContext->Config.ShardMode == EchoShardNone) {
+		return STATUS_SUCCESS;
+	}
+
+	// 1 Ƭ
+	count = KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS);
+	if (count > ECHO_MAX_SHARDS) {
+		count = ECHO_MAX_SHARDS;
+	}
+
+	size = (SIZE_T)count * sizeof(ECHO_SHARD);
+	if (size < PAGE_SIZE) {
+		size = PAGE_SIZE;
+	}
+
+	queueContext->Shards = ExAllocatePoolWithTag(NonPagedPoolNx, size, 'sam1');
+	if (queueContext->Shards == NULL) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoShardInitialize: Could not allocate %u shards", count);
+		return STATUS_INSUFFICIENT_RESOURCES;
+	}
+
+	RtlZeroMemory(queueContext->Shards, size);
+	queueContext->ShardCount = count;
+
+	for (i = 0; i < count; i++) {
+
+		shard = &queueContext->Shards[i];
+		shard->Index = i;
+
+		// 2 ʼƬͨ
+		status = EchoChannelInitialize(&shard->Channel,
+			Queue,
+			Queue,
+			queueContext->Config.SlotCount,
+			queueContext->Config.ChunkSize,
+			queueContext->Config.MemoryCap,
+			&queueContext->BufferPool);
+		if (!NT_SUCCESS(status)) {
+			TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoChannelInitialize for shard %u failed %!STATUS!", i, status);
+			return status;
+		}
+
+		WdfSpinLockAcquire(queueContext->ChannelLock);
+		InsertTailList(&queueContext->ChannelList, &shard->Channel.ChannelEntry);
+		WdfSpinLockRelease(queueContext->ChannelLock);
+
+		// 3 Ƭĵȴ
+		status = EchoCompletionInitialize(&shard->Pending, Queue);
+		if (!NT_SUCCESS(status)) {
+			TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoCompletionInitialize for shard %u failed %!STATUS!", i, status);
+			return status;
+		}
+	}
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_QUEUE, "EchoShardInitialize created %u shards, mode %u", count, queueContext->Config.ShardMode);
+
+	return STATUS_SUCCESS;
+}
+
+
+// ͷŷƬڶеٻصе
+// ƬͨеĿ黹бʱ͵ȴк豸һɾ
+VOID
+EchoShardCleanup(
+	IN WDFQUEUE Queue
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	ULONG i;
+
+	if (queueContext->Shards == NULL) {
+		return;
+	}
+
+	for (i = 0; i < queueContext->ShardCount; i++) {
+		EchoChannelCleanup(&queueContext->Shards[i].Channel);
+	}
+
+	ExFreePool(queueContext->Shards);
+	queueContext->Shards = NULL;
+	queueContext->ShardCount = 0;
+
+	return;
+}
+
+
+// 󵽴ʱѡƬ¼Ļ
+// EchoShardPerProcessorύĴ
+// EchoShardPerHandleļַĳ˷ϣͬһͬһƬûļ󰴴
+VOID
+EchoShardAssign(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	WDFFILEOBJECT fileObject;
+	ULONG index;
+
+	if (queueContext->ShardCount == 0) {
+		return;
+	}
+
+	fileObject = (queueContext->Config.ShardMode == EchoShardPerHandle) ? WdfRequestGetFileObject(Request) : NULL;
+
+	if (fileObject != NULL) {
+		index = (ULONG)(((ULONG64)(ULONG_PTR)fileObject * 0x9E3779B97F4A7C15ULL) >> 32);
+	}
+	else {
+		index = KeGetCurrentProcessorNumberEx(NULL);
+	}
+
+	RequestGetContext(Request)->Shard = &queueContext->Shards[index % queueContext->ShardCount];
+
+	return;
+}
+
+
+// ȡChannelһõĵIndexͨûиʱNULL
+// ChannelǹͨƬͨʱηзƬͨǹͬ湲ֻͨͨԼ
+// ģʽ㲥תԼͷžڹͨϵȴʱʹ
+PECHO_CHANNEL
+EchoShardChannelAt(
+	IN WDFQUEUE Queue,
+	IN PECHO_CHANNEL Channel,
+	IN ULONG    Index
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+
+	if (queueContext->ShardCount != 0 &&
+		(Channel == &queueContext->Channel ||
+		((PUCHAR)Channel >= (PUCHAR)queueContext->Shards &&
+		(PUCHAR)Channel < (PUCHAR)(queueContext->Shards + queueContext->ShardCount)))) {
+
+		return (Index < queueContext->ShardCount) ? &queueContext->Shards[Index].Channel : NULL;
+	}
+
+	return (Index == 0) ? Channel : NULL;
+}
+
+
+// ˳ӸƬĵȴMaxCount󣬷ɵĸ
+// ÿεôһƬʼEchoCompletionTimerģʽÿһʱƬ
+ULONG
+EchoShardDrain(
+	IN WDFQUEUE Queue,
+	IN ULONG    MaxCount
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	ULONG completed = 0;
+	ULONG start;
+	ULONG i;
+
+	if (queueContext->ShardCount == 0) {
+		return 0;
+	}
+
+	start = (ULONG)InterlockedIncrement(&queueContext->ShardNext);
+
+	for (i = 0; i < queueContext->ShardCount && completed < MaxCount; i++) {
+		completed += EchoCompletionDrain(queueContext,
+			&queueContext->Shards[(start + i) % queueContext->ShardCount].Pending,
+			MaxCount - completed);
+	}
+
+	return completed;
+}
+
+
+// ֹͣзƬĺϲʱȴʱصִŷأ豸ʱ
+VOID
+EchoShardStopTimers(
+	IN WDFQUEUE Queue
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	ULONG i;
+
+	PAGED_CODE();
+
+	for (i = 0; i < queueContext->ShardCount; i++) {
+		WdfTimerStop(queueContext->Shards[i].Pending.CoalesceTimer, TRUE);
+	}
+
+	return;
+}
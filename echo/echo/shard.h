@@ -0,0 +1,80 @@
+#pragma once
+
+// Default shard mode, none keeps one shared channel and one pending queue for the whole device
+#define ECHO_DEFAULT_SHARD_MODE		EchoShardNone
+
+// Upper bound of the shard count, the count is the number of active processors up to this
+#define ECHO_MAX_SHARDS				64
+
+// һȴɵﰴɲ󣬲ͬȼ֮Ȩת
+// еĻһ飻ƬʱÿƬһ飬֮ͬ䲻
+// ɲֻһݣڶеĻУɶһPendingLock
+typedef struct _ECHO_PENDING {
+
+	WDFQUEUE Queue;			// Ĭ϶
+	WDFQUEUE PendingQueue[ECHO_PRIORITY_CLASSES];	// ÿȼһֶУѴȴɵɿܴȡ
+	WDFSPINLOCK PendingLock;	// PendingCountȨת״̬ͺϲʱ
+	LONG PendingCount;		// ȴת֮䱻ȡȡʱʱΪ
+	LONG Deficit[ECHO_PRIORITY_CLASSES];	// ʣĶȣֽڣڸһֶ
+	ULONG Current;			// Ȩתǰ
+	WDFTIMER CoalesceTimer;	// һԶʱEchoCompletionCoalesceģʽµںɱеȴ
+
+} ECHO_PENDING, *PECHO_PENDING;
+
+// ȴкͺϲʱĻ
+typedef struct _PENDING_CONTEXT {
+
+	PECHO_PENDING Pending;
+
+} PENDING_CONTEXT, *PPENDING_CONTEXT;
+
+WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(PENDING_CONTEXT, PendingGetContext)
+
+// Ƭͬʱύʱͨ͵ȴɵΪƿ
+// ƬʱаĸƬÿƬԼͨλתȴԼһȴɵ
+// 󵽴ʱύĴĹϣѡƬ¼REQUEST_CONTEXTУ˺һֱʹƬ
+// ʹùͨ÷ƬͨƬͬ湲ͨ˽ͨʹ˽ֻͨڷƬеȴ
+// Ƭʱͬһ̵߳дͶͬһƬ󶨴֮߳以ã
+// ͬϵдͶٹͬһFIFOҪ紦ԵĳӦʹðƬ
+// Ƭ鰴ж룬ͬƬ
+typedef struct DECLSPEC_CACHEALIGN _ECHO_SHARD {
+
+	ECHO_CHANNEL Channel;	// ƬͨڶеChannelListϣ豸ʱ˽ͨһͷ
+	ECHO_PENDING Pending;	// Ƭеȴɵ
+	ULONG Index;
+
+} ECHO_SHARD, *PECHO_SHARD;
+
+NTSTATUS
+EchoShardInitialize(
+	IN WDFQUEUE Queue
+);
+
+VOID
+EchoShardCleanup(
+	IN WDFQUEUE Queue
+);
+
+VOID
+EchoShardAssign(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request
+);
+
+PECHO_CHANNEL
+EchoShardChannelAt(
+	IN WDFQUEUE Queue,
+	IN PECHO_CHANNEL Channel,
+	IN ULONG    Index
+);
+
+ULONG
+EchoShardDrain(
+	IN WDFQUEUE Queue,
+	IN ULONG    MaxCount
+);
+
+VOID
+EchoShardStopTimers(
+	IN WDFQUEUE Queue
+);
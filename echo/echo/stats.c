@@ -0,0 +1,172 @@
+#include "driver.h"
+#include "stats.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoStatsInitialize)
+#endif
+
+
+// Ϊÿһ
+// һҳʱһҳ䣬ҳҲǻУı߽翪ʼ
+NTSTATUS
+EchoStatsInitialize(
+	OUT PECHO_STATS_BLOCK Stats
+)
+{
+	LARGE_INTEGER frequency;
+	SIZE_T size;
+
+	PAGED_CODE();
+
+	RtlZeroMemory(Stats, sizeof(ECHO_STATS_BLOCK));
+
+	Stats->ProcessorCount = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+	size = (SIZE_T)Stats->ProcessorCount * sizeof(ECHO_CPU_STATS);
+	if (size < PAGE_SIZE) {
+		size = PAGE_SIZE;
+	}
+
+	Stats->PerCpu = ExAllocatePoolWithTag(NonPagedPoolNx, size, 'sam1');
+	if (Stats->PerCpu == NULL) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "EchoStatsInitialize: Could not allocate stats for %u processors", Stats->ProcessorCount);
+		return STATUS_INSUFFICIENT_RESOURCES;
+	}
+
+	RtlZeroMemory(Stats->PerCpu, size);
+
+	Stats->IntervalStart = KeQueryPerformanceCounter(&frequency).QuadPart;
+	Stats->Frequency = frequency.QuadPart;
+
+	return STATUS_SUCCESS;
+}
+
+
+// ͷżڶʱ
+VOID
+EchoStatsCleanup(
+	IN PECHO_STATS_BLOCK Stats
+)
+{
+	if (Stats->PerCpu != NULL) {
+		ExFreePool(Stats->PerCpu);
+		Stats->PerCpu = NULL;
+	}
+
+	return;
+}
+
+
+// ȡõǰܼ󵽴ʱ¼REQUEST_CONTEXT
+LONGLONG
+EchoStatsTimestamp(
+	VOID
+)
+{
+	return KeQueryPerformanceCounter(NULL).QuadPart;
+}
+
+
+// ¼һɣӳٰlog2(us)ӦͰͬʱȼClassķֲ
+VOID
+EchoStatsRecordCompletion(
+	IN PECHO_STATS_BLOCK Stats,
+	IN LONGLONG StartTime,
+	IN ULONG Class
+)
+{
+	PECHO_CPU_STATS cpuStats = EchoStatsCurrent(Stats);
+	LONGLONG elapsed = EchoStatsTimestamp() - StartTime;
+	ULONGLONG latencyUs;
+	ULONG bucket = 0;
+
+	if (elapsed > 0) {
+		latencyUs = (ULONGLONG)elapsed * 1000000 / (ULONGLONG)Stats->Frequency;
+		if (latencyUs > 1) {
+			bucket = (ULONG)RtlFindMostSignificantBit(latencyUs);
+			if (bucket >= ECHO_STATS_LATENCY_BUCKETS) {
+				bucket = ECHO_STATS_LATENCY_BUCKETS - 1;
+			}
+		}
+	}
+
+	InterlockedIncrement64(&cpuStats->Completions);
+	InterlockedIncrement64(&cpuStats->Latency[bucket]);
+
+	if (Class < ECHO_PRIORITY_CLASSES) {
+		InterlockedIncrement64(&cpuStats->ClassLatency[Class][bucket]);
+	}
+
+	return;
+}
+
+
+// ȡһResetʱͬʱ
+// ȡͬһԭӲĸҪô뱾νҪôһ
+static
+LONG64
+EchoStatsReadCounter(
+	IN volatile LONG64* Counter,
+	IN BOOLEAN Reset
+)
+{
+	if (Reset) {
+		return InterlockedExchange64(Counter, 0);
+	}
+
+	return InterlockedCompareExchange64(Counter, 0, 0);
+}
+
+
+// дļ
+// Pendingǵǰȣᱻ
+VOID
+EchoStatsQuery(
+	IN PECHO_STATS_BLOCK Stats,
+	IN BOOLEAN Reset,
+	OUT PECHO_STATS Result
+)
+{
+	PECHO_CPU_STATS cpuStats;
+	LONGLONG now = EchoStatsTimestamp();
+	LONGLONG start;
+	ULONG i, j, k;
+
+	RtlZeroMemory(Result, sizeof(ECHO_STATS));
+
+	start = Reset ? InterlockedExchange64(&Stats->IntervalStart, now) :
+		InterlockedCompareExchange64(&Stats->IntervalStart, 0, 0);
+
+	Result->IntervalUs = (ULONG64)(now - start) * 1000000 / (ULONG64)Stats->Frequency;
+	Result->ProcessorCount = Stats->ProcessorCount;
+
+	for (i = 0; i < Stats->ProcessorCount; i++) {
+
+		cpuStats = &Stats->PerCpu[i];
+
+		Result->BytesIn += EchoStatsReadCounter(&cpuStats->BytesIn, Reset);
+		Result->BytesOut += EchoStatsReadCounter(&cpuStats->BytesOut, Reset);
+		Result->WriteRequests += EchoStatsReadCounter(&cpuStats->WriteRequests, Reset);
+		Result->ReadRequests += EchoStatsReadCounter(&cpuStats->ReadRequests, Reset);
+		Result->Completions += EchoStatsReadCounter(&cpuStats->Completions, Reset);
+		Result->Cancels += EchoStatsReadCounter(&cpuStats->Cancels, Reset);
+		Result->AllocationFailures += EchoStatsReadCounter(&cpuStats->AllocationFailures, Reset);
+		Result->ReadWaits += EchoStatsReadCounter(&cpuStats->ReadWaits, Reset);
+		Result->ReadWaitTimeouts += EchoStatsReadCounter(&cpuStats->ReadWaitTimeouts, Reset);
+		Result->WriteWaits += EchoStatsReadCounter(&cpuStats->WriteWaits, Reset);
+		Result->AdmissionWaits += EchoStatsReadCounter(&cpuStats->AdmissionWaits, Reset);
+		Result->BatchOps += EchoStatsReadCounter(&cpuStats->BatchOps, Reset);
+		Result->UringOps += EchoStatsReadCounter(&cpuStats->UringOps, Reset);
+		Result->PendingDepth += EchoStatsReadCounter(&cpuStats->Pending, FALSE);
+
+		for (j = 0; j < ECHO_STATS_LATENCY_BUCKETS; j++) {
+			Result->Latency[j] += EchoStatsReadCounter(&cpuStats->Latency[j], Reset);
+
+			for (k = 0; k < ECHO_PRIORITY_CLASSES; k++) {
+				Result->ClassLatency[k][j] += EchoStatsReadCounter(&cpuStats->ClassLatency[k][j], Reset);
+			}
+		}
+	}
+
+	return;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+// һļж룬ͬļ
+// ֻɵǰϵĴInterlocked£ҪҲûл
+// ߳ȡô֮󱻵ȵʱInterlocked֤Ȼȷ
+typedef struct DECLSPEC_CACHEALIGN _ECHO_CPU_STATS {
+
+	volatile LONG64 BytesIn;
+	volatile LONG64 BytesOut;
+	volatile LONG64 WriteRequests;
+	volatile LONG64 ReadRequests;
+	volatile LONG64 Completions;
+	volatile LONG64 Cancels;
+	volatile LONG64 AllocationFailures;
+	volatile LONG64 ReadWaits;
+	volatile LONG64 ReadWaitTimeouts;
+	volatile LONG64 WriteWaits;
+	volatile LONG64 AdmissionWaits;
+	volatile LONG64 BatchOps;
+	volatile LONG64 UringOps;
+	volatile LONG64 Pending;		// 뿪ȴĲֵ֮Ϊǰ
+	volatile LONG64 Latency[ECHO_STATS_LATENCY_BUCKETS];
+	volatile LONG64 ClassLatency[ECHO_PRIORITY_CLASSES][ECHO_STATS_LATENCY_BUCKETS];
+
+} ECHO_CPU_STATS, *PECHO_CPU_STATS;
+
+// 豸ͳƣɶӵ
+// ģ鲻WDFIRQL <= DISPATCH_LEVEL¸ºͲѯ
+typedef struct _ECHO_STATS_BLOCK {
+
+	PECHO_CPU_STATS PerCpu;
+	ULONG ProcessorCount;
+	LONGLONG Frequency;				// KeQueryPerformanceCounterƵ
+	volatile LONG64 IntervalStart;	// ϴʱܼ
+
+} ECHO_STATS_BLOCK, *PECHO_STATS_BLOCK;
+
+// ȡõǰļ
+#define EchoStatsCurrent(Stats) \
+	(&(Stats)->PerCpu[KeGetCurrentProcessorNumberEx(NULL)])
+
+// ǰļFieldValue
+#define EchoStatsAdd(Stats, Field, Value) \
+	InterlockedAdd64(&EchoStatsCurrent(Stats)->Field, (LONG64)(Value))
+
+NTSTATUS
+EchoStatsInitialize(
+	OUT PECHO_STATS_BLOCK Stats
+);
+
+VOID
+EchoStatsCleanup(
+	IN PECHO_STATS_BLOCK Stats
+);
+
+LONGLONG
+EchoStatsTimestamp(
+	VOID
+);
+
+VOID
+EchoStatsRecordCompletion(
+	IN PECHO_STATS_BLOCK Stats,
+	IN LONGLONG StartTime,
+	IN ULONG Class
+);
+
+VOID
+EchoStatsQuery(
+	IN PECHO_STATS_BLOCK Stats,
+	IN BOOLEAN Reset,
+	OUT PECHO_STATS Result
+);
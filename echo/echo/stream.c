@@ -0,0 +1,406 @@
+#include "driver.h"
+#include "stream.tmh"
+
+
+// ûдɵд黹ڴԤ㣬黹Ԥ㹻׼д
+// requestɺ˽ͨļ٣ֻʹ豸Ķ
+static
+VOID
+EchoStreamUncharge(
+	IN WDFQUEUE   Queue,
+	IN ULONG      Length
+)
+{
+	EchoBufferUncharge(&QueueGetContext(Queue)->BufferPool, Length);
+	EchoAdmissionRun(Queue);
+
+	return;
+}
+
+
+// BufferLengthֽ׷ӵģʽͨFIFOFIFOʱд
+// 1 StreamLockȰStreamWaitCountһٳд룬EchoStreamWakeһԷ
+// 2 дڵȴʱֱǺ棬
+// 3 ʱдȴΪȡSTATUS_PENDINGrequestEchoStreamWakeȡص
+// EchoRingWriteĽrequestɵɣ豸ڹʱSTATUS_DEVICE_BUSY
+// дڴԤеԤûдʱ黹
+// ֻռòۣͷٸݣ۵˳д󵽴˳򣬶дͬʱ
+NTSTATUS
+EchoStreamWrite(
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+)
+{
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+	WDFQUEUE queue = Channel->Queue;
+	PQUEUE_CONTEXT queueContext = QueueGetContext(queue);
+	NTSTATUS status = STATUS_DEVICE_BUSY;
+	PECHO_SLOT slot = NULL;
+
+	requestContext->Buffer = Buffer;
+	requestContext->Length = Length;
+
+	// 1 ռò
+	WdfSpinLockAcquire(Channel->StreamLock);
+
+	InterlockedIncrement(&Channel->StreamWaitCount);
+
+	// 2 ûдڵȴʱֱд
+	if (IsListEmpty(&Channel->StreamList)) {
+		status = EchoRingReserve(&Channel->Ring, Length, &slot);
+	}
+
+	if (status != STATUS_DEVICE_BUSY || queueContext->StreamSuspended) {
+		InterlockedDecrement(&Channel->StreamWaitCount);
+		WdfSpinLockRelease(Channel->StreamLock);
+
+		if (NT_SUCCESS(status)) {
+			status = EchoRingCommit(&Channel->Ring, slot, Buffer, Length);
+		}
+
+		return status;
+	}
+
+	// 3 дȴȹΪȡEchoEvtStreamWriteCancelҵ
+	InsertTailList(&Channel->StreamList, &requestContext->ListEntry);
+
+	if (WdfRequestMarkCancelableEx(Request, EchoEvtStreamWriteCancel) == STATUS_CANCELLED) {
+		RemoveEntryList(&requestContext->ListEntry);
+		InitializeListHead(&requestContext->ListEntry);
+		InterlockedDecrement(&Channel->StreamWaitCount);
+		WdfSpinLockRelease(Channel->StreamLock);
+		EchoStatsAdd(&queueContext->Stats, Cancels, 1);
+		WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
+		EchoStreamUncharge(queue, Length);
+		return STATUS_PENDING;
+	}
+
+	WdfSpinLockRelease(Channel->StreamLock);
+
+	TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_IO, "EchoStreamWrite Request 0x%p waits for %u bytes of space", Request, Length);
+
+	EchoStatsAdd(&queueContext->Stats, WriteWaits, 1);
+
+	return STATUS_PENDING;
+}
+
+
+// ģʽͨFIFOͷȡLengthֽڣضȡĳ
+// һ۶һֱۣBufferFIFOΪ
+ULONG
+EchoStreamRead(
+	IN PECHO_CHANNEL Channel,
+	OUT PVOID     Buffer,
+	IN ULONG      Length
+)
+{
+	ULONG bytesRead = 0;
+	ULONG copied;
+
+	while (bytesRead < Length) {
+		copied = EchoRingRead(&Channel->Ring, (PUCHAR)Buffer + bytesRead, Length - bytesRead);
+		if (copied == 0) {
+			break;
+		}
+
+		bytesRead += copied;
+	}
+
+	return bytesRead;
+}
+
+
+// ڳռãFIFO˳ѵȴд뻷λ
+// 1 ûдڵȴڳʱȡ
+// 2 ͬһʱֻһѹУлѹʱStreamRewakeټһ飬Ȼ󷵻
+//   ݻỽѶ󣬶ڳռ䣬òǶ
+// 3 StreamLockȡдռòۣѱȡĽȡص
+// 4 ûпռ䣨STATUS_DEVICE_BUSYʱŻͷΪȡֹͣ
+// 5 ͷݲύۣȡµдݴʱѵȴݵĶ
+VOID
+EchoStreamWake(
+	IN PECHO_CHANNEL Channel
+)
+{
+	WDFQUEUE queue = Channel->Queue;
+	PQUEUE_CONTEXT queueContext = QueueGetContext(queue);
+	PREQUEST_CONTEXT requestContext;
+	LIST_ENTRY doneList;
+	PLIST_ENTRY entry;
+	WDFREQUEST request;
+	NTSTATUS status;
+	ULONG length;
+	BOOLEAN stored;
+
+	// 1 ȹ黹ռٶȡдȼһٳд
+	KeMemoryBarrier();
+	if (Channel->StreamWaitCount == 0) {
+		return;
+	}
+
+	InitializeListHead(&doneList);
+
+	WdfSpinLockAcquire(Channel->StreamLock);
+
+	// 2 лѹ
+	if (Channel->StreamWaking) {
+		Channel->StreamRewake = TRUE;
+		WdfSpinLockRelease(Channel->StreamLock);
+		return;
+	}
+
+	Channel->StreamWaking = TRUE;
+
+	do {
+
+		Channel->StreamRewake = FALSE;
+		stored = FALSE;
+
+		while (!IsListEmpty(&Channel->StreamList)) {
+
+			// 3 ȡд
+			entry = RemoveHeadList(&Channel->StreamList);
+			InitializeListHead(entry);
+
+			requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+			request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+			if (WdfRequestUnmarkCancelable(request) == STATUS_CANCELLED) {
+				InterlockedDecrement(&Channel->StreamWaitCount);
+				continue;
+			}
+
+			status = EchoRingReserve(&Channel->Ring, requestContext->Length, &requestContext->Slot);
+
+			// 4 Ȼûпռ䣬Żͷ
+			if (status == STATUS_DEVICE_BUSY) {
+				InsertHeadList(&Channel->StreamList, entry);
+
+				if (WdfRequestMarkCancelableEx(request, EchoEvtStreamWriteCancel) == STATUS_CANCELLED) {
+					RemoveEntryList(entry);
+					InitializeListHead(entry);
+					InterlockedDecrement(&Channel->StreamWaitCount);
+					requestContext->Status = STATUS_CANCELLED;
+					InsertTailList(&doneList, entry);
+				}
+				break;
+			}
+
+			InterlockedDecrement(&Channel->StreamWaitCount);
+			requestContext->Status = status;
+			InsertTailList(&doneList, entry);
+		}
+
+		WdfSpinLockRelease(Channel->StreamLock);
+
+		// 5 ݣȡµд
+		while (!IsListEmpty(&doneList)) {
+
+			entry = RemoveHeadList(&doneList);
+			InitializeListHead(entry);
+
+			requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+			request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+			if (NT_SUCCESS(requestContext->Status)) {
+				requestContext->Status = EchoRingCommit(&Channel->Ring, requestContext->Slot,
+					requestContext->Buffer, requestContext->Length);
+			}
+
+			requestContext->Slot = NULL;
+
+			if (NT_SUCCESS(requestContext->Status)) {
+				stored = TRUE;
+				EchoStatsAdd(&queueContext->Stats, BytesIn, requestContext->Length);
+				WdfRequestSetInformation(request, (ULONG_PTR)requestContext->Length);
+				EchoCompletionPend(Channel->Queue, request, STATUS_SUCCESS);
+				continue;
+			}
+
+			if (requestContext->Status == STATUS_CANCELLED) {
+				EchoStatsAdd(&queueContext->Stats, Cancels, 1);
+			}
+			else if (requestContext->Status == STATUS_INSUFFICIENT_RESOURCES) {
+				EchoStatsAdd(&queueContext->Stats, AllocationFailures, 1);
+			}
+
+			length = requestContext->Length;
+			WdfRequestCompleteWithInformation(request, requestContext->Status, 0L);
+			EchoStreamUncharge(queue, length);
+		}
+
+		if (stored) {
+			EchoReadWaitWake(Channel);
+		}
+
+		WdfSpinLockAcquire(Channel->StreamLock);
+
+	} while (Channel->StreamRewake);
+
+	Channel->StreamWaking = FALSE;
+
+	WdfSpinLockRelease(Channel->StreamLock);
+
+	return;
+}
+
+
+// ȡдȴFileObjectдFileObjectΪNULLʱȡд
+// ȡµListϣɵͷ֮
+static
+VOID
+EchoStreamDetach(
+	IN PECHO_CHANNEL Channel,
+	IN WDFFILEOBJECT FileObject,
+	IN OUT PLIST_ENTRY List
+)
+{
+	PREQUEST_CONTEXT requestContext;
+	PLIST_ENTRY entry;
+	PLIST_ENTRY next;
+	WDFREQUEST request;
+
+	WdfSpinLockAcquire(Channel->StreamLock);
+
+	for (entry = Channel->StreamList.Flink; entry != &Channel->StreamList; entry = next) {
+
+		next = entry->Flink;
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+		if (FileObject != NULL && WdfRequestGetFileObject(request) != FileObject) {
+			continue;
+		}
+
+		RemoveEntryList(entry);
+		InitializeListHead(entry);
+		InterlockedDecrement(&Channel->StreamWaitCount);
+
+		if (WdfRequestUnmarkCancelable(request) != STATUS_CANCELLED) {
+			InsertTailList(List, entry);
+		}
+	}
+
+	WdfSpinLockRelease(Channel->StreamLock);
+
+	return;
+}
+
+
+// Listϵдûд룬黹ǵڴԤ
+static
+VOID
+EchoStreamCompleteList(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN PLIST_ENTRY List,
+	IN NTSTATUS    Status
+)
+{
+	PREQUEST_CONTEXT requestContext;
+	PLIST_ENTRY entry;
+	WDFREQUEST request;
+	ULONG length;
+
+	while (!IsListEmpty(List)) {
+
+		entry = RemoveHeadList(List);
+		InitializeListHead(entry);
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+		length = requestContext->Length;
+		WdfRequestCompleteWithInformation(request, Status, 0L);
+		EchoBufferUncharge(&QueueContext->BufferPool, length);
+	}
+
+	return;
+}
+
+
+// StatusͨFileObjectеȴд󣬹رվʱ
+VOID
+EchoStreamRelease(
+	IN PECHO_CHANNEL Channel,
+	IN WDFFILEOBJECT FileObject,
+	IN NTSTATUS      Status
+)
+{
+	WDFQUEUE queue = Channel->Queue;
+	LIST_ENTRY releaseList;
+
+	InitializeListHead(&releaseList);
+
+	EchoStreamDetach(Channel, FileObject, &releaseList);
+	EchoStreamCompleteList(QueueGetContext(queue), &releaseList, Status);
+	EchoAdmissionRun(queue);
+
+	return;
+}
+
+
+// 豸ʱãͨϵȴд󷵻STATUS_DEVICE_BUSY벻ģʽʱдFIFOͬ
+// ˺ֱ豸صD0дٹȴֹͣĬ϶ʱһֱȴ
+VOID
+EchoStreamReleaseAll(
+	IN PQUEUE_CONTEXT QueueContext
+)
+{
+	LIST_ENTRY releaseList;
+	PLIST_ENTRY entry;
+
+	InitializeListHead(&releaseList);
+
+	QueueContext->StreamSuspended = TRUE;
+
+	EchoStreamDetach(&QueueContext->Channel, NULL, &releaseList);
+
+	WdfSpinLockAcquire(QueueContext->ChannelLock);
+
+	for (entry = QueueContext->ChannelList.Flink; entry != &QueueContext->ChannelList; entry = entry->Flink) {
+		EchoStreamDetach(CONTAINING_RECORD(entry, ECHO_CHANNEL, ChannelEntry), NULL, &releaseList);
+	}
+
+	WdfSpinLockRelease(QueueContext->ChannelLock);
+
+	EchoStreamCompleteList(QueueContext, &releaseList, STATUS_DEVICE_BUSY);
+
+	return;
+}
+
+
+// ȴдȡʱĻص
+VOID
+EchoEvtStreamWriteCancel(
+	IN WDFREQUEST Request
+)
+{
+	PECHO_CHANNEL channel = EchoRequestGetChannel(Request);
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+	WDFQUEUE queue = channel->Queue;
+	ULONG length = requestContext->Length;
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_IO, "EchoEvtStreamWriteCancel called on Request 0x%p", Request);
+
+	// ѱȡµListEntryָ
+	WdfSpinLockAcquire(channel->StreamLock);
+
+	if (!IsListEmpty(&requestContext->ListEntry)) {
+		RemoveEntryList(&requestContext->ListEntry);
+		InitializeListHead(&requestContext->ListEntry);
+		InterlockedDecrement(&channel->StreamWaitCount);
+	}
+
+	WdfSpinLockRelease(channel->StreamLock);
+
+	EchoStatsAdd(&QueueGetContext(channel->Queue)->Stats, Cancels, 1);
+
+	WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
+
+	EchoStreamUncharge(queue, length);
+
+	return;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+// ģʽͨIOCTL_ECHO_SET_STREAM򿪺󣬻λΪнֽFIFOʹ
+// ͷȡԿԽдı߽磻д׷ӵβ
+// FIFOûпвۻ򳬹MemoryCapʱдͨдȴϣǷSTATUS_DEVICE_BUSY
+// ڳռFIFO˳ѵȴд뻷λߵٶԼ
+// 㿽ģʽд͹תϣFIFOʱǼʧܣforward.h
+// ÿͨԼдȴͨStreamLockͷ֮
+
+NTSTATUS
+EchoStreamWrite(
+	IN PECHO_CHANNEL Channel,
+	IN WDFREQUEST Request,
+	IN PVOID      Buffer,
+	IN ULONG      Length
+);
+
+ULONG
+EchoStreamRead(
+	IN PECHO_CHANNEL Channel,
+	OUT PVOID     Buffer,
+	IN ULONG      Length
+);
+
+VOID
+EchoStreamWake(
+	IN PECHO_CHANNEL Channel
+);
+
+VOID
+EchoStreamRelease(
+	IN PECHO_CHANNEL Channel,
+	IN WDFFILEOBJECT FileObject,
+	IN NTSTATUS      Status
+);
+
+VOID
+EchoStreamReleaseAll(
+	IN PQUEUE_CONTEXT QueueContext
+);
+
+EVT_WDF_REQUEST_CANCEL EchoEvtStreamWriteCancel;
@@ -0,0 +1,300 @@
+#include "driver.h"
+#include "ticker.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoTickerInitialize)
+#endif
+
+
+// ConfigһԶʱΪ
+// ʱصԼȡLockرAutomaticSerialization
+static
+NTSTATUS
+EchoTickerCreateTimer(
+	IN  PECHO_TICKER       Ticker,
+	IN  PECHO_TIMER_CONFIG Config,
+	OUT WDFTIMER*          Timer
+)
+{
+	WDF_TIMER_CONFIG timerConfig;
+	WDF_OBJECT_ATTRIBUTES attributes;
+
+	WDF_TIMER_CONFIG_INIT(&timerConfig, Ticker->TimerFunc);
+	timerConfig.AutomaticSerialization = FALSE;
+	timerConfig.UseHighResolutionTimer = Config->HighResolution ? WdfTrue : WdfFalse;
+	timerConfig.TolerableDelay = Config->TolerableDelayMs;
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = Ticker->Queue;
+
+	return WdfTimerCreate(&timerConfig, &attributes, Timer);
+}
+
+
+// ExpectedΪʱʱ߳Lock
+// Ѿڲٲϣǰʱ֮ĵһʱ
+static
+VOID
+EchoTickerArm(
+	IN PECHO_TICKER Ticker
+)
+{
+	LONGLONG now = KeQueryPerformanceCounter(NULL).QuadPart;
+	LONGLONG missed;
+	LONGLONG remaining;
+
+	if (Ticker->Expected <= now) {
+		missed = (now - Ticker->Expected) / Ticker->PeriodTicks + 1;
+		Ticker->Expected += missed * Ticker->PeriodTicks;
+		Ticker->Missed += missed;
+	}
+
+	// 100ns
+	remaining = (Ticker->Expected - now) * 10000000 / Ticker->Frequency;
+	if (remaining < 1) {
+		remaining = 1;
+	}
+
+	WdfTimerStart(Ticker->Timer, -remaining);
+
+	return;
+}
+
+
+// ʼɶʱPeriodUsڴͨȵĶʱ豸D0ʱEchoTickerStart
+NTSTATUS
+EchoTickerInitialize(
+	OUT PECHO_TICKER   Ticker,
+	IN  WDFQUEUE       Queue,
+	IN  PFN_WDF_TIMER  TimerFunc,
+	IN  ULONG          PeriodUs
+)
+{
+	NTSTATUS status;
+	WDF_OBJECT_ATTRIBUTES attributes;
+	LARGE_INTEGER frequency;
+
+	PAGED_CODE();
+
+	RtlZeroMemory(Ticker, sizeof(ECHO_TICKER));
+
+	KeQueryPerformanceCounter(&frequency);
+	Ticker->Frequency = frequency.QuadPart;
+	Ticker->Queue = Queue;
+	Ticker->TimerFunc = TimerFunc;
+	Ticker->Config.PeriodUs = PeriodUs;
+	Ticker->Config.HighResolution = FALSE;
+	Ticker->Config.TolerableDelayMs = 0;
+	Ticker->PeriodTicks = Ticker->Frequency * Ticker->Config.PeriodUs / 1000000;
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = Queue;
+
+	status = WdfSpinLockCreate(&attributes, &Ticker->Lock);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_COMPLETION, "WdfSpinLockCreate failed %!STATUS!", status);
+		return status;
+	}
+
+	status = EchoTickerCreateTimer(Ticker, &Ticker->Config, &Ticker->Timer);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_COMPLETION, "Error creating timer %!STATUS!", status);
+		return status;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+
+// µ滻ʱ㶶ͳ
+// 1 ãڵķΧ߾ȶʱָӳ
+// 2 µĶʱ
+// 3 滻Timer豸D0ʱ
+// 4 ֹͣɾɵĶʱȴִеĻصأֻPASSIVE_LEVEL
+NTSTATUS
+EchoTickerConfigure(
+	IN PECHO_TICKER       Ticker,
+	IN PECHO_TIMER_CONFIG Config
+)
+{
+	NTSTATUS status;
+	WDFTIMER timer;
+	WDFTIMER oldTimer;
+
+	// 1 
+	if (Config->PeriodUs < ECHO_TIMER_MIN_PERIOD_US ||
+		Config->PeriodUs > ECHO_TICKER_MAX_PERIOD_US ||
+		(Config->HighResolution && Config->TolerableDelayMs != 0)) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	if (KeGetCurrentIrql() != PASSIVE_LEVEL) {
+		return STATUS_INVALID_DEVICE_STATE;
+	}
+
+	// 2 µĶʱ
+	status = EchoTickerCreateTimer(Ticker, Config, &timer);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_COMPLETION, "Error creating timer %!STATUS!", status);
+		return status;
+	}
+
+	// 3 滻ʱ
+	WdfSpinLockAcquire(Ticker->Lock);
+
+	oldTimer = Ticker->Timer;
+	Ticker->Timer = timer;
+	Ticker->Config = *Config;
+	Ticker->Config.HighResolution = (Config->HighResolution != 0);
+	Ticker->PeriodTicks = Ticker->Frequency * Config->PeriodUs / 1000000;
+	if (Ticker->PeriodTicks == 0) {
+		Ticker->PeriodTicks = 1;
+	}
+
+	Ticker->Fires = 0;
+	Ticker->Early = 0;
+	Ticker->Missed = 0;
+	Ticker->TotalLateUs = 0;
+	Ticker->MaxLateUs = 0;
+	RtlZeroMemory(Ticker->Histogram, sizeof(Ticker->Histogram));
+
+	if (Ticker->Running) {
+		Ticker->Expected = KeQueryPerformanceCounter(NULL).QuadPart + Ticker->PeriodTicks;
+		EchoTickerArm(Ticker);
+	}
+
+	WdfSpinLockRelease(Ticker->Lock);
+
+	// 4 ɶʱĻصTimerѱ滻
+	WdfTimerStop(oldTimer, TRUE);
+	WdfObjectDelete(oldTimer);
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_COMPLETION, "Completion timer: period %u us, high resolution %u, tolerable delay %u ms",
+		Config->PeriodUs, Ticker->Config.HighResolution, Config->TolerableDelayMs);
+
+	return STATUS_SUCCESS;
+}
+
+
+// 豸D0ʱʱһECHO_TICKER_START_DELAY_US֮󴥷
+VOID
+EchoTickerStart(
+	IN PECHO_TICKER Ticker
+)
+{
+	WdfSpinLockAcquire(Ticker->Lock);
+
+	Ticker->Running = TRUE;
+	Ticker->Expected = KeQueryPerformanceCounter(NULL).QuadPart +
+		Ticker->Frequency * ECHO_TICKER_START_DELAY_US / 1000000;
+	EchoTickerArm(Ticker);
+
+	WdfSpinLockRelease(Ticker->Lock);
+
+	return;
+}
+
+
+// 豸뿪D0ʱֹͣʱȴصִŷ
+VOID
+EchoTickerStop(
+	IN PECHO_TICKER Ticker
+)
+{
+	WDFTIMER timer;
+
+	WdfSpinLockAcquire(Ticker->Lock);
+
+	Ticker->Running = FALSE;
+	timer = Ticker->Timer;
+
+	WdfSpinLockRelease(Ticker->Lock);
+
+	WdfTimerStop(timer, TRUE);
+
+	return;
+}
+
+
+// ʱصʼʱã¼һ
+// Timerѱ滻豸뿪D0ʱFALSEδһ
+BOOLEAN
+EchoTickerFired(
+	IN PECHO_TICKER Ticker,
+	IN WDFTIMER     Timer
+)
+{
+	LONGLONG late = KeQueryPerformanceCounter(NULL).QuadPart;
+	ULONGLONG lateUs = 0;
+	ULONG bucket = 0;
+
+	WdfSpinLockAcquire(Ticker->Lock);
+
+	if (Timer != Ticker->Timer || !Ticker->Running) {
+		WdfSpinLockRelease(Ticker->Lock);
+		return FALSE;
+	}
+
+	late -= Ticker->Expected;
+	if (late < 0) {
+		Ticker->Early++;
+	}
+	else {
+		lateUs = (ULONGLONG)late * 1000000 / (ULONGLONG)Ticker->Frequency;
+		if (lateUs > 1) {
+			bucket = (ULONG)RtlFindMostSignificantBit(lateUs);
+			if (bucket >= ECHO_STATS_LATENCY_BUCKETS) {
+				bucket = ECHO_STATS_LATENCY_BUCKETS - 1;
+			}
+		}
+	}
+
+	Ticker->Fires++;
+	Ticker->TotalLateUs += lateUs;
+	if (lateUs > Ticker->MaxLateUs) {
+		Ticker->MaxLateUs = lateUs;
+	}
+	Ticker->Histogram[bucket]++;
+
+	Ticker->Expected += Ticker->PeriodTicks;
+	EchoTickerArm(Ticker);
+
+	WdfSpinLockRelease(Ticker->Lock);
+
+	return TRUE;
+}
+
+
+// ȡǰúͶͳƣResetʱͬʱ
+VOID
+EchoTickerQueryJitter(
+	IN  PECHO_TICKER       Ticker,
+	IN  BOOLEAN            Reset,
+	OUT PECHO_TIMER_JITTER Result
+)
+{
+	RtlZeroMemory(Result, sizeof(ECHO_TIMER_JITTER));
+
+	WdfSpinLockAcquire(Ticker->Lock);
+
+	Result->Config = Ticker->Config;
+	Result->Fires = Ticker->Fires;
+	Result->Early = Ticker->Early;
+	Result->Missed = Ticker->Missed;
+	Result->TotalLateUs = Ticker->TotalLateUs;
+	Result->MaxLateUs = Ticker->MaxLateUs;
+	RtlCopyMemory(Result->Histogram, Ticker->Histogram, sizeof(Result->Histogram));
+
+	if (Reset) {
+		Ticker->Fires = 0;
+		Ticker->Early = 0;
+		Ticker->Missed = 0;
+		Ticker->TotalLateUs = 0;
+		Ticker->MaxLateUs = 0;
+		RtlZeroMemory(Ticker->Histogram, sizeof(Ticker->Histogram));
+	}
+
+	WdfSpinLockRelease(Ticker->Lock);
+
+	return;
+}
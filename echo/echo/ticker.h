@@ -0,0 +1,72 @@
+#pragma once
+
+// ɶʱĬãTIMER_PERIODmsͨʱ
+#define ECHO_TICKER_DEFAULT_PERIOD_US	(TIMER_PERIOD * 1000)
+
+// ɶʱ
+#define ECHO_TICKER_MAX_PERIOD_US		(60 * 1000 * 1000)
+
+// 豸һδӳ
+#define ECHO_TICKER_START_DELAY_US		(100 * 1000)
+
+// ɶʱEchoCompletionTimerģʽÿһ
+// ʹһԶʱÿδʱڿԶ1msҲٵۻƯ
+// ߾ȺͿӳֻڴʱʱָ޸ʱµĶʱֹͣɾɵĶʱ
+// ÿδ¼ʵʱʱ֮IOCTL_ECHO_GET_TIMER_JITTERȡ
+typedef struct _ECHO_TICKER {
+
+	WDFSPINLOCK Lock;		// Timer滻RunningExpectedͶͳ
+	WDFTIMER Timer;			// ǰĶʱɶʱĻصԼѱ滻ʱ
+	WDFQUEUE Queue;			// ʱĸ
+	PFN_WDF_TIMER TimerFunc;
+	ECHO_TIMER_CONFIG Config;
+	LONGLONG Frequency;		// KeQueryPerformanceCounterƵ
+	LONGLONG PeriodTicks;	// һڵܼ
+	LONGLONG Expected;		// һδʱ
+	BOOLEAN Running;		// 豸D0ʱӦ
+
+	ULONG64 Fires;
+	ULONG64 Early;
+	ULONG64 Missed;
+	ULONG64 TotalLateUs;
+	ULONG64 MaxLateUs;
+	ULONG64 Histogram[ECHO_STATS_LATENCY_BUCKETS];
+
+} ECHO_TICKER, *PECHO_TICKER;
+
+NTSTATUS
+EchoTickerInitialize(
+	OUT PECHO_TICKER   Ticker,
+	IN  WDFQUEUE       Queue,
+	IN  PFN_WDF_TIMER  TimerFunc,
+	IN  ULONG          PeriodUs
+);
+
+NTSTATUS
+EchoTickerConfigure(
+	IN PECHO_TICKER       Ticker,
+	IN PECHO_TIMER_CONFIG Config
+);
+
+VOID
+EchoTickerStart(
+	IN PECHO_TICKER Ticker
+);
+
+VOID
+EchoTickerStop(
+	IN PECHO_TICKER Ticker
+);
+
+BOOLEAN
+EchoTickerFired(
+	IN PECHO_TICKER Ticker,
+	IN WDFTIMER     Timer
+);
+
+VOID
+EchoTickerQueryJitter(
+	IN  PECHO_TICKER       Ticker,
+	IN  BOOLEAN            Reset,
+	OUT PECHO_TIMER_JITTER Result
+);
@@ -0,0 +1,55 @@
+/*++
+
+Module Name:
+
+	trace.h
+
+Abstract:
+
+	Header file for the debug tracing related function defintions and macros.
+
+Environment:
+
+	Kernel mode
+
+--*/
+
+#include <evntrace.h> // For TRACE_LEVEL definitions
+
+//
+// Define the tracing flags.
+//
+// Tracing GUID - d67e46f0-281b-4854-a6fd-b20acd5438ba
+// The same GUID is GUID_ECHO_TRACE_PROVIDER in public.h, used by the application to enable the provider
+//
+
+#define WPP_CONTROL_GUIDS                                              \
+    WPP_DEFINE_CONTROL_GUID(                                           \
+        EchoTraceGuid, (d67e46f0,281b,4854,a6fd,b20acd5438ba),         \
+                                                                       \
+        WPP_DEFINE_BIT(TRACE_DRIVER)         /* bit  0 = 0x00000001 */ \
+        WPP_DEFINE_BIT(TRACE_DEVICE)         /* bit  1 = 0x00000002 */ \
+        WPP_DEFINE_BIT(TRACE_QUEUE)          /* bit  2 = 0x00000004 */ \
+        WPP_DEFINE_BIT(TRACE_IO)             /* bit  3 = 0x00000008 */ \
+        WPP_DEFINE_BIT(TRACE_COMPLETION)     /* bit  4 = 0x00000010 */ \
+        WPP_DEFINE_BIT(TRACE_FORWARD)        /* bit  5 = 0x00000020 */ \
+        WPP_DEFINE_BIT(TRACE_CHANNEL)        /* bit  6 = 0x00000040 */ \
+        WPP_DEFINE_BIT(TRACE_BUFFER)         /* bit  7 = 0x00000080 */ \
+        )
+
+// ÿTraceEventsȼñ־λǷáỰļǷ񲻵LEVELŸʽ
+// ûиٻỰʱÿֻһڴȡͱȽϣдصеVERBOSEټûп
+#define WPP_LEVEL_FLAGS_LOGGER(lvl,flags) \
+           WPP_LEVEL_LOGGER(flags)
+
+#define WPP_LEVEL_FLAGS_ENABLED(lvl, flags) \
+           (WPP_LEVEL_ENABLED(flags) && WPP_CONTROL(WPP_BIT_ ## flags).Level >= lvl)
+
+//
+// This comment block is scanned by the trace preprocessor to define our
+// TraceEvents function.
+//
+// begin_wpp config
+// FUNC TraceEvents(LEVEL, FLAGS, MSG, ...);
+// end_wpp
+//
@@ -0,0 +1,243 @@
+#ifdef ECHO_TRANSCODE_PORTABLE
+#include "transcode.h"
+#else
+#include "driver.h"
+#endif
+
+// ÿδ8ֽڣһζһ64λ֣òڲУSWARλ㴦ѭûݵķ֧
+// ԭתӻĩβǰУiֽڵڵiֽڻλãḲδȡ
+// һд֮ǰѾ룬ͬһڵԼҲû
+// ֽС˴kֵֽĵ8kλ
+
+#define ECHO_SWAR_ONES		0x0101010101010101ULL
+#define ECHO_SWAR_HIGH		0x8080808080808080ULL
+
+// ÿֽڶӦUTF-16뵥Ԫ0x30~0x39Ϊ~
+static const WCHAR EchoDigitUtf16Table[256] = {
+	0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007,
+	0x0008, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x000E, 0x000F,
+	0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017,
+	0x0018, 0x0019, 0x001A, 0x001B, 0x001C, 0x001D, 0x001E, 0x001F,
+	0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+	0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+	0x96F6, 0x4E00, 0x4E8C, 0x4E09, 0x56DB, 0x4E94, 0x516D, 0x4E03,
+	0x516B, 0x4E5D, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+	0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+	0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+	0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+	0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+	0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+	0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+	0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+	0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x007F,
+	0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087,
+	0x0088, 0x0089, 0x008A, 0x008B, 0x008C, 0x008D, 0x008E, 0x008F,
+	0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097,
+	0x0098, 0x0099, 0x009A, 0x009B, 0x009C, 0x009D, 0x009E, 0x009F,
+	0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+	0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+	0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+	0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+	0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+	0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+	0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+	0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+	0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+	0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF,
+};
+
+// ÿֽڶӦUTF-8룺ֽΪĸֽڣֽΪĳ
+// 0x30~0x39Ϊ~ŵֽڱ룬0x80~0xFFLatin-1Ϊֽ
+static const ULONG EchoDigitUtf8Table[256] = {
+	0x01000000, 0x01000001, 0x01000002, 0x01000003, 0x01000004, 0x01000005, 0x01000006, 0x01000007,
+	0x01000008, 0x01000009, 0x0100000A, 0x0100000B, 0x0100000C, 0x0100000D, 0x0100000E, 0x0100000F,
+	0x01000010, 0x01000011, 0x01000012, 0x01000013, 0x01000014, 0x01000015, 0x01000016, 0x01000017,
+	0x01000018, 0x01000019, 0x0100001A, 0x0100001B, 0x0100001C, 0x0100001D, 0x0100001E, 0x0100001F,
+	0x01000020, 0x01000021, 0x01000022, 0x01000023, 0x01000024, 0x01000025, 0x01000026, 0x01000027,
+	0x01000028, 0x01000029, 0x0100002A, 0x0100002B, 0x0100002C, 0x0100002D, 0x0100002E, 0x0100002F,
+	0x03B69BE9, 0x0380B8E4, 0x038CBAE4, 0x0389B8E4, 0x039B9BE5, 0x0394BAE4, 0x03AD85E5, 0x0383B8E4,
+	0x03AB85E5, 0x039DB9E4, 0x0100003A, 0x0100003B, 0x0100003C, 0x0100003D, 0x0100003E, 0x0100003F,
+	0x01000040, 0x01000041, 0x01000042, 0x01000043, 0x01000044, 0x01000045, 0x01000046, 0x01000047,
+	0x01000048, 0x01000049, 0x0100004A, 0x0100004B, 0x0100004C, 0x0100004D, 0x0100004E, 0x0100004F,
+	0x01000050, 0x01000051, 0x01000052, 0x01000053, 0x01000054, 0x01000055, 0x01000056, 0x01000057,
+	0x01000058, 0x01000059, 0x0100005A, 0x0100005B, 0x0100005C, 0x0100005D, 0x0100005E, 0x0100005F,
+	0x01000060, 0x01000061, 0x01000062, 0x01000063, 0x01000064, 0x01000065, 0x01000066, 0x01000067,
+	0x01000068, 0x01000069, 0x0100006A, 0x0100006B, 0x0100006C, 0x0100006D, 0x0100006E, 0x0100006F,
+	0x01000070, 0x01000071, 0x01000072, 0x01000073, 0x01000074, 0x01000075, 0x01000076, 0x01000077,
+	0x01000078, 0x01000079, 0x0100007A, 0x0100007B, 0x0100007C, 0x0100007D, 0x0100007E, 0x0100007F,
+	0x020080C2, 0x020081C2, 0x020082C2, 0x020083C2, 0x020084C2, 0x020085C2, 0x020086C2, 0x020087C2,
+	0x020088C2, 0x020089C2, 0x02008AC2, 0x02008BC2, 0x02008CC2, 0x02008DC2, 0x02008EC2, 0x02008FC2,
+	0x020090C2, 0x020091C2, 0x020092C2, 0x020093C2, 0x020094C2, 0x020095C2, 0x020096C2, 0x020097C2,
+	0x020098C2, 0x020099C2, 0x02009AC2, 0x02009BC2, 0x02009CC2, 0x02009DC2, 0x02009EC2, 0x02009FC2,
+	0x0200A0C2, 0x0200A1C2, 0x0200A2C2, 0x0200A3C2, 0x0200A4C2, 0x0200A5C2, 0x0200A6C2, 0x0200A7C2,
+	0x0200A8C2, 0x0200A9C2, 0x0200AAC2, 0x0200ABC2, 0x0200ACC2, 0x0200ADC2, 0x0200AEC2, 0x0200AFC2,
+	0x0200B0C2, 0x0200B1C2, 0x0200B2C2, 0x0200B3C2, 0x0200B4C2, 0x0200B5C2, 0x0200B6C2, 0x0200B7C2,
+	0x0200B8C2, 0x0200B9C2, 0x0200BAC2, 0x0200BBC2, 0x0200BCC2, 0x0200BDC2, 0x0200BEC2, 0x0200BFC2,
+	0x020080C3, 0x020081C3, 0x020082C3, 0x020083C3, 0x020084C3, 0x020085C3, 0x020086C3, 0x020087C3,
+	0x020088C3, 0x020089C3, 0x02008AC3, 0x02008BC3, 0x02008CC3, 0x02008DC3, 0x02008EC3, 0x02008FC3,
+	0x020090C3, 0x020091C3, 0x020092C3, 0x020093C3, 0x020094C3, 0x020095C3, 0x020096C3, 0x020097C3,
+	0x020098C3, 0x020099C3, 0x02009AC3, 0x02009BC3, 0x02009CC3, 0x02009DC3, 0x02009EC3, 0x02009FC3,
+	0x0200A0C3, 0x0200A1C3, 0x0200A2C3, 0x0200A3C3, 0x0200A4C3, 0x0200A5C3, 0x0200A6C3, 0x0200A7C3,
+	0x0200A8C3, 0x0200A9C3, 0x0200AAC3, 0x0200ABC3, 0x0200ACC3, 0x0200ADC3, 0x0200AEC3, 0x0200AFC3,
+	0x0200B0C3, 0x0200B1C3, 0x0200B2C3, 0x0200B3C3, 0x0200B4C3, 0x0200B5C3, 0x0200B6C3, 0x0200B7C3,
+	0x0200B8C3, 0x0200B9C3, 0x0200BAC3, 0x0200BBC3, 0x0200BCC3, 0x0200BDC3, 0x0200BEC3, 0x0200BFC3,
+};
+
+
+// ΪֵֽڣЩֽڵλΪ1λΪ0
+// ȥλֵ0x50λһֽڣλΪ1ʾС'0'0x46ʱλΪ1ʾ'9'
+FORCEINLINE
+ULONG64
+EchoSwarDigits(
+	IN ULONG64 Word
+)
+{
+	ULONG64 low = Word & ~ECHO_SWAR_HIGH;
+
+	return (low + 0x5050505050505050ULL) & ~(low + 0x4646464646464646ULL) & ~Word & ECHO_SWAR_HIGH;
+}
+
+
+// ͳֻڸֽλ11ĸƵֽڵλ˷8ֽڼӵֽ
+FORCEINLINE
+ULONG
+EchoSwarCount(
+	IN ULONG64 Mask
+)
+{
+	return (ULONG)(((Mask >> 7) * ECHO_SWAR_ONES) >> 56);
+}
+
+
+// һUTF-8дEnd֮ǰдĳ
+FORCEINLINE
+ULONG
+EchoUtf8PutBefore(
+	IN PUCHAR End,
+	IN ULONG  Entry
+)
+{
+	ULONG length = Entry >> 24;
+	PUCHAR p = End - length;
+	ULONG j;
+
+	for (j = 0; j < length; j++) {
+		p[j] = (UCHAR)(Entry >> (8 * j));
+	}
+
+	return length;
+}
+
+
+// תΪUTF-16LEȹ̶Ϊ
+// ÿֵ8ֽڲõ8뵥Ԫһд
+ULONG
+EchoTranscodeDigitsUtf16(
+	IN OUT PUCHAR Buffer,
+	IN ULONG      Length
+)
+{
+	WCHAR block[8];
+	ULONG64 word;
+	ULONG i = Length;
+	ULONG k;
+
+	while (i >= 8) {
+
+		i -= 8;
+		RtlCopyMemory(&word, Buffer + i, sizeof(word));
+
+		for (k = 0; k < 8; k++) {
+			block[k] = EchoDigitUtf16Table[(UCHAR)(word >> (8 * k))];
+		}
+
+		RtlCopyMemory(Buffer + 2 * i, block, sizeof(block));
+	}
+
+	// ͷһֵֽ
+	while (i > 0) {
+		i--;
+		block[0] = EchoDigitUtf16Table[Buffer[i]];
+		RtlCopyMemory(Buffer + 2 * i, block, sizeof(WCHAR));
+	}
+
+	return 2 * Length;
+}
+
+
+// תΪUTF-8
+// 1 ͳֺͷASCIIֽڣȣֶֽڣASCIIֽڶһֽ
+// 2 Ӻǰת룺ûֺͷASCIIֽڵԭƶֲ
+// ӳûռ䣬̸ܱ֮߳Ķ1鲻һ
+// 2ÿдǰ鲻Խͷһʱֹͣ0LengthΪ0ʱȲ0
+ULONG
+EchoTranscodeDigitsUtf8(
+	IN OUT PUCHAR Buffer,
+	IN ULONG      Length
+)
+{
+	UCHAR block[8 * ECHO_TRANSCODE_UTF8_EXPANSION + sizeof(ULONG)];
+	ULONG64 word;
+	ULONG outLength = Length;
+	ULONG whole = Length & ~7UL;
+	ULONG out;
+	ULONG entry;
+	ULONG length;
+	ULONG i;
+	ULONG k;
+
+	// 1 
+	for (i = 0; i < whole; i += 8) {
+		RtlCopyMemory(&word, Buffer + i, sizeof(word));
+		outLength += 2 * EchoSwarCount(EchoSwarDigits(word)) + EchoSwarCount(word & ECHO_SWAR_HIGH);
+	}
+
+	for (; i < Length; i++) {
+		outLength += (EchoDigitUtf8Table[Buffer[i]] >> 24) - 1;
+	}
+
+	// 2 Ӻǰת룬ȴĩβһֵֽ
+	out = outLength;
+
+	for (i = Length; i > whole; i--) {
+		entry = EchoDigitUtf8Table[Buffer[i - 1]];
+		if ((entry >> 24) > out) {
+			return 0;
+		}
+		out -= EchoUtf8PutBefore(Buffer + out, entry);
+	}
+
+	while (i > 0) {
+
+		i -= 8;
+		RtlCopyMemory(&word, Buffer + i, sizeof(word));
+
+		if (((EchoSwarDigits(word) | word) & ECHO_SWAR_HIGH) == 0) {
+			if (8 > out) {
+				return 0;
+			}
+			out -= 8;
+			RtlCopyMemory(Buffer + out, &word, sizeof(word));
+			continue;
+		}
+
+		// ڱذ˳ƴֵÿ̶д4ֽٰʵʳǰһθƵλ
+		length = 0;
+		for (k = 0; k < 8; k++) {
+			entry = EchoDigitUtf8Table[(UCHAR)(word >> (8 * k))];
+			RtlCopyMemory(block + length, &entry, sizeof(entry));
+			length += entry >> 24;
+		}
+
+		if (length > out) {
+			return 0;
+		}
+		out -= length;
+		RtlCopyMemory(Buffer + out, block, length);
+	}
+
+	// ʱûдӻͷʼ
+	return (out == 0) ? outLength : 0;
+}
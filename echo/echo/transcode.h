@@ -0,0 +1,22 @@
+#pragma once
+
+// תĵתģֽе0~9תΪ~ţֽڰLatin-1תΪͬһַ
+// תڻԭؽУڻͷӻͷд𣬻볤ȵExpansion
+// ģ鲻WDFҲʹø٣IRQLµãECHO_TRANSCODE_PORTABLEû̬룬ڻ׼
+// ӳûռ䣬תڼ뱻ĶʱԽд룬0ʾתʧ
+
+// ÿֽֽ
+#define ECHO_TRANSCODE_UTF16_EXPANSION	2
+#define ECHO_TRANSCODE_UTF8_EXPANSION	3
+
+ULONG
+EchoTranscodeDigitsUtf16(
+	IN OUT PUCHAR Buffer,
+	IN ULONG      Length
+);
+
+ULONG
+EchoTranscodeDigitsUtf8(
+	IN OUT PUCHAR Buffer,
+	IN ULONG      Length
+);
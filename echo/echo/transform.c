@@ -0,0 +1,30 @@
+#include "driver.h"
+
+
+// תECHO_TRANSFORM_*ţECHO_TRANSFORM_NONEʹ
+static const ECHO_TRANSFORM EchoTransformTable[ECHO_TRANSFORM_COUNT] = {
+	{ 1, NULL },
+	{ ECHO_TRANSCODE_UTF16_EXPANSION, EchoTranscodeDigitsUtf16 },
+	{ ECHO_TRANSCODE_UTF8_EXPANSION, EchoTranscodeDigitsUtf8 },
+};
+
+
+// IOCTL_ECHO_SET_TRANSFORMеıȡתECHO_TRANSFORM_NONENULL
+NTSTATUS
+EchoTransformLookup(
+	IN ULONG  Id,
+	OUT PCECHO_TRANSFORM* Transform
+)
+{
+	*Transform = NULL;
+
+	if (Id >= ECHO_TRANSFORM_COUNT) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	if (Id != ECHO_TRANSFORM_NONE) {
+		*Transform = &EchoTransformTable[Id];
+	}
+
+	return STATUS_SUCCESS;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// ·ϵת
+// ͨIOCTL_ECHO_SET_TRANSFORMѡһת󣬶ͨȡõڽ֮ǰڶĻԭת
+// ÿתÿֽֽExpansionȡʱȡ󳤶ȳExpansionݣתܷŽĻ
+// ûȡߵĶ󣻶ĳȲExpansionʱSTATUS_BUFFER_TOO_SMALL
+// һתֻʵECHO_TRANSFORM_APPLYtransform.cתмһ
+// Ļӳûռ䣬תڼ䱻̸߳ĶʱECHO_TRANSFORM_APPLY벻Խ粢0ʧ
+typedef
+ULONG
+ECHO_TRANSFORM_APPLY(
+	IN OUT PUCHAR Buffer,
+	IN ULONG      Length
+);
+
+typedef ECHO_TRANSFORM_APPLY* PFN_ECHO_TRANSFORM_APPLY;
+
+typedef struct _ECHO_TRANSFORM {
+
+	ULONG Expansion;		// ÿֽֽ
+	PFN_ECHO_TRANSFORM_APPLY Apply;	// ԭתBufferͷLengthֽڣĳȣʧʱ0
+
+} ECHO_TRANSFORM, *PECHO_TRANSFORM;
+
+typedef const ECHO_TRANSFORM* PCECHO_TRANSFORM;
+
+// 󳤶ΪLengthʱȡߵݳȣTransformΪNULLʾת
+FORCEINLINE
+ULONG
+EchoTransformCapacity(
+	IN PCECHO_TRANSFORM Transform,
+	IN ULONG Length
+)
+{
+	return (Transform == NULL) ? Length : Length / Transform->Expansion;
+}
+
+// ԭתȡߵLengthֽڣOutLengthΪĳ
+// תڼ䱻ĶʱSTATUS_INVALID_USER_BUFFEROutLengthΪ0
+FORCEINLINE
+NTSTATUS
+EchoTransformApply(
+	IN PCECHO_TRANSFORM Transform,
+	IN PVOID  Buffer,
+	IN ULONG  Length,
+	OUT PULONG OutLength
+)
+{
+	if (Transform == NULL || Length == 0) {
+		*OutLength = Length;
+		return STATUS_SUCCESS;
+	}
+
+	*OutLength = Transform->Apply((PUCHAR)Buffer, Length);
+
+	return (*OutLength == 0) ? STATUS_INVALID_USER_BUFFER : STATUS_SUCCESS;
+}
+
+NTSTATUS
+EchoTransformLookup(
+	IN ULONG  Id,
+	OUT PCECHO_TRANSFORM* Transform
+);
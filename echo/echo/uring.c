@@ -0,0 +1,389 @@
+#include "driver.h"
+#include "uring.tmh"
+
+
+// ȡUringĵǼ󣬵߳жеChannelLockͷ֮ɷص
+// CancelledΪTRUEʱȡصãȳȡѱȡ󽻸ȡص
+// ִʱֻClosingڽʱɵǼ
+static
+WDFREQUEST
+EchoUringDetach(
+	IN PECHO_URING Uring,
+	IN BOOLEAN     Cancelled
+)
+{
+	WDFREQUEST request;
+
+	if (Uring->Request == NULL) {
+		return NULL;
+	}
+
+	if (!Cancelled) {
+		if (Uring->Closing || WdfRequestUnmarkCancelable(Uring->Request) == STATUS_CANCELLED) {
+			return NULL;
+		}
+	}
+
+	Uring->Closing = TRUE;
+
+	if (Uring->Running) {
+		return NULL;
+	}
+
+	request = Uring->Request;
+	Uring->Request = NULL;
+	RemoveEntryList(&Uring->Entry);
+	InitializeListHead(&Uring->Entry);
+
+	return request;
+}
+
+
+// Ǽǹڴ滷ִIOCTL_ECHO_URING_SETUP
+// 1 黷ĴСͷΪ
+// 2 ʼͷǼΪȡڶеUringList
+// STATUS_PENDINGʱѹ״̬ɵ
+NTSTATUS
+EchoUringSetup(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	WDFFILEOBJECT fileObject = WdfRequestGetFileObject(Request);
+	PECHO_URING_SETUP setup;
+	PECHO_URING uring;
+	PUCHAR region;
+	size_t length;
+	size_t dataOffset;
+	ULONG sqEntries;
+	ULONG cqEntries;
+	NTSTATUS status;
+
+	if (fileObject == NULL) {
+		return STATUS_INVALID_DEVICE_REQUEST;
+	}
+
+	uring = &FileGetContext(fileObject)->Uring;
+
+	// 1 С
+	status = WdfRequestRetrieveInputBuffer(Request, sizeof(ECHO_URING_SETUP), (PVOID*)&setup, NULL);
+	if (!NT_SUCCESS(status)) {
+		return status;
+	}
+
+	sqEntries = setup->SqEntries;
+	cqEntries = setup->CqEntries;
+
+	if (sqEntries == 0 || cqEntries < sqEntries || cqEntries > ECHO_URING_MAX_ENTRIES ||
+		(sqEntries & (sqEntries - 1)) != 0 || (cqEntries & (cqEntries - 1)) != 0) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	// METHOD_OUT_DIRECTMDLȡõϵͳַ֮ǰһֱЧ
+	dataOffset = ECHO_URING_DATA_OFFSET(sqEntries, cqEntries);
+	status = WdfRequestRetrieveOutputBuffer(Request, dataOffset, (PVOID*)&region, &length);
+	if (!NT_SUCCESS(status)) {
+		return status;
+	}
+
+	if (((ULONG_PTR)region & (sizeof(ULONG64) - 1)) != 0) {
+		return STATUS_DATATYPE_MISALIGNMENT;
+	}
+
+	// 2 Ǽ
+	WdfSpinLockAcquire(queueContext->ChannelLock);
+
+	if (queueContext->UringSuspended) {
+		status = STATUS_DEVICE_BUSY;
+	}
+	else if (uring->Request != NULL) {
+		status = STATUS_INVALID_DEVICE_STATE;
+	}
+	else {
+		uring->Header = (PECHO_URING_HEADER)region;
+		uring->Sq = (PECHO_URING_SQE)(region + ECHO_URING_SQ_OFFSET);
+		uring->Cq = (PECHO_URING_CQE)(region + ECHO_URING_CQ_OFFSET(sqEntries));
+		uring->Data = region + dataOffset;
+		uring->SqEntries = sqEntries;
+		uring->CqEntries = cqEntries;
+		uring->DataLength = (ULONG)min(length - dataOffset, MAXULONG);
+		uring->SqHead = 0;
+		uring->CqTail = 0;
+		uring->Running = FALSE;
+		uring->Rerun = FALSE;
+		uring->Closing = FALSE;
+
+		RtlZeroMemory(uring->Header, sizeof(ECHO_URING_HEADER));
+		uring->Header->SqEntries = sqEntries;
+		uring->Header->CqEntries = cqEntries;
+		uring->Header->DataOffset = (ULONG)dataOffset;
+		uring->Header->DataLength = uring->DataLength;
+
+		status = WdfRequestMarkCancelableEx(Request, EchoEvtUringCancel);
+		if (NT_SUCCESS(status)) {
+			uring->Request = Request;
+			InsertTailList(&queueContext->UringList, &uring->Entry);
+		}
+	}
+
+	WdfSpinLockRelease(queueContext->ChannelLock);
+
+	if (!NT_SUCCESS(status)) {
+		return status;
+	}
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_IO, "EchoUringSetup FileObject 0x%p Sq %u Cq %u Data %u", fileObject, sqEntries, cqEntries, uring->DataLength);
+
+	return STATUS_PENDING;
+}
+
+
+// ִύύĲִеã
+// 1 һӦдSqTailCqHeadʱִκβ
+// 2 ȡύȸƵټ飬ӦͬʱдڴҲֻӰòԼĽ
+// 3 дɻʱֹͣ
+// 4 д֮ٷCqTailSqHead
+static
+NTSTATUS
+EchoUringProcess(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN PECHO_CHANNEL  Channel,
+	IN PECHO_URING    Uring,
+	OUT PULONG        Count
+)
+{
+	ECHO_URING_SQE sqe;
+	PECHO_URING_CQE cqe;
+	ULONG sqTail;
+	ULONG cqHead;
+	ULONG count = 0;
+	ULONG information;
+	NTSTATUS status;
+
+	*Count = 0;
+
+	// 1 ȡӦõļ˺ٶύ
+	sqTail = Uring->Header->SqTail;
+	cqHead = Uring->Header->CqHead;
+	KeMemoryBarrier();
+
+	if (sqTail - Uring->SqHead > Uring->SqEntries || Uring->CqTail - cqHead > Uring->CqEntries) {
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	while (Uring->SqHead != sqTail && Uring->CqTail - cqHead < Uring->CqEntries) {
+
+		// 2 ύ
+		sqe = *(volatile ECHO_URING_SQE*)&Uring->Sq[Uring->SqHead & (Uring->SqEntries - 1)];
+		information = 0;
+
+		if (sqe.Offset > Uring->DataLength || sqe.Length > Uring->DataLength - sqe.Offset) {
+			status = STATUS_INVALID_PARAMETER;
+		}
+		else if (sqe.Op == ECHO_BATCH_OP_WRITE) {
+			status = (sqe.Length == 0) ? STATUS_SUCCESS :
+				EchoBatchWrite(QueueContext, Channel, Uring->Data + sqe.Offset, sqe.Length);
+			if (NT_SUCCESS(status)) {
+				information = sqe.Length;
+			}
+		}
+		else if (sqe.Op == ECHO_BATCH_OP_READ) {
+			status = EchoBatchRead(QueueContext, Channel, Uring->Data + sqe.Offset, sqe.Length, &information);
+		}
+		else {
+			status = STATUS_INVALID_PARAMETER;
+		}
+
+		// 3 д
+		cqe = &Uring->Cq[Uring->CqTail & (Uring->CqEntries - 1)];
+		cqe->UserData = sqe.UserData;
+		cqe->Status = status;
+		cqe->Information = information;
+
+		Uring->SqHead++;
+		Uring->CqTail++;
+		count++;
+	}
+
+	// 4 
+	KeMemoryBarrier();
+	Uring->Header->CqTail = Uring->CqTail;
+	Uring->Header->SqHead = Uring->SqHead;
+
+	*Count = count;
+
+	return STATUS_SUCCESS;
+}
+
+
+// 壬ִIOCTL_ECHO_URING_ENTER
+// ִʱֻҪټһ飬
+// ִнʱעɵǼ󣬴˺ٷʹڴ
+NTSTATUS
+EchoUringEnter(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	OUT PULONG_PTR Information
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	WDFFILEOBJECT fileObject = WdfRequestGetFileObject(Request);
+	PFILE_CONTEXT fileContext;
+	PECHO_URING uring;
+	WDFREQUEST setupRequest = NULL;
+	ULONG submitted = 0;
+	ULONG count;
+	NTSTATUS status;
+
+	*Information = 0;
+
+	if (fileObject == NULL) {
+		return STATUS_INVALID_DEVICE_REQUEST;
+	}
+
+	fileContext = FileGetContext(fileObject);
+	uring = &fileContext->Uring;
+
+	WdfSpinLockAcquire(queueContext->ChannelLock);
+
+	if (uring->Request == NULL || uring->Closing) {
+		WdfSpinLockRelease(queueContext->ChannelLock);
+		return STATUS_INVALID_DEVICE_STATE;
+	}
+
+	if (uring->Running) {
+		uring->Rerun = TRUE;
+		WdfSpinLockRelease(queueContext->ChannelLock);
+		return STATUS_SUCCESS;
+	}
+
+	uring->Running = TRUE;
+
+	WdfSpinLockRelease(queueContext->ChannelLock);
+
+	for (;;) {
+
+		status = EchoUringProcess(queueContext, EchoRequestGetChannel(Request), uring, &count);
+		submitted += count;
+
+		WdfSpinLockAcquire(queueContext->ChannelLock);
+
+		if (NT_SUCCESS(status) && uring->Rerun && !uring->Closing) {
+			uring->Rerun = FALSE;
+			WdfSpinLockRelease(queueContext->ChannelLock);
+			continue;
+		}
+
+		uring->Rerun = FALSE;
+		uring->Running = FALSE;
+
+		if (uring->Closing) {
+			setupRequest = uring->Request;
+			uring->Request = NULL;
+			RemoveEntryList(&uring->Entry);
+			InitializeListHead(&uring->Entry);
+		}
+
+		WdfSpinLockRelease(queueContext->ChannelLock);
+		break;
+	}
+
+	if (setupRequest != NULL) {
+		WdfRequestCompleteWithInformation(setupRequest, STATUS_CANCELLED, 0L);
+	}
+
+	EchoStatsAdd(&queueContext->Stats, UringOps, submitted);
+
+	*Information = submitted;
+
+	return status;
+}
+
+
+// עFileObjectǼǵĹڴ滷رվʱ
+VOID
+EchoUringRelease(
+	IN WDFQUEUE      Queue,
+	IN WDFFILEOBJECT FileObject
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	WDFREQUEST request;
+
+	WdfSpinLockAcquire(queueContext->ChannelLock);
+	request = EchoUringDetach(&FileGetContext(FileObject)->Uring, FALSE);
+	WdfSpinLockRelease(queueContext->ChannelLock);
+
+	if (request != NULL) {
+		WdfRequestCompleteWithInformation(request, STATUS_CANCELLED, 0L);
+	}
+
+	return;
+}
+
+
+// 豸ʱãעйڴ滷ǼSTATUS_CANCELLED
+// ˺ֱ豸صD0Ǽ󷵻STATUS_DEVICE_BUSYֹͣĬ϶ʱһֱȴ
+VOID
+EchoUringReleaseAll(
+	IN WDFQUEUE   Queue
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	LIST_ENTRY releaseList;
+	PLIST_ENTRY entry;
+	PLIST_ENTRY next;
+	WDFREQUEST request;
+
+	InitializeListHead(&releaseList);
+
+	WdfSpinLockAcquire(queueContext->ChannelLock);
+
+	queueContext->UringSuspended = TRUE;
+
+	for (entry = queueContext->UringList.Flink; entry != &queueContext->UringList; entry = next) {
+
+		next = entry->Flink;
+
+		request = EchoUringDetach(CONTAINING_RECORD(entry, ECHO_URING, Entry), FALSE);
+		if (request != NULL) {
+			InsertTailList(&releaseList, &RequestGetContext(request)->ListEntry);
+		}
+	}
+
+	WdfSpinLockRelease(queueContext->ChannelLock);
+
+	while (!IsListEmpty(&releaseList)) {
+		entry = RemoveHeadList(&releaseList);
+		request = (WDFREQUEST)WdfObjectContextGetObject(CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry));
+		WdfRequestCompleteWithInformation(request, STATUS_CANCELLED, 0L);
+	}
+
+	return;
+}
+
+
+// ǼȡʱĻص
+VOID
+EchoEvtUringCancel(
+	IN WDFREQUEST Request
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(WdfRequestGetIoQueue(Request));
+	WDFREQUEST request;
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_IO, "EchoEvtUringCancel called on Request 0x%p", Request);
+
+	WdfSpinLockAcquire(queueContext->ChannelLock);
+	request = EchoUringDetach(&FileGetContext(WdfRequestGetFileObject(Request))->Uring, TRUE);
+	WdfSpinLockRelease(queueContext->ChannelLock);
+
+	EchoStatsAdd(&queueContext->Stats, Cancels, 1);
+
+	if (request != NULL) {
+		WdfRequestCompleteWithInformation(request, STATUS_CANCELLED, 0L);
+	}
+
+	return;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// ڴ滷ӦõǼǵһڴеύɻǶļĻ
+// ǼIOCTL_ECHO_URING_SETUPһֱMDLʹڴ汣HeaderָǸMDLϵͳַ
+// ڵߵִ߳ύĲͬһʱֻһִУֻҪټһ
+// ֻһӦдļύԼSqHeadCqTailιڴеֵ
+// עȡǼ󡢹رվ豸ʱִУڽʱɵǼ֮ٷʹڴ
+// RequestRunningRerunClosingEntryɶеChannelLock
+typedef struct _ECHO_URING {
+
+	WDFREQUEST Request;		// ĵǼNULLʾδǼ
+	PECHO_URING_HEADER Header;
+	PECHO_URING_SQE Sq;
+	PECHO_URING_CQE Cq;
+	PUCHAR Data;
+	ULONG SqEntries;
+	ULONG CqEntries;
+	ULONG DataLength;
+	ULONG SqHead;			// ȡߵύ
+	ULONG CqTail;			// д
+	BOOLEAN Running;		// ִ
+	BOOLEAN Rerun;			// ִй壬ټһ
+	BOOLEAN Closing;		// ע岻ִ
+	LIST_ENTRY Entry;		// ǼڼڶеUringList
+
+} ECHO_URING, *PECHO_URING;
+
+FORCEINLINE
+VOID
+EchoUringInitialize(
+	OUT PECHO_URING Uring
+)
+{
+	Uring->Request = NULL;
+	InitializeListHead(&Uring->Entry);
+}
+
+NTSTATUS
+EchoUringSetup(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request
+);
+
+NTSTATUS
+EchoUringEnter(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	OUT PULONG_PTR Information
+);
+
+VOID
+EchoUringRelease(
+	IN WDFQUEUE      Queue,
+	IN WDFFILEOBJECT FileObject
+);
+
+VOID
+EchoUringReleaseAll(
+	IN WDFQUEUE   Queue
+);
+
+EVT_WDF_REQUEST_CANCEL EchoEvtUringCancel;
@@ -0,0 +1,441 @@
+#include "driver.h"
+#include "wheel.tmh"
+
+#ifdef ALLOC_PRAGMA
+#pragma alloc_text (PAGE, EchoWheelInitialize)
+#endif
+
+
+// ʼʱ
+// ʱֵʱֵĸ߾һԶʱΪ
+NTSTATUS
+EchoWheelInitialize(
+	OUT PECHO_WHEEL Wheel,
+	IN WDFQUEUE Queue
+)
+{
+	NTSTATUS status;
+	WDF_OBJECT_ATTRIBUTES attributes;
+	WDF_TIMER_CONFIG timerConfig;
+	LARGE_INTEGER frequency;
+	ULONG i;
+
+	PAGED_CODE();
+
+	Wheel->Lock = NULL;
+	Wheel->Timer = NULL;
+	Wheel->BaseTime = KeQueryPerformanceCounter(&frequency).QuadPart;
+	Wheel->Frequency = frequency.QuadPart;
+	Wheel->TickLength = frequency.QuadPart * ECHO_WHEEL_TICK_US / 1000000;
+	if (Wheel->TickLength == 0) {
+		Wheel->TickLength = 1;
+	}
+	Wheel->Now = 0;
+	Wheel->Count = 0;
+	Wheel->Running = FALSE;
+	Wheel->Suspended = FALSE;
+
+	for (i = 0; i < ECHO_WHEEL_SLOTS; i++) {
+		InitializeListHead(&Wheel->Slots[i]);
+	}
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	attributes.ParentObject = Queue;
+
+	status = WdfSpinLockCreate(&attributes, &Wheel->Lock);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_COMPLETION, "WdfSpinLockCreate failed %!STATUS!", status);
+		return status;
+	}
+
+	// Ķϵͳʱжϵļʹø߾ȶʱ
+	// ʱصԼȡLockرAutomaticSerialization
+	WDF_TIMER_CONFIG_INIT(&timerConfig, EchoEvtWheelTimerFunc);
+	timerConfig.AutomaticSerialization = FALSE;
+	timerConfig.UseHighResolutionTimer = WdfTrue;
+
+	status = WdfTimerCreate(&timerConfig, &attributes, &Wheel->Timer);
+	if (!NT_SUCCESS(status)) {
+		TraceEvents(TRACE_LEVEL_ERROR, TRACE_COMPLETION, "Error creating wheel timer %!STATUS!", status);
+		return status;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+
+// ǰʱڵĽ
+static
+ULONGLONG
+EchoWheelCurrentTick(
+	IN PECHO_WHEEL Wheel
+)
+{
+	LONGLONG elapsed = KeQueryPerformanceCounter(NULL).QuadPart - Wheel->BaseTime;
+
+	return (ULONGLONG)elapsed / (ULONGLONG)Wheel->TickLength;
+}
+
+
+// ڽĺNowľ룬ڶӦĲϣ߳Lock
+// Сڵ0һȦĹڵ0㣬ɸþһ㣬ۺɵڽڸòλ
+static
+VOID
+EchoWheelLink(
+	IN PECHO_WHEEL Wheel,
+	IN PREQUEST_CONTEXT RequestContext
+)
+{
+	ULONGLONG expires = RequestContext->WheelTick;
+	ULONGLONG delta;
+	ULONG shift = ECHO_WHEEL_L0_BITS;
+	ULONG base = ECHO_WHEEL_L0_SIZE;
+	ULONG level;
+
+	if (expires < Wheel->Now) {
+		expires = Wheel->Now;
+	}
+
+	delta = expires - Wheel->Now;
+
+	if (delta < ECHO_WHEEL_L0_SIZE) {
+		InsertTailList(&Wheel->Slots[expires & (ECHO_WHEEL_L0_SIZE - 1)], &RequestContext->ListEntry);
+		return;
+	}
+
+	if (delta > ECHO_WHEEL_MAX_TICKS) {
+		expires = Wheel->Now + ECHO_WHEEL_MAX_TICKS;
+		RequestContext->WheelTick = expires;
+	}
+
+	for (level = 1; level < ECHO_WHEEL_LEVELS - 1; level++) {
+		if (delta < (1ULL << (shift + ECHO_WHEEL_LN_BITS))) {
+			break;
+		}
+		shift += ECHO_WHEEL_LN_BITS;
+		base += ECHO_WHEEL_LN_SIZE;
+	}
+
+	InsertTailList(&Wheel->Slots[base + ((expires >> shift) & (ECHO_WHEEL_LN_SIZE - 1))], &RequestContext->ListEntry);
+
+	return;
+}
+
+
+// ѵLevel㣨Level >= 1IndexŲϵ¹ҵ²㣬߳Lock
+static
+VOID
+EchoWheelCascade(
+	IN PECHO_WHEEL Wheel,
+	IN ULONG Level,
+	IN ULONG Index
+)
+{
+	PLIST_ENTRY slot = &Wheel->Slots[ECHO_WHEEL_L0_SIZE + (Level - 1) * ECHO_WHEEL_LN_SIZE + Index];
+	LIST_ENTRY cascadeList;
+	PLIST_ENTRY entry;
+
+	if (IsListEmpty(slot)) {
+		return;
+	}
+
+	// ȡ£¹ʱͬһ
+	InitializeListHead(&cascadeList);
+	AppendTailList(&cascadeList, slot);
+	RemoveEntryList(slot);
+	InitializeListHead(slot);
+
+	while (!IsListEmpty(&cascadeList)) {
+		entry = RemoveHeadList(&cascadeList);
+		EchoWheelLink(Wheel, CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry));
+	}
+
+	return;
+}
+
+
+// ʱȡһڵ󣬵߳Lock
+// ȡȡ״̬ɹʱƵExpiredListϣ˺ȡصٱãExpiredList
+// ѱȡListEntryָκϣɵȴLockEchoEvtWheelCancel
+static
+VOID
+EchoWheelExpire(
+	IN PECHO_WHEEL Wheel,
+	IN PLIST_ENTRY Entry,
+	IN OUT PLIST_ENTRY ExpiredList
+)
+{
+	PREQUEST_CONTEXT requestContext = CONTAINING_RECORD(Entry, REQUEST_CONTEXT, ListEntry);
+
+	InitializeListHead(Entry);
+	Wheel->Count--;
+
+	if (WdfRequestUnmarkCancelable((WDFREQUEST)WdfObjectContextGetObject(requestContext)) != STATUS_CANCELLED) {
+		InsertTailList(ExpiredList, Entry);
+	}
+
+	return;
+}
+
+
+// TargetΪֹTargetĽģڵƵExpiredListϣ߳Lock
+// 0תһȦʱһһ۽һҲתһȦʱ
+static
+VOID
+EchoWheelAdvance(
+	IN PECHO_WHEEL Wheel,
+	IN ULONGLONG Target,
+	IN OUT PLIST_ENTRY ExpiredList
+)
+{
+	PLIST_ENTRY slot;
+	ULONG shift;
+	ULONG level;
+	ULONG index;
+
+	while (Wheel->Now <= Target && Wheel->Count != 0) {
+
+		index = (ULONG)(Wheel->Now & (ECHO_WHEEL_L0_SIZE - 1));
+
+		if (index == 0) {
+			shift = ECHO_WHEEL_L0_BITS;
+			for (level = 1; level < ECHO_WHEEL_LEVELS; level++) {
+				index = (ULONG)((Wheel->Now >> shift) & (ECHO_WHEEL_LN_SIZE - 1));
+				EchoWheelCascade(Wheel, level, index);
+				if (index != 0) {
+					break;
+				}
+				shift += ECHO_WHEEL_LN_BITS;
+			}
+			index = 0;
+		}
+
+		// ۶ѵ
+		slot = &Wheel->Slots[index];
+		while (!IsListEmpty(slot)) {
+			EchoWheelExpire(Wheel, RemoveHeadList(slot), ExpiredList);
+		}
+
+		Wheel->Now++;
+	}
+
+	// ʱѿգNowֱ׷ϵǰģһʱزתĽ
+	if (Wheel->Count == 0 && Wheel->Now <= Target) {
+		Wheel->Now = Target + 1;
+	}
+
+	return;
+}
+
+
+// ʱһĵ㵽ڣ߳Lock
+static
+VOID
+EchoWheelArm(
+	IN PECHO_WHEEL Wheel
+)
+{
+	LONGLONG nextTime;
+	LONGLONG remaining;
+
+	// һܼ100ns
+	nextTime = Wheel->BaseTime + (LONGLONG)Wheel->Now * Wheel->TickLength;
+	remaining = (nextTime - KeQueryPerformanceCounter(NULL).QuadPart) * 10000000 / Wheel->Frequency;
+	if (remaining < 1) {
+		remaining = 1;
+	}
+
+	Wheel->Running = TRUE;
+	WdfTimerStart(Wheel->Timer, -remaining);
+
+	return;
+}
+
+
+// ExpiredListϵǶȡ˿ȡ״̬
+static
+VOID
+EchoWheelCompleteList(
+	IN PQUEUE_CONTEXT QueueContext,
+	IN PLIST_ENTRY    ExpiredList
+)
+{
+	PREQUEST_CONTEXT requestContext;
+	PLIST_ENTRY entry;
+	WDFREQUEST request;
+
+	while (!IsListEmpty(ExpiredList)) {
+
+		entry = RemoveHeadList(ExpiredList);
+		InitializeListHead(entry);
+
+		requestContext = CONTAINING_RECORD(entry, REQUEST_CONTEXT, ListEntry);
+		request = (WDFREQUEST)WdfObjectContextGetObject(requestContext);
+
+		EchoStatsAdd(&QueueContext->Stats, Pending, -1);
+
+		EchoCompletionComplete(QueueContext, request, requestContext->Status);
+	}
+
+	return;
+}
+
+
+// ʱϣDelayUs֮requestContext->Status
+// 豸ڹʱ
+// 1 㵽ڽģһĵĲȡʵӳDelayUsDelayUsһ֮
+// 2 ȹۣΪȡEchoEvtWheelCancelڲҵ
+// 3 ʱԭΪʱʱ
+VOID
+EchoWheelInsert(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	IN ULONG      DelayUs
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	PECHO_WHEEL wheel = &queueContext->Wheel;
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+	ULONGLONG delayTicks = ((ULONGLONG)DelayUs + ECHO_WHEEL_TICK_US - 1) / ECHO_WHEEL_TICK_US;
+	ULONGLONG now;
+
+	WdfSpinLockAcquire(wheel->Lock);
+
+	if (wheel->Suspended) {
+		WdfSpinLockRelease(wheel->Lock);
+		EchoCompletionComplete(queueContext, Request, requestContext->Status);
+		return;
+	}
+
+	EchoStatsAdd(&queueContext->Stats, Pending, 1);
+
+	// 1 㵽ڽ
+	now = EchoWheelCurrentTick(wheel);
+	if (wheel->Count == 0 && wheel->Now < now) {
+		wheel->Now = now;
+	}
+
+	// ʱ̿ڵǰĵм䣬һģ֤DelayUs
+	requestContext->WheelTick = now + delayTicks + 1;
+
+	// 2 ۣΪȡ
+	EchoWheelLink(wheel, requestContext);
+	wheel->Count++;
+
+	if (WdfRequestMarkCancelableEx(Request, EchoEvtWheelCancel) == STATUS_CANCELLED) {
+		RemoveEntryList(&requestContext->ListEntry);
+		InitializeListHead(&requestContext->ListEntry);
+		wheel->Count--;
+		WdfSpinLockRelease(wheel->Lock);
+		EchoStatsAdd(&queueContext->Stats, Pending, -1);
+		EchoStatsAdd(&queueContext->Stats, Cancels, 1);
+		WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
+		return;
+	}
+
+	// 3 ʱ
+	if (!wheel->Running) {
+		EchoWheelArm(wheel);
+	}
+
+	WdfSpinLockRelease(wheel->Lock);
+
+	return;
+}
+
+
+// ʱϵ豸ǰ
+// ȡвۣƽ˺ֱ豸صD0µٹʱ
+VOID
+EchoWheelFlush(
+	IN WDFQUEUE   Queue
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(Queue);
+	PECHO_WHEEL wheel = &queueContext->Wheel;
+	LIST_ENTRY expiredList;
+	ULONG i;
+
+	InitializeListHead(&expiredList);
+
+	WdfSpinLockAcquire(wheel->Lock);
+
+	wheel->Suspended = TRUE;
+
+	for (i = 0; i < ECHO_WHEEL_SLOTS; i++) {
+		while (!IsListEmpty(&wheel->Slots[i])) {
+			EchoWheelExpire(wheel, RemoveHeadList(&wheel->Slots[i]), &expiredList);
+		}
+	}
+
+	ASSERT(wheel->Count == 0);
+
+	WdfSpinLockRelease(wheel->Lock);
+
+	EchoWheelCompleteList(queueContext, &expiredList);
+
+	return;
+}
+
+
+// ʱϵȡʱĻص
+VOID
+EchoEvtWheelCancel(
+	IN WDFREQUEST Request
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(WdfRequestGetIoQueue(Request));
+	PECHO_WHEEL wheel = &queueContext->Wheel;
+	PREQUEST_CONTEXT requestContext = RequestGetContext(Request);
+
+	TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_COMPLETION, "EchoEvtWheelCancel called on Request 0x%p", Request);
+
+	// ʱȡȡ״̬ʧܵѱEchoWheelExpireȡ£ListEntryָκ
+	// ɹȡȡ״̬󲻻ñﲻ̵߳ExpiredList
+	WdfSpinLockAcquire(wheel->Lock);
+
+	if (!IsListEmpty(&requestContext->ListEntry)) {
+		RemoveEntryList(&requestContext->ListEntry);
+		InitializeListHead(&requestContext->ListEntry);
+		wheel->Count--;
+	}
+
+	WdfSpinLockRelease(wheel->Lock);
+
+	EchoStatsAdd(&queueContext->Stats, Pending, -1);
+	EchoStatsAdd(&queueContext->Stats, Cancels, 1);
+
+	WdfRequestCompleteWithInformation(Request, STATUS_CANCELLED, 0L);
+
+	return;
+}
+
+
+// ʱֶʱĻص
+// ǰΪֹнģȴʱһͷһɵڵ
+VOID
+EchoEvtWheelTimerFunc(
+	IN WDFTIMER     Timer
+)
+{
+	PQUEUE_CONTEXT queueContext = QueueGetContext(WdfTimerGetParentObject(Timer));
+	PECHO_WHEEL wheel = &queueContext->Wheel;
+	LIST_ENTRY expiredList;
+
+	InitializeListHead(&expiredList);
+
+	WdfSpinLockAcquire(wheel->Lock);
+
+	EchoWheelAdvance(wheel, EchoWheelCurrentTick(wheel), &expiredList);
+
+	wheel->Running = FALSE;
+	if (wheel->Count != 0) {
+		EchoWheelArm(wheel);
+	}
+
+	WdfSpinLockRelease(wheel->Lock);
+
+	EchoWheelCompleteList(queueContext, &expiredList);
+
+	return;
+}
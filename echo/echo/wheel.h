@@ -0,0 +1,57 @@
+#pragma once
+
+// Length of one wheel tick in us, also the resolution of per-request delays
+#define ECHO_WHEEL_TICK_US		500
+
+// Wheel geometry: level 0 has 2^ECHO_WHEEL_L0_BITS slots of one tick, every higher level has 2^ECHO_WHEEL_LN_BITS slots
+#define ECHO_WHEEL_L0_BITS		8
+#define ECHO_WHEEL_LN_BITS		6
+#define ECHO_WHEEL_LEVELS		4
+
+#define ECHO_WHEEL_L0_SIZE		(1 << ECHO_WHEEL_L0_BITS)
+#define ECHO_WHEEL_LN_SIZE		(1 << ECHO_WHEEL_LN_BITS)
+#define ECHO_WHEEL_SLOTS		(ECHO_WHEEL_L0_SIZE + (ECHO_WHEEL_LEVELS - 1) * ECHO_WHEEL_LN_SIZE)
+
+// Longest delay the wheel can hold in ticks, longer delays are clamped
+#define ECHO_WHEEL_MAX_TICKS	((1ULL << (ECHO_WHEEL_L0_BITS + (ECHO_WHEEL_LEVELS - 1) * ECHO_WHEEL_LN_BITS)) - 1)
+
+// ֲʱ֣ÿȴԼĵʱ̣Խļƣ뵽ڵԶĳһĳ
+// 0ÿһģiÿ۸ǵi-1תһȦʱ䣬0תһȦʱһһ۽²
+// 롢ȡÿĵڶO(1)ȴ޹
+// ʱһ߾һԶʱֻȴʱУÿİѵڵĲȡ£ͷһ
+// ʱʱܼϴĽ
+typedef struct _ECHO_WHEEL {
+
+	WDFSPINLOCK Lock;		// вۡNowCountͶʱ
+	WDFTIMER Timer;			// ߾һԶʱÿ
+	LONGLONG Frequency;		// KeQueryPerformanceCounterƵ
+	LONGLONG TickLength;	// һĵܼ
+	LONGLONG BaseTime;		// 0ĵܼ
+	ULONGLONG Now;			// һҪĽģ֮ǰĽĶѴ
+	ULONG Count;			// ʱϵ
+	BOOLEAN Running;		// ʱ
+	BOOLEAN Suspended;		// 豸ڼ󲻹ʱϣ
+	LIST_ENTRY Slots[ECHO_WHEEL_SLOTS];
+
+} ECHO_WHEEL, *PECHO_WHEEL;
+
+NTSTATUS
+EchoWheelInitialize(
+	OUT PECHO_WHEEL Wheel,
+	IN WDFQUEUE Queue
+);
+
+VOID
+EchoWheelInsert(
+	IN WDFQUEUE   Queue,
+	IN WDFREQUEST Request,
+	IN ULONG      DelayUs
+);
+
+VOID
+EchoWheelFlush(
+	IN WDFQUEUE   Queue
+);
+
+EVT_WDF_REQUEST_CANCEL EchoEvtWheelCancel;
+EVT_WDF_TIMER EchoEvtWheelTimerFunc;
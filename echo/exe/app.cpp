@@ -7,6 +7,7 @@ _Analysis_mode_(_Analysis_code_type_user_code_)
 #include <windows.h>
 #include <strsafe.h>
 #include <cfgmgr32.h>
+#include <evntrace.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "public.h"
@@ -19,7 +20,117 @@ _Analysis_mode_(_Analysis_code_type_user_code_)
 
 #define MAX_DEVPATH_LENGTH                       256
 
+#define POLICY_BENCH_DEPTH		32			// ɲԲʱͬʱδɵ
+#define POLICY_BENCH_LENGTH		512			// ɲԲʱÿĳ
+#define POLICY_BENCH_COUNT		2000		// ɲԲʱÿֲԷ͵
+#define POLICY_BENCH_TIMER_COUNT	4		// ʱÿֻһֻ
+
+#define STREAM_BENCH_MIN_LENGTH		(4*1024)			// ʽԵСд볤
+#define STREAM_BENCH_MAX_LENGTH		(64*1024*1024)		// ʽԵд볤
+#define STREAM_BENCH_BYTES			(64*1024*1024)		// ʽÿֳдֽ
+#define STREAM_BENCH_READ_LENGTH	(64*1024)			// ʽÿζȡĳ
+
+#define CHANNEL_TEST_HANDLES		16			// ͨĬϴ򿪵ľ
+#define CHANNEL_TEST_MAX_HANDLES	MAXIMUM_WAIT_OBJECTS
+#define CHANNEL_TEST_ITERATIONS		2000		// ͨÿд
+#define CHANNEL_TEST_LENGTH			512			// ͨÿдĳ
+
+#define TRACE_BENCH_COUNT			20000		// ٿÿõд
+#define TRACE_BENCH_LENGTH			64			// ٿÿдĳ
+#define TRACE_BENCH_SESSION_NAME	L"EchoTraceBench"
+
+#define READ_WAIT_BENCH_COUNT		1000		// ȴÿģʽд
+#define READ_WAIT_BENCH_LENGTH		64			// ȴÿдĳ
+
+#define BROADCAST_BENCH_COUNT		2000		// 㲥ÿֶд
+#define BROADCAST_BENCH_LENGTH		512			// 㲥ÿдĳ
+#define BROADCAST_BENCH_MAX_READERS	MAXIMUM_WAIT_OBJECTS	// 㲥ͬʱȴĶ
+
+#define WHEEL_BENCH_COUNT			65536		// ʱֲͬʱ
+#define WHEEL_BENCH_MAX_DELAY_US	200000		// ʱֲӳ
+
+#define JITTER_BENCH_PERIOD_US		1000		// ʱĬϵ
+#define JITTER_BENCH_SECONDS		2			// ʱÿֶʱеʱ
+#define JITTER_BENCH_TOLERABLE_DELAY_MS	10		// ʱͨʱƳٵʱ
+
+#define PIPE_BENCH_MEGABYTES		256			// ģʽÿд볤ȴ
+#define PIPE_BENCH_READ_LENGTH		(64*1024)	// ģʽÿζȡĳ
+
+#define BATCH_BENCH_COUNT			100000		// ÿַʽд
+#define BATCH_BENCH_LENGTH			64			// ÿдĳ
+#define BATCH_BENCH_MAX_PAIRS		(ECHO_BATCH_MAX_OPS / 2)	// һIOCTL_ECHO_BATCHд
+
+#define URING_BENCH_COUNT			100000		// ڴ滷ÿַʽд
+#define URING_BENCH_LENGTH			64			// ڴ滷ÿдĳ
+#define URING_BENCH_ENTRIES			1024		// ύɻĴС
+#define URING_BENCH_DEPTH			64			// IOCPʽͬʱдͶ
+
+#define TRANSFORM_SAMPLE			"Echo 2024-05-17 09:30, order 1234567890"	// תд
+
+#define SCALE_BENCH_SECONDS			2			// չԲÿһеʱ
+#define SCALE_BENCH_LENGTH			64			// չԲÿдĳ
+#define SCALE_BENCH_MAX_THREADS		64			// չԲ߳ÿ̰߳һ
+
+#define LATENCY_BENCH_COUNT			2000		// ӳģͲÿģ͵д
+#define LATENCY_BENCH_LENGTH		4096		// ӳģͲÿдĳ
+#define LATENCY_BENCH_SEED			12345		// ӳģͲʹõ
+
+#define PRIORITY_BENCH_SECONDS		3			// ȼÿеʱ
+#define PRIORITY_BENCH_SMALL_LENGTH	64			// ȼӳед
+#define PRIORITY_BENCH_BULK_LENGTH	(40 * 1024)	// ȼд
+#define PRIORITY_BENCH_BULK_DEPTH	8			// ͬʱдͶ
+#define PRIORITY_BENCH_PERIOD_US	1000		// ȼʱɶʱڣÿһ
+
+#define BENCH_DEFAULT_DEPTH			NUM_ASYNCH_IO	// ׼Ĭͬʱд
+#define BENCH_DEFAULT_LENGTH		BUFFER_SIZE		// ׼Ĭÿĳ
+#define BENCH_DEFAULT_SECONDS		10				// ׼ĬϵĲʱ
+#define BENCH_DEFAULT_WARMUP_SECONDS	2			// ׼ĬϵԤʱ䣬ڼɵ󲻼
+#define BENCH_MAX_DEPTH				4096			// ׼ͬʱд
+#define BENCH_HISTOGRAM_SUB_BUCKETS	32				// ӳٷֲÿ2ٵȷֵͰ1/32
+#define BENCH_HISTOGRAM_BUCKETS		(60 * BENCH_HISTOGRAM_SUB_BUCKETS)	// 64λֵͰ
+#define BENCH_WRITE					0				// ׼Խд󡢶ȫ±
+#define BENCH_READ					1
+#define BENCH_ALL					2
+#define BENCH_RESULTS				3
+
 BOOLEAN G_PerformAsyncIo;		// 첽ִб־
+BOOLEAN G_PerformPolicyBench;	// ɲԲԱ־
+ULONG G_PolicyBenchCount;		// ɲԲʱÿֲԷ͵
+BOOLEAN G_PrintLookasideStats;	// ӡбͳƱ־
+BOOLEAN G_PerformStreamBench;	// ʽдԱ־
+BOOLEAN G_PerformChannelTest;	// ͨԱ־
+ULONG G_ChannelTestHandles;		// ͨԴ򿪵ľ
+BOOLEAN G_PrintStats;			// ӡ豸ͳƱ־
+ULONG G_StatsFlags;				// ȡ豸ͳʱı־
+BOOLEAN G_PerformTraceBench;	// ٿԱ־
+ULONG G_TraceBenchCount;		// ٿÿõд
+BOOLEAN G_PerformReadWaitBench;	// ȴԱ־
+ULONG G_ReadWaitBenchCount;		// ȴÿģʽд
+BOOLEAN G_PerformBroadcastBench;	// 㲥Ա־
+ULONG G_BroadcastBenchCount;	// 㲥ÿֶд
+BOOLEAN G_PerformWheelBench;		// ʱֲԱ־
+ULONG G_WheelBenchCount;		// ʱֲͬʱ
+BOOLEAN G_PerformJitterBench;	// ʱԱ־
+ULONG G_JitterBenchPeriodUs;	// ʱԵ
+BOOLEAN G_PerformPipeBench;		// ģʽԱ־
+ULONG G_PipeBenchMegabytes;		// ģʽÿд볤ȴ
+BOOLEAN G_PerformBatchBench;	// Ա־
+ULONG G_BatchBenchCount;		// ÿַʽд
+BOOLEAN G_PerformUringBench;	// ڴ滷Ա־
+ULONG G_UringBenchCount;		// ڴ滷ÿַʽд
+BOOLEAN G_PerformTransformTest;	// ·תԱ־
+ULONG G_TransformTestId;		// תʹõECHO_TRANSFORM_*
+BOOLEAN G_PerformScaleBench;	// ദչԲԱ־
+ULONG G_ScaleBenchThreads;		// չԲ߳
+BOOLEAN G_SetParameters;		// ȡ޸豸ɵ־
+int G_ParameterArgc;			// ޸Ĳʱname=valueĸ
+char** G_ParameterArgv;			// ޸Ĳʱname=value
+BOOLEAN G_PerformLatencyBench;	// ӳģͲԱ־
+ULONG G_LatencyBenchCount;		// ӳģͲÿģ͵д
+BOOLEAN G_PerformPriorityBench;	// ȼԱ־
+BOOLEAN G_PerformBench;			// ӳٻ׼Ա־
+int G_BenchArgc;				// ׼name=valueĸ
+char** G_BenchArgv;				// ׼Եname=value
 BOOLEAN G_LimitedLoops;			// 첽ִдǷ޵ı־λ
 ULONG G_AsyncIoLoopsNum;		// 첽ִд
 WCHAR G_DevicePath[MAX_DEVPATH_LENGTH];
@@ -36,6 +147,122 @@ PerformWriteReadTest(
 	IN ULONG TestLength
 );
 
+BOOLEAN
+PerformPolicyBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+);
+
+BOOLEAN
+PrintLookasideStats(
+	IN HANDLE hDevice
+);
+
+BOOLEAN
+PerformStreamBenchmark(
+	IN HANDLE hDevice
+);
+
+BOOLEAN
+PerformChannelTest(
+	IN HANDLE hDevice,
+	IN ULONG Handles
+);
+
+BOOLEAN
+PrintStats(
+	IN HANDLE hDevice,
+	IN ULONG Flags
+);
+
+BOOLEAN
+PerformTraceBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+);
+
+BOOLEAN
+PerformReadWaitBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+);
+
+BOOLEAN
+PerformBroadcastBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+);
+
+BOOLEAN
+PerformWheelBenchmark(
+	IN ULONG Count
+);
+
+BOOLEAN
+PerformJitterBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG PeriodUs
+);
+
+BOOLEAN
+PerformPipeBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Megabytes
+);
+
+BOOLEAN
+PerformBatchBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+);
+
+BOOLEAN
+PerformUringBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+);
+
+BOOLEAN
+PerformTransformTest(
+	IN ULONG Transform
+);
+
+BOOLEAN
+PerformScaleBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG MaxThreads
+);
+
+BOOLEAN
+SetParameters(
+	IN HANDLE hDevice,
+	IN int Argc,
+	IN char* Argv[]
+);
+
+BOOLEAN
+PerformLatencyBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+);
+
+VOID
+PrintClassLatency(
+	IN PECHO_STATS Stats
+);
+
+BOOLEAN
+PerformPriorityBenchmark(
+	IN HANDLE hDevice
+);
+
+BOOLEAN
+PerformBenchmark(
+	IN HANDLE hDevice,
+	IN int Argc,
+	IN char* Argv[]
+);
+
 BOOL
 GetDevicePath(
 	_In_ LPGUID InterfaceGuid,
@@ -71,12 +298,125 @@ main(
 			}
 
 		}
+		else if (!_strnicmp(argv[1], "-Policy", 7)) {
+			// һ-PolicyԸɲ
+			G_PerformPolicyBench = TRUE;
+			G_PolicyBenchCount = (argc > 2) ? atoi(argv[2]) : POLICY_BENCH_COUNT;
+		}
+		else if (!_strnicmp(argv[1], "-Lookaside", 10)) {
+			// һ-Lookasideӡибͳ
+			G_PrintLookasideStats = TRUE;
+		}
+		else if (!_strnicmp(argv[1], "-Stream", 7)) {
+			// һ-StreamԴдʽȡ
+			G_PerformStreamBench = TRUE;
+		}
+		else if (!_strnicmp(argv[1], "-Channels", 9)) {
+			// һ-Channelsʹ˽ͨд
+			G_PerformChannelTest = TRUE;
+			G_ChannelTestHandles = (argc > 2) ? atoi(argv[2]) : CHANNEL_TEST_HANDLES;
+		}
+		else if (!_strnicmp(argv[1], "-Stats", 6)) {
+			// һ-Statsӡ豸ͳƣڶ-Resetʱͬʱ
+			G_PrintStats = TRUE;
+			G_StatsFlags = (argc > 2 && !_strnicmp(argv[2], "-Reset", 6)) ? ECHO_STATS_FLAG_RESET : 0;
+		}
+		else if (!_strnicmp(argv[1], "-Trace", 6)) {
+			// һ-TraceȽWPPٹرպʹʱÿĿ
+			G_PerformTraceBench = TRUE;
+			G_TraceBenchCount = (argc > 2) ? atoi(argv[2]) : TRACE_BENCH_COUNT;
+		}
+		else if (!_strnicmp(argv[1], "-ReadWait", 9)) {
+			// һ-ReadWaitȽѯ͵ȴдɵɵӳ
+			G_PerformReadWaitBench = TRUE;
+			G_ReadWaitBenchCount = (argc > 2) ? atoi(argv[2]) : READ_WAIT_BENCH_COUNT;
+		}
+		else if (!_strnicmp(argv[1], "-Broadcast", 10)) {
+			// һ-Broadcastһд㲥1864ʱдĿ
+			G_PerformBroadcastBench = TRUE;
+			G_BroadcastBenchCount = (argc > 2) ? atoi(argv[2]) : BROADCAST_BENCH_COUNT;
+		}
+		else if (!_strnicmp(argv[1], "-Wheel", 6)) {
+			// һ-WheelԴͬӳٵͬʱʱʱĿ͵ھ
+			G_PerformWheelBench = TRUE;
+			G_WheelBenchCount = (argc > 2) ? atoi(argv[2]) : WHEEL_BENCH_COUNT;
+		}
+		else if (!_strnicmp(argv[1], "-Jitter", 7)) {
+			// һ-JitterȽͨʱ͸߾ȶʱĴڶڣus
+			G_PerformJitterBench = TRUE;
+			G_JitterBenchPeriodUs = (argc > 2) ? atoi(argv[2]) : JITTER_BENCH_PERIOD_US;
+		}
+		else if (!_strnicmp(argv[1], "-Pipe", 5)) {
+			// һ-Pipeģʽ²̺֮߳߳ĳڶMB
+			G_PerformPipeBench = TRUE;
+			G_PipeBenchMegabytes = (argc > 2) ? atoi(argv[2]) : PIPE_BENCH_MEGABYTES;
+		}
+		else if (!_strnicmp(argv[1], "-Batch", 6)) {
+			// һ-BatchȽÿһдһIOCTL_ECHO_BATCHִждÿ
+			G_PerformBatchBench = TRUE;
+			G_BatchBenchCount = (argc > 2) ? atoi(argv[2]) : BATCH_BENCH_COUNT;
+		}
+		else if (!_strnicmp(argv[1], "-Uring", 6)) {
+			// һ-UringȽɶ˿ϵصд빲ڴ滷ÿ
+			G_PerformUringBench = TRUE;
+			G_UringBenchCount = (argc > 2) ? atoi(argv[2]) : URING_BENCH_COUNT;
+		}
+		else if (!_strnicmp(argv[1], "-Transform", 10)) {
+			// һ-Transformڶ816˽ͨϴתĵתдһٶ
+			G_PerformTransformTest = TRUE;
+			G_TransformTestId = (argc > 2 && atoi(argv[2]) == 8) ? ECHO_TRANSFORM_DIGITS_UTF8 : ECHO_TRANSFORM_DIGITS_UTF16;
+		}
+		else if (!_strnicmp(argv[1], "-Scale", 6)) {
+			// һ-Scale1̵߳[number]̣߳ÿ̰߳һÿ̵߳ÿд
+			G_PerformScaleBench = TRUE;
+			G_ScaleBenchThreads = (argc > 2) ? atoi(argv[2]) : 0;
+		}
+		else if (!_strnicmp(argv[1], "-Params", 7)) {
+			// һ-Paramsӡ豸Ŀɵname=value޸ǣ-Persistͬʱдע
+			G_SetParameters = TRUE;
+			G_ParameterArgc = argc - 2;
+			G_ParameterArgv = argv + 2;
+		}
+		else if (!_strnicmp(argv[1], "-Latency", 8)) {
+			// һ-Latencyĸӳģͣдӳٷֲ
+			G_PerformLatencyBench = TRUE;
+			G_LatencyBenchCount = (argc > 2) ? atoi(argv[2]) : LATENCY_BENCH_COUNT;
+		}
+		else if (!_strnicmp(argv[1], "-Priority", 9)) {
+			// һ-PriorityͬʱСӳ٣ȽϲȼͷȼȨת
+			G_PerformPriorityBench = TRUE;
+		}
+		else if (!_strnicmp(argv[1], "-Bench", 6)) {
+			// һ-Benchname=valueöȡ󳤶ȡԤʱ䣬ӡIOPSMB/sӳٷλ
+			G_PerformBench = TRUE;
+			G_BenchArgc = argc - 2;
+			G_BenchArgv = argv + 2;
+		}
 		else {
 			// 󣬴ӡȷִиʽ
 			printf("Usage:\n");
 			printf("    Echoapp.exe         --- Send single write and read request synchronously\n");
 			printf("    Echoapp.exe -Async  --- Send reads and writes asynchronously without terminating\n");
 			printf("    Echoapp.exe -Async <number> --- Send <number> reads and writes asynchronously\n");
+			printf("    Echoapp.exe -Policy [number] --- Measure requests/s and latency of each completion policy\n");
+			printf("    Echoapp.exe -Lookaside --- Print hit/miss counters of the driver's payload buffer lookaside lists\n");
+			printf("    Echoapp.exe -Stream --- Measure MB/s of writes from 4 KB to 64 MB read back in 64 KB pieces\n");
+			printf("    Echoapp.exe -Channels [number] --- Echo concurrently on [number] handles with private channels and check for cross-talk\n");
+			printf("    Echoapp.exe -Stats [-Reset] --- Print the driver's counters and latency histogram, optionally resetting them\n");
+			printf("    Echoapp.exe -Trace [number] --- Measure per-request cost with the driver's WPP tracing off and on (needs administrator)\n");
+			printf("    Echoapp.exe -ReadWait [number] --- Measure write-to-read wakeup latency of polling reads and waiting reads\n");
+			printf("    Echoapp.exe -Broadcast [number] --- Measure the cost of one write fanned out to 1, 8 and 64 waiting reads\n");
+			printf("    Echoapp.exe -Wheel [number] --- Measure issue cost and lateness of up to [number] requests pending on the driver's timer wheel\n");
+			printf("    Echoapp.exe -Jitter [period] --- Compare fire time jitter of default and high resolution driver timers with a [period] us period\n");
+			printf("    Echoapp.exe -Pipe [MB] --- Measure sustained MB/s from a producer thread to a consumer thread in stream mode with backpressure\n");
+			printf("    Echoapp.exe -Batch [number] --- Compare ops/s of 64-byte echoes sent as single reads and writes and as IOCTL_ECHO_BATCH arrays\n");
+			printf("    Echoapp.exe -Uring [number] --- Compare ops/s of 64-byte echoes through an I/O completion port and through shared submission/completion rings\n");
+			printf("    Echoapp.exe -Transform [8|16] --- Echo a line through the digit-to-Chinese read transform with UTF-8 or UTF-16 (default) output\n");
+			printf("    Echoapp.exe -Scale [number] --- Measure echoes/s per thread from 1 to [number] (default all processors) threads, each bound to its own processor\n");
+			printf("    Echoapp.exe -Params [name=value ...] [-Persist] --- Print the driver's tunable parameters, set the given ones and optionally save them to the registry\n");
+			printf("    Echoapp.exe -Latency [number] --- Print the write latency distribution under each synthetic device latency model and a bandwidth throttle\n");
+			printf("    Echoapp.exe -Priority --- Measure 64-byte echo latency next to 40 KB bulk transfers with and without priority classes\n");
+			printf("    Echoapp.exe -Bench [depth=N] [size=N] [seconds=N] [warmup=N] [csv=file] [json=file] --- Measure IOPS, MB/s and p50/p90/p99/p99.9 latency of overlapped echoes\n");
 			printf("Exit the app anytime by pressing Ctrl-C\n");
 			result = FALSE;
 			goto exit;
@@ -134,6 +474,82 @@ main(
 		result = (BOOLEAN)AsyncIo((PVOID)WRITER_TYPE);
 
 	}
+	else if (G_PerformPolicyBench) {
+		// ɲԲ
+		result = PerformPolicyBenchmark(hDevice, G_PolicyBenchCount);
+	}
+	else if (G_PrintLookasideStats) {
+		// ӡбͳ
+		result = PrintLookasideStats(hDevice);
+	}
+	else if (G_PerformStreamBench) {
+		// ʽд
+		result = PerformStreamBenchmark(hDevice);
+	}
+	else if (G_PerformChannelTest) {
+		// ͨ
+		result = PerformChannelTest(hDevice, G_ChannelTestHandles);
+	}
+	else if (G_PrintStats) {
+		// ӡ豸ͳ
+		result = PrintStats(hDevice, G_StatsFlags);
+	}
+	else if (G_PerformTraceBench) {
+		// ԸٵĿ
+		result = PerformTraceBenchmark(hDevice, G_TraceBenchCount);
+	}
+	else if (G_PerformReadWaitBench) {
+		// ȴ
+		result = PerformReadWaitBenchmark(hDevice, G_ReadWaitBenchCount);
+	}
+	else if (G_PerformBroadcastBench) {
+		// 㲥
+		result = PerformBroadcastBenchmark(hDevice, G_BroadcastBenchCount);
+	}
+	else if (G_PerformWheelBench) {
+		// ʱֲ
+		result = PerformWheelBenchmark(G_WheelBenchCount);
+	}
+	else if (G_PerformJitterBench) {
+		// ʱ
+		result = PerformJitterBenchmark(hDevice, G_JitterBenchPeriodUs);
+	}
+	else if (G_PerformPipeBench) {
+		// ģʽ
+		result = PerformPipeBenchmark(hDevice, G_PipeBenchMegabytes);
+	}
+	else if (G_PerformBatchBench) {
+		// 
+		result = PerformBatchBenchmark(hDevice, G_BatchBenchCount);
+	}
+	else if (G_PerformUringBench) {
+		// ڴ滷
+		result = PerformUringBenchmark(hDevice, G_UringBenchCount);
+	}
+	else if (G_PerformTransformTest) {
+		// ·ת
+		result = PerformTransformTest(G_TransformTestId);
+	}
+	else if (G_PerformScaleBench) {
+		// ദչԲ
+		result = PerformScaleBenchmark(hDevice, G_ScaleBenchThreads);
+	}
+	else if (G_SetParameters) {
+		// ȡ޸豸ɵ
+		result = SetParameters(hDevice, G_ParameterArgc, G_ParameterArgv);
+	}
+	else if (G_PerformLatencyBench) {
+		// ӳģͲ
+		result = PerformLatencyBenchmark(hDevice, G_LatencyBenchCount);
+	}
+	else if (G_PerformPriorityBench) {
+		// ȼ
+		result = PerformPriorityBenchmark(hDevice);
+	}
+	else if (G_PerformBench) {
+		// ӳٻ׼
+		result = PerformBenchmark(hDevice, G_BenchArgc, G_BenchArgv);
+	}
 	else {
 		// ִͬ
 		result = PerformWriteReadTest(hDevice, 512);
@@ -336,6 +752,4280 @@ Cleanup:
 	return result;
 }
 
+// 豸ɲ
+BOOLEAN
+SetCompletionPolicy(
+	IN HANDLE hDevice,
+	IN PECHO_COMPLETION_POLICY Policy
+)
+{
+	ULONG bytesReturned;
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_SET_COMPLETION_POLICY,
+		Policy,
+		sizeof(ECHO_COMPLETION_POLICY),
+		NULL,
+		0,
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_SET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+// POLICY_BENCH_DEPTHصżд۶һɲ
+// ӡÿɵƽӳ
+BOOLEAN
+RunPolicyBenchmark(
+	IN HANDLE hDevice,
+	IN HANDLE hCompletionPort,
+	IN PCSTR Name,
+	IN ULONG Count
+)
+{
+	OVERLAPPED ovList[POLICY_BENCH_DEPTH];
+	LARGE_INTEGER startTime[POLICY_BENCH_DEPTH];
+	PUCHAR buf = NULL;
+	LARGE_INTEGER frequency, benchStart, now;
+	ULONG numberOfBytesTransferred;
+	OVERLAPPED *completedOv;
+	ULONG_PTR key;
+	ULONG_PTR i;
+	ULONG depth = (Count < POLICY_BENCH_DEPTH) ? Count : POLICY_BENCH_DEPTH;
+	ULONG remainingRequestsToSend = Count;
+	ULONG completed = 0;
+	ULONG outstanding = 0;
+	ULONG errors = 0;
+	double latencyUs, totalLatencyUs = 0, maxLatencyUs = 0, elapsedSec;
+	BOOLEAN result = TRUE;
+	BOOL ok;
+
+	buf = CreatePatternBuffer(POLICY_BENCH_DEPTH * POLICY_BENCH_LENGTH);
+	if (buf == NULL) {
+		return FALSE;
+	}
+
+	ZeroMemory(ovList, sizeof(ovList));
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&benchStart);
+
+	for (i = 0; i < depth; i++) {
+		QueryPerformanceCounter(&startTime[i]);
+		remainingRequestsToSend--;
+
+		if (i & 1) {
+			ok = ReadFile(hDevice, buf + (i * POLICY_BENCH_LENGTH), POLICY_BENCH_LENGTH, NULL, &ovList[i]);
+		}
+		else {
+			ok = WriteFile(hDevice, buf + (i * POLICY_BENCH_LENGTH), POLICY_BENCH_LENGTH, NULL, &ovList[i]);
+		}
+
+		if (!ok && GetLastError() != ERROR_IO_PENDING) {
+			printf(" %dth request failed %d \n", (ULONG)i, GetLastError());
+			result = FALSE;
+			goto Error;
+		}
+
+		outstanding++;
+	}
+
+	while (completed < Count) {
+
+		ok = GetQueuedCompletionStatus(hCompletionPort, &numberOfBytesTransferred, &key, &completedOv, INFINITE);
+		if (completedOv == NULL) {
+			printf("GetQueuedCompletionStatus failed %d\n", GetLastError());
+			result = FALSE;
+			goto Error;
+		}
+
+		// λȴֹֻ
+		if (!ok) {
+			errors++;
+		}
+
+		QueryPerformanceCounter(&now);
+		i = completedOv - ovList;
+		outstanding--;
+
+		latencyUs = (double)(now.QuadPart - startTime[i].QuadPart) * 1000000.0 / (double)frequency.QuadPart;
+		totalLatencyUs += latencyUs;
+		if (latencyUs > maxLatencyUs) {
+			maxLatencyUs = latencyUs;
+		}
+
+		completed++;
+
+		if (remainingRequestsToSend == 0) {
+			continue;
+		}
+		remainingRequestsToSend--;
+
+		ZeroMemory(completedOv, sizeof(OVERLAPPED));
+		startTime[i] = now;
+
+		if (i & 1) {
+			ok = ReadFile(hDevice, buf + (i * POLICY_BENCH_LENGTH), POLICY_BENCH_LENGTH, NULL, completedOv);
+		}
+		else {
+			ok = WriteFile(hDevice, buf + (i * POLICY_BENCH_LENGTH), POLICY_BENCH_LENGTH, NULL, completedOv);
+		}
+
+		if (!ok && GetLastError() != ERROR_IO_PENDING) {
+			printf("%Idth request failed %d \n", i, GetLastError());
+			result = FALSE;
+			goto Error;
+		}
+
+		outstanding++;
+	}
+
+	QueryPerformanceCounter(&now);
+	elapsedSec = (double)(now.QuadPart - benchStart.QuadPart) / (double)frequency.QuadPart;
+
+	printf("%-10s %8d requests %8.3f s %12.1f req/s  avg %10.1f us  max %10.1f us  errors %d\n",
+		Name,
+		completed,
+		elapsedSec,
+		(elapsedSec > 0) ? completed / elapsedSec : 0.0,
+		totalLatencyUs / completed,
+		maxLatencyUs,
+		errors);
+
+Error:
+	// ͷŻǰȡȴѷ͵ȫ
+	if (outstanding != 0) {
+		CancelIo(hDevice);
+
+		while (outstanding != 0 &&
+			(GetQueuedCompletionStatus(hCompletionPort, &numberOfBytesTransferred, &key, &completedOv, INFINITE) ||
+				completedOv != NULL)) {
+			outstanding--;
+		}
+	}
+
+	free(buf);
+
+	return result;
+}
+
+// βɲԣԽָԭĲ
+BOOLEAN
+PerformPolicyBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+)
+{
+	HANDLE hOverlapped = INVALID_HANDLE_VALUE;
+	HANDLE hCompletionPort = NULL;
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	ULONG bytesReturned;
+	BOOLEAN result = TRUE;
+
+	if (Count == 0) {
+		Count = POLICY_BENCH_COUNT;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_COMPLETION_POLICY,
+		NULL,
+		0,
+		&savedPolicy,
+		sizeof(savedPolicy),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	// ʹһص
+	hOverlapped = CreateFile(G_DevicePath,
+		GENERIC_WRITE | GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED,
+		NULL);
+
+	if (hOverlapped == INVALID_HANDLE_VALUE) {
+		printf("Cannot open %ws error %d\n", G_DevicePath, GetLastError());
+		return FALSE;
+	}
+
+	hCompletionPort = CreateIoCompletionPort(hOverlapped, NULL, 1, 0);
+	if (hCompletionPort == NULL) {
+		printf("Cannot open completion port %d \n", GetLastError());
+		CloseHandle(hOverlapped);
+		return FALSE;
+	}
+
+	printf("Completion policy benchmark: depth %d, %d bytes per request\n",
+		POLICY_BENCH_DEPTH, POLICY_BENCH_LENGTH);
+
+	// 1 
+	policy.Mode = EchoCompletionImmediate;
+	policy.MaxDelayMs = savedPolicy.MaxDelayMs;
+	policy.BatchSize = savedPolicy.BatchSize;
+	result = SetCompletionPolicy(hDevice, &policy) &&
+		RunPolicyBenchmark(hOverlapped, hCompletionPort, "Immediate", Count);
+
+	// 2 ϲ
+	if (result) {
+		policy.Mode = EchoCompletionCoalesce;
+		policy.MaxDelayMs = 1;
+		policy.BatchSize = POLICY_BENCH_DEPTH / 2;
+		result = SetCompletionPolicy(hDevice, &policy) &&
+			RunPolicyBenchmark(hOverlapped, hCompletionPort, "Coalesce", Count);
+	}
+
+	// 3 ʱÿһ
+	if (result) {
+		policy.Mode = EchoCompletionTimer;
+		result = SetCompletionPolicy(hDevice, &policy) &&
+			RunPolicyBenchmark(hOverlapped, hCompletionPort, "Timer",
+				(Count < POLICY_BENCH_TIMER_COUNT) ? Count : POLICY_BENCH_TIMER_COUNT);
+	}
+
+	// ָԭĲ
+	CloseHandle(hOverlapped);
+	CloseHandle(hCompletionPort);
+	SetCompletionPolicy(hDevice, &savedPolicy);
+
+	return result;
+}
+
+// ӡбķ䡢Сδк͹黹
+BOOLEAN
+PrintLookasideStats(
+	IN HANDLE hDevice
+)
+{
+	ECHO_LOOKASIDE_STATS stats;
+	ULONG bytesReturned;
+	ULONG i;
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_LOOKASIDE_STATS,
+		NULL,
+		0,
+		&stats,
+		sizeof(stats),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_LOOKASIDE_STATS failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	printf("%8s %14s %14s %14s %14s\n", "Size", "Allocations", "Hits", "Misses", "Frees");
+
+	for (i = 0; i < stats.ClassCount && i < ECHO_LOOKASIDE_MAX_CLASSES; i++) {
+		printf("%8u %14llu %14llu %14llu %14llu\n",
+			stats.Classes[i].Size,
+			stats.Classes[i].Allocations,
+			stats.Classes[i].Allocations - stats.Classes[i].Misses,
+			stats.Classes[i].Misses,
+			stats.Classes[i].Frees);
+	}
+
+	return TRUE;
+}
+
+// дLengthֽڣSTREAM_BENCH_READ_LENGTHΪλزУ飬ظIterations
+// дصģʱܷ
+BOOLEAN
+RunStreamBenchmark(
+	IN HANDLE hDevice,
+	IN PUCHAR WriteBuffer,
+	IN PUCHAR ReadBuffer,
+	IN ULONG Length,
+	IN ULONG Iterations
+)
+{
+	OVERLAPPED writeOv;
+	OVERLAPPED readOv;
+	LARGE_INTEGER frequency, benchStart, now;
+	ULONG readLength = (Length < STREAM_BENCH_READ_LENGTH) ? Length : STREAM_BENCH_READ_LENGTH;
+	ULONG bytesReturned;
+	ULONG received;
+	ULONG i;
+	double elapsedSec;
+	BOOLEAN result = TRUE;
+
+	ZeroMemory(&writeOv, sizeof(writeOv));
+	ZeroMemory(&readOv, sizeof(readOv));
+
+	writeOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	readOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (writeOv.hEvent == NULL || readOv.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&benchStart);
+
+	for (i = 0; i < Iterations; i++) {
+
+		if (!WriteFile(hDevice, WriteBuffer, Length, NULL, &writeOv) &&
+			GetLastError() != ERROR_IO_PENDING) {
+			printf("WriteFile of %d bytes failed %d\n", Length, GetLastError());
+			result = FALSE;
+			goto exit;
+		}
+
+		// αʽݣ0ֽ˵дδ
+		for (received = 0; received < Length; received += bytesReturned) {
+
+			if (!ReadFile(hDevice, ReadBuffer + received, readLength, NULL, &readOv) &&
+				GetLastError() != ERROR_IO_PENDING) {
+				printf("ReadFile failed %d\n", GetLastError());
+				result = FALSE;
+				break;
+			}
+
+			if (!GetOverlappedResult(hDevice, &readOv, &bytesReturned, TRUE)) {
+				printf("ReadFile failed %d\n", GetLastError());
+				result = FALSE;
+				break;
+			}
+
+			if (readLength > Length - received - bytesReturned) {
+				readLength = Length - received - bytesReturned;
+			}
+		}
+
+		readLength = (Length < STREAM_BENCH_READ_LENGTH) ? Length : STREAM_BENCH_READ_LENGTH;
+
+		if (!GetOverlappedResult(hDevice, &writeOv, &bytesReturned, TRUE)) {
+			printf("WriteFile of %d bytes failed %d\n", Length, GetLastError());
+			result = FALSE;
+			goto exit;
+		}
+
+		if (!result) {
+			goto exit;
+		}
+
+		if (memcmp(WriteBuffer, ReadBuffer, Length) != 0) {
+			printf("Verify failed for %d bytes\n", Length);
+			result = FALSE;
+			goto exit;
+		}
+	}
+
+	QueryPerformanceCounter(&now);
+	elapsedSec = (double)(now.QuadPart - benchStart.QuadPart) / (double)frequency.QuadPart;
+
+	printf("%10d bytes %8d writes %8.3f s %10.1f MB/s\n",
+		Length,
+		Iterations,
+		elapsedSec,
+		(elapsedSec > 0) ? ((double)Length * Iterations) / (1024.0 * 1024.0) / elapsedSec : 0.0);
+
+exit:
+	if (writeOv.hEvent != NULL) {
+		CloseHandle(writeOv.hEvent);
+	}
+
+	if (readOv.hEvent != NULL) {
+		CloseHandle(readOv.hEvent);
+	}
+
+	return result;
+}
+
+// д볤ȴSTREAM_BENCH_MIN_LENGTHSTREAM_BENCH_MAX_LENGTHÿγ4
+// ڼʹɲԣԽָԭĲ
+BOOLEAN
+PerformStreamBenchmark(
+	IN HANDLE hDevice
+)
+{
+	HANDLE hOverlapped = INVALID_HANDLE_VALUE;
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	PUCHAR writeBuffer = NULL;
+	PUCHAR readBuffer = NULL;
+	ULONG bytesReturned;
+	ULONG length;
+	BOOLEAN result = TRUE;
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_COMPLETION_POLICY,
+		NULL,
+		0,
+		&savedPolicy,
+		sizeof(savedPolicy),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	writeBuffer = CreatePatternBuffer(STREAM_BENCH_MAX_LENGTH);
+	readBuffer = (PUCHAR)malloc(STREAM_BENCH_MAX_LENGTH);
+	if (writeBuffer == NULL || readBuffer == NULL) {
+		printf("Could not allocate %d byte buffers\n", STREAM_BENCH_MAX_LENGTH);
+		result = FALSE;
+		goto exit;
+	}
+
+	// ʹһص
+	hOverlapped = CreateFile(G_DevicePath,
+		GENERIC_WRITE | GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED,
+		NULL);
+
+	if (hOverlapped == INVALID_HANDLE_VALUE) {
+		printf("Cannot open %ws error %d\n", G_DevicePath, GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	policy = savedPolicy;
+	policy.Mode = EchoCompletionImmediate;
+	if (!SetCompletionPolicy(hDevice, &policy)) {
+		result = FALSE;
+		goto exit;
+	}
+
+	printf("Stream benchmark: %d bytes per size, %d bytes per read\n",
+		STREAM_BENCH_BYTES, STREAM_BENCH_READ_LENGTH);
+
+	for (length = STREAM_BENCH_MIN_LENGTH; length <= STREAM_BENCH_MAX_LENGTH && result; length *= 4) {
+		result = RunStreamBenchmark(hOverlapped,
+			writeBuffer,
+			readBuffer,
+			length,
+			(length < STREAM_BENCH_BYTES) ? STREAM_BENCH_BYTES / length : 1);
+	}
+
+	// ָԭĲ
+	SetCompletionPolicy(hDevice, &savedPolicy);
+
+exit:
+	if (hOverlapped != INVALID_HANDLE_VALUE) {
+		CloseHandle(hOverlapped);
+	}
+
+	free(writeBuffer);
+	free(readBuffer);
+
+	return result;
+}
+
+// ͨһĲͽ
+typedef struct _CHANNEL_TEST {
+	HANDLE hDevice;
+	ULONG Index;
+	ULONG Completed;
+	ULONG Errors;
+} CHANNEL_TEST, *PCHANNEL_TEST;
+
+// ͨԵĹ߳
+// ԼľϷдоźдŵݣٶУ
+// ˵֮ͨд
+ULONG
+ChannelTestWorker(
+	PVOID ThreadParameter
+)
+{
+	PCHANNEL_TEST test = (PCHANNEL_TEST)ThreadParameter;
+	UCHAR writeBuffer[CHANNEL_TEST_LENGTH];
+	UCHAR readBuffer[CHANNEL_TEST_LENGTH];
+	OVERLAPPED writeOv;
+	OVERLAPPED readOv;
+	ULONG bytesReturned;
+	ULONG received;
+	ULONG i, j;
+
+	ZeroMemory(&writeOv, sizeof(writeOv));
+	ZeroMemory(&readOv, sizeof(readOv));
+
+	writeOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	readOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (writeOv.hEvent == NULL || readOv.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		test->Errors++;
+		goto exit;
+	}
+
+	for (i = 0; i < CHANNEL_TEST_ITERATIONS; i++) {
+
+		for (j = 0; j < CHANNEL_TEST_LENGTH; j++) {
+			writeBuffer[j] = (UCHAR)(j + i);
+		}
+
+		((PULONG)writeBuffer)[0] = test->Index;
+		((PULONG)writeBuffer)[1] = i;
+
+		if (!WriteFile(test->hDevice, writeBuffer, CHANNEL_TEST_LENGTH, NULL, &writeOv) &&
+			GetLastError() != ERROR_IO_PENDING) {
+			test->Errors++;
+			break;
+		}
+
+		// 0ֽ˵дδ
+		for (received = 0; received < CHANNEL_TEST_LENGTH; received += bytesReturned) {
+
+			if ((!ReadFile(test->hDevice, readBuffer + received, CHANNEL_TEST_LENGTH - received, NULL, &readOv) &&
+				GetLastError() != ERROR_IO_PENDING) ||
+				!GetOverlappedResult(test->hDevice, &readOv, &bytesReturned, TRUE)) {
+				test->Errors++;
+				break;
+			}
+		}
+
+		if (!GetOverlappedResult(test->hDevice, &writeOv, &bytesReturned, TRUE)) {
+			test->Errors++;
+			break;
+		}
+
+		if (received != CHANNEL_TEST_LENGTH ||
+			memcmp(writeBuffer, readBuffer, CHANNEL_TEST_LENGTH) != 0) {
+			printf("Handle %d: write %d read back data of handle %d write %d\n",
+				test->Index, i, ((PULONG)readBuffer)[0], ((PULONG)readBuffer)[1]);
+			test->Errors++;
+			break;
+		}
+
+		test->Completed++;
+	}
+
+exit:
+	if (writeOv.hEvent != NULL) {
+		CloseHandle(writeOv.hEvent);
+	}
+
+	if (readOv.hEvent != NULL) {
+		CloseHandle(readOv.hEvent);
+	}
+
+	return 0;
+}
+
+// Handlesʹ˽ͨľÿһ̲߳д
+// ڼʹɲԣԽָԭĲ
+BOOLEAN
+PerformChannelTest(
+	IN HANDLE hDevice,
+	IN ULONG Handles
+)
+{
+	CHANNEL_TEST tests[CHANNEL_TEST_MAX_HANDLES];
+	HANDLE threads[CHANNEL_TEST_MAX_HANDLES];
+	WCHAR channelPath[MAX_DEVPATH_LENGTH];
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	LARGE_INTEGER frequency, start, now;
+	ULONG bytesReturned;
+	ULONG completed = 0;
+	ULONG errors = 0;
+	ULONG opened = 0;
+	ULONG started = 0;
+	ULONG i;
+	double elapsedSec;
+	BOOLEAN result = TRUE;
+	HRESULT hr;
+
+	if (Handles == 0 || Handles > CHANNEL_TEST_MAX_HANDLES) {
+		Handles = CHANNEL_TEST_HANDLES;
+	}
+
+	hr = StringCchPrintf(channelPath, MAX_DEVPATH_LENGTH, L"%ws%ws", G_DevicePath, ECHO_PRIVATE_CHANNEL_NAME);
+	if (FAILED(hr)) {
+		printf("Error: StringCchPrintf failed with HRESULT 0x%x", hr);
+		return FALSE;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_COMPLETION_POLICY,
+		NULL,
+		0,
+		&savedPolicy,
+		sizeof(savedPolicy),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	ZeroMemory(tests, sizeof(tests));
+
+	for (opened = 0; opened < Handles; opened++) {
+
+		tests[opened].Index = opened;
+		tests[opened].hDevice = CreateFile(channelPath,
+			GENERIC_WRITE | GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE,
+			NULL,
+			OPEN_EXISTING,
+			FILE_FLAG_OVERLAPPED,
+			NULL);
+
+		if (tests[opened].hDevice == INVALID_HANDLE_VALUE) {
+			printf("Cannot open %ws error %d\n", channelPath, GetLastError());
+			result = FALSE;
+			goto exit;
+		}
+	}
+
+	policy = savedPolicy;
+	policy.Mode = EchoCompletionImmediate;
+	if (!SetCompletionPolicy(hDevice, &policy)) {
+		result = FALSE;
+		goto exit;
+	}
+
+	printf("Channel test: %d handles, %d writes of %d bytes each\n",
+		Handles, CHANNEL_TEST_ITERATIONS, CHANNEL_TEST_LENGTH);
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	for (started = 0; started < Handles; started++) {
+
+		threads[started] = CreateThread(NULL,
+			0,
+			(LPTHREAD_START_ROUTINE)ChannelTestWorker,
+			&tests[started],
+			0,
+			NULL);
+
+		if (threads[started] == NULL) {
+			printf("Couldn't create worker thread - error %d\n", GetLastError());
+			result = FALSE;
+			break;
+		}
+	}
+
+	if (started != 0) {
+		WaitForMultipleObjects(started, threads, TRUE, INFINITE);
+	}
+
+	QueryPerformanceCounter(&now);
+	elapsedSec = (double)(now.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+
+	for (i = 0; i < started; i++) {
+		CloseHandle(threads[i]);
+		completed += tests[i].Completed;
+		errors += tests[i].Errors;
+	}
+
+	printf("%8d echoes %8.3f s %12.1f echoes/s  errors %d\n",
+		completed,
+		elapsedSec,
+		(elapsedSec > 0) ? completed / elapsedSec : 0.0,
+		errors);
+
+	if (errors != 0) {
+		result = FALSE;
+	}
+
+	// ָԭĲ
+	SetCompletionPolicy(hDevice, &savedPolicy);
+
+exit:
+	for (i = 0; i < opened; i++) {
+		CloseHandle(tests[i].hDevice);
+	}
+
+	return result;
+}
+
+// ӡ豸ͳƣʰͳ㣬ӳٷֲֻӡǿյͰ
+BOOLEAN
+PrintStats(
+	IN HANDLE hDevice,
+	IN ULONG Flags
+)
+{
+	ECHO_STATS stats;
+	ULONG bytesReturned;
+	double intervalSec;
+	ULONG i;
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_STATS,
+		&Flags,
+		sizeof(Flags),
+		&stats,
+		sizeof(stats),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_STATS failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	intervalSec = stats.IntervalUs / 1000000.0;
+	if (intervalSec <= 0) {
+		intervalSec = 1;
+	}
+
+	printf("Interval            %12.3f s (%d processors, %d shards)\n", stats.IntervalUs / 1000000.0, stats.ProcessorCount, stats.ShardCount);
+	printf("Bytes in            %12llu  %12.1f MB/s\n", stats.BytesIn, stats.BytesIn / (1024.0 * 1024.0) / intervalSec);
+	printf("Bytes out           %12llu  %12.1f MB/s\n", stats.BytesOut, stats.BytesOut / (1024.0 * 1024.0) / intervalSec);
+	printf("Write requests      %12llu  %12.1f /s\n", stats.WriteRequests, stats.WriteRequests / intervalSec);
+	printf("Read requests       %12llu  %12.1f /s\n", stats.ReadRequests, stats.ReadRequests / intervalSec);
+	printf("Completions         %12llu  %12.1f /s\n", stats.Completions, stats.Completions / intervalSec);
+	printf("Cancels             %12llu\n", stats.Cancels);
+	printf("Allocation failures %12llu\n", stats.AllocationFailures);
+	printf("Read waits          %12llu\n", stats.ReadWaits);
+	printf("Read wait timeouts  %12llu\n", stats.ReadWaitTimeouts);
+	printf("Write waits         %12llu\n", stats.WriteWaits);
+	printf("Admission waits     %12llu\n", stats.AdmissionWaits);
+	printf("Batch operations    %12llu  %12.1f /s\n", stats.BatchOps, stats.BatchOps / intervalSec);
+	printf("Uring operations    %12llu  %12.1f /s\n", stats.UringOps, stats.UringOps / intervalSec);
+	printf("Pending depth       %12lld\n", stats.PendingDepth);
+	printf("Admission depth     %12lld\n", stats.AdmissionDepth);
+	printf("Budget used         %12llu / %llu bytes\n", stats.BudgetUsed, stats.BudgetLimit);
+	printf("Suspends            %12llu  last %llu us, resume %llu us, %llu requests kept\n",
+		stats.SuspendCount, stats.LastSuspendUs, stats.LastResumeUs, stats.StopAcknowledged);
+
+	printf("Completion latency:\n");
+	for (i = 0; i < ECHO_STATS_LATENCY_BUCKETS; i++) {
+		if (stats.Latency[i] != 0) {
+			printf("  %10llu us - %10llu us %12llu\n",
+				(i == 0) ? 0ULL : (1ULL << i),
+				(1ULL << (i + 1)) - 1,
+				stats.Latency[i]);
+		}
+	}
+
+	PrintClassLatency(&stats);
+
+	return TRUE;
+}
+
+// ͬдCountΣӡÿƽʱ
+BOOLEAN
+RunTraceBenchmark(
+	IN HANDLE hDevice,
+	IN PCSTR Name,
+	IN ULONG Count
+)
+{
+	UCHAR writeBuffer[TRACE_BENCH_LENGTH];
+	UCHAR readBuffer[TRACE_BENCH_LENGTH];
+	LARGE_INTEGER frequency, start, end;
+	ULONG bytesReturned;
+	ULONG i;
+
+	FillMemory(writeBuffer, sizeof(writeBuffer), 0x5a);
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	for (i = 0; i < Count; i++) {
+
+		if (!WriteFile(hDevice, writeBuffer, sizeof(writeBuffer), &bytesReturned, NULL)) {
+			printf("WriteFile failed with error 0x%x\n", GetLastError());
+			return FALSE;
+		}
+
+		if (!ReadFile(hDevice, readBuffer, sizeof(readBuffer), &bytesReturned, NULL) ||
+			bytesReturned != sizeof(readBuffer)) {
+			printf("ReadFile failed with error 0x%x, %d bytes returned\n", GetLastError(), bytesReturned);
+			return FALSE;
+		}
+	}
+
+	QueryPerformanceCounter(&end);
+
+	printf("%-36s %10.0f ns/request\n", Name,
+		(double)(end.QuadPart - start.QuadPart) * 1e9 / frequency.QuadPart / (2.0 * Count));
+
+	return TRUE;
+}
+
+// ֹֻͣдڴ滺ĸٻỰĸṩߵб־
+// ҪԱȨ
+BOOLEAN
+ControlTraceSession(
+	IN BOOLEAN Start,
+	IN UCHAR Level,
+	IN OUT TRACEHANDLE* Session
+)
+{
+	UCHAR buffer[sizeof(EVENT_TRACE_PROPERTIES) + sizeof(TRACE_BENCH_SESSION_NAME)];
+	PEVENT_TRACE_PROPERTIES properties = (PEVENT_TRACE_PROPERTIES)buffer;
+	ULONG status;
+
+	ZeroMemory(buffer, sizeof(buffer));
+	properties->Wnode.BufferSize = sizeof(buffer);
+	properties->Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+	properties->LogFileMode = EVENT_TRACE_BUFFERING_MODE;
+	properties->LoggerNameOffset = sizeof(EVENT_TRACE_PROPERTIES);
+
+	if (!Start) {
+		ControlTrace(*Session, TRACE_BENCH_SESSION_NAME, properties, EVENT_TRACE_CONTROL_STOP);
+		*Session = 0;
+		return TRUE;
+	}
+
+	status = StartTrace(Session, TRACE_BENCH_SESSION_NAME, properties);
+	if (status == ERROR_ALREADY_EXISTS) {
+		// ϴβ쳣˳µĻỰֹͣ
+		ControlTrace(0, TRACE_BENCH_SESSION_NAME, properties, EVENT_TRACE_CONTROL_STOP);
+		ZeroMemory(buffer, sizeof(buffer));
+		properties->Wnode.BufferSize = sizeof(buffer);
+		properties->Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+		properties->LogFileMode = EVENT_TRACE_BUFFERING_MODE;
+		properties->LoggerNameOffset = sizeof(EVENT_TRACE_PROPERTIES);
+		status = StartTrace(Session, TRACE_BENCH_SESSION_NAME, properties);
+	}
+
+	if (status != ERROR_SUCCESS) {
+		printf("StartTrace failed with error %d\n", status);
+		return FALSE;
+	}
+
+	// WPPṩߵı־λMatchAnyKeywordĵ32λ
+	status = EnableTraceEx2(*Session,
+		&GUID_ECHO_TRACE_PROVIDER,
+		EVENT_CONTROL_CODE_ENABLE_PROVIDER,
+		Level,
+		0xFFFFFFFF,
+		0,
+		0,
+		NULL);
+
+	if (status != ERROR_SUCCESS) {
+		printf("EnableTraceEx2 failed with error %d\n", status);
+		ControlTraceSession(FALSE, 0, Session);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+// Ƚٹرաֻ򿪴󼶱𡢴мʱÿĿ
+// ʹɲԣԽָԭĲ
+BOOLEAN
+PerformTraceBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+)
+{
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	TRACEHANDLE session = 0;
+	ULONG bytesReturned;
+	BOOLEAN result;
+
+	if (Count == 0) {
+		Count = TRACE_BENCH_COUNT;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_COMPLETION_POLICY,
+		NULL,
+		0,
+		&savedPolicy,
+		sizeof(savedPolicy),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	policy = savedPolicy;
+	policy.Mode = EchoCompletionImmediate;
+	if (!SetCompletionPolicy(hDevice, &policy)) {
+		return FALSE;
+	}
+
+	printf("Trace overhead benchmark: %d writes and reads of %d bytes\n", Count, TRACE_BENCH_LENGTH);
+
+	// 1 ûиٻỰ
+	result = RunTraceBenchmark(hDevice, "Tracing disabled", Count);
+
+	// 2 б־ֻ¼󣬶дصеĸڸʽ֮ǰ
+	if (result && ControlTraceSession(TRUE, TRACE_LEVEL_ERROR, &session)) {
+		result = RunTraceBenchmark(hDevice, "Tracing enabled, level ERROR", Count);
+		ControlTraceSession(FALSE, 0, &session);
+
+		// 3 б־ͼÿ󶼼¼
+		if (result && ControlTraceSession(TRUE, TRACE_LEVEL_VERBOSE, &session)) {
+			result = RunTraceBenchmark(hDevice, "Tracing enabled, level VERBOSE", Count);
+			ControlTraceSession(FALSE, 0, &session);
+		}
+	}
+	else if (result) {
+		printf("Could not start a trace session, run as administrator to measure enabled tracing\n");
+	}
+
+	SetCompletionPolicy(hDevice, &savedPolicy);
+
+	return result;
+}
+
+// ȴж̵߳Ĳͽ
+typedef struct _READ_WAIT_TEST {
+	HANDLE hDevice;
+	BOOLEAN Wait;			// TRUEʱеȴݣFALSEʱͶѯ
+	volatile BOOLEAN Stop;	// д̳߳ʱ֪ͨ߳˳
+	ULONG Count;
+	HANDLE ArmedEvent;		// ߳̿ʼȴε
+	HANDLE DoneEvent;		// ̶߳˱ε
+	LONGLONG ReadDone;		// ʱܼ
+	ULONG ReadsIssued;
+	ULONG Errors;
+} READ_WAIT_TEST, *PREAD_WAIT_TEST;
+
+// ȴԵĶ߳
+// ÿηһ֪ͨд̣߳дʱ¼ɵʱ
+ULONG
+ReadWaitTestReader(
+	PVOID ThreadParameter
+)
+{
+	PREAD_WAIT_TEST test = (PREAD_WAIT_TEST)ThreadParameter;
+	UCHAR readBuffer[READ_WAIT_BENCH_LENGTH];
+	OVERLAPPED readOv;
+	LARGE_INTEGER now;
+	ULONG bytesReturned;
+	BOOLEAN armed;
+	ULONG i;
+
+	ZeroMemory(&readOv, sizeof(readOv));
+
+	readOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (readOv.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		test->Errors++;
+		SetEvent(test->ArmedEvent);
+		return 0;
+	}
+
+	for (i = 0; i < test->Count && !test->Stop; i++) {
+
+		armed = FALSE;
+		bytesReturned = 0;
+
+		// ȴģʽ¶й֪ͨд߳ʱѾ
+		// ѯģʽ¶0ֽʱٶ
+		do {
+			test->ReadsIssued++;
+
+			if (!ReadFile(test->hDevice, readBuffer, sizeof(readBuffer), NULL, &readOv) &&
+				GetLastError() != ERROR_IO_PENDING) {
+				test->Errors++;
+				break;
+			}
+
+			if (!armed) {
+				SetEvent(test->ArmedEvent);
+				armed = TRUE;
+			}
+
+			if (!GetOverlappedResult(test->hDevice, &readOv, &bytesReturned, TRUE)) {
+				test->Errors++;
+				break;
+			}
+		} WHILE(bytesReturned == 0 && !test->Wait && !test->Stop);
+
+		QueryPerformanceCounter(&now);
+		test->ReadDone = now.QuadPart;
+
+		if (bytesReturned != sizeof(readBuffer)) {
+			test->Errors++;
+		}
+
+		SetEvent(test->DoneEvent);
+
+		if (test->Errors != 0) {
+			break;
+		}
+	}
+
+	// ˳ʱд߳̿ڵȴһε֪ͨ
+	SetEvent(test->ArmedEvent);
+
+	CloseHandle(readOv.hEvent);
+
+	return 0;
+}
+
+// һֶģʽдCount
+// ӡдɵɵƽӳ١ÿλԷĶͶ̵߳CPUʱ
+// дڶ߳̿ʼȴ1ms󷢳ȴģʽ¶ʱй
+BOOLEAN
+RunReadWaitBenchmark(
+	IN HANDLE hDevice,
+	IN BOOLEAN Wait,
+	IN ULONG Count
+)
+{
+	READ_WAIT_TEST test;
+	ECHO_READ_WAIT readWait;
+	UCHAR writeBuffer[READ_WAIT_BENCH_LENGTH];
+	OVERLAPPED writeOv;
+	LARGE_INTEGER frequency, now;
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	ULARGE_INTEGER kernel, user;
+	HANDLE thread = NULL;
+	ULONG bytesReturned;
+	ULONG i;
+	double latencyUs;
+	double totalUs = 0;
+	double maxUs = 0;
+	BOOLEAN result = TRUE;
+
+	ZeroMemory(&test, sizeof(test));
+	ZeroMemory(&writeOv, sizeof(writeOv));
+
+	test.hDevice = hDevice;
+	test.Wait = Wait;
+	test.Count = Count;
+
+	FillMemory(writeBuffer, sizeof(writeBuffer), 0x5a);
+
+	test.ArmedEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	test.DoneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	writeOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (test.ArmedEvent == NULL || test.DoneEvent == NULL || writeOv.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	// ֻԸþ򿪻رնȴһֱȴֱ
+	readWait.Enable = Wait;
+	readWait.TimeoutMs = 0;
+
+	if ((!DeviceIoControl(hDevice,
+		IOCTL_ECHO_SET_READ_WAIT,
+		&readWait,
+		sizeof(readWait),
+		NULL,
+		0,
+		NULL,
+		&writeOv) &&
+		GetLastError() != ERROR_IO_PENDING) ||
+		!GetOverlappedResult(hDevice, &writeOv, &bytesReturned, TRUE)) {
+
+		printf("IOCTL_ECHO_SET_READ_WAIT failed: Error %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	QueryPerformanceFrequency(&frequency);
+
+	thread = CreateThread(NULL,
+		0,
+		(LPTHREAD_START_ROUTINE)ReadWaitTestReader,
+		&test,
+		0,
+		NULL);
+
+	if (thread == NULL) {
+		printf("Couldn't create reader thread - error %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	for (i = 0; i < Count; i++) {
+
+		WaitForSingleObject(test.ArmedEvent, INFINITE);
+		if (test.Errors != 0) {
+			break;
+		}
+
+		Sleep(1);
+
+		if ((!WriteFile(hDevice, writeBuffer, sizeof(writeBuffer), NULL, &writeOv) &&
+			GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(hDevice, &writeOv, &bytesReturned, TRUE)) {
+			printf("WriteFile failed with error 0x%x\n", GetLastError());
+			result = FALSE;
+			break;
+		}
+
+		QueryPerformanceCounter(&now);
+
+		WaitForSingleObject(test.DoneEvent, INFINITE);
+
+		// д֮ǰѶ󣬶дɣʱӳټΪ0
+		latencyUs = (double)(test.ReadDone - now.QuadPart) * 1e6 / frequency.QuadPart;
+		if (latencyUs < 0) {
+			latencyUs = 0;
+		}
+
+		totalUs += latencyUs;
+		if (latencyUs > maxUs) {
+			maxUs = latencyUs;
+		}
+	}
+
+	if (!result) {
+		// дʧʱ߳ڵȴȡĶ
+		test.Stop = TRUE;
+		CancelIoEx(hDevice, NULL);
+	}
+
+	WaitForSingleObject(thread, INFINITE);
+
+	if (test.Errors != 0) {
+		printf("Reader failed with %d errors\n", test.Errors);
+		result = FALSE;
+	}
+
+	if (result && Count != 0) {
+		GetThreadTimes(thread, &creationTime, &exitTime, &kernelTime, &userTime);
+		kernel.LowPart = kernelTime.dwLowDateTime;
+		kernel.HighPart = kernelTime.dwHighDateTime;
+		user.LowPart = userTime.dwLowDateTime;
+		user.HighPart = userTime.dwHighDateTime;
+
+		printf("%-16s avg %8.1f us  max %8.1f us  %10.1f reads/echo  reader CPU %8.1f ms\n",
+			Wait ? "Waiting reads" : "Polling reads",
+			totalUs / Count,
+			maxUs,
+			(double)test.ReadsIssued / Count,
+			(kernel.QuadPart + user.QuadPart) / 10000.0);
+	}
+
+exit:
+	if (thread != NULL) {
+		CloseHandle(thread);
+	}
+
+	if (test.ArmedEvent != NULL) {
+		CloseHandle(test.ArmedEvent);
+	}
+
+	if (test.DoneEvent != NULL) {
+		CloseHandle(test.DoneEvent);
+	}
+
+	if (writeOv.hEvent != NULL) {
+		CloseHandle(writeOv.hEvent);
+	}
+
+	return result;
+}
+
+// һʹ˽ͨصϱȽѯ͵ȴ
+// ʹɲԣԽָԭĲ
+BOOLEAN
+PerformReadWaitBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+)
+{
+	WCHAR channelPath[MAX_DEVPATH_LENGTH];
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	HANDLE hChannel;
+	ULONG bytesReturned;
+	BOOLEAN result;
+	HRESULT hr;
+
+	if (Count == 0) {
+		Count = READ_WAIT_BENCH_COUNT;
+	}
+
+	hr = StringCchPrintf(channelPath, MAX_DEVPATH_LENGTH, L"%ws%ws", G_DevicePath, ECHO_PRIVATE_CHANNEL_NAME);
+	if (FAILED(hr)) {
+		printf("Error: StringCchPrintf failed with HRESULT 0x%x", hr);
+		return FALSE;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_COMPLETION_POLICY,
+		NULL,
+		0,
+		&savedPolicy,
+		sizeof(savedPolicy),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	hChannel = CreateFile(channelPath,
+		GENERIC_WRITE | GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED,
+		NULL);
+
+	if (hChannel == INVALID_HANDLE_VALUE) {
+		printf("Cannot open %ws error %d\n", channelPath, GetLastError());
+		return FALSE;
+	}
+
+	policy = savedPolicy;
+	policy.Mode = EchoCompletionImmediate;
+	if (!SetCompletionPolicy(hDevice, &policy)) {
+		CloseHandle(hChannel);
+		return FALSE;
+	}
+
+	printf("Read wait benchmark: %d writes of %d bytes, each 1 ms after the reader starts reading\n",
+		Count, READ_WAIT_BENCH_LENGTH);
+
+	result = RunReadWaitBenchmark(hChannel, FALSE, Count);
+	if (result) {
+		result = RunReadWaitBenchmark(hChannel, TRUE, Count);
+	}
+
+	SetCompletionPolicy(hDevice, &savedPolicy);
+
+	CloseHandle(hChannel);
+
+	return result;
+}
+
+// 㲥һ
+typedef struct _BROADCAST_READER {
+	OVERLAPPED Ov;
+	UCHAR Buffer[BROADCAST_BENCH_LENGTH];
+} BROADCAST_READER, *PBROADCAST_READER;
+
+// ÿдǰReadersصеȴݣһдӦж
+// ӡдƽʱ䣨ߵĿʹӷджɵƽʱ
+BOOLEAN
+RunBroadcastBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Readers,
+	IN ULONG Count
+)
+{
+	PBROADCAST_READER readers;
+	HANDLE events[BROADCAST_BENCH_MAX_READERS];
+	UCHAR writeBuffer[BROADCAST_BENCH_LENGTH];
+	OVERLAPPED writeOv;
+	LARGE_INTEGER frequency, start, written, delivered;
+	LONGLONG writeTicks = 0;
+	LONGLONG deliverTicks = 0;
+	ULONG bytesReturned;
+	ULONG i, j;
+	BOOLEAN result = TRUE;
+
+	readers = (PBROADCAST_READER)calloc(Readers, sizeof(BROADCAST_READER));
+	if (readers == NULL) {
+		printf("Could not allocate %d readers\n", Readers);
+		return FALSE;
+	}
+
+	ZeroMemory(&writeOv, sizeof(writeOv));
+
+	writeOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (writeOv.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	for (j = 0; j < Readers; j++) {
+		readers[j].Ov.hEvent = events[j] = CreateEvent(NULL, TRUE, FALSE, NULL);
+		if (events[j] == NULL) {
+			printf("CreateEvent failed %d\n", GetLastError());
+			result = FALSE;
+			goto exit;
+		}
+	}
+
+	QueryPerformanceFrequency(&frequency);
+
+	for (i = 0; i < Count && result; i++) {
+
+		// зַʱReadFile֮ǰй
+		for (j = 0; j < Readers; j++) {
+			if (!ReadFile(hDevice, readers[j].Buffer, BROADCAST_BENCH_LENGTH, NULL, &readers[j].Ov) &&
+				GetLastError() != ERROR_IO_PENDING) {
+				printf("ReadFile failed with error 0x%x\n", GetLastError());
+				result = FALSE;
+				break;
+			}
+		}
+
+		if (!result) {
+			CancelIoEx(hDevice, NULL);
+			if (j != 0) {
+				WaitForMultipleObjects(j, events, TRUE, INFINITE);
+			}
+			break;
+		}
+
+		FillMemory(writeBuffer, sizeof(writeBuffer), (UCHAR)i);
+
+		QueryPerformanceCounter(&start);
+
+		if ((!WriteFile(hDevice, writeBuffer, sizeof(writeBuffer), NULL, &writeOv) &&
+			GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(hDevice, &writeOv, &bytesReturned, TRUE)) {
+			printf("WriteFile failed with error 0x%x\n", GetLastError());
+			CancelIoEx(hDevice, NULL);
+			WaitForMultipleObjects(Readers, events, TRUE, INFINITE);
+			result = FALSE;
+			break;
+		}
+
+		QueryPerformanceCounter(&written);
+
+		WaitForMultipleObjects(Readers, events, TRUE, INFINITE);
+
+		QueryPerformanceCounter(&delivered);
+
+		writeTicks += written.QuadPart - start.QuadPart;
+		deliverTicks += delivered.QuadPart - start.QuadPart;
+
+		for (j = 0; j < Readers; j++) {
+			if (!GetOverlappedResult(hDevice, &readers[j].Ov, &bytesReturned, FALSE) ||
+				bytesReturned != BROADCAST_BENCH_LENGTH ||
+				memcmp(readers[j].Buffer, writeBuffer, BROADCAST_BENCH_LENGTH) != 0) {
+				printf("Reader %d of write %d did not receive the broadcast (%d bytes)\n", j, i, bytesReturned);
+				result = FALSE;
+				break;
+			}
+		}
+	}
+
+	if (result && Count != 0) {
+		printf("%4d readers  write %8.2f us  all reads done %8.2f us\n",
+			Readers,
+			(double)writeTicks * 1e6 / frequency.QuadPart / Count,
+			(double)deliverTicks * 1e6 / frequency.QuadPart / Count);
+	}
+
+exit:
+	for (j = 0; j < Readers; j++) {
+		if (readers[j].Ov.hEvent != NULL) {
+			CloseHandle(readers[j].Ov.hEvent);
+		}
+	}
+
+	if (writeOv.hEvent != NULL) {
+		CloseHandle(writeOv.hEvent);
+	}
+
+	free(readers);
+
+	return result;
+}
+
+// һʹ˽ͨصϴ򿪶ȴ͹㲥1864
+// ʹɲԣԽָԭĲ
+BOOLEAN
+PerformBroadcastBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+)
+{
+	static const ULONG readerCounts[] = { 1, 8, BROADCAST_BENCH_MAX_READERS };
+	WCHAR channelPath[MAX_DEVPATH_LENGTH];
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	ECHO_READ_WAIT readWait;
+	ECHO_BROADCAST_CONFIG broadcast;
+	OVERLAPPED ov;
+	HANDLE hChannel;
+	ULONG bytesReturned;
+	ULONG i;
+	BOOLEAN result = TRUE;
+	HRESULT hr;
+
+	if (Count == 0) {
+		Count = BROADCAST_BENCH_COUNT;
+	}
+
+	hr = StringCchPrintf(channelPath, MAX_DEVPATH_LENGTH, L"%ws%ws", G_DevicePath, ECHO_PRIVATE_CHANNEL_NAME);
+	if (FAILED(hr)) {
+		printf("Error: StringCchPrintf failed with HRESULT 0x%x", hr);
+		return FALSE;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_COMPLETION_POLICY,
+		NULL,
+		0,
+		&savedPolicy,
+		sizeof(savedPolicy),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	hChannel = CreateFile(channelPath,
+		GENERIC_WRITE | GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED,
+		NULL);
+
+	if (hChannel == INVALID_HANDLE_VALUE) {
+		printf("Cannot open %ws error %d\n", channelPath, GetLastError());
+		return FALSE;
+	}
+
+	ZeroMemory(&ov, sizeof(ov));
+	ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (ov.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		CloseHandle(hChannel);
+		return FALSE;
+	}
+
+	readWait.Enable = TRUE;
+	readWait.TimeoutMs = 0;
+	broadcast.Enable = TRUE;
+
+	if ((!DeviceIoControl(hChannel, IOCTL_ECHO_SET_READ_WAIT, &readWait, sizeof(readWait), NULL, 0, NULL, &ov) &&
+		GetLastError() != ERROR_IO_PENDING) ||
+		!GetOverlappedResult(hChannel, &ov, &bytesReturned, TRUE) ||
+		(!DeviceIoControl(hChannel, IOCTL_ECHO_SET_BROADCAST, &broadcast, sizeof(broadcast), NULL, 0, NULL, &ov) &&
+		GetLastError() != ERROR_IO_PENDING) ||
+		!GetOverlappedResult(hChannel, &ov, &bytesReturned, TRUE)) {
+
+		printf("Enabling read wait and broadcast failed: Error %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	policy = savedPolicy;
+	policy.Mode = EchoCompletionImmediate;
+	if (!SetCompletionPolicy(hDevice, &policy)) {
+		result = FALSE;
+		goto exit;
+	}
+
+	printf("Broadcast benchmark: %d writes of %d bytes for each number of readers\n", Count, BROADCAST_BENCH_LENGTH);
+
+	for (i = 0; i < RTL_NUMBER_OF(readerCounts) && result; i++) {
+		result = RunBroadcastBenchmark(hChannel, readerCounts[i], Count);
+	}
+
+	SetCompletionPolicy(hDevice, &savedPolicy);
+
+exit:
+	CloseHandle(ov.hEvent);
+	CloseHandle(hChannel);
+
+	return result;
+}
+
+// ʱֲһIOCTL_ECHO_DELAY
+typedef struct _WHEEL_REQUEST {
+	OVERLAPPED Ov;
+	ECHO_REQUEST_DELAY Delay;
+	LARGE_INTEGER IssueTime;
+} WHEEL_REQUEST, *PWHEEL_REQUEST;
+
+// һηCountIOCTL_ECHO_DELAYӳ(0, WHEEL_BENCH_MAX_DELAY_US]ھȷֲ˳ң
+// ͨɶ˿ջȫ
+// ӡƽÿķʱ䡢ԼʵʱʱƽӺ
+// ʱֵĲ͵ڶO(1)ʱʱӺӦ
+BOOLEAN
+RunWheelBenchmark(
+	IN HANDLE hDevice,
+	IN HANDLE hPort,
+	IN PWHEEL_REQUEST Requests,
+	IN ULONG Count
+)
+{
+	LARGE_INTEGER frequency, start, issued, now;
+	LONGLONG lateTicks = 0;
+	LONGLONG maxLateTicks = 0;
+	LONGLONG late;
+	LPOVERLAPPED ov;
+	PWHEEL_REQUEST request;
+	ULONG_PTR key;
+	DWORD bytesReturned;
+	ULONG i;
+	ULONG outstanding = 0;
+	ULONG failed = 0;
+
+	QueryPerformanceFrequency(&frequency);
+
+	QueryPerformanceCounter(&start);
+
+	for (i = 0; i < Count; i++) {
+		request = &Requests[i];
+
+		ZeroMemory(&request->Ov, sizeof(request->Ov));
+		request->Delay.DelayUs = (ULONG)(((ULONGLONG)(i + 1) * 7919 % Count + 1) * WHEEL_BENCH_MAX_DELAY_US / Count);
+		QueryPerformanceCounter(&request->IssueTime);
+
+		if (!DeviceIoControl(hDevice, IOCTL_ECHO_DELAY, &request->Delay, sizeof(request->Delay), NULL, 0, NULL, &request->Ov) &&
+			GetLastError() != ERROR_IO_PENDING) {
+			printf("IOCTL_ECHO_DELAY failed with error %d\n", GetLastError());
+			failed++;
+			break;
+		}
+
+		outstanding++;
+	}
+
+	QueryPerformanceCounter(&issued);
+
+	now = issued;
+
+	while (outstanding != 0) {
+		if (!GetQueuedCompletionStatus(hPort, &bytesReturned, &key, &ov, INFINITE)) {
+			if (ov == NULL) {
+				printf("GetQueuedCompletionStatus failed with error %d\n", GetLastError());
+				return FALSE;
+			}
+			failed++;
+		}
+
+		QueryPerformanceCounter(&now);
+
+		outstanding--;
+
+		request = CONTAINING_RECORD(ov, WHEEL_REQUEST, Ov);
+		late = now.QuadPart - request->IssueTime.QuadPart - (LONGLONG)request->Delay.DelayUs * frequency.QuadPart / 1000000;
+		if (late < 0) {
+			printf("Request with delay %d us completed %.2f us early\n",
+				request->Delay.DelayUs, (double)-late * 1e6 / frequency.QuadPart);
+			failed++;
+		}
+
+		lateTicks += late;
+		if (late > maxLateTicks) {
+			maxLateTicks = late;
+		}
+	}
+
+	if (failed != 0) {
+		return FALSE;
+	}
+
+	printf("%6d requests  issue %6.2f us/req  %10.0f req/s  late avg %8.2f us  max %8.2f us\n",
+		Count,
+		(double)(issued.QuadPart - start.QuadPart) * 1e6 / frequency.QuadPart / Count,
+		(double)Count * frequency.QuadPart / (now.QuadPart - start.QuadPart),
+		(double)lateTicks * 1e6 / frequency.QuadPart / Count,
+		(double)maxLateTicks * 1e6 / frequency.QuadPart);
+
+	return TRUE;
+}
+
+// һص10248192Countͬʱʱ
+BOOLEAN
+PerformWheelBenchmark(
+	IN ULONG Count
+)
+{
+	ULONG counts[3] = { 1024, 8192, 0 };
+	PWHEEL_REQUEST requests;
+	HANDLE hDevice;
+	HANDLE hPort;
+	ULONG i;
+	BOOLEAN result = TRUE;
+
+	if (Count == 0) {
+		Count = WHEEL_BENCH_COUNT;
+	}
+
+	counts[2] = Count;
+
+	requests = (PWHEEL_REQUEST)calloc(Count, sizeof(WHEEL_REQUEST));
+	if (requests == NULL) {
+		printf("Could not allocate %d requests\n", Count);
+		return FALSE;
+	}
+
+	hDevice = CreateFile(G_DevicePath,
+		GENERIC_WRITE | GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED,
+		NULL);
+
+	if (hDevice == INVALID_HANDLE_VALUE) {
+		printf("Cannot open %ws error %d\n", G_DevicePath, GetLastError());
+		free(requests);
+		return FALSE;
+	}
+
+	hPort = CreateIoCompletionPort(hDevice, NULL, 0, 1);
+	if (hPort == NULL) {
+		printf("CreateIoCompletionPort failed with error %d\n", GetLastError());
+		CloseHandle(hDevice);
+		free(requests);
+		return FALSE;
+	}
+
+	printf("Timer wheel benchmark: delays spread over (0, %d] us\n", WHEEL_BENCH_MAX_DELAY_US);
+
+	for (i = 0; i < RTL_NUMBER_OF(counts) && result; i++) {
+		// Countǰһͬ
+		if (counts[i] > Count || (i != 0 && counts[i] == counts[i - 1])) {
+			continue;
+		}
+		result = RunWheelBenchmark(hDevice, hPort, requests, counts[i]);
+	}
+
+	CloseHandle(hPort);
+	CloseHandle(hDevice);
+	free(requests);
+
+	return result;
+}
+
+// Config´ɶʱJITTER_BENCH_SECONDSȡӡֲ
+BOOLEAN
+RunJitterBenchmark(
+	IN HANDLE hDevice,
+	IN PCSTR Name,
+	IN PECHO_TIMER_CONFIG Config
+)
+{
+	ECHO_TIMER_JITTER jitter;
+	ULONG flags = ECHO_STATS_FLAG_RESET;
+	ULONG bytesReturned;
+	ULONG i;
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_SET_TIMER,
+		Config,
+		sizeof(ECHO_TIMER_CONFIG),
+		NULL,
+		0,
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_SET_TIMER failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	Sleep(JITTER_BENCH_SECONDS * 1000);
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_TIMER_JITTER,
+		&flags,
+		sizeof(flags),
+		&jitter,
+		sizeof(jitter),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_TIMER_JITTER failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	printf("%s: %llu fires, %llu early, %llu missed periods, late avg %.2f us max %llu us\n",
+		Name,
+		jitter.Fires,
+		jitter.Early,
+		jitter.Missed,
+		(jitter.Fires != 0) ? (double)jitter.TotalLateUs / jitter.Fires : 0.0,
+		jitter.MaxLateUs);
+
+	for (i = 0; i < ECHO_STATS_LATENCY_BUCKETS; i++) {
+		if (jitter.Histogram[i] != 0) {
+			printf("  %10llu us - %10llu us %12llu\n",
+				(i == 0) ? 0ULL : (1ULL << i),
+				(1ULL << (i + 1)) - 1,
+				jitter.Histogram[i]);
+		}
+	}
+
+	return TRUE;
+}
+
+// PeriodUsΪڣβͨʱƳٵͨʱ͸߾ȶʱĴ
+// ԽָԭĶʱ
+BOOLEAN
+PerformJitterBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG PeriodUs
+)
+{
+	ECHO_TIMER_JITTER saved;
+	ECHO_TIMER_CONFIG config;
+	ULONG bytesReturned;
+	BOOLEAN result;
+
+	if (PeriodUs < ECHO_TIMER_MIN_PERIOD_US) {
+		PeriodUs = JITTER_BENCH_PERIOD_US;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_TIMER_JITTER,
+		NULL,
+		0,
+		&saved,
+		sizeof(saved),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_TIMER_JITTER failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	printf("Timer jitter benchmark: period %d us, %d s for each timer\n", PeriodUs, JITTER_BENCH_SECONDS);
+
+	config.PeriodUs = PeriodUs;
+	config.HighResolution = FALSE;
+	config.TolerableDelayMs = 0;
+	result = RunJitterBenchmark(hDevice, "Default resolution", &config);
+
+	if (result) {
+		config.TolerableDelayMs = JITTER_BENCH_TOLERABLE_DELAY_MS;
+		result = RunJitterBenchmark(hDevice, "Default resolution, tolerable delay", &config);
+	}
+
+	if (result) {
+		config.HighResolution = TRUE;
+		config.TolerableDelayMs = 0;
+		result = RunJitterBenchmark(hDevice, "High resolution", &config);
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_SET_TIMER,
+		&saved.Config,
+		sizeof(saved.Config),
+		NULL,
+		0,
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_SET_TIMER failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	return result;
+}
+
+// ģʽ̵߳Ĳͽ
+typedef struct _PIPE_TEST {
+	HANDLE hDevice;
+	ULONG WriteLength;		// ÿдĳ
+	ULONGLONG TotalBytes;	// д롢߶ȡֽ
+	volatile LONG Errors;
+} PIPE_TEST, *PPIPE_TEST;
+
+// ģʽеOffsetֽڵֵ2512ݣݴλʱܱ
+#define PIPE_PATTERN(Offset)	((UCHAR)((Offset) % 251))
+
+// ̣߳дTotalBytesֽڣFIFOʱдйֱ߶
+ULONG
+PipeProducer(
+	PVOID ThreadParameter
+)
+{
+	PPIPE_TEST test = (PPIPE_TEST)ThreadParameter;
+	PUCHAR buffer;
+	OVERLAPPED ov;
+	ULONGLONG offset = 0;
+	ULONG length;
+	ULONG bytesReturned;
+	ULONG i;
+
+	buffer = (PUCHAR)malloc(test->WriteLength);
+	if (buffer == NULL) {
+		printf("Could not allocate %d bytes\n", test->WriteLength);
+		InterlockedIncrement(&test->Errors);
+		return 0;
+	}
+
+	ZeroMemory(&ov, sizeof(ov));
+	ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (ov.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		InterlockedIncrement(&test->Errors);
+		free(buffer);
+		return 0;
+	}
+
+	while (offset < test->TotalBytes && test->Errors == 0) {
+
+		length = (ULONG)min(test->WriteLength, test->TotalBytes - offset);
+		for (i = 0; i < length; i++) {
+			buffer[i] = PIPE_PATTERN(offset + i);
+		}
+
+		if ((!WriteFile(test->hDevice, buffer, length, NULL, &ov) &&
+			GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(test->hDevice, &ov, &bytesReturned, TRUE) ||
+			bytesReturned != length) {
+			printf("WriteFile failed with error 0x%x\n", GetLastError());
+			InterlockedIncrement(&test->Errors);
+			break;
+		}
+
+		offset += length;
+	}
+
+	CloseHandle(ov.hEvent);
+	free(buffer);
+
+	return 0;
+}
+
+// ߳ÿдWriteLengthֽڣǰ߳ΪÿζȡPIPE_BENCH_READ_LENGTHֽڲУ
+// ӡʱдFIFOȴĴ
+BOOLEAN
+RunPipeBenchmark(
+	IN HANDLE hDevice,
+	IN HANDLE hChannel,
+	IN ULONG WriteLength,
+	IN ULONGLONG TotalBytes
+)
+{
+	PIPE_TEST test;
+	ECHO_STATS before, after;
+	PUCHAR buffer;
+	OVERLAPPED ov;
+	HANDLE thread;
+	LARGE_INTEGER frequency, start, end;
+	ULONGLONG offset = 0;
+	ULONG bytesReturned;
+	ULONG flags = 0;
+	ULONG i;
+	double seconds;
+
+	buffer = (PUCHAR)malloc(PIPE_BENCH_READ_LENGTH);
+	if (buffer == NULL) {
+		printf("Could not allocate %d bytes\n", PIPE_BENCH_READ_LENGTH);
+		return FALSE;
+	}
+
+	ZeroMemory(&ov, sizeof(ov));
+	ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (ov.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		free(buffer);
+		return FALSE;
+	}
+
+	if (!DeviceIoControl(hDevice, IOCTL_ECHO_GET_STATS, &flags, sizeof(flags), &before, sizeof(before), &bytesReturned, NULL)) {
+		ZeroMemory(&before, sizeof(before));
+	}
+
+	test.hDevice = hChannel;
+	test.WriteLength = WriteLength;
+	test.TotalBytes = TotalBytes;
+	test.Errors = 0;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	thread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)PipeProducer, &test, 0, NULL);
+	if (thread == NULL) {
+		printf("Couldn't create producer thread - error %d\n", GetLastError());
+		CloseHandle(ov.hEvent);
+		free(buffer);
+		return FALSE;
+	}
+
+	// ˶ȴFIFOΪʱеȴ
+	while (offset < TotalBytes && test.Errors == 0) {
+
+		if ((!ReadFile(hChannel, buffer, PIPE_BENCH_READ_LENGTH, NULL, &ov) &&
+			GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(hChannel, &ov, &bytesReturned, TRUE)) {
+			printf("ReadFile failed with error 0x%x\n", GetLastError());
+			InterlockedIncrement(&test.Errors);
+			break;
+		}
+
+		for (i = 0; i < bytesReturned; i++) {
+			if (buffer[i] != PIPE_PATTERN(offset + i)) {
+				printf("Data mismatch at offset %llu\n", offset + i);
+				InterlockedIncrement(&test.Errors);
+				break;
+			}
+		}
+
+		offset += bytesReturned;
+	}
+
+	QueryPerformanceCounter(&end);
+
+	// ʱȡ߹д
+	if (test.Errors != 0) {
+		CancelIoEx(hChannel, NULL);
+	}
+
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+	CloseHandle(ov.hEvent);
+	free(buffer);
+
+	if (test.Errors != 0) {
+		return FALSE;
+	}
+
+	if (!DeviceIoControl(hDevice, IOCTL_ECHO_GET_STATS, &flags, sizeof(flags), &after, sizeof(after), &bytesReturned, NULL)) {
+		ZeroMemory(&after, sizeof(after));
+	}
+
+	seconds = (double)(end.QuadPart - start.QuadPart) / frequency.QuadPart;
+
+	printf("%8d byte writes  %10.1f MB/s  %10llu write waits\n",
+		WriteLength,
+		TotalBytes / (1024.0 * 1024.0) / seconds,
+		after.WriteWaits - before.WriteWaits);
+
+	return TRUE;
+}
+
+// һʹ˽ͨصϴģʽͶȴԲͬд볤Ȳߺ֮ĳ
+// ʹɲԣԽָԭĲ
+BOOLEAN
+PerformPipeBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Megabytes
+)
+{
+	static const ULONG writeLengths[] = { 512, 4 * 1024, 64 * 1024, 1024 * 1024 };
+	WCHAR channelPath[MAX_DEVPATH_LENGTH];
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	ECHO_READ_WAIT readWait;
+	ECHO_STREAM_CONFIG stream;
+	OVERLAPPED ov;
+	HANDLE hChannel;
+	ULONG bytesReturned;
+	ULONG i;
+	BOOLEAN result = TRUE;
+	HRESULT hr;
+
+	if (Megabytes == 0) {
+		Megabytes = PIPE_BENCH_MEGABYTES;
+	}
+
+	hr = StringCchPrintf(channelPath, MAX_DEVPATH_LENGTH, L"%ws%ws", G_DevicePath, ECHO_PRIVATE_CHANNEL_NAME);
+	if (FAILED(hr)) {
+		printf("Error: StringCchPrintf failed with HRESULT 0x%x", hr);
+		return FALSE;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_COMPLETION_POLICY,
+		NULL,
+		0,
+		&savedPolicy,
+		sizeof(savedPolicy),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	// ߺͬʱϵȴص
+	hChannel = CreateFile(channelPath,
+		GENERIC_WRITE | GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED,
+		NULL);
+
+	if (hChannel == INVALID_HANDLE_VALUE) {
+		printf("Cannot open %ws error %d\n", channelPath, GetLastError());
+		return FALSE;
+	}
+
+	ZeroMemory(&ov, sizeof(ov));
+	ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (ov.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		CloseHandle(hChannel);
+		return FALSE;
+	}
+
+	readWait.Enable = TRUE;
+	readWait.TimeoutMs = 0;
+	stream.Enable = TRUE;
+
+	if ((!DeviceIoControl(hChannel, IOCTL_ECHO_SET_READ_WAIT, &readWait, sizeof(readWait), NULL, 0, NULL, &ov) &&
+		GetLastError() != ERROR_IO_PENDING) ||
+		!GetOverlappedResult(hChannel, &ov, &bytesReturned, TRUE) ||
+		(!DeviceIoControl(hChannel, IOCTL_ECHO_SET_STREAM, &stream, sizeof(stream), NULL, 0, NULL, &ov) &&
+		GetLastError() != ERROR_IO_PENDING) ||
+		!GetOverlappedResult(hChannel, &ov, &bytesReturned, TRUE)) {
+
+		printf("Enabling read wait and stream mode failed: Error %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	policy = savedPolicy;
+	policy.Mode = EchoCompletionImmediate;
+	if (!SetCompletionPolicy(hDevice, &policy)) {
+		result = FALSE;
+		goto exit;
+	}
+
+	printf("Pipe benchmark: %d MB from a producer thread to a consumer thread reading %d bytes at a time\n",
+		Megabytes, PIPE_BENCH_READ_LENGTH);
+
+	for (i = 0; i < RTL_NUMBER_OF(writeLengths) && result; i++) {
+		result = RunPipeBenchmark(hDevice, hChannel, writeLengths[i], (ULONGLONG)Megabytes * 1024 * 1024);
+	}
+
+	SetCompletionPolicy(hDevice, &savedPolicy);
+
+exit:
+	CloseHandle(ov.hEvent);
+	CloseHandle(hChannel);
+
+	return result;
+}
+
+// һдеλãiԵдǰصݽ
+#define BATCH_PAIR_OFFSET(i)	((i) * 2 * BATCH_BENCH_LENGTH)
+
+// ÿһдһIRPһд
+// 㿽ģʽдֱȡݣصʽ
+BOOLEAN
+RunBatchBaseline(
+	IN HANDLE hChannel,
+	IN ULONG Count,
+	OUT double* OpsPerSecond
+)
+{
+	UCHAR writeBuffer[BATCH_BENCH_LENGTH];
+	UCHAR readBuffer[BATCH_BENCH_LENGTH];
+	OVERLAPPED writeOv;
+	OVERLAPPED readOv;
+	LARGE_INTEGER frequency, start, end;
+	ULONG bytesWritten;
+	ULONG bytesRead;
+	ULONG i;
+	BOOLEAN result = TRUE;
+
+	ZeroMemory(&writeOv, sizeof(writeOv));
+	ZeroMemory(&readOv, sizeof(readOv));
+	writeOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	readOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (writeOv.hEvent == NULL || readOv.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	for (i = 0; i < Count; i++) {
+
+		FillMemory(writeBuffer, sizeof(writeBuffer), (UCHAR)(i % 251));
+
+		if ((!WriteFile(hChannel, writeBuffer, sizeof(writeBuffer), NULL, &writeOv) && GetLastError() != ERROR_IO_PENDING) ||
+			(!ReadFile(hChannel, readBuffer, sizeof(readBuffer), NULL, &readOv) && GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(hChannel, &writeOv, &bytesWritten, TRUE) ||
+			!GetOverlappedResult(hChannel, &readOv, &bytesRead, TRUE)) {
+
+			printf("Write or read %d failed: Error %d\n", i, GetLastError());
+			result = FALSE;
+			goto exit;
+		}
+
+		if (bytesRead != sizeof(readBuffer) || memcmp(writeBuffer, readBuffer, sizeof(readBuffer)) != 0) {
+			printf("Read %d returned %d bytes of wrong data\n", i, bytesRead);
+			result = FALSE;
+			goto exit;
+		}
+	}
+
+	QueryPerformanceCounter(&end);
+
+	*OpsPerSecond = 2.0 * Count * frequency.QuadPart / (double)(end.QuadPart - start.QuadPart);
+
+	printf("%-28s %12.0f ops/s\n", "ReadFile/WriteFile", *OpsPerSecond);
+
+exit:
+	if (writeOv.hEvent != NULL) {
+		CloseHandle(writeOv.hEvent);
+	}
+	if (readOv.hEvent != NULL) {
+		CloseHandle(readOv.hEvent);
+	}
+
+	return result;
+}
+
+// ÿIOCTL_ECHO_BATCHִPairsдÿĽͶص
+BOOLEAN
+RunBatchBenchmark(
+	IN HANDLE hChannel,
+	IN ULONG Count,
+	IN ULONG Pairs,
+	IN double BaselineOpsPerSecond
+)
+{
+	ULONG opCount = 2 * Pairs;
+	ULONG dataOffset = (ULONG)ECHO_BATCH_DATA_OFFSET(opCount);
+	ULONG length = dataOffset + BATCH_PAIR_OFFSET(Pairs);
+	PECHO_BATCH batch;
+	PUCHAR data;
+	OVERLAPPED ov;
+	LARGE_INTEGER frequency, start, end;
+	ULONG bytesReturned;
+	ULONG calls = (Count + Pairs - 1) / Pairs;
+	ULONG call;
+	ULONG i;
+	double opsPerSecond;
+	CHAR name[64];
+	BOOLEAN result = TRUE;
+
+	batch = (PECHO_BATCH)malloc(length);
+	if (batch == NULL) {
+		printf("Failed to allocate %d bytes\n", length);
+		return FALSE;
+	}
+
+	ZeroMemory(&ov, sizeof(ov));
+	ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (ov.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		free(batch);
+		return FALSE;
+	}
+
+	data = (PUCHAR)batch + dataOffset;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	for (call = 0; call < calls; call++) {
+
+		// ѽдͬһÿд
+		batch->Count = opCount;
+		batch->Reserved = 0;
+
+		for (i = 0; i < Pairs; i++) {
+			batch->Ops[2 * i].Op = ECHO_BATCH_OP_WRITE;
+			batch->Ops[2 * i].Offset = BATCH_PAIR_OFFSET(i);
+			batch->Ops[2 * i].Length = BATCH_BENCH_LENGTH;
+			batch->Ops[2 * i + 1].Op = ECHO_BATCH_OP_READ;
+			batch->Ops[2 * i + 1].Offset = BATCH_PAIR_OFFSET(i) + BATCH_BENCH_LENGTH;
+			batch->Ops[2 * i + 1].Length = BATCH_BENCH_LENGTH;
+
+			FillMemory(data + BATCH_PAIR_OFFSET(i), BATCH_BENCH_LENGTH, (UCHAR)((call * Pairs + i) % 251));
+		}
+
+		if ((!DeviceIoControl(hChannel, IOCTL_ECHO_BATCH, batch, length, batch, length, NULL, &ov) &&
+			GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(hChannel, &ov, &bytesReturned, TRUE)) {
+
+			printf("IOCTL_ECHO_BATCH failed: Error %d\n", GetLastError());
+			result = FALSE;
+			goto exit;
+		}
+
+		for (i = 0; i < opCount; i++) {
+			if (batch->Ops[i].Status != 0 || batch->Ops[i].Information != BATCH_BENCH_LENGTH) {
+				printf("Batch operation %d returned status 0x%x with %d bytes\n", i, batch->Ops[i].Status, batch->Ops[i].Information);
+				result = FALSE;
+				goto exit;
+			}
+		}
+
+		for (i = 0; i < Pairs; i++) {
+			if (memcmp(data + BATCH_PAIR_OFFSET(i), data + BATCH_PAIR_OFFSET(i) + BATCH_BENCH_LENGTH, BATCH_BENCH_LENGTH) != 0) {
+				printf("Batch read %d returned wrong data\n", i);
+				result = FALSE;
+				goto exit;
+			}
+		}
+	}
+
+	QueryPerformanceCounter(&end);
+
+	opsPerSecond = 2.0 * calls * Pairs * frequency.QuadPart / (double)(end.QuadPart - start.QuadPart);
+
+	StringCchPrintfA(name, RTL_NUMBER_OF(name), "IOCTL_ECHO_BATCH x %d ops", opCount);
+	printf("%-28s %12.0f ops/s %8.2fx\n", name, opsPerSecond, opsPerSecond / BaselineOpsPerSecond);
+
+exit:
+	CloseHandle(ov.hEvent);
+	free(batch);
+
+	return result;
+}
+
+// ȽÿһReadFileWriteFileһIOCTL_ECHO_BATCHִжʱ64ֽдÿ
+// ˽ͨϲԣʹɲԣԽָԭĲ
+BOOLEAN
+PerformBatchBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+)
+{
+	static const ULONG batchPairs[] = { 1, 8, 64, BATCH_BENCH_MAX_PAIRS };
+	WCHAR channelPath[MAX_DEVPATH_LENGTH];
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	HANDLE hChannel;
+	ULONG bytesReturned;
+	ULONG i;
+	double baseline = 0;
+	BOOLEAN result;
+	HRESULT hr;
+
+	if (Count == 0) {
+		Count = BATCH_BENCH_COUNT;
+	}
+
+	hr = StringCchPrintf(channelPath, MAX_DEVPATH_LENGTH, L"%ws%ws", G_DevicePath, ECHO_PRIVATE_CHANNEL_NAME);
+	if (FAILED(hr)) {
+		printf("Error: StringCchPrintf failed with HRESULT 0x%x", hr);
+		return FALSE;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_COMPLETION_POLICY,
+		NULL,
+		0,
+		&savedPolicy,
+		sizeof(savedPolicy),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	hChannel = CreateFile(channelPath,
+		GENERIC_WRITE | GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED,
+		NULL);
+
+	if (hChannel == INVALID_HANDLE_VALUE) {
+		printf("Cannot open %ws error %d\n", channelPath, GetLastError());
+		return FALSE;
+	}
+
+	policy = savedPolicy;
+	policy.Mode = EchoCompletionImmediate;
+	if (!SetCompletionPolicy(hDevice, &policy)) {
+		CloseHandle(hChannel);
+		return FALSE;
+	}
+
+	printf("Batch benchmark: %d writes and reads of %d bytes\n", Count, BATCH_BENCH_LENGTH);
+
+	result = RunBatchBaseline(hChannel, Count, &baseline);
+
+	for (i = 0; i < RTL_NUMBER_OF(batchPairs) && result; i++) {
+		result = RunBatchBenchmark(hChannel, Count, batchPairs[i], baseline);
+	}
+
+	SetCompletionPolicy(hDevice, &savedPolicy);
+	CloseHandle(hChannel);
+
+	return result;
+}
+
+// һʹ˽ͨص
+HANDLE
+OpenPrivateChannel(
+	VOID
+)
+{
+	WCHAR channelPath[MAX_DEVPATH_LENGTH];
+	HANDLE hChannel;
+	HRESULT hr;
+
+	hr = StringCchPrintf(channelPath, MAX_DEVPATH_LENGTH, L"%ws%ws", G_DevicePath, ECHO_PRIVATE_CHANNEL_NAME);
+	if (FAILED(hr)) {
+		printf("Error: StringCchPrintf failed with HRESULT 0x%x", hr);
+		return INVALID_HANDLE_VALUE;
+	}
+
+	hChannel = CreateFile(channelPath,
+		GENERIC_WRITE | GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_OVERLAPPED,
+		NULL);
+
+	if (hChannel == INVALID_HANDLE_VALUE) {
+		printf("Cannot open %ws error %d\n", channelPath, GetLastError());
+	}
+
+	return hChannel;
+}
+
+// AsyncIoͬɶ˿ڷʽͬʱURING_BENCH_DEPTHдͶÿһٷһͬ
+// 򿪶ȴûʱÿȡһдURING_BENCH_LENGTHֽ
+BOOLEAN
+RunUringIocp(
+	IN ULONG Count,
+	OUT double* OpsPerSecond
+)
+{
+	HANDLE hChannel;
+	HANDLE hCompletionPort = NULL;
+	OVERLAPPED ovList[2 * URING_BENCH_DEPTH];
+	UCHAR buf[2 * URING_BENCH_DEPTH][URING_BENCH_LENGTH];
+	ECHO_READ_WAIT readWait;
+	LARGE_INTEGER frequency, start, end;
+	OVERLAPPED* completedOv;
+	ULONG_PTR key;
+	ULONG numberOfBytesTransferred;
+	ULONG bytesReturned;
+	ULONG writesToSend = Count;
+	ULONG readsToSend = Count;
+	ULONG remaining = 2 * Count;
+	ULONG i;
+	BOOLEAN result = TRUE;
+
+	hChannel = OpenPrivateChannel();
+	if (hChannel == INVALID_HANDLE_VALUE) {
+		return FALSE;
+	}
+
+	// ȴڹɶ˿֮ǰã¼ȴ
+	ZeroMemory(ovList, sizeof(ovList));
+	ovList[0].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (ovList[0].hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		CloseHandle(hChannel);
+		return FALSE;
+	}
+
+	readWait.Enable = 1;
+	readWait.TimeoutMs = 0;
+
+	if ((!DeviceIoControl(hChannel, IOCTL_ECHO_SET_READ_WAIT, &readWait, sizeof(readWait), NULL, 0, NULL, &ovList[0]) &&
+		GetLastError() != ERROR_IO_PENDING) ||
+		!GetOverlappedResult(hChannel, &ovList[0], &bytesReturned, TRUE)) {
+
+		printf("IOCTL_ECHO_SET_READ_WAIT failed: Error %d\n", GetLastError());
+		CloseHandle(ovList[0].hEvent);
+		CloseHandle(hChannel);
+		return FALSE;
+	}
+
+	CloseHandle(ovList[0].hEvent);
+	ZeroMemory(ovList, sizeof(ovList));
+
+	hCompletionPort = CreateIoCompletionPort(hChannel, NULL, 1, 0);
+	if (hCompletionPort == NULL) {
+		printf("Cannot open completion port %d \n", GetLastError());
+		CloseHandle(hChannel);
+		return FALSE;
+	}
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	// ǰURING_BENCH_DEPTHOVERLAPPEDдڶ
+	for (i = 0; i < 2 * URING_BENCH_DEPTH; i++) {
+
+		if (i < URING_BENCH_DEPTH) {
+			if (writesToSend == 0) {
+				continue;
+			}
+			writesToSend--;
+			FillMemory(buf[i], URING_BENCH_LENGTH, (UCHAR)i);
+			if (!WriteFile(hChannel, buf[i], URING_BENCH_LENGTH, NULL, &ovList[i]) && GetLastError() != ERROR_IO_PENDING) {
+				printf(" %dth Write failed %d \n", i, GetLastError());
+				result = FALSE;
+				goto exit;
+			}
+		}
+		else {
+			if (readsToSend == 0) {
+				continue;
+			}
+			readsToSend--;
+			if (!ReadFile(hChannel, buf[i], URING_BENCH_LENGTH, NULL, &ovList[i]) && GetLastError() != ERROR_IO_PENDING) {
+				printf(" %dth Read failed %d \n", i, GetLastError());
+				result = FALSE;
+				goto exit;
+			}
+		}
+	}
+
+	while (remaining != 0) {
+
+		if (GetQueuedCompletionStatus(hCompletionPort, &numberOfBytesTransferred, &key, &completedOv, INFINITE) == 0) {
+			printf("GetQueuedCompletionStatus failed %d\n", GetLastError());
+			result = FALSE;
+			goto exit;
+		}
+
+		remaining--;
+
+		if (numberOfBytesTransferred != URING_BENCH_LENGTH) {
+			printf("Request transferred %d bytes\n", numberOfBytesTransferred);
+			result = FALSE;
+			goto exit;
+		}
+
+		i = (ULONG)(completedOv - ovList);
+
+		if (i < URING_BENCH_DEPTH) {
+			if (writesToSend == 0) {
+				continue;
+			}
+			writesToSend--;
+			if (!WriteFile(hChannel, buf[i], URING_BENCH_LENGTH, NULL, completedOv) && GetLastError() != ERROR_IO_PENDING) {
+				printf(" %dth Write failed %d \n", i, GetLastError());
+				result = FALSE;
+				goto exit;
+			}
+		}
+		else {
+			if (readsToSend == 0) {
+				continue;
+			}
+			readsToSend--;
+			if (!ReadFile(hChannel, buf[i], URING_BENCH_LENGTH, NULL, completedOv) && GetLastError() != ERROR_IO_PENDING) {
+				printf(" %dth Read failed %d \n", i, GetLastError());
+				result = FALSE;
+				goto exit;
+			}
+		}
+	}
+
+	QueryPerformanceCounter(&end);
+
+	*OpsPerSecond = 2.0 * Count * frequency.QuadPart / (double)(end.QuadPart - start.QuadPart);
+
+	printf("%-28s %12.0f ops/s\n", "IOCP ReadFile/WriteFile", *OpsPerSecond);
+
+exit:
+	// رվʱڹ֮Źرɶ˿
+	CloseHandle(hChannel);
+	CloseHandle(hCompletionPort);
+
+	return result;
+}
+
+// ڴ滷еiдλãдǰصݽ
+#define URING_PAIR_OFFSET(Header, i)	((Header)->DataOffset + ((i) % (URING_BENCH_ENTRIES / 2)) * 2 * URING_BENCH_LENGTH)
+
+// ÿύPairsд巵ʱִЩȡͶص
+BOOLEAN
+RunUringBatch(
+	IN HANDLE hChannel,
+	IN PUCHAR Region,
+	IN ULONG Count,
+	IN ULONG Pairs,
+	IN double BaselineOpsPerSecond
+)
+{
+	PECHO_URING_HEADER header = (PECHO_URING_HEADER)Region;
+	PECHO_URING_SQE sq = (PECHO_URING_SQE)(Region + ECHO_URING_SQ_OFFSET);
+	PECHO_URING_CQE cq = (PECHO_URING_CQE)(Region + ECHO_URING_CQ_OFFSET(header->SqEntries));
+	PECHO_URING_SQE sqe;
+	PECHO_URING_CQE cqe;
+	OVERLAPPED ov;
+	LARGE_INTEGER frequency, start, end;
+	ULONG bytesReturned;
+	ULONG sqTail = header->SqTail;
+	ULONG cqHead = header->CqHead;
+	ULONG cqTail;
+	ULONG pair = 0;
+	ULONG i;
+	ULONG n;
+	double opsPerSecond;
+	CHAR name[64];
+	BOOLEAN result = TRUE;
+
+	ZeroMemory(&ov, sizeof(ov));
+	ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (ov.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		return FALSE;
+	}
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	while (pair < Count) {
+
+		// дύUserDataΪдԵų2ټ1
+		n = min(Pairs, Count - pair);
+
+		for (i = 0; i < n; i++) {
+			FillMemory(Region + URING_PAIR_OFFSET(header, pair + i), URING_BENCH_LENGTH, (UCHAR)((pair + i) % 251));
+
+			sqe = &sq[sqTail++ & (header->SqEntries - 1)];
+			sqe->Op = ECHO_BATCH_OP_WRITE;
+			sqe->Offset = URING_PAIR_OFFSET(header, pair + i) - header->DataOffset;
+			sqe->Length = URING_BENCH_LENGTH;
+			sqe->UserData = 2ULL * (pair + i);
+
+			sqe = &sq[sqTail++ & (header->SqEntries - 1)];
+			sqe->Op = ECHO_BATCH_OP_READ;
+			sqe->Offset = URING_PAIR_OFFSET(header, pair + i) - header->DataOffset + URING_BENCH_LENGTH;
+			sqe->Length = URING_BENCH_LENGTH;
+			sqe->UserData = 2ULL * (pair + i) + 1;
+		}
+
+		// ύд֮ƽSqTail
+		MemoryBarrier();
+		header->SqTail = sqTail;
+
+		if ((!DeviceIoControl(hChannel, IOCTL_ECHO_URING_ENTER, NULL, 0, NULL, 0, NULL, &ov) &&
+			GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(hChannel, &ov, &bytesReturned, TRUE)) {
+
+			printf("IOCTL_ECHO_URING_ENTER failed: Error %d\n", GetLastError());
+			result = FALSE;
+			goto exit;
+		}
+
+		// ȡ
+		cqTail = header->CqTail;
+		MemoryBarrier();
+
+		if (cqTail - cqHead != 2 * n) {
+			printf("Doorbell completed %d of %d operations\n", cqTail - cqHead, 2 * n);
+			result = FALSE;
+			goto exit;
+		}
+
+		for (; cqHead != cqTail; cqHead++) {
+			cqe = &cq[cqHead & (header->CqEntries - 1)];
+			if (cqe->Status != 0 || cqe->Information != URING_BENCH_LENGTH) {
+				printf("Uring operation %lld returned status 0x%x with %d bytes\n", cqe->UserData, cqe->Status, cqe->Information);
+				result = FALSE;
+				goto exit;
+			}
+		}
+
+		header->CqHead = cqHead;
+
+		for (i = 0; i < n; i++) {
+			if (memcmp(Region + URING_PAIR_OFFSET(header, pair + i),
+				Region + URING_PAIR_OFFSET(header, pair + i) + URING_BENCH_LENGTH,
+				URING_BENCH_LENGTH) != 0) {
+
+				printf("Uring read %d returned wrong data\n", pair + i);
+				result = FALSE;
+				goto exit;
+			}
+		}
+
+		pair += n;
+	}
+
+	QueryPerformanceCounter(&end);
+
+	opsPerSecond = 2.0 * Count * frequency.QuadPart / (double)(end.QuadPart - start.QuadPart);
+
+	StringCchPrintfA(name, RTL_NUMBER_OF(name), "Uring x %d ops/doorbell", 2 * Pairs);
+	printf("%-28s %12.0f ops/s %8.2fx\n", name, opsPerSecond, opsPerSecond / BaselineOpsPerSecond);
+
+exit:
+	CloseHandle(ov.hEvent);
+
+	return result;
+}
+
+// Ƚɶ˿ϵصд빲ڴ滷64ֽдÿ
+// ڴ滷Ǽһ˽ͨľϣԽȡǼע
+// ʹɲԣԽָԭĲ
+BOOLEAN
+PerformUringBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+)
+{
+	static const ULONG doorbellPairs[] = { 1, 8, 64, URING_BENCH_ENTRIES / 2 };
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	ECHO_URING_SETUP setup;
+	OVERLAPPED setupOv;
+	HANDLE hChannel = INVALID_HANDLE_VALUE;
+	PUCHAR region = NULL;
+	SIZE_T regionLength;
+	ULONG bytesReturned;
+	ULONG i;
+	double baseline = 0;
+	BOOLEAN registered = FALSE;
+	BOOLEAN result;
+
+	if (Count == 0) {
+		Count = URING_BENCH_COUNT;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_COMPLETION_POLICY,
+		NULL,
+		0,
+		&savedPolicy,
+		sizeof(savedPolicy),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	policy = savedPolicy;
+	policy.Mode = EchoCompletionImmediate;
+	if (!SetCompletionPolicy(hDevice, &policy)) {
+		return FALSE;
+	}
+
+	ZeroMemory(&setupOv, sizeof(setupOv));
+
+	printf("Uring benchmark: %d writes and reads of %d bytes\n", Count, URING_BENCH_LENGTH);
+
+	result = RunUringIocp(Count, &baseline);
+	if (!result) {
+		goto exit;
+	}
+
+	// ڴ水ҳ䣬Ҫ
+	regionLength = ECHO_URING_DATA_OFFSET(URING_BENCH_ENTRIES, URING_BENCH_ENTRIES) + URING_BENCH_ENTRIES * URING_BENCH_LENGTH;
+	region = (PUCHAR)VirtualAlloc(NULL, regionLength, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (region == NULL) {
+		printf("VirtualAlloc failed %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	hChannel = OpenPrivateChannel();
+	if (hChannel == INVALID_HANDLE_VALUE) {
+		result = FALSE;
+		goto exit;
+	}
+
+	setupOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (setupOv.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	// Ǽһֱֱȡ
+	setup.SqEntries = URING_BENCH_ENTRIES;
+	setup.CqEntries = URING_BENCH_ENTRIES;
+
+	if (DeviceIoControl(hChannel, IOCTL_ECHO_URING_SETUP, &setup, sizeof(setup), region, (ULONG)regionLength, NULL, &setupOv) ||
+		GetLastError() != ERROR_IO_PENDING) {
+
+		GetOverlappedResult(hChannel, &setupOv, &bytesReturned, FALSE);
+		printf("IOCTL_ECHO_URING_SETUP failed: Error %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	registered = TRUE;
+
+	for (i = 0; i < RTL_NUMBER_OF(doorbellPairs) && result; i++) {
+		result = RunUringBatch(hChannel, region, Count, doorbellPairs[i], baseline);
+	}
+
+exit:
+	// Ǽ֮ڴŲٱ
+	if (registered) {
+		CancelIoEx(hChannel, &setupOv);
+		if (!GetOverlappedResult(hChannel, &setupOv, &bytesReturned, TRUE) && GetLastError() != ERROR_OPERATION_ABORTED) {
+			printf("IOCTL_ECHO_URING_SETUP completed with error %d\n", GetLastError());
+		}
+	}
+	if (setupOv.hEvent != NULL) {
+		CloseHandle(setupOv.hEvent);
+	}
+	if (hChannel != INVALID_HANDLE_VALUE) {
+		CloseHandle(hChannel);
+	}
+	if (region != NULL) {
+		VirtualFree(region, 0, MEM_RELEASE);
+	}
+
+	SetCompletionPolicy(hDevice, &savedPolicy);
+
+	return result;
+}
+
+// ˽ͨѡ·תдTRANSFORM_SAMPLEתݲӡ
+// UTF-8ͱ䣬һζУUTF-16ĽתΪUTF-8ӡ
+BOOLEAN
+PerformTransformTest(
+	IN ULONG Transform
+)
+{
+	static const CHAR sample[] = TRANSFORM_SAMPLE;
+	UCHAR readBuffer[3 * (sizeof(sample) - 1)];
+	CHAR text[3 * sizeof(sample)];
+	ECHO_TRANSFORM_CONFIG config;
+	OVERLAPPED writeOv;
+	OVERLAPPED readOv;
+	HANDLE hChannel;
+	ULONG bytesWritten;
+	ULONG bytesRead;
+	ULONG bytesReturned;
+	UINT savedCodePage;
+	int textLength;
+	BOOLEAN result = FALSE;
+
+	hChannel = OpenPrivateChannel();
+	if (hChannel == INVALID_HANDLE_VALUE) {
+		return FALSE;
+	}
+
+	ZeroMemory(&writeOv, sizeof(writeOv));
+	ZeroMemory(&readOv, sizeof(readOv));
+	writeOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	readOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (writeOv.hEvent == NULL || readOv.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		goto exit;
+	}
+
+	config.Transform = Transform;
+
+	if ((!DeviceIoControl(hChannel, IOCTL_ECHO_SET_TRANSFORM, &config, sizeof(config), NULL, 0, NULL, &writeOv) &&
+		GetLastError() != ERROR_IO_PENDING) ||
+		!GetOverlappedResult(hChannel, &writeOv, &bytesReturned, TRUE)) {
+
+		printf("IOCTL_ECHO_SET_TRANSFORM failed: Error %d\n", GetLastError());
+		goto exit;
+	}
+
+	// 㿽ģʽдֱȡݣصʽ
+	if ((!WriteFile(hChannel, sample, sizeof(sample) - 1, NULL, &writeOv) && GetLastError() != ERROR_IO_PENDING) ||
+		(!ReadFile(hChannel, readBuffer, sizeof(readBuffer), NULL, &readOv) && GetLastError() != ERROR_IO_PENDING) ||
+		!GetOverlappedResult(hChannel, &writeOv, &bytesWritten, TRUE) ||
+		!GetOverlappedResult(hChannel, &readOv, &bytesRead, TRUE)) {
+
+		printf("Write or read failed: Error %d\n", GetLastError());
+		goto exit;
+	}
+
+	if (Transform == ECHO_TRANSFORM_DIGITS_UTF16) {
+		textLength = WideCharToMultiByte(CP_UTF8, 0, (LPCWCH)readBuffer, bytesRead / sizeof(WCHAR), text, sizeof(text) - 1, NULL, NULL);
+	}
+	else {
+		textLength = min(bytesRead, sizeof(text) - 1);
+		CopyMemory(text, readBuffer, textLength);
+	}
+	text[textLength] = '\0';
+
+	printf("Wrote %d bytes: %s\n", bytesWritten, sample);
+	printf("Read  %d bytes (%s)\n", bytesRead, (Transform == ECHO_TRANSFORM_DIGITS_UTF16) ? "UTF-16" : "UTF-8");
+
+	savedCodePage = GetConsoleOutputCP();
+	SetConsoleOutputCP(CP_UTF8);
+	printf("%s\n", text);
+	fflush(stdout);
+	SetConsoleOutputCP(savedCodePage);
+
+	result = TRUE;
+
+exit:
+	if (writeOv.hEvent != NULL) {
+		CloseHandle(writeOv.hEvent);
+	}
+	if (readOv.hEvent != NULL) {
+		CloseHandle(readOv.hEvent);
+	}
+	CloseHandle(hChannel);
+
+	return result;
+}
+
+typedef struct _SCALE_TEST {
+	HANDLE hDevice;
+	ULONG Processor;		// 󶨵Ĵ
+	HANDLE StartEvent;		// ߳̾һʼ
+	volatile LONG* Stop;	// ߳λ
+	ULONG64 Echoes;
+	ULONG64 BytesRead;
+	ULONG Errors;
+} SCALE_TEST, *PSCALE_TEST;
+
+// չԲԵĹ߳
+// 󶨵ԼĴԼľϷдSCALE_BENCH_LENGTHֽٶأֱ߳Ҫ
+// Ƭʱ̵߳ڹͨлһ𣬶0ֽڻ̵߳ݶֻͳɵд
+ULONG
+ScaleBenchWorker(
+	PVOID ThreadParameter
+)
+{
+	PSCALE_TEST test = (PSCALE_TEST)ThreadParameter;
+	UCHAR writeBuffer[SCALE_BENCH_LENGTH];
+	UCHAR readBuffer[SCALE_BENCH_LENGTH];
+	OVERLAPPED writeOv;
+	OVERLAPPED readOv;
+	ULONG bytesReturned;
+
+	ZeroMemory(&writeOv, sizeof(writeOv));
+	ZeroMemory(&readOv, sizeof(readOv));
+	FillMemory(writeBuffer, sizeof(writeBuffer), (UCHAR)test->Processor);
+
+	writeOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	readOv.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (writeOv.hEvent == NULL || readOv.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		test->Errors++;
+		goto exit;
+	}
+
+	if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << test->Processor) == 0) {
+		printf("SetThreadAffinityMask to processor %d failed %d\n", test->Processor, GetLastError());
+		test->Errors++;
+		goto exit;
+	}
+
+	WaitForSingleObject(test->StartEvent, INFINITE);
+
+	while (!*test->Stop) {
+
+		if ((!WriteFile(test->hDevice, writeBuffer, SCALE_BENCH_LENGTH, NULL, &writeOv) &&
+			GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(test->hDevice, &writeOv, &bytesReturned, TRUE)) {
+			test->Errors++;
+			break;
+		}
+
+		if ((!ReadFile(test->hDevice, readBuffer, SCALE_BENCH_LENGTH, NULL, &readOv) &&
+			GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(test->hDevice, &readOv, &bytesReturned, TRUE)) {
+			test->Errors++;
+			break;
+		}
+
+		test->BytesRead += bytesReturned;
+		test->Echoes++;
+	}
+
+exit:
+	if (writeOv.hEvent != NULL) {
+		CloseHandle(writeOv.hEvent);
+	}
+
+	if (readOv.hEvent != NULL) {
+		CloseHandle(readOv.hEvent);
+	}
+
+	return 0;
+}
+
+// չԲԵһThreads̸߳Դһʹùͨľֱ󶨵0Threads-1
+// ͬʱдSCALE_BENCH_SECONDS룬ÿдPerThreadÿ̵߳ƽֵ
+BOOLEAN
+RunScaleStep(
+	IN ULONG Threads,
+	OUT double* EchoesPerSec,
+	OUT double* PerThread
+)
+{
+	SCALE_TEST tests[SCALE_BENCH_MAX_THREADS];
+	HANDLE threads[SCALE_BENCH_MAX_THREADS];
+	HANDLE startEvent;
+	LARGE_INTEGER frequency, start, now;
+	volatile LONG stop = 0;
+	ULONG64 echoes = 0;
+	ULONG64 bytesRead = 0;
+	ULONG errors = 0;
+	ULONG opened = 0;
+	ULONG started = 0;
+	ULONG i;
+	double elapsedSec;
+	BOOLEAN result = TRUE;
+
+	*EchoesPerSec = 0;
+	*PerThread = 0;
+
+	startEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (startEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		return FALSE;
+	}
+
+	ZeroMemory(tests, sizeof(tests));
+
+	for (opened = 0; opened < Threads; opened++) {
+
+		tests[opened].Processor = opened;
+		tests[opened].StartEvent = startEvent;
+		tests[opened].Stop = &stop;
+		tests[opened].hDevice = CreateFile(G_DevicePath,
+			GENERIC_WRITE | GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE,
+			NULL,
+			OPEN_EXISTING,
+			FILE_FLAG_OVERLAPPED,
+			NULL);
+
+		if (tests[opened].hDevice == INVALID_HANDLE_VALUE) {
+			printf("Cannot open %ws error %d\n", G_DevicePath, GetLastError());
+			result = FALSE;
+			goto exit;
+		}
+	}
+
+	for (started = 0; started < Threads; started++) {
+
+		threads[started] = CreateThread(NULL,
+			0,
+			(LPTHREAD_START_ROUTINE)ScaleBenchWorker,
+			&tests[started],
+			0,
+			NULL);
+
+		if (threads[started] == NULL) {
+			printf("Couldn't create worker thread - error %d\n", GetLastError());
+			result = FALSE;
+			break;
+		}
+	}
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	SetEvent(startEvent);
+
+	if (started != 0) {
+		Sleep(SCALE_BENCH_SECONDS * 1000);
+		InterlockedExchange(&stop, 1);
+		WaitForMultipleObjects(started, threads, TRUE, INFINITE);
+	}
+
+	QueryPerformanceCounter(&now);
+	elapsedSec = (double)(now.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+
+	for (i = 0; i < started; i++) {
+		CloseHandle(threads[i]);
+		echoes += tests[i].Echoes;
+		bytesRead += tests[i].BytesRead;
+		errors += tests[i].Errors;
+	}
+
+	if (errors != 0 || started != Threads) {
+		printf("%d threads: %d errors\n", Threads, errors);
+		result = FALSE;
+		goto exit;
+	}
+
+	*EchoesPerSec = (elapsedSec > 0) ? echoes / elapsedSec : 0.0;
+	*PerThread = *EchoesPerSec / Threads;
+
+	printf("%8d threads %14.1f echoes/s %12.1f echoes/s/thread %8.1f MB/s read\n",
+		Threads,
+		*EchoesPerSec,
+		*PerThread,
+		(elapsedSec > 0) ? bytesRead / (1024.0 * 1024.0) / elapsedSec : 0.0);
+
+exit:
+	for (i = 0; i < opened; i++) {
+		CloseHandle(tests[i].hDevice);
+	}
+
+	CloseHandle(startEvent);
+
+	return result;
+}
+
+// ദչԲԣ1̵߳MaxThreadṣ߳ÿ̰߳һÿ̵߳ÿд
+// Ƭʱÿ̵߳дԼķƬϣÿ̵߳Ӧ߳½Ƭʱ߳ùͨ
+// ķƬʽECHO_DEFAULT_SHARD_MODEͳжƬĸ
+// ڼʹɲԣԽָԭĲ
+BOOLEAN
+PerformScaleBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG MaxThreads
+)
+{
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	ECHO_STATS stats;
+	ULONG flags = 0;
+	ULONG bytesReturned;
+	ULONG processors;
+	ULONG threads;
+	double echoesPerSec;
+	double perThread;
+	double baseline = 0;
+	BOOLEAN result = TRUE;
+
+	// ߳׺󶨴ֻʹõһ
+	processors = GetActiveProcessorCount(0);
+	if (processors > SCALE_BENCH_MAX_THREADS) {
+		processors = SCALE_BENCH_MAX_THREADS;
+	}
+
+	if (MaxThreads == 0 || MaxThreads > processors) {
+		MaxThreads = processors;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_STATS,
+		&flags,
+		sizeof(flags),
+		&stats,
+		sizeof(stats),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_STATS failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	if (!DeviceIoControl(hDevice,
+		IOCTL_ECHO_GET_COMPLETION_POLICY,
+		NULL,
+		0,
+		&savedPolicy,
+		sizeof(savedPolicy),
+		&bytesReturned,
+		NULL)) {
+
+		printf("IOCTL_ECHO_GET_COMPLETION_POLICY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	policy = savedPolicy;
+	policy.Mode = EchoCompletionImmediate;
+	if (!SetCompletionPolicy(hDevice, &policy)) {
+		return FALSE;
+	}
+
+	if (stats.ShardCount != 0) {
+		printf("Scale test: %d shards, 1 to %d threads, %d-byte echoes, %d s per step\n",
+			stats.ShardCount, MaxThreads, SCALE_BENCH_LENGTH, SCALE_BENCH_SECONDS);
+	}
+	else {
+		printf("Scale test: not sharded, 1 to %d threads, %d-byte echoes, %d s per step\n",
+			MaxThreads, SCALE_BENCH_LENGTH, SCALE_BENCH_SECONDS);
+	}
+
+	for (threads = 1; threads <= MaxThreads; threads++) {
+
+		if (!RunScaleStep(threads, &echoesPerSec, &perThread)) {
+			result = FALSE;
+			break;
+		}
+
+		if (threads == 1) {
+			baseline = perThread;
+		}
+		else if (baseline > 0) {
+			printf("%8s per-thread rate %5.1f%% of 1 thread\n", "", perThread * 100.0 / baseline);
+		}
+	}
+
+	// ָԭĲ
+	SetCompletionPolicy(hDevice, &savedPolicy);
+
+	return result;
+}
+
+// ӡ豸Ŀɵ
+VOID
+PrintParameters(
+	IN PECHO_PARAMETERS Parameters
+)
+{
+	printf("MaxWriteLength    %u (limit %u)\n", Parameters->MaxWriteLength, Parameters->MaxWriteLimit);
+	printf("TimerPeriodUs     %u\n", Parameters->TimerPeriodUs);
+	printf("CompletionDelayMs %u\n", Parameters->CompletionDelayMs);
+	printf("BatchSize         %u\n", Parameters->BatchSize);
+	printf("DispatchMode      %u (active %u)\n", Parameters->DispatchMode, Parameters->ActiveDispatchMode);
+	printf("MemoryBudget      %llu\n", Parameters->MemoryBudget);
+}
+
+// ڱ̵SeLoadDriverPrivilegeڴ򿪾ʱ
+// ûиȨʱǹԱFALSE
+BOOLEAN
+EnableLoadDriverPrivilege(
+	VOID
+)
+{
+	TOKEN_PRIVILEGES privileges;
+	HANDLE hToken;
+	BOOL result;
+
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &hToken)) {
+		return FALSE;
+	}
+
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+	result = LookupPrivilegeValue(NULL, SE_LOAD_DRIVER_NAME, &privileges.Privileges[0].Luid) &&
+		AdjustTokenPrivileges(hToken, FALSE, &privileges, sizeof(privileges), NULL, NULL) &&
+		GetLastError() == ERROR_SUCCESS;
+
+	CloseHandle(hToken);
+
+	return result ? TRUE : FALSE;
+}
+
+// ȡ豸Ŀɵname=value޸ĺһãٶشӡ
+// ûname=valueʱֻӡ-Persistʱͬʱдע豸´ʱЧ
+// дעҪԱSeLoadDriverPrivilege´豸¾
+BOOLEAN
+SetParameters(
+	IN HANDLE hDevice,
+	IN int Argc,
+	IN char* Argv[]
+)
+{
+	ECHO_PARAMETERS parameters;
+	ULONG bytesReturned;
+	BOOLEAN modified = FALSE;
+	HANDLE hPersist;
+	DWORD error;
+	BOOL result;
+	char* value;
+	int i;
+
+	if (!DeviceIoControl(hDevice, IOCTL_ECHO_GET_PARAMETERS, NULL, 0, &parameters, sizeof(parameters), &bytesReturned, NULL)) {
+		printf("IOCTL_ECHO_GET_PARAMETERS failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	parameters.Flags = 0;
+
+	for (i = 0; i < Argc; i++) {
+
+		if (!_stricmp(Argv[i], "-Persist")) {
+			parameters.Flags |= ECHO_PARAMETERS_FLAG_PERSIST;
+			modified = TRUE;
+			continue;
+		}
+
+		value = strchr(Argv[i], '=');
+		if (value == NULL) {
+			printf("Expected name=value, got %s\n", Argv[i]);
+			return FALSE;
+		}
+
+		*value++ = '\0';
+
+		if (!_stricmp(Argv[i], "MaxWriteLength")) {
+			parameters.MaxWriteLength = strtoul(value, NULL, 0);
+		}
+		else if (!_stricmp(Argv[i], "TimerPeriodUs")) {
+			parameters.TimerPeriodUs = strtoul(value, NULL, 0);
+		}
+		else if (!_stricmp(Argv[i], "CompletionDelayMs")) {
+			parameters.CompletionDelayMs = strtoul(value, NULL, 0);
+		}
+		else if (!_stricmp(Argv[i], "BatchSize")) {
+			parameters.BatchSize = strtoul(value, NULL, 0);
+		}
+		else if (!_stricmp(Argv[i], "DispatchMode")) {
+			parameters.DispatchMode = strtoul(value, NULL, 0);
+		}
+		else if (!_stricmp(Argv[i], "MemoryBudget")) {
+			parameters.MemoryBudget = _strtoui64(value, NULL, 0);
+		}
+		else {
+			printf("Unknown parameter %s\n", Argv[i]);
+			return FALSE;
+		}
+
+		modified = TRUE;
+	}
+
+	if (modified) {
+		hPersist = INVALID_HANDLE_VALUE;
+
+		if (parameters.Flags & ECHO_PARAMETERS_FLAG_PERSIST) {
+			if (!EnableLoadDriverPrivilege()) {
+				printf("-Persist needs administrator (SeLoadDriverPrivilege)\n");
+				return FALSE;
+			}
+
+			hPersist = CreateFile(G_DevicePath,
+				GENERIC_READ | GENERIC_WRITE,
+				FILE_SHARE_READ | FILE_SHARE_WRITE,
+				NULL,
+				OPEN_EXISTING,
+				0,
+				NULL);
+
+			if (hPersist == INVALID_HANDLE_VALUE) {
+				printf("Failed to reopen device. Error %d\n", GetLastError());
+				return FALSE;
+			}
+		}
+
+		result = DeviceIoControl((hPersist != INVALID_HANDLE_VALUE) ? hPersist : hDevice,
+			IOCTL_ECHO_SET_PARAMETERS, &parameters, sizeof(parameters), NULL, 0, &bytesReturned, NULL);
+		error = GetLastError();
+
+		if (hPersist != INVALID_HANDLE_VALUE) {
+			CloseHandle(hPersist);
+		}
+
+		if (!result) {
+			printf("IOCTL_ECHO_SET_PARAMETERS failed: Error %d\n", error);
+			return FALSE;
+		}
+
+		if (!DeviceIoControl(hDevice, IOCTL_ECHO_GET_PARAMETERS, NULL, 0, &parameters, sizeof(parameters), &bytesReturned, NULL)) {
+			printf("IOCTL_ECHO_GET_PARAMETERS failed: Error %d\n", GetLastError());
+			return FALSE;
+		}
+	}
+
+	PrintParameters(&parameters);
+
+	return TRUE;
+}
+
+// qsortıȽϺӳٴС
+int __cdecl
+CompareLatency(
+	const void* A,
+	const void* B
+)
+{
+	double a = *(const double*)A;
+	double b = *(const double*)B;
+
+	return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+// һӳģͣͬдCountLATENCY_BENCH_LENGTHֽڲأӡдӳٵķλ
+BOOLEAN
+RunLatencyBenchmark(
+	IN HANDLE hDevice,
+	IN PCSTR Name,
+	IN PECHO_LATENCY_CONFIG Config,
+	IN ULONG Count,
+	IN double* Latencies
+)
+{
+	UCHAR writeBuffer[LATENCY_BENCH_LENGTH];
+	UCHAR readBuffer[LATENCY_BENCH_LENGTH];
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER start;
+	LARGE_INTEGER end;
+	ULONG bytesReturned;
+	double total = 0;
+	ULONG i;
+
+	if (!DeviceIoControl(hDevice, IOCTL_ECHO_SET_LATENCY_MODEL, Config, sizeof(ECHO_LATENCY_CONFIG), NULL, 0, &bytesReturned, NULL)) {
+		printf("IOCTL_ECHO_SET_LATENCY_MODEL failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	QueryPerformanceFrequency(&frequency);
+
+	for (i = 0; i < Count; i++) {
+
+		FillMemory(writeBuffer, sizeof(writeBuffer), (UCHAR)i);
+
+		QueryPerformanceCounter(&start);
+
+		if (!WriteFile(hDevice, writeBuffer, sizeof(writeBuffer), &bytesReturned, NULL)) {
+			printf("WriteFile failed with error 0x%x\n", GetLastError());
+			return FALSE;
+		}
+
+		QueryPerformanceCounter(&end);
+
+		if (!ReadFile(hDevice, readBuffer, sizeof(readBuffer), &bytesReturned, NULL) ||
+			bytesReturned != sizeof(readBuffer) ||
+			memcmp(readBuffer, writeBuffer, sizeof(readBuffer)) != 0) {
+			printf("Echo %d did not read back what was written\n", i);
+			return FALSE;
+		}
+
+		Latencies[i] = (double)(end.QuadPart - start.QuadPart) * 1e6 / frequency.QuadPart;
+		total += Latencies[i];
+	}
+
+	qsort(Latencies, Count, sizeof(double), CompareLatency);
+
+	printf("%-24s mean %9.1f  p50 %9.1f  p90 %9.1f  p99 %9.1f  max %9.1f us\n",
+		Name,
+		total / Count,
+		Latencies[Count * 50 / 100],
+		Latencies[Count * 90 / 100],
+		Latencies[Count * 99 / 100],
+		Latencies[Count - 1]);
+
+	return TRUE;
+}
+
+// βԹ̶ȡָ˫ӳģͺʹƣģʹͬ
+// ʱľʱֵĽģ500usֵĿ
+// Խرӳģָͣɲ
+BOOLEAN
+PerformLatencyBenchmark(
+	IN HANDLE hDevice,
+	IN ULONG Count
+)
+{
+	ECHO_LATENCY_CONFIG config;
+	ULONG bytesReturned;
+	double* latencies;
+	BOOLEAN result = TRUE;
+
+	if (Count == 0) {
+		return TRUE;
+	}
+
+	latencies = (double*)malloc(Count * sizeof(double));
+	if (latencies == NULL) {
+		printf("Could not allocate %d latencies\n", Count);
+		return FALSE;
+	}
+
+	printf("%d echoes of %d bytes per model\n", Count, LATENCY_BENCH_LENGTH);
+
+	ZeroMemory(&config, sizeof(config));
+	config.Seed = LATENCY_BENCH_SEED;
+
+	config.Model = EchoLatencyConstant;
+	config.MinUs = 2000;
+	result = RunLatencyBenchmark(hDevice, "constant 2ms", &config, Count, latencies);
+
+	if (result) {
+		config.Model = EchoLatencyUniform;
+		config.MinUs = 1000;
+		config.MaxUs = 5000;
+		result = RunLatencyBenchmark(hDevice, "uniform 1-5ms", &config, Count, latencies);
+	}
+
+	if (result) {
+		config.Model = EchoLatencyExponential;
+		config.MinUs = 500;
+		config.MeanUs = 2000;
+		config.MaxUs = 50000;
+		result = RunLatencyBenchmark(hDevice, "exponential 0.5+2ms", &config, Count, latencies);
+	}
+
+	if (result) {
+		config.Model = EchoLatencyBimodal;
+		config.MinUs = 1000;
+		config.MaxUs = 20000;
+		config.TailPpm = 20000;
+		result = RunLatencyBenchmark(hDevice, "bimodal 1ms/20ms 2%", &config, Count, latencies);
+	}
+
+	if (result) {
+		// 4 KBдͶһΣ8 MB/sʱÿдԼ1ms
+		ZeroMemory(&config, sizeof(config));
+		config.Seed = LATENCY_BENCH_SEED;
+		config.BytesPerSecond = 8 * 1024 * 1024;
+		result = RunLatencyBenchmark(hDevice, "bandwidth 8 MB/s", &config, Count, latencies);
+	}
+
+	// رӳģ
+	ZeroMemory(&config, sizeof(config));
+	DeviceIoControl(hDevice, IOCTL_ECHO_SET_LATENCY_MODEL, &config, sizeof(config), NULL, 0, &bytesReturned, NULL);
+
+	free(latencies);
+
+	return result;
+}
+
+// log2ͰӳٷֲƷλطλͰϽ磨us
+ULONG64
+HistogramPercentile(
+	IN const ULONG64* Histogram,
+	IN double Fraction
+)
+{
+	ULONG64 total = 0;
+	ULONG64 count = 0;
+	ULONG i;
+
+	for (i = 0; i < ECHO_STATS_LATENCY_BUCKETS; i++) {
+		total += Histogram[i];
+	}
+
+	if (total == 0) {
+		return 0;
+	}
+
+	for (i = 0; i < ECHO_STATS_LATENCY_BUCKETS; i++) {
+		count += Histogram[i];
+		if (count >= total * Fraction) {
+			break;
+		}
+	}
+
+	return (i < ECHO_STATS_LATENCY_BUCKETS) ? (1ULL << (i + 1)) - 1 : (1ULL << ECHO_STATS_LATENCY_BUCKETS);
+}
+
+// ӡÿȼɴӳٷλλľlog2Ͱ
+VOID
+PrintClassLatency(
+	IN PECHO_STATS Stats
+)
+{
+	static const PCSTR classNames[ECHO_PRIORITY_CLASSES] = { "high", "normal", "bulk" };
+	ULONG64 count;
+	ULONG i, j;
+
+	printf("Completion latency by priority class (bucket upper bounds):\n");
+
+	for (i = 0; i < ECHO_PRIORITY_CLASSES; i++) {
+
+		count = 0;
+		for (j = 0; j < ECHO_STATS_LATENCY_BUCKETS; j++) {
+			count += Stats->ClassLatency[i][j];
+		}
+
+		if (count == 0) {
+			continue;
+		}
+
+		printf("  %-8s %12llu  p50 <= %8llu us  p90 <= %8llu us  p99 <= %8llu us\n",
+			classNames[i],
+			count,
+			HistogramPercentile(Stats->ClassLatency[i], 0.50),
+			HistogramPercentile(Stats->ClassLatency[i], 0.90),
+			HistogramPercentile(Stats->ClassLatency[i], 0.99));
+	}
+}
+
+// þȼ
+BOOLEAN
+SetHandlePriority(
+	IN HANDLE hChannel,
+	IN ULONG Class
+)
+{
+	ECHO_PRIORITY priority;
+	ULONG bytesReturned;
+
+	priority.Class = Class;
+
+	if (!DeviceIoControl(hChannel, IOCTL_ECHO_SET_PRIORITY, &priority, sizeof(priority), NULL, 0, &bytesReturned, NULL)) {
+		printf("IOCTL_ECHO_SET_PRIORITY failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+// ȼ̵߳Ĳͽ
+typedef struct _PRIORITY_BULK {
+	HANDLE hChannel;
+	volatile LONG* Stop;	// ߳λ
+	ULONG64 Transfers;
+	ULONG Errors;
+} PRIORITY_BULK, *PPRIORITY_BULK;
+
+// ̣߳ͬʱPRIORITY_BENCH_BULK_DEPTH40KBдȫɺȫأֱ߳Ҫ
+ULONG
+PriorityBulkWorker(
+	PVOID ThreadParameter
+)
+{
+	PPRIORITY_BULK bulk = (PPRIORITY_BULK)ThreadParameter;
+	OVERLAPPED ov[PRIORITY_BENCH_BULK_DEPTH];
+	PUCHAR buffers;
+	ULONG bytesReturned;
+	ULONG i;
+
+	ZeroMemory(ov, sizeof(ov));
+
+	buffers = (PUCHAR)malloc(PRIORITY_BENCH_BULK_DEPTH * PRIORITY_BENCH_BULK_LENGTH);
+	if (buffers == NULL) {
+		bulk->Errors++;
+		return 0;
+	}
+
+	for (i = 0; i < PRIORITY_BENCH_BULK_DEPTH; i++) {
+		ov[i].hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+		if (ov[i].hEvent == NULL) {
+			bulk->Errors++;
+			goto exit;
+		}
+	}
+
+	while (!*bulk->Stop && bulk->Errors == 0) {
+
+		for (i = 0; i < PRIORITY_BENCH_BULK_DEPTH; i++) {
+			if (!WriteFile(bulk->hChannel, buffers + i * PRIORITY_BENCH_BULK_LENGTH, PRIORITY_BENCH_BULK_LENGTH, NULL, &ov[i]) &&
+				GetLastError() != ERROR_IO_PENDING) {
+				bulk->Errors++;
+			}
+		}
+
+		for (i = 0; i < PRIORITY_BENCH_BULK_DEPTH; i++) {
+			if (!GetOverlappedResult(bulk->hChannel, &ov[i], &bytesReturned, TRUE)) {
+				bulk->Errors++;
+			}
+		}
+
+		for (i = 0; i < PRIORITY_BENCH_BULK_DEPTH; i++) {
+			if (!ReadFile(bulk->hChannel, buffers + i * PRIORITY_BENCH_BULK_LENGTH, PRIORITY_BENCH_BULK_LENGTH, NULL, &ov[i]) &&
+				GetLastError() != ERROR_IO_PENDING) {
+				bulk->Errors++;
+			}
+		}
+
+		for (i = 0; i < PRIORITY_BENCH_BULK_DEPTH; i++) {
+			if (!GetOverlappedResult(bulk->hChannel, &ov[i], &bytesReturned, TRUE)) {
+				bulk->Errors++;
+			}
+		}
+
+		bulk->Transfers += PRIORITY_BENCH_BULK_DEPTH;
+	}
+
+exit:
+	for (i = 0; i < PRIORITY_BENCH_BULK_DEPTH; i++) {
+		if (ov[i].hEvent != NULL) {
+			CloseHandle(ov[i].hEvent);
+		}
+	}
+
+	free(buffers);
+
+	return 0;
+}
+
+// ȼԵһãСһ˽ֱͨΪBulkClassSmallClass
+// С߳дPRIORITY_BENCH_SECONDS룬ӡͳиӳٷλ
+BOOLEAN
+RunPriorityBenchmark(
+	IN HANDLE hDevice,
+	IN PCSTR Name,
+	IN ULONG BulkClass,
+	IN ULONG SmallClass
+)
+{
+	UCHAR writeBuffer[PRIORITY_BENCH_SMALL_LENGTH];
+	UCHAR readBuffer[PRIORITY_BENCH_SMALL_LENGTH];
+	PRIORITY_BULK bulk;
+	ECHO_STATS stats;
+	OVERLAPPED ov;
+	HANDLE hSmall = INVALID_HANDLE_VALUE;
+	HANDLE thread = NULL;
+	LARGE_INTEGER frequency, start, now;
+	ULONG flags = ECHO_STATS_FLAG_RESET;
+	ULONG bytesReturned;
+	ULONG64 echoes = 0;
+	volatile LONG stop = 0;
+	BOOLEAN result = FALSE;
+
+	ZeroMemory(&bulk, sizeof(bulk));
+	ZeroMemory(&ov, sizeof(ov));
+	bulk.Stop = &stop;
+
+	bulk.hChannel = OpenPrivateChannel();
+	hSmall = OpenPrivateChannel();
+	ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+	if (bulk.hChannel == INVALID_HANDLE_VALUE || hSmall == INVALID_HANDLE_VALUE || ov.hEvent == NULL) {
+		goto exit;
+	}
+
+	if (!SetHandlePriority(bulk.hChannel, BulkClass) || !SetHandlePriority(hSmall, SmallClass)) {
+		goto exit;
+	}
+
+	// ͳ
+	if (!DeviceIoControl(hDevice, IOCTL_ECHO_GET_STATS, &flags, sizeof(flags), &stats, sizeof(stats), &bytesReturned, NULL)) {
+		printf("IOCTL_ECHO_GET_STATS failed: Error %d\n", GetLastError());
+		goto exit;
+	}
+
+	thread = CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE)PriorityBulkWorker, &bulk, 0, NULL);
+	if (thread == NULL) {
+		printf("Couldn't create bulk thread - error %d\n", GetLastError());
+		goto exit;
+	}
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+	now = start;
+
+	result = TRUE;
+
+	while (now.QuadPart - start.QuadPart < PRIORITY_BENCH_SECONDS * frequency.QuadPart) {
+
+		if ((!WriteFile(hSmall, writeBuffer, sizeof(writeBuffer), NULL, &ov) && GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(hSmall, &ov, &bytesReturned, TRUE) ||
+			(!ReadFile(hSmall, readBuffer, sizeof(readBuffer), NULL, &ov) && GetLastError() != ERROR_IO_PENDING) ||
+			!GetOverlappedResult(hSmall, &ov, &bytesReturned, TRUE)) {
+			printf("Small echo failed with error 0x%x\n", GetLastError());
+			result = FALSE;
+			break;
+		}
+
+		echoes++;
+		QueryPerformanceCounter(&now);
+	}
+
+	InterlockedExchange(&stop, 1);
+	WaitForSingleObject(thread, INFINITE);
+
+	if (bulk.Errors != 0) {
+		printf("Bulk transfers failed %d times\n", bulk.Errors);
+		result = FALSE;
+	}
+
+	if (!result) {
+		goto exit;
+	}
+
+	flags = 0;
+	if (!DeviceIoControl(hDevice, IOCTL_ECHO_GET_STATS, &flags, sizeof(flags), &stats, sizeof(stats), &bytesReturned, NULL)) {
+		printf("IOCTL_ECHO_GET_STATS failed: Error %d\n", GetLastError());
+		result = FALSE;
+		goto exit;
+	}
+
+	printf("%s: %llu small echoes, %llu bulk transfers\n", Name, echoes, bulk.Transfers);
+	PrintClassLatency(&stats);
+
+exit:
+	if (thread != NULL) {
+		CloseHandle(thread);
+	}
+
+	if (ov.hEvent != NULL) {
+		CloseHandle(ov.hEvent);
+	}
+
+	if (hSmall != INVALID_HANDLE_VALUE) {
+		CloseHandle(hSmall);
+	}
+
+	if (bulk.hChannel != INVALID_HANDLE_VALUE) {
+		CloseHandle(bulk.hChannel);
+	}
+
+	return result;
+}
+
+// ɶʱΪPRIORITY_BENCH_PERIOD_USĸ߾ȶʱEchoCompletionTimerÿһ
+// ΪƿʹͬһٰСΪȼΪȼȽСӳ
+// ԽָԭɲԺͶʱ
+BOOLEAN
+PerformPriorityBenchmark(
+	IN HANDLE hDevice
+)
+{
+	ECHO_COMPLETION_POLICY savedPolicy;
+	ECHO_COMPLETION_POLICY policy;
+	ECHO_TIMER_JITTER savedTimer;
+	ECHO_TIMER_CONFIG timer;
+	ECHO_PRIORITY_WEIGHTS weights;
+	ULONG bytesReturned;
+	BOOLEAN result;
+
+	if (!DeviceIoControl(hDevice, IOCTL_ECHO_GET_COMPLETION_POLICY, NULL, 0, &savedPolicy, sizeof(savedPolicy), &bytesReturned, NULL) ||
+		!DeviceIoControl(hDevice, IOCTL_ECHO_GET_TIMER_JITTER, NULL, 0, &savedTimer, sizeof(savedTimer), &bytesReturned, NULL) ||
+		!DeviceIoControl(hDevice, IOCTL_ECHO_GET_PRIORITY_WEIGHTS, NULL, 0, &weights, sizeof(weights), &bytesReturned, NULL)) {
+		printf("Reading the completion settings failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	timer.PeriodUs = PRIORITY_BENCH_PERIOD_US;
+	timer.HighResolution = TRUE;
+	timer.TolerableDelayMs = 0;
+
+	if (!DeviceIoControl(hDevice, IOCTL_ECHO_SET_TIMER, &timer, sizeof(timer), NULL, 0, &bytesReturned, NULL)) {
+		printf("IOCTL_ECHO_SET_TIMER failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	policy = savedPolicy;
+	policy.Mode = EchoCompletionTimer;
+	result = SetCompletionPolicy(hDevice, &policy);
+
+	printf("Priority benchmark: one completion per %d us, weights high %d normal %d bulk %d\n",
+		PRIORITY_BENCH_PERIOD_US,
+		weights.Weights[EchoPriorityHigh],
+		weights.Weights[EchoPriorityNormal],
+		weights.Weights[EchoPriorityBulk]);
+
+	if (result) {
+		result = RunPriorityBenchmark(hDevice, "Same class", EchoPriorityNormal, EchoPriorityNormal);
+	}
+
+	if (result) {
+		result = RunPriorityBenchmark(hDevice, "High over bulk", EchoPriorityBulk, EchoPriorityHigh);
+	}
+
+	// ָԭĲԺͶʱ
+	SetCompletionPolicy(hDevice, &savedPolicy);
+	DeviceIoControl(hDevice, IOCTL_ECHO_SET_TIMER, &savedTimer.Config, sizeof(savedTimer.Config), NULL, 0, &bytesReturned, NULL);
+
+	return result;
+}
+
+// ׼ԵĲ
+typedef struct _BENCH_CONFIG {
+	ULONG Depth;			// ͬʱд
+	ULONG Length;			// ÿĳ
+	ULONG Seconds;			// ʱ
+	ULONG WarmupSeconds;	// Ԥʱ
+	PCSTR CsvPath;			// ׷CSVļNULLʱ
+	PCSTR JsonPath;			// дJSONļNULLʱ
+} BENCH_CONFIG, *PBENCH_CONFIG;
+
+// ͻ˵ӳٷֲnsС2 * BENCH_HISTOGRAM_SUB_BUCKETSֵÿһͰ
+// ֮ÿ2ȷΪBENCH_HISTOGRAM_SUB_BUCKETSͰp99.9ҲܾȷԼ3%
+typedef struct _BENCH_HISTOGRAM {
+	ULONG64 Counts[BENCH_HISTOGRAM_BUCKETS];
+	ULONG64 Total;
+	ULONG64 SumNs;
+	ULONG64 MaxNs;
+} BENCH_HISTOGRAM, *PBENCH_HISTOGRAM;
+
+// ӳٷֲõĽ
+typedef struct _BENCH_SUMMARY {
+	ULONG64 Requests;
+	double Iops;
+	double MegabytesPerSecond;
+	double MeanUs;
+	double P50Us;
+	double P90Us;
+	double P99Us;
+	double P999Us;
+	double MaxUs;
+} BENCH_SUMMARY, *PBENCH_SUMMARY;
+
+// ׼еһ
+typedef struct _BENCH_OP {
+	OVERLAPPED Ov;			// ɵOVERLAPPEDõڵλ
+	LARGE_INTEGER Issued;	// ʱ
+	struct _BENCH_SLOT* Slot;	// ڵλ
+	BOOLEAN Reading;		// 
+	PUCHAR Buffer;
+} BENCH_OP, *PBENCH_OP;
+
+// ׼еһλãдͶͬʱԼĻɺٷһ
+// 㿽ģʽдֱȡݣԶܵдɺŷ
+typedef struct _BENCH_SLOT {
+	BENCH_OP Write;
+	BENCH_OP Read;
+	ULONG Pending;			// λù
+} BENCH_SLOT, *PBENCH_SLOT;
+
+static const PCSTR BenchResultNames[BENCH_RESULTS] = { "write", "read", "all" };
+
+// ֵڵͰƵС2 * BENCH_HISTOGRAM_SUB_BUCKETSΪֹÿһλһͰ
+ULONG
+BenchHistogramBucket(
+	IN ULONG64 Ns
+)
+{
+	ULONG shift = 0;
+
+	while ((Ns >> shift) >= 2 * BENCH_HISTOGRAM_SUB_BUCKETS) {
+		shift++;
+	}
+
+	return shift * BENCH_HISTOGRAM_SUB_BUCKETS + (ULONG)(Ns >> shift);
+}
+
+// Ͱе㣨ns
+ULONG64
+BenchHistogramValue(
+	IN ULONG Bucket
+)
+{
+	ULONG shift;
+
+	if (Bucket < 2 * BENCH_HISTOGRAM_SUB_BUCKETS) {
+		return Bucket;
+	}
+
+	shift = Bucket / BENCH_HISTOGRAM_SUB_BUCKETS - 1;
+
+	return ((ULONG64)(Bucket - shift * BENCH_HISTOGRAM_SUB_BUCKETS) << shift) + ((1ULL << shift) >> 1);
+}
+
+VOID
+BenchHistogramRecord(
+	IN OUT PBENCH_HISTOGRAM Histogram,
+	IN ULONG64 Ns
+)
+{
+	Histogram->Counts[BenchHistogramBucket(Ns)]++;
+	Histogram->Total++;
+	Histogram->SumNs += Ns;
+
+	if (Ns > Histogram->MaxNs) {
+		Histogram->MaxNs = Ns;
+	}
+}
+
+// ƷλطλͰе㣨us¼ֵ
+double
+BenchHistogramPercentile(
+	IN const BENCH_HISTOGRAM* Histogram,
+	IN double Fraction
+)
+{
+	ULONG64 count = 0;
+	ULONG64 value;
+	ULONG i;
+
+	for (i = 0; i < BENCH_HISTOGRAM_BUCKETS; i++) {
+
+		count += Histogram->Counts[i];
+
+		if (count != 0 && count >= Fraction * Histogram->Total) {
+			value = BenchHistogramValue(i);
+			return ((value < Histogram->MaxNs) ? value : Histogram->MaxNs) / 1000.0;
+		}
+	}
+
+	return 0;
+}
+
+// ɲʱڵӳٷֲÿMB/sͷλ
+VOID
+BenchSummarize(
+	IN const BENCH_HISTOGRAM* Histogram,
+	IN PBENCH_CONFIG Config,
+	OUT PBENCH_SUMMARY Summary
+)
+{
+	ZeroMemory(Summary, sizeof(BENCH_SUMMARY));
+
+	Summary->Requests = Histogram->Total;
+	Summary->Iops = (double)Histogram->Total / Config->Seconds;
+	Summary->MegabytesPerSecond = Summary->Iops * Config->Length / (1024 * 1024);
+
+	if (Histogram->Total != 0) {
+		Summary->MeanUs = (double)Histogram->SumNs / Histogram->Total / 1000.0;
+		Summary->P50Us = BenchHistogramPercentile(Histogram, 0.50);
+		Summary->P90Us = BenchHistogramPercentile(Histogram, 0.90);
+		Summary->P99Us = BenchHistogramPercentile(Histogram, 0.99);
+		Summary->P999Us = BenchHistogramPercentile(Histogram, 0.999);
+		Summary->MaxUs = Histogram->MaxNs / 1000.0;
+	}
+}
+
+// Op󣬼¼ʱ
+BOOLEAN
+BenchIssue(
+	IN HANDLE hChannel,
+	IN OUT PBENCH_OP Op,
+	IN ULONG Length
+)
+{
+	BOOL ok;
+
+	QueryPerformanceCounter(&Op->Issued);
+
+	if (Op->Reading) {
+		ok = ReadFile(hChannel, Op->Buffer, Length, NULL, &Op->Ov);
+	}
+	else {
+		ok = WriteFile(hChannel, Op->Buffer, Length, NULL, &Op->Ov);
+	}
+
+	if (!ok && GetLastError() != ERROR_IO_PENDING) {
+		printf("%s failed %d\n", Op->Reading ? "ReadFile" : "WriteFile", GetLastError());
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+// SlotͬʱдͶPendingΪλù
+BOOLEAN
+BenchIssueSlot(
+	IN HANDLE hChannel,
+	IN OUT PBENCH_SLOT Slot,
+	IN ULONG Length,
+	IN OUT PULONG Pending
+)
+{
+	if (!BenchIssue(hChannel, &Slot->Write, Length)) {
+		return FALSE;
+	}
+
+	Slot->Pending++;
+	(*Pending)++;
+
+	if (!BenchIssue(hChannel, &Slot->Read, Length)) {
+		return FALSE;
+	}
+
+	Slot->Pending++;
+	(*Pending)++;
+
+	return TRUE;
+}
+
+// ȡͨй󣬵ȴȫɣ˺ͷǵĻOVERLAPPED
+// ɶ˿ڲٿʱҲܵȴʱOVERLAPPEDInternalSTATUS_PENDING
+VOID
+BenchDrain(
+	IN HANDLE hChannel,
+	IN PBENCH_SLOT Slots,
+	IN ULONG Depth
+)
+{
+	ULONG i;
+
+	CancelIoEx(hChannel, NULL);
+
+	for (i = 0; i < Depth; i++) {
+		while (!HasOverlappedIoCompleted(&Slots[i].Write.Ov) || !HasOverlappedIoCompleted(&Slots[i].Read.Ov)) {
+			Sleep(1);
+		}
+	}
+}
+
+// ˽ͨϱConfig->DepthдÿдConfig->Lengthֽڲͬʱأظ
+// ԤȽ󡢲ǰɵдȫӳٷֲٷ󣬵ȴ
+// ʱȡ󣬵ȫɺͷŻ
+BOOLEAN
+RunBenchmark(
+	IN PBENCH_CONFIG Config,
+	OUT BENCH_HISTOGRAM Histograms[BENCH_RESULTS]
+)
+{
+	HANDLE hChannel;
+	HANDLE hCompletionPort = NULL;
+	PBENCH_SLOT slots;
+	PUCHAR buffers;
+	PBENCH_OP op;
+	ECHO_READ_WAIT readWait;
+	OVERLAPPED ov;
+	OVERLAPPED* completedOv;
+	LARGE_INTEGER frequency, now, measureStart, measureEnd;
+	ULONG_PTR key;
+	ULONG numberOfBytesTransferred;
+	ULONG bytesReturned;
+	ULONG pending = 0;
+	ULONG64 latencyNs;
+	double nsPerTick;
+	BOOL ok;
+	ULONG i;
+	BOOLEAN result = FALSE;
+
+	hChannel = OpenPrivateChannel();
+	if (hChannel == INVALID_HANDLE_VALUE) {
+		return FALSE;
+	}
+
+	slots = (PBENCH_SLOT)calloc(Config->Depth, sizeof(BENCH_SLOT));
+	buffers = (PUCHAR)malloc((SIZE_T)Config->Depth * 2 * Config->Length);
+
+	if (slots == NULL || buffers == NULL) {
+		printf("Could not allocate %d buffers of %d bytes\n", Config->Depth * 2, Config->Length);
+		goto exit;
+	}
+
+	// ȴڹɶ˿֮ǰã¼ȴ
+	// дͬʱݵеȴд
+	ZeroMemory(&ov, sizeof(ov));
+	ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (ov.hEvent == NULL) {
+		printf("CreateEvent failed %d\n", GetLastError());
+		goto exit;
+	}
+
+	readWait.Enable = 1;
+	readWait.TimeoutMs = 0;
+
+	if ((!DeviceIoControl(hChannel, IOCTL_ECHO_SET_READ_WAIT, &readWait, sizeof(readWait), NULL, 0, NULL, &ov) &&
+		GetLastError() != ERROR_IO_PENDING) ||
+		!GetOverlappedResult(hChannel, &ov, &bytesReturned, TRUE)) {
+
+		printf("IOCTL_ECHO_SET_READ_WAIT failed: Error %d\n", GetLastError());
+		CloseHandle(ov.hEvent);
+		goto exit;
+	}
+
+	CloseHandle(ov.hEvent);
+
+	hCompletionPort = CreateIoCompletionPort(hChannel, NULL, 1, 0);
+	if (hCompletionPort == NULL) {
+		printf("Cannot open completion port %d \n", GetLastError());
+		goto exit;
+	}
+
+	QueryPerformanceFrequency(&frequency);
+	nsPerTick = 1e9 / frequency.QuadPart;
+
+	QueryPerformanceCounter(&now);
+	measureStart.QuadPart = now.QuadPart + Config->WarmupSeconds * frequency.QuadPart;
+	measureEnd.QuadPart = measureStart.QuadPart + Config->Seconds * frequency.QuadPart;
+
+	result = TRUE;
+
+	for (i = 0; i < Config->Depth; i++) {
+
+		slots[i].Write.Slot = &slots[i];
+		slots[i].Write.Reading = FALSE;
+		slots[i].Write.Buffer = buffers + (SIZE_T)i * 2 * Config->Length;
+		slots[i].Read.Slot = &slots[i];
+		slots[i].Read.Reading = TRUE;
+		slots[i].Read.Buffer = slots[i].Write.Buffer + Config->Length;
+		FillMemory(slots[i].Write.Buffer, Config->Length, (UCHAR)i);
+
+		if (!BenchIssueSlot(hChannel, &slots[i], Config->Length, &pending)) {
+			result = FALSE;
+			break;
+		}
+	}
+
+	// ȡ㿽ģʽûԶд󲻻Լ
+	if (!result) {
+		CancelIoEx(hChannel, NULL);
+	}
+
+	// ٷֻȴ
+	while (pending != 0) {
+
+		ok = GetQueuedCompletionStatus(hCompletionPort, &numberOfBytesTransferred, &key, &completedOv, INFINITE);
+		if (!ok && completedOv == NULL) {
+			printf("GetQueuedCompletionStatus failed %d\n", GetLastError());
+			result = FALSE;
+			break;
+		}
+
+		QueryPerformanceCounter(&now);
+		pending--;
+
+		op = CONTAINING_RECORD(completedOv, BENCH_OP, Ov);
+		op->Slot->Pending--;
+
+		if (!ok || numberOfBytesTransferred != Config->Length) {
+			if (result) {
+				printf("%s transferred %d bytes: Error %d\n",
+					op->Reading ? "Read" : "Write", numberOfBytesTransferred, ok ? 0 : GetLastError());
+				CancelIoEx(hChannel, NULL);
+			}
+			result = FALSE;
+			continue;
+		}
+
+		if (now.QuadPart >= measureStart.QuadPart && now.QuadPart < measureEnd.QuadPart) {
+			latencyNs = (ULONG64)((now.QuadPart - op->Issued.QuadPart) * nsPerTick);
+			BenchHistogramRecord(&Histograms[op->Reading ? BENCH_READ : BENCH_WRITE], latencyNs);
+			BenchHistogramRecord(&Histograms[BENCH_ALL], latencyNs);
+		}
+
+		if (!result || op->Slot->Pending != 0 || now.QuadPart >= measureEnd.QuadPart) {
+			continue;
+		}
+
+		if (!BenchIssueSlot(hChannel, op->Slot, Config->Length, &pending)) {
+			CancelIoEx(hChannel, NULL);
+			result = FALSE;
+			continue;
+		}
+	}
+
+	// ɶ˿ڳʱȡȴɺͷŻ
+	if (pending != 0) {
+		BenchDrain(hChannel, slots, Config->Depth);
+	}
+
+exit:
+	CloseHandle(hChannel);
+
+	if (hCompletionPort != NULL) {
+		CloseHandle(hCompletionPort);
+	}
+
+	free(buffers);
+	free(slots);
+
+	return result;
+}
+
+// ׷CSVÿһУļΪʱдͷ
+BOOLEAN
+WriteBenchCsv(
+	IN PBENCH_CONFIG Config,
+	IN BENCH_SUMMARY Summaries[BENCH_RESULTS]
+)
+{
+	FILE* file;
+	ULONG i;
+
+	if (fopen_s(&file, Config->CsvPath, "a") != 0 || file == NULL) {
+		printf("Cannot open %s\n", Config->CsvPath);
+		return FALSE;
+	}
+
+	fseek(file, 0, SEEK_END);
+	if (ftell(file) == 0) {
+		fprintf(file, "depth,size,seconds,warmup,type,requests,iops,mbps,mean_us,p50_us,p90_us,p99_us,p999_us,max_us\n");
+	}
+
+	for (i = 0; i < BENCH_RESULTS; i++) {
+		fprintf(file, "%u,%u,%u,%u,%s,%llu,%.0f,%.2f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+			Config->Depth, Config->Length, Config->Seconds, Config->WarmupSeconds, BenchResultNames[i],
+			Summaries[i].Requests, Summaries[i].Iops, Summaries[i].MegabytesPerSecond, Summaries[i].MeanUs,
+			Summaries[i].P50Us, Summaries[i].P90Us, Summaries[i].P99Us, Summaries[i].P999Us, Summaries[i].MaxUs);
+	}
+
+	fclose(file);
+
+	return TRUE;
+}
+
+// дJSONԭļ
+BOOLEAN
+WriteBenchJson(
+	IN PBENCH_CONFIG Config,
+	IN BENCH_SUMMARY Summaries[BENCH_RESULTS]
+)
+{
+	FILE* file;
+	ULONG i;
+
+	if (fopen_s(&file, Config->JsonPath, "w") != 0 || file == NULL) {
+		printf("Cannot open %s\n", Config->JsonPath);
+		return FALSE;
+	}
+
+	fprintf(file, "{\n  \"depth\": %u,\n  \"size\": %u,\n  \"seconds\": %u,\n  \"warmup\": %u,\n",
+		Config->Depth, Config->Length, Config->Seconds, Config->WarmupSeconds);
+
+	for (i = 0; i < BENCH_RESULTS; i++) {
+		fprintf(file, "  \"%s\": { \"requests\": %llu, \"iops\": %.0f, \"mbps\": %.2f, \"mean_us\": %.1f, "
+			"\"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f, \"max_us\": %.1f }%s\n",
+			BenchResultNames[i], Summaries[i].Requests, Summaries[i].Iops, Summaries[i].MegabytesPerSecond,
+			Summaries[i].MeanUs, Summaries[i].P50Us, Summaries[i].P90Us, Summaries[i].P99Us, Summaries[i].P999Us,
+			Summaries[i].MaxUs, (i + 1 < BENCH_RESULTS) ? "," : "");
+	}
+
+	fprintf(file, "}\n");
+	fclose(file);
+
+	return TRUE;
+}
+
+// name=valuedepthsizesecondswarmupcsvjsonӳٻ׼ԣӡÿĽ
+// ޸豸ɲԡӳģ͵ã豸ǰµı֣ÿMB/sʱ㣬д
+BOOLEAN
+PerformBenchmark(
+	IN HANDLE hDevice,
+	IN int Argc,
+	IN char* Argv[]
+)
+{
+	BENCH_CONFIG config;
+	BENCH_SUMMARY summaries[BENCH_RESULTS];
+	PBENCH_HISTOGRAM histograms;
+	ECHO_COMPLETION_POLICY policy;
+	ECHO_PARAMETERS parameters;
+	ULONG bytesReturned;
+	char* value;
+	ULONG i;
+	BOOLEAN result;
+
+	ZeroMemory(&config, sizeof(config));
+	config.Depth = BENCH_DEFAULT_DEPTH;
+	config.Length = BENCH_DEFAULT_LENGTH;
+	config.Seconds = BENCH_DEFAULT_SECONDS;
+	config.WarmupSeconds = BENCH_DEFAULT_WARMUP_SECONDS;
+
+	for (i = 0; i < (ULONG)Argc; i++) {
+
+		value = strchr(Argv[i], '=');
+		if (value == NULL) {
+			printf("Expected name=value, got %s\n", Argv[i]);
+			return FALSE;
+		}
+
+		*value++ = '\0';
+
+		if (!_stricmp(Argv[i], "depth")) {
+			config.Depth = strtoul(value, NULL, 0);
+		}
+		else if (!_stricmp(Argv[i], "size")) {
+			config.Length = strtoul(value, NULL, 0);
+		}
+		else if (!_stricmp(Argv[i], "seconds")) {
+			config.Seconds = strtoul(value, NULL, 0);
+		}
+		else if (!_stricmp(Argv[i], "warmup")) {
+			config.WarmupSeconds = strtoul(value, NULL, 0);
+		}
+		else if (!_stricmp(Argv[i], "csv")) {
+			config.CsvPath = value;
+		}
+		else if (!_stricmp(Argv[i], "json")) {
+			config.JsonPath = value;
+		}
+		else {
+			printf("Unknown option %s\n", Argv[i]);
+			return FALSE;
+		}
+	}
+
+	if (!DeviceIoControl(hDevice, IOCTL_ECHO_GET_COMPLETION_POLICY, NULL, 0, &policy, sizeof(policy), &bytesReturned, NULL) ||
+		!DeviceIoControl(hDevice, IOCTL_ECHO_GET_PARAMETERS, NULL, 0, &parameters, sizeof(parameters), &bytesReturned, NULL)) {
+		printf("Reading the device settings failed: Error %d\n", GetLastError());
+		return FALSE;
+	}
+
+	if (config.Depth == 0 || config.Depth > BENCH_MAX_DEPTH ||
+		config.Length == 0 || config.Length > parameters.MaxWriteLength ||
+		config.Seconds == 0) {
+
+		printf("depth must be 1 to %d, size 1 to %d (MaxWriteLength), seconds at least 1\n",
+			BENCH_MAX_DEPTH, parameters.MaxWriteLength);
+		return FALSE;
+	}
+
+	histograms = (PBENCH_HISTOGRAM)calloc(BENCH_RESULTS, sizeof(BENCH_HISTOGRAM));
+	if (histograms == NULL) {
+		printf("Could not allocate the latency histograms\n");
+		return FALSE;
+	}
+
+	printf("Benchmark: depth %d, %d bytes, %d s after %d s warmup, completion mode %d\n",
+		config.Depth, config.Length, config.Seconds, config.WarmupSeconds, policy.Mode);
+
+	result = RunBenchmark(&config, histograms);
+
+	if (result) {
+
+		for (i = 0; i < BENCH_RESULTS; i++) {
+
+			BenchSummarize(&histograms[i], &config, &summaries[i]);
+
+			printf("%-5s %10.0f IOPS %9.2f MB/s  mean %9.1f  p50 %9.1f  p90 %9.1f  p99 %9.1f  p99.9 %9.1f  max %9.1f us\n",
+				BenchResultNames[i], summaries[i].Iops, summaries[i].MegabytesPerSecond, summaries[i].MeanUs,
+				summaries[i].P50Us, summaries[i].P90Us, summaries[i].P99Us, summaries[i].P999Us, summaries[i].MaxUs);
+		}
+
+		if (config.CsvPath != NULL && !WriteBenchCsv(&config, summaries)) {
+			result = FALSE;
+		}
+
+		if (config.JsonPath != NULL && !WriteBenchJson(&config, summaries)) {
+			result = FALSE;
+		}
+	}
+
+	free(histograms);
+
+	return result;
+}
+
 ULONG
 AsyncIo(
 	PVOID  ThreadParameter